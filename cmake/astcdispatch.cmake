@@ -0,0 +1,113 @@
+# Copyright 2023 The Khronos Group Inc.
+# SPDX-License-Identifier: Apache-2.0
+
+# Build the astcenc core for each of the SSE2, SSE4.1 and AVX2 ISAs and
+# combine the copies into one static library, astcenc-dispatch-static.
+# lib/astcenc_dispatch.cpp picks the copy to use at run time.
+#
+# Each ISA is a separate object library, astcenc-dispatch-<isa>-obj, built
+# with hidden visibility from wrapper sources generated from
+# lib/astcenc_dispatch_isa.cpp.in. The wrappers put each copy in its own
+# namespace, ktx_astcenc_<isa>, so the copies do not clash at link time.
+#
+# The ISA is not selected with compiler options such as -mavx2. Those would
+# also apply to the inline and template code of the C++ standard library,
+# which is included outside the namespace and emitted as weak symbols
+# shared by all copies. The linker could then keep an AVX2 build of, say,
+# std::vector code and call it from the SSE2 copy. Instead the wrappers
+# enable the ISA with a target pragma that covers only the namespace, so
+# shared code is always built for the x86_64 baseline.
+
+set(ASTCENC_DISPATCH_CORE_SOURCES
+    averages_and_directions
+    block_sizes
+    color_quantize
+    color_unquantize
+    compress_symbolic
+    compute_variance
+    decompress_symbolic
+    entry
+    find_best_partitioning
+    ideal_endpoints_and_weights
+    image
+    integer_sequence
+    mathlib
+    mathlib_softfloat
+    partition_tables
+    percentile_tables
+    pick_best_endpoint_format
+    platform_isa_detection
+    quantization
+    symbolic_physical
+    weight_align
+    weight_quant_xfer_tables
+)
+
+set(ASTCENC_DISPATCH_ISAS sse2 sse4.1 avx2)
+
+# Settings matching those of astcenc's own per-ISA library targets.
+set(ASTCENC_DISPATCH_sse2_DEFS
+    ASTCENC_NEON=0 ASTCENC_SSE=20 ASTCENC_AVX=0
+    ASTCENC_POPCNT=0 ASTCENC_F16C=0)
+set(ASTCENC_DISPATCH_sse4.1_DEFS
+    ASTCENC_NEON=0 ASTCENC_SSE=41 ASTCENC_AVX=0
+    ASTCENC_POPCNT=1 ASTCENC_F16C=0)
+set(ASTCENC_DISPATCH_avx2_DEFS
+    ASTCENC_NEON=0 ASTCENC_SSE=41 ASTCENC_AVX=2
+    ASTCENC_POPCNT=1 ASTCENC_F16C=1)
+# Argument of the target pragma. MSVC needs no equivalent as it allows
+# intrinsics of any ISA without /arch.
+set(ASTCENC_DISPATCH_sse2_TARGET "sse2")
+set(ASTCENC_DISPATCH_sse4.1_TARGET "sse4.1,popcnt")
+set(ASTCENC_DISPATCH_avx2_TARGET "avx2,popcnt,f16c")
+
+set(ASTCENC_DISPATCH_OBJECTS)
+foreach(ASTCENC_DISPATCH_ISA ${ASTCENC_DISPATCH_ISAS})
+    string(REPLACE "." "" ASTCENC_DISPATCH_NAMESPACE ${ASTCENC_DISPATCH_ISA})
+    set(ASTCENC_DISPATCH_TARGET
+        ${ASTCENC_DISPATCH_${ASTCENC_DISPATCH_ISA}_TARGET})
+    set(isa_dir ${CMAKE_CURRENT_BINARY_DIR}/astcenc_dispatch/${ASTCENC_DISPATCH_NAMESPACE})
+
+    set(isa_src)
+    foreach(core_src ${ASTCENC_DISPATCH_CORE_SOURCES})
+        set(ASTCENC_DISPATCH_SOURCE
+            ${CMAKE_CURRENT_SOURCE_DIR}/lib/astc-encoder/Source/astcenc_${core_src}.cpp)
+        configure_file(lib/astcenc_dispatch_isa.cpp.in
+                       ${isa_dir}/astcenc_${core_src}.cpp @ONLY)
+        list(APPEND isa_src ${isa_dir}/astcenc_${core_src}.cpp)
+    endforeach()
+    set(ASTCENC_DISPATCH_SOURCE
+        ${CMAKE_CURRENT_SOURCE_DIR}/lib/astcenc_dispatch_funcs.inl)
+    configure_file(lib/astcenc_dispatch_isa.cpp.in
+                   ${isa_dir}/astcenc_dispatch_funcs.cpp @ONLY)
+    list(APPEND isa_src ${isa_dir}/astcenc_dispatch_funcs.cpp)
+
+    set(isa_target astcenc-dispatch-${ASTCENC_DISPATCH_NAMESPACE}-obj)
+    add_library(${isa_target} OBJECT ${isa_src})
+    target_compile_features(${isa_target} PRIVATE cxx_std_14)
+    target_compile_definitions(${isa_target}
+    PRIVATE
+        ${ASTCENC_DISPATCH_${ASTCENC_DISPATCH_ISA}_DEFS}
+    )
+    target_include_directories(${isa_target}
+    PRIVATE
+        ${CMAKE_CURRENT_SOURCE_DIR}/lib
+    )
+    set_target_properties(${isa_target} PROPERTIES
+        CXX_VISIBILITY_PRESET hidden
+        VISIBILITY_INLINES_HIDDEN ON
+        POSITION_INDEPENDENT_CODE ON
+    )
+    if(MSVC)
+        target_compile_definitions(${isa_target}
+            PRIVATE _CRT_SECURE_NO_WARNINGS)
+        target_compile_options(${isa_target}
+            PRIVATE /EHsc /fp:strict /wd4324)
+    endif()
+    list(APPEND ASTCENC_DISPATCH_OBJECTS $<TARGET_OBJECTS:${isa_target}>)
+endforeach()
+
+add_library(astcenc-dispatch-static STATIC ${ASTCENC_DISPATCH_OBJECTS})
+set_target_properties(astcenc-dispatch-static PROPERTIES
+    LINKER_LANGUAGE CXX
+)
@@ -764,9 +764,16 @@ enum ktxTextureCreateFlagBits {
     KTX_TEXTURE_CREATE_RAW_KVDATA_BIT = 0x02,
                                    /*!< Load the raw key-value data instead of
                                         creating a @c ktxHashList from it. */
-    KTX_TEXTURE_CREATE_SKIP_KVDATA_BIT = 0x04
+    KTX_TEXTURE_CREATE_SKIP_KVDATA_BIT = 0x04,
                                    /*!< Skip any key-value data. This overrides
                                         the RAW_KVDATA_BIT. */
+    KTX_TEXTURE_CREATE_MMAP_BIT = 0x08
+                                   /*!< Map the file into memory instead of
+                                        reading it. KTX2 image data that needs
+                                        no inflation or byte swapping is used
+                                        in place, without copying. Only used
+                                        by the CreateFromNamedFile
+                                        functions. */
 };
 /**
  * @memberof ktxTexture
@@ -949,6 +956,17 @@ ktxTexture_GLUpload(ktxTexture* This, GLuint* pTexture, GLenum* pTarget,
 KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture_IterateLevelFaces(ktxTexture* This, PFNKTXITERCB iterCb,
                              void* userdata);
+
+/*
+ * Decodes an image of a KTX or KTX2 texture in an ETC1, ETC2 or EAC format.
+ * ETC1 and ETC2 images decode to 8-bit RGBA. EAC R11 and RG11 images decode
+ * to 16-bit R and RG respectively, not to RGBA.
+ */
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture_DecodeEtcImage(ktxTexture* This, ktx_uint32_t level,
+                          ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                          ktx_uint8_t* pDst, ktx_size_t dstSize,
+                          ktx_uint32_t dstRowPitch, ktx_uint32_t threadCount);
 /*
  * Create a new ktxTexture1.
  */
@@ -1008,6 +1026,24 @@ ktxTexture1_WriteKTX2ToMemory(ktxTexture1* This,
 KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture1_WriteKTX2ToStream(ktxTexture1* This, ktxStream *dststr);
 
+/**
+ * @class ktxThreadPool
+ * @~English
+ * @brief Opaque handle to a pool of worker threads.
+ *
+ * A pool can be given to libktx's encoding, transcoding and supercompression
+ * functions in place of a thread count so that many calls, including
+ * concurrent calls from different application threads, share a bounded set
+ * of threads.
+ */
+typedef struct ktxThreadPool ktxThreadPool;
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxThreadPool_Create(ktx_uint32_t threadCount, ktxThreadPool** newPool);
+
+KTX_API void KTX_APIENTRY
+ktxThreadPool_Destroy(ktxThreadPool* pool);
+
 /*
  * Create a new ktxTexture2.
  */
@@ -1051,6 +1087,31 @@ ktxTexture2_CompressBasis(ktxTexture2* This, ktx_uint32_t quality);
 KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture2_DeflateZstd(ktxTexture2* This, ktx_uint32_t level);
 
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_DeflateZstdEx(ktxTexture2* This, ktx_uint32_t level,
+                          ktx_uint32_t threadCount);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_DeflateZstdWithPool(ktxTexture2* This, ktx_uint32_t level,
+                                ktxThreadPool* pool);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_LoadImageDataEx(ktxTexture2* This,
+                            ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                            ktx_uint32_t threadCount);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_LoadImageDataWithPool(ktxTexture2* This,
+                                  ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                                  ktxThreadPool* pool);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_LoadLevel(ktxTexture2* This, ktx_uint32_t level,
+                      ktx_uint8_t* pBuffer, ktx_size_t bufSize);
+
+KTX_API ktx_size_t KTX_APIENTRY
+ktxTexture2_GetLevelSizeUncompressed(ktxTexture2* This, ktx_uint32_t level);
+
 KTX_API void KTX_APIENTRY
 ktxTexture2_GetComponentInfo(ktxTexture2* This, ktx_uint32_t* numComponents,
                              ktx_uint32_t* componentByteLength);
@@ -1190,6 +1251,7 @@ typedef struct ktxAstcParams {
 
     ktx_uint32_t threadCount;
         /*!< Number of threads used for compression. Default is 1.
+             Ignored if threadPool is not @c NULL.
          */
 
     /* astcenc params */
@@ -1224,6 +1286,12 @@ typedef struct ktxAstcParams {
          /*!< A swizzle to provide as input to astcenc. It must match the regular
              expression /^[rgba01]{4}$/.
           */
+
+    ktxThreadPool* threadPool;
+        /*!< If not @c NULL, compression runs on the threads of this pool,
+             shared with any other concurrent users of the pool, instead
+             of on threadCount new threads.
+         */
 } ktxAstcParams;
 
 KTX_API KTX_error_code KTX_APIENTRY
@@ -1232,6 +1300,46 @@ ktxTexture2_CompressAstcEx(ktxTexture2* This, ktxAstcParams* params);
 KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture2_CompressAstc(ktxTexture2* This, ktx_uint32_t quality);
 
+/**
+ * @~English
+ * @brief Filters for resampling images in ktxTexture2_GenerateMipmaps().
+ */
+typedef enum ktx_mipmap_filter_e {
+    KTX_MIPMAP_FILTER_BOX,      /*!< Box filter. */
+    KTX_MIPMAP_FILTER_TENT,     /*!< Tent (bilinear) filter. */
+    KTX_MIPMAP_FILTER_MITCHELL, /*!< Mitchell-Netravali filter, B = C = 1/3. */
+    KTX_MIPMAP_FILTER_LANCZOS3, /*!< Lanczos filter with 3 lobes. */
+    KTX_MIPMAP_FILTER_LANCZOS4  /*!< Lanczos filter with 4 lobes. */
+} ktx_mipmap_filter_e;
+
+/**
+ * @~English
+ * @brief Flags guiding mipmap generation by ktxTexture2_GenerateMipmaps().
+ */
+typedef enum ktx_mipmap_flag_bits_e {
+    KTX_MIPMAP_WRAP_BIT = 1,
+        /*!< Wrap around the image edges when sampling beyond them instead of
+             clamping to the edge. Use for tiling textures.
+         */
+    KTX_MIPMAP_CASCADE_BIT = 2,
+        /*!< Generate each level from the previous level instead of from the
+             base level. Faster but lower quality.
+         */
+    KTX_MIPMAP_LINEAR_BIT = 4,
+        /*!< Filter the images of sRGB formats without first converting them
+             to linear.
+         */
+} ktx_mipmap_flag_bits_e;
+typedef ktx_uint32_t ktx_mipmap_flags;
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_GenerateMipmaps(ktxTexture2* This, ktx_mipmap_filter_e filter,
+                            ktx_mipmap_flags flags, ktx_uint32_t threadCount);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_Decompress(ktxTexture2* This, ktx_uint32_t targetVkFormat,
+                       ktx_uint32_t threadCount);
+
 /**
  * @memberof ktxTexture2
  * @~English
@@ -1265,7 +1373,8 @@ typedef struct ktxBasisParams {
         /*!< True to forbid use of the SSE instruction set. Ignored if CPU
              does not support SSE. */
     ktx_uint32_t threadCount;
-        /*!< Number of threads used for compression. Default is 1. */
+        /*!< Number of threads used for compression. Default is 1.
+             Ignored if threadPool is not @c NULL. */
 
     /* ETC1S params */
 
@@ -1390,6 +1499,11 @@ typedef struct ktxBasisParams {
              deterministic).
          */
 
+    ktxThreadPool* threadPool;
+        /*!< If not @c NULL, compression runs on the threads of this pool,
+             shared with any other concurrent users of the pool, instead
+             of on threadCount new threads.
+         */
 } ktxBasisParams;
 
 KTX_API KTX_error_code KTX_APIENTRY
@@ -1564,6 +1678,48 @@ KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture2_TranscodeBasis(ktxTexture2* This, ktx_transcode_fmt_e fmt,
                            ktx_transcode_flags transcodeFlags);
 
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_TranscodeBasisEx(ktxTexture2* This, ktx_transcode_fmt_e fmt,
+                             ktx_transcode_flags transcodeFlags,
+                             ktx_uint32_t threadCount);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_TranscodeBasisWithPool(ktxTexture2* This, ktx_transcode_fmt_e fmt,
+                                   ktx_transcode_flags transcodeFlags,
+                                   ktxThreadPool* pool);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_GetTranscodedImageSize(ktxTexture2* This, ktx_uint32_t level,
+                                   ktx_transcode_fmt_e fmt,
+                                   ktx_transcode_flags transcodeFlags,
+                                   ktx_size_t* pSize);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_TranscodeBasisImage(ktxTexture2* This, ktx_uint32_t level,
+                                ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                                ktx_transcode_fmt_e fmt,
+                                ktx_transcode_flags transcodeFlags,
+                                ktx_uint8_t* pDst, ktx_size_t dstSize,
+                                ktx_uint32_t dstRowPitch);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_TranscodeBasisMulti(ktxTexture2* This, ktx_uint32_t numTargets,
+                                const ktx_transcode_fmt_e* outputFormats,
+                                ktx_transcode_flags transcodeFlags,
+                                ktx_uint32_t threadCount,
+                                ktxTexture2** outputs);
+
+/*
+ * Decodes an image of a KTX2 texture in an ETC2 or EAC format. ETC2 images
+ * decode to 8-bit RGBA. EAC R11 and RG11 images decode to 16-bit R and RG
+ * respectively, not to RGBA.
+ */
+KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture2_DecodeEtcImage(ktxTexture2* This, ktx_uint32_t level,
+                           ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                           ktx_uint8_t* pDst, ktx_size_t dstSize,
+                           ktx_uint32_t dstRowPitch, ktx_uint32_t threadCount);
+
 /*
  * Returns a string corresponding to a KTX error code.
  */
@@ -1673,6 +1829,186 @@ KTX_API KTX_error_code KTX_APIENTRY ktxPrintInfoForStdioStream(FILE* stdioStream
 KTX_API KTX_error_code KTX_APIENTRY ktxPrintInfoForNamedFile(const char* const filename);
 KTX_API KTX_error_code KTX_APIENTRY ktxPrintInfoForMemory(const ktx_uint8_t* bytes, ktx_size_t size);
 
+/*===========================================================*
+ * Validation of a KTX 2 file.                               *
+ *===========================================================*/
+
+/**
+ * @~English
+ * @brief Severity of an issue found by ktxValidateMemory().
+ */
+typedef enum ktxValidationSeverity {
+    KTX_VALIDATION_WARNING = 0,
+        /*!< The file goes against a recommendation of the specification. */
+    KTX_VALIDATION_ERROR = 1,
+        /*!< The file breaks a requirement of the specification. */
+    KTX_VALIDATION_FATAL = 2
+        /*!< The file cannot be validated any further. */
+} ktxValidationSeverity;
+
+/**
+ * @~English
+ * @brief Codes identifying the issues found by ktxValidateMemory().
+ *
+ * Each code is the issue's severity bit ORed with a number unique to the
+ * issue. The severity bit always matches the @c ktxValidationSeverity with
+ * which the issue is reported. Use @c KTX_ISSUE_NUMBER_MASK and
+ * @c KTX_ISSUE_SEVERITY_MASK to separate them. The @c KTX_ISSUE_IO_* codes
+ * are for validators reading from a file or stream. ktxValidateMemory()
+ * reports only @c KTX_ISSUE_IO_UNEXPECTED_EOF of them.
+ */
+typedef enum ktxValidationIssue {
+    KTX_ISSUE_WARNING_BIT = 0x00010000,
+        /*!< Set in the codes of issues reported as KTX_VALIDATION_WARNING. */
+    KTX_ISSUE_ERROR_BIT = 0x00100000,
+        /*!< Set in the codes of issues reported as KTX_VALIDATION_ERROR. */
+    KTX_ISSUE_FATAL_BIT = 0x01000000,
+        /*!< Set in the codes of issues reported as KTX_VALIDATION_FATAL. */
+    KTX_ISSUE_SEVERITY_MASK = 0x01110000,
+        /*!< Mask selecting the severity bit of an issue code. */
+    KTX_ISSUE_NUMBER_MASK = 0x0000ffff,
+        /*!< Mask selecting the issue number of an issue code. */
+
+    KTX_ISSUE_IO_FILE_OPEN = KTX_ISSUE_FATAL_BIT | 0x0001,
+    KTX_ISSUE_IO_FILE_READ = KTX_ISSUE_FATAL_BIT | 0x0002,
+    KTX_ISSUE_IO_UNEXPECTED_EOF = KTX_ISSUE_FATAL_BIT | 0x0003,
+    KTX_ISSUE_IO_REWIND_FAILURE = KTX_ISSUE_FATAL_BIT | 0x0004,
+    KTX_ISSUE_IO_FILE_SEEK_END_FAILURE = KTX_ISSUE_FATAL_BIT | 0x0005,
+    KTX_ISSUE_IO_FILE_TELL_FAILURE = KTX_ISSUE_FATAL_BIT | 0x0006,
+
+    KTX_ISSUE_FILE_NOT_KTX2 = KTX_ISSUE_FATAL_BIT | 0x0010,
+    KTX_ISSUE_FILE_CREATE_FAILURE = KTX_ISSUE_ERROR_BIT | 0x0011,
+    KTX_ISSUE_FILE_INCORRECT_DATA_SIZE = KTX_ISSUE_ERROR_BIT | 0x0012,
+
+    KTX_ISSUE_HEADER_PROHIBITED_FORMAT = KTX_ISSUE_ERROR_BIT | 0x0020,
+    KTX_ISSUE_HEADER_INVALID_FORMAT = KTX_ISSUE_ERROR_BIT | 0x0021,
+    KTX_ISSUE_HEADER_UNKNOWN_FORMAT = KTX_ISSUE_ERROR_BIT | 0x0022,
+    KTX_ISSUE_HEADER_WIDTH_ZERO = KTX_ISSUE_ERROR_BIT | 0x0023,
+    KTX_ISSUE_HEADER_DEPTH_NO_HEIGHT = KTX_ISSUE_ERROR_BIT | 0x0024,
+    KTX_ISSUE_HEADER_3D_ARRAY = KTX_ISSUE_WARNING_BIT | 0x0025,
+    KTX_ISSUE_HEADER_CUBE_FACE_NOT_2D = KTX_ISSUE_ERROR_BIT | 0x0026,
+    KTX_ISSUE_HEADER_INVALID_FACE_COUNT = KTX_ISSUE_ERROR_BIT | 0x0027,
+    KTX_ISSUE_HEADER_TOO_MANY_MIP_LEVELS = KTX_ISSUE_ERROR_BIT | 0x0028,
+    KTX_ISSUE_HEADER_VENDOR_SUPERCOMPRESSION = KTX_ISSUE_WARNING_BIT | 0x0029,
+    KTX_ISSUE_HEADER_INVALID_SUPERCOMPRESSION = KTX_ISSUE_ERROR_BIT | 0x002a,
+    KTX_ISSUE_HEADER_INVALID_OPTIONAL_INDEX_ENTRY = KTX_ISSUE_ERROR_BIT | 0x002b,
+    KTX_ISSUE_HEADER_INVALID_REQUIRED_INDEX_ENTRY = KTX_ISSUE_ERROR_BIT | 0x002c,
+    KTX_ISSUE_HEADER_INVALID_DFD_OFFSET = KTX_ISSUE_ERROR_BIT | 0x002d,
+    KTX_ISSUE_HEADER_INVALID_KVD_OFFSET = KTX_ISSUE_ERROR_BIT | 0x002e,
+    KTX_ISSUE_HEADER_INVALID_SGD_OFFSET = KTX_ISSUE_ERROR_BIT | 0x002f,
+    KTX_ISSUE_HEADER_TYPE_SIZE_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x0030,
+    KTX_ISSUE_HEADER_VKFORMAT_AND_BASIS = KTX_ISSUE_ERROR_BIT | 0x0031,
+    KTX_ISSUE_HEADER_TYPE_SIZE_NOT_ONE = KTX_ISSUE_ERROR_BIT | 0x0032,
+    KTX_ISSUE_HEADER_ZERO_LEVEL_COUNT_FOR_BC = KTX_ISSUE_ERROR_BIT | 0x0033,
+
+    KTX_ISSUE_VALIDATOR_CREATE_DFD_FAILURE = KTX_ISSUE_FATAL_BIT | 0x0040,
+    KTX_ISSUE_VALIDATOR_INCORRECT_DFD = KTX_ISSUE_ERROR_BIT | 0x0041,
+    KTX_ISSUE_VALIDATOR_DFD_VALIDATION_FAILURE = KTX_ISSUE_ERROR_BIT | 0x0042,
+
+    KTX_ISSUE_DFD_INVALID_TRANSFER_FUNCTION = KTX_ISSUE_ERROR_BIT | 0x0050,
+    KTX_ISSUE_DFD_INCORRECT_BASICS = KTX_ISSUE_ERROR_BIT | 0x0051,
+    KTX_ISSUE_DFD_INCORRECT_MODEL_FOR_BLOCK = KTX_ISSUE_ERROR_BIT | 0x0052,
+    KTX_ISSUE_DFD_MULTIPLE_PLANES = KTX_ISSUE_ERROR_BIT | 0x0053,
+    KTX_ISSUE_DFD_SRGB_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x0054,
+    KTX_ISSUE_DFD_UNSIGNED_FLOAT = KTX_ISSUE_WARNING_BIT | 0x0055,
+    KTX_ISSUE_DFD_FORMAT_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x0056,
+    KTX_ISSUE_DFD_ZERO_SAMPLES = KTX_ISSUE_ERROR_BIT | 0x0057,
+    KTX_ISSUE_DFD_TEXEL_BLOCK_DIMENSION_ZERO_FOR_UNDEFINED = KTX_ISSUE_ERROR_BIT | 0x0058,
+    KTX_ISSUE_DFD_4D_TEXTURES_NOT_SUPPORTED = KTX_ISSUE_ERROR_BIT | 0x0059,
+    KTX_ISSUE_DFD_BYTES_PLANE0_ZERO = KTX_ISSUE_ERROR_BIT | 0x005a,
+    KTX_ISSUE_DFD_MULTIPLANE_FORMATS_NOT_SUPPORTED = KTX_ISSUE_ERROR_BIT | 0x005b,
+    KTX_ISSUE_DFD_INVALID_SAMPLE_COUNT = KTX_ISSUE_ERROR_BIT | 0x005c,
+    KTX_ISSUE_DFD_INCORRECT_MODEL_FOR_BLZE = KTX_ISSUE_ERROR_BIT | 0x005d,
+    KTX_ISSUE_DFD_INVALID_TEXEL_BLOCK_DIMENSION = KTX_ISSUE_ERROR_BIT | 0x005e,
+    KTX_ISSUE_DFD_NOT_UNSIZED = KTX_ISSUE_ERROR_BIT | 0x005f,
+    KTX_ISSUE_DFD_INVALID_CHANNEL_FOR_BLZE = KTX_ISSUE_ERROR_BIT | 0x0060,
+    KTX_ISSUE_DFD_INVALID_BIT_OFFSET_FOR_BLZE = KTX_ISSUE_ERROR_BIT | 0x0061,
+    KTX_ISSUE_DFD_INVALID_BIT_LENGTH = KTX_ISSUE_ERROR_BIT | 0x0062,
+    KTX_ISSUE_DFD_INVALID_LOWER_OR_UPPER = KTX_ISSUE_ERROR_BIT | 0x0063,
+    KTX_ISSUE_DFD_INVALID_CHANNEL_FOR_UASTC = KTX_ISSUE_ERROR_BIT | 0x0064,
+    KTX_ISSUE_DFD_INVALID_BIT_OFFSET_FOR_UASTC = KTX_ISSUE_ERROR_BIT | 0x0065,
+    KTX_ISSUE_DFD_SIZE_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x0066,
+    KTX_ISSUE_DFD_INVALID_COLOR_MODEL = KTX_ISSUE_ERROR_BIT | 0x0067,
+    KTX_ISSUE_DFD_MIXED_CHANNELS = KTX_ISSUE_ERROR_BIT | 0x0068,
+    KTX_ISSUE_DFD_MULTISAMPLE = KTX_ISSUE_ERROR_BIT | 0x0069,
+    KTX_ISSUE_DFD_NON_TRIVIAL_ENDIANNESS = KTX_ISSUE_ERROR_BIT | 0x006a,
+    KTX_ISSUE_DFD_INVALID_PRIMARIES = KTX_ISSUE_ERROR_BIT | 0x006b,
+    KTX_ISSUE_DFD_SAMPLE_COUNT_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x006c,
+    KTX_ISSUE_DFD_BYTES_PLANE0_MISMATCH = KTX_ISSUE_ERROR_BIT | 0x006d,
+    KTX_ISSUE_DFD_INVALID_DESCRIPTOR_BLOCK_SIZE = KTX_ISSUE_ERROR_BIT | 0x006e,
+
+    KTX_ISSUE_LEVEL_INDEX_INCORRECT_BYTE_LENGTH = KTX_ISSUE_ERROR_BIT | 0x0070,
+    KTX_ISSUE_LEVEL_INDEX_BYTE_OFFSET_TOO_SMALL = KTX_ISSUE_ERROR_BIT | 0x0071,
+    KTX_ISSUE_LEVEL_INDEX_INCORRECT_BYTE_OFFSET = KTX_ISSUE_ERROR_BIT | 0x0072,
+    KTX_ISSUE_LEVEL_INDEX_UNALIGNED_OFFSET = KTX_ISSUE_ERROR_BIT | 0x0073,
+    KTX_ISSUE_LEVEL_INDEX_EXTRA_PADDING = KTX_ISSUE_ERROR_BIT | 0x0074,
+    KTX_ISSUE_LEVEL_INDEX_ZERO_OFFSET_OR_LENGTH = KTX_ISSUE_ERROR_BIT | 0x0075,
+    KTX_ISSUE_LEVEL_INDEX_ZERO_UNCOMPRESSED_LENGTH = KTX_ISSUE_ERROR_BIT | 0x0076,
+    KTX_ISSUE_LEVEL_INDEX_INCORRECT_LEVEL_ORDER = KTX_ISSUE_ERROR_BIT | 0x0077,
+
+    KTX_ISSUE_METADATA_MISSING_NUL_TERMINATOR = KTX_ISSUE_ERROR_BIT | 0x0080,
+    KTX_ISSUE_METADATA_FORBIDDEN_BOM1 = KTX_ISSUE_ERROR_BIT | 0x0081,
+    KTX_ISSUE_METADATA_FORBIDDEN_BOM2 = KTX_ISSUE_ERROR_BIT | 0x0082,
+    KTX_ISSUE_METADATA_INVALID_STRUCTURE = KTX_ISSUE_ERROR_BIT | 0x0083,
+    KTX_ISSUE_METADATA_MISSING_FINAL_PADDING = KTX_ISSUE_ERROR_BIT | 0x0084,
+    KTX_ISSUE_METADATA_OUT_OF_ORDER = KTX_ISSUE_ERROR_BIT | 0x0085,
+    KTX_ISSUE_METADATA_CUSTOM_METADATA = KTX_ISSUE_WARNING_BIT | 0x0086,
+    KTX_ISSUE_METADATA_ILLEGAL_METADATA = KTX_ISSUE_ERROR_BIT | 0x0087,
+    KTX_ISSUE_METADATA_VALUE_NOT_NUL_TERMINATED = KTX_ISSUE_WARNING_BIT | 0x0088,
+    KTX_ISSUE_METADATA_INVALID_VALUE = KTX_ISSUE_ERROR_BIT | 0x0089,
+    KTX_ISSUE_METADATA_NO_REQUIRED_KTXWRITER = KTX_ISSUE_ERROR_BIT | 0x008a,
+    KTX_ISSUE_METADATA_MISSING_VALUE = KTX_ISSUE_ERROR_BIT | 0x008b,
+    KTX_ISSUE_METADATA_NOT_ALLOWED = KTX_ISSUE_ERROR_BIT | 0x008c,
+    KTX_ISSUE_METADATA_NO_KTXWRITER = KTX_ISSUE_WARNING_BIT | 0x008f,
+
+    KTX_ISSUE_SGD_UNEXPECTED_SUPERCOMPRESSION_GLOBAL_DATA = KTX_ISSUE_ERROR_BIT | 0x0090,
+    KTX_ISSUE_SGD_MISSING_SUPERCOMPRESSION_GLOBAL_DATA = KTX_ISSUE_ERROR_BIT | 0x0091,
+    KTX_ISSUE_SGD_INVALID_IMAGE_FLAG_BIT = KTX_ISSUE_ERROR_BIT | 0x0092,
+    KTX_ISSUE_SGD_INCORRECT_GLOBAL_DATA_SIZE = KTX_ISSUE_ERROR_BIT | 0x0093,
+    KTX_ISSUE_SGD_EXTENDED_BYTE_LENGTH_NOT_ZERO = KTX_ISSUE_ERROR_BIT | 0x0094,
+    KTX_ISSUE_SGD_DFD_MISMATCH_ALPHA = KTX_ISSUE_ERROR_BIT | 0x0095,
+    KTX_ISSUE_SGD_DFD_MISMATCH_NO_ALPHA = KTX_ISSUE_ERROR_BIT | 0x0096,
+
+    KTX_ISSUE_SYSTEM_OUT_OF_MEMORY = KTX_ISSUE_ERROR_BIT | 0x00a0,
+
+    KTX_ISSUE_TRANSCODE_FAILURE = KTX_ISSUE_ERROR_BIT | 0x0100
+} ktxValidationIssue;
+
+/**
+ * @~English
+ * @brief Flags modifying the checks made by ktxValidateMemory().
+ */
+typedef enum ktxValidateFlagBits {
+    KTX_VALIDATE_TRANSCODE_BIT = 0x01
+        /*!< Create a texture from the file, loading its image data, and,
+             if it is Basis Universal compressed, transcode it. */
+} ktxValidateFlagBits;
+typedef ktx_uint32_t ktxValidateFlags;
+
+/**
+ * @~English
+ * @brief Signature of the function called for each issue found by
+ *        ktxValidateMemory().
+ *
+ * @param [in] severity  severity of the issue.
+ * @param [in] issueCode code identifying the issue, one of the
+ *                       @c ktxValidationIssue values.
+ * @param [in] message   description of the issue. Valid only during the
+ *                       call.
+ * @param [in,out] userdata pointer given to ktxValidateMemory().
+ *
+ * @return @c KTX_TRUE to continue validating, @c KTX_FALSE to stop.
+ */
+typedef ktx_bool_t
+    (* PFNKTXVALIDATECALLBACK)(ktxValidationSeverity severity,
+                               ktx_uint32_t issueCode, const char* message,
+                               void* userdata);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxValidateMemory(const ktx_uint8_t* bytes, ktx_size_t size,
+                  ktxValidateFlags flags, PFNKTXVALIDATECALLBACK callback,
+                  void* userdata);
+
 #ifdef __cplusplus
 }
 #endif
@@ -132,6 +132,37 @@ KTX_API void KTX_APIENTRY
 ktxVulkanTexture_Destruct(ktxVulkanTexture* This, VkDevice device,
                           const VkAllocationCallbacks* pAllocator);
 
+/**
+ * @class ktxVulkanStaging
+ * @~English
+ * @brief Struct for returning the staging resources used by an upload
+ *        recorded by ktxTexture_VkRecordUpload().
+ *
+ * The resources must be kept until the recorded commands have completed
+ * then released with ktxVulkanStaging_Destruct() or, if the upload was
+ * recorded with a staging ring, handed to the ring with
+ * ktxVulkanStaging_Release() once the commands have been submitted.
+ */
+typedef struct ktxVulkanStaging
+{
+    PFN_vkDestroyBuffer vkDestroyBuffer; /*!< Pointer to vkDestroyBuffer function */
+    PFN_vkFreeMemory vkFreeMemory; /*!< Pointer to vkFreeMemory function */
+
+    VkBuffer buffer; /*!< Handle of the staging buffer or VK_NULL_HANDLE. */
+    VkDeviceMemory memory; /*!< Memory bound to @c buffer or VK_NULL_HANDLE
+                                if @c buffer is the staging ring. */
+    struct ktxVulkanStagingRing* ring; /*!< The staging ring passed when
+                                            recording the upload or NULL. */
+    VkDeviceSize offset; /*!< Offset of the staging data in @c buffer. */
+} ktxVulkanStaging;
+
+KTX_API void KTX_APIENTRY
+ktxVulkanStaging_Destruct(ktxVulkanStaging* This, VkDevice device,
+                          const VkAllocationCallbacks* pAllocator);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxVulkanStaging_Release(ktxVulkanStaging* This, ktx_uint64_t submitValue);
+
 
 
 
@@ -179,6 +210,16 @@ typedef struct ktxVulkanDeviceInfo {
     ktxVulkanFunctions vkFuncs;
 } ktxVulkanDeviceInfo;
 
+/**
+ * @class ktxVulkanStagingRing
+ * @~English
+ * @brief Opaque handle to a persistently mapped staging buffer from which
+ *        uploads recorded by ktxTexture_VkRecordUpload() sub-allocate.
+ *
+ * @sa ktxVulkanStagingRing_Create()
+ */
+typedef struct ktxVulkanStagingRing ktxVulkanStagingRing;
+
 
 KTX_API ktxVulkanDeviceInfo* KTX_APIENTRY
 ktxVulkanDeviceInfo_CreateEx(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device,
@@ -209,6 +250,15 @@ KTX_API void KTX_APIENTRY
 ktxVulkanDeviceInfo_Destruct(ktxVulkanDeviceInfo* This);
 KTX_API void KTX_APIENTRY
 ktxVulkanDeviceInfo_Destroy(ktxVulkanDeviceInfo* This);
+
+KTX_API KTX_error_code KTX_APIENTRY
+ktxVulkanStagingRing_Create(ktxVulkanDeviceInfo* vdi, VkDeviceSize size,
+                            ktxVulkanStagingRing** ppRing);
+KTX_API void KTX_APIENTRY
+ktxVulkanStagingRing_Destroy(ktxVulkanStagingRing* This);
+KTX_API void KTX_APIENTRY
+ktxVulkanStagingRing_Retire(ktxVulkanStagingRing* This,
+                            ktx_uint64_t completedValue);
 KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
                       ktxVulkanTexture* vkTexture,
@@ -219,6 +269,15 @@ KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture_VkUpload(ktxTexture* texture, ktxVulkanDeviceInfo* vdi,
                     ktxVulkanTexture *vkTexture);
 KTX_API KTX_error_code KTX_APIENTRY
+ktxTexture_VkRecordUpload(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
+                          VkCommandBuffer cmdBuffer,
+                          ktxVulkanTexture* vkTexture,
+                          VkImageTiling tiling,
+                          VkImageUsageFlags usageFlags,
+                          VkImageLayout finalLayout,
+                          ktxVulkanStagingRing* ring,
+                          ktxVulkanStaging* staging);
+KTX_API KTX_error_code KTX_APIENTRY
 ktxTexture1_VkUploadEx(ktxTexture1* This, ktxVulkanDeviceInfo* vdi,
                        ktxVulkanTexture* vkTexture,
                        VkImageTiling tiling,
@@ -4,9 +4,11 @@
  */
 
 #include <assert.h>
+#include <cstdlib>
 #include <cstring>
 #include <cstdint>
 #include <jni.h>
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -176,6 +178,89 @@ extern "C" JNIEXPORT jbyteArray JNICALL Java_org_khronos_ktx_KtxTexture_getData(
     return outputArray;
 }
 
+// The direct buffers returned by getDataBuffer, getLevelBuffer and getImageBuffer
+// alias the texture's own image data. They are invalid after destroy() or after
+// any operation that replaces the image data, e.g. compression or transcoding.
+
+// A ByteBuffer's capacity is an int. NewDirectByteBuffer does not check this,
+// so throw rather than return a buffer that cannot reach all of the data.
+static bool check_buffer_size(JNIEnv *env, ktx_size_t size)
+{
+    if (size > INT32_MAX) {
+        std::string message = "Data of " + std::to_string(size)
+                              + " bytes is larger than a ByteBuffer can hold";
+        env->ThrowNew(env->FindClass("java/lang/IllegalStateException"), message.c_str());
+        return false;
+    }
+    return true;
+}
+
+static jobject new_data_view(JNIEnv *env, ktxTexture *texture, ktx_size_t offset, ktx_size_t size)
+{
+    ktx_uint8_t *data = ktxTexture_GetData(texture);
+    ktx_size_t dataSize = ktxTexture_GetDataSize(texture);
+
+    if (data == NULL || offset > dataSize || size > dataSize - offset) {
+        return NULL;
+    }
+    if (!check_buffer_size(env, size)) {
+        return NULL;
+    }
+
+    return env->NewDirectByteBuffer(data + offset, static_cast<jlong>(size));
+}
+
+extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture_getDataBuffer(JNIEnv *env, jobject thiz)
+{
+    ktxTexture *texture = get_ktx_texture(env, thiz);
+
+    return new_data_view(env, texture, 0, ktxTexture_GetDataSize(texture));
+}
+
+extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture_getLevelBuffer(JNIEnv *env,
+                                                                            jobject thiz,
+                                                                            jint level)
+{
+    ktxTexture *texture = get_ktx_texture(env, thiz);
+
+    if (level < 0 || static_cast<ktx_uint32_t>(level) >= texture->numLevels) {
+        return NULL;
+    }
+
+    ktx_size_t offset = 0;
+    if (ktxTexture_GetImageOffset(texture, level, 0, 0, &offset) != KTX_SUCCESS) {
+        return NULL;
+    }
+
+    // Images of a level are contiguous: layers, then faces or depth slices.
+    ktx_uint32_t depth = texture->baseDepth >> level;
+    ktx_size_t levelSize = ktxTexture_GetImageSize(texture, level)
+                           * texture->numLayers
+                           * texture->numFaces
+                           * (depth > 0 ? depth : 1);
+
+    return new_data_view(env, texture, offset, levelSize);
+}
+
+extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture_getImageBuffer(JNIEnv *env,
+                                                                            jobject thiz,
+                                                                            jint level,
+                                                                            jint layer,
+                                                                            jint faceSlice)
+{
+    ktxTexture *texture = get_ktx_texture(env, thiz);
+    ktx_size_t offset = 0;
+
+    if (level < 0 || static_cast<ktx_uint32_t>(level) >= texture->numLevels) {
+        return NULL;
+    }
+    if (ktxTexture_GetImageOffset(texture, level, layer, faceSlice, &offset) != KTX_SUCCESS) {
+        return NULL;
+    }
+
+    return new_data_view(env, texture, offset, ktxTexture_GetImageSize(texture, level));
+}
+
 extern "C" JNIEXPORT jlong JNICALL Java_org_khronos_ktx_KtxTexture_getDataSize(JNIEnv *env, jobject thiz)
 {
     return static_cast<jlong>(ktxTexture_GetDataSize(get_ktx_texture(env, thiz)));
@@ -254,6 +339,31 @@ extern "C" JNIEXPORT jint JNICALL Java_org_khronos_ktx_KtxTexture_setImageFromMe
     return result;
 }
 
+extern "C" JNIEXPORT jint JNICALL Java_org_khronos_ktx_KtxTexture_setImageFromBuffer(JNIEnv *env,
+                                                                                    jobject thiz,
+                                                                                    jint level,
+                                                                                    jint layer,
+                                                                                    jint faceSlice,
+                                                                                    jobject srcBuffer,
+                                                                                    jint srcOffset,
+                                                                                    jint srcLength)
+{
+    ktx_uint8_t *src = static_cast<ktx_uint8_t*>(env->GetDirectBufferAddress(srcBuffer));
+
+    if (src == NULL) {
+        return KTX_INVALID_VALUE;
+    }
+
+    // libktx copies the image into the texture's storage so, unlike
+    // setImageFromMemory, there is nothing to keep pinned.
+    return ktxTexture_SetImageFromMemory(get_ktx_texture(env, thiz),
+                                level,
+                                layer,
+                                faceSlice,
+                                src + srcOffset,
+                                static_cast<ktx_size_t>(srcLength));
+}
+
 extern "C" JNIEXPORT jint JNICALL Java_org_khronos_ktx_KtxTexture_writeToNamedFile(JNIEnv *env,
                                                                                     jobject thiz,
                                                                                     jstring dstName)
@@ -280,7 +390,7 @@ extern "C" JNIEXPORT jbyteArray JNICALL Java_org_khronos_ktx_KtxTexture_writeToM
     }
     if (pSize >= UINT32_MAX) {
         std::cout << "writeToMemory array is too large for Java" << std::endl;
-        delete ppDstBytes;// make sure to delete it
+        free(ppDstBytes);// make sure to free it
         return NULL;
     }
 
@@ -291,8 +401,45 @@ extern "C" JNIEXPORT jbyteArray JNICALL Java_org_khronos_ktx_KtxTexture_writeToM
                             static_cast<jsize>(pSize),
                             reinterpret_cast<const jbyte*>(ppDstBytes));
 
-    delete ppDstBytes;
+    free(ppDstBytes);
+
+    return out;
+}
+
+extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture_writeToDirectBuffer(JNIEnv *env,
+                                                                                    jobject thiz)
+{
+    ktx_uint8_t *ppDstBytes;
+    ktx_size_t pSize;
+    KTX_error_code result = ktxTexture_WriteToMemory(get_ktx_texture(env, thiz), &ppDstBytes, &pSize);
+
+    if (result != KTX_SUCCESS) {
+        std::cout << "Failed to writeToDirectBuffer KTXTexture, error " << result << std::endl;
+        return NULL;
+    }
+
+    if (!check_buffer_size(env, pSize)) {
+        free(ppDstBytes);
+        return NULL;
+    }
+
+    // Ownership of ppDstBytes passes to the Java caller who must release it
+    // with freeDirectBuffer.
+    jobject out = env->NewDirectByteBuffer(ppDstBytes, static_cast<jlong>(pSize));
+
+    if (out == NULL) {
+        free(ppDstBytes);
+    }
 
     return out;
 }
 
+extern "C" JNIEXPORT void JNICALL Java_org_khronos_ktx_KtxTexture_freeDirectBuffer(JNIEnv *env,
+                                                                                jclass,
+                                                                                jobject buffer)
+{
+    if (buffer != NULL) {
+        free(env->GetDirectBufferAddress(buffer));
+    }
+}
+
@@ -113,6 +113,39 @@ extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture2_create(JNI
     return texture;
 }
 
+extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture2_createFromBuffer(JNIEnv *env,
+                                                                                            jclass,
+                                                                                            jobject srcBuffer,
+                                                                                            jint srcOffset,
+                                                                                            jint srcLength,
+                                                                                            jint createFlags)
+{
+    ktx_uint8_t *src = static_cast<ktx_uint8_t*>(env->GetDirectBufferAddress(srcBuffer));
+    ktxTexture2 *instance = NULL;
+
+    if (src == NULL) {
+        std::cout << "createFromMemory Ktx2Texture needs a direct buffer" << std::endl;
+        return NULL;
+    }
+
+    // The texture reads from the buffer in place. Image data not loaded
+    // now is read from it later so the Java side keeps the buffer
+    // reachable for the life of the texture.
+    jint result = ktxTexture2_CreateFromMemory(src + srcOffset,
+                                               static_cast<ktx_size_t>(srcLength),
+                                               createFlags,
+                                               &instance);
+
+    if (result != KTX_SUCCESS) {
+        std::cout << "Failure to createFromMemory Ktx2Texture, error " << result << std::endl;
+        return NULL;
+    }
+
+    assert (instance != NULL);
+
+    return make_ktx2_wrapper(env, instance);
+}
+
 extern "C" JNIEXPORT jobject JNICALL Java_org_khronos_ktx_KtxTexture2_createFromNamedFile(JNIEnv *env,
                                                                                             jobject,
                                                                                             jstring filename,
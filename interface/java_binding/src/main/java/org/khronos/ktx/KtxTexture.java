@@ -5,9 +5,13 @@
 
 package org.khronos.ktx;
 
+import java.nio.ByteBuffer;
+
 public abstract class KtxTexture {
     private final long instance;
     private long buffers;
+    /* The buffer a texture was created from. It is read in place. */
+    ByteBuffer source;
 
     protected KtxTexture(long instance) {
         this.instance = instance;
@@ -36,6 +40,44 @@ public abstract class KtxTexture {
      * Gets the image data of the KTX file (the data is copied into a Java array)
      */
     public native byte[] getData();
+
+    /**
+     * Gets the image data of the KTX file as a direct buffer over the texture's own
+     * memory. Nothing is copied.
+     *
+     * NOTE: The buffer must not be used after {@link KtxTexture#destroy} or after the
+     * image data is replaced, e.g. by compression or transcoding.
+     *
+     * @return The image data or null if it has not been loaded.
+     * @throws IllegalStateException if the data is larger than Integer.MAX_VALUE
+     *         bytes, the most a ByteBuffer can hold. Use {@link KtxTexture#getLevelBuffer}
+     *         or {@link KtxTexture#getImageBuffer} to reach such data in parts.
+     */
+    public native ByteBuffer getDataBuffer();
+
+    /**
+     * Gets a direct buffer over all the images of a mip level. The same lifetime
+     * rules as {@link KtxTexture#getDataBuffer} apply.
+     *
+     * @param level - The mip level
+     * @return The level's data or null if the level does not exist, the image data
+     *         has not been loaded or is supercompressed.
+     * @throws IllegalStateException if the level is larger than Integer.MAX_VALUE bytes.
+     */
+    public native ByteBuffer getLevelBuffer(int level);
+
+    /**
+     * Gets a direct buffer over a single image. The same lifetime rules as
+     * {@link KtxTexture#getDataBuffer} apply.
+     *
+     * @param level - The image level, should be 0 for non-mipmapped textures
+     * @param layer - The texture layer, should be 0 for non-arrays
+     * @param faceSlice - The face or depth slice, should be 0 for non-cubemaps
+     * @return The image data or null if the image does not exist, the image data
+     *         has not been loaded or is supercompressed.
+     * @throws IllegalStateException if the image is larger than Integer.MAX_VALUE bytes.
+     */
+    public native ByteBuffer getImageBuffer(int level, int layer, int faceSlice);
     public native long getDataSize();
     public native long getDataSizeUncompressed();
     public native int getElementSize();
@@ -62,6 +104,26 @@ public abstract class KtxTexture {
      */
     public native int setImageFromMemory(int level, int layer, int faceSlice, byte[] src);
 
+    /**
+     * Set the image data from a direct buffer. The bytes between the buffer's position
+     * and limit are copied straight into the texture so, unlike the array version,
+     * nothing is kept in memory afterwards.
+     *
+     * @param level - The image level, should be 0 for non-mipmapped textures
+     * @param layer - The texture layer, should be 0 for non-arrays
+     * @param faceSlice - The face slice, should be 0 for non-cubemaps
+     * @param src - The image data. Must be a direct buffer.
+     */
+    public int setImageFromMemory(int level, int layer, int faceSlice, ByteBuffer src) {
+        if (!src.isDirect()) {
+            throw new IllegalArgumentException("src must be a direct ByteBuffer");
+        }
+        return setImageFromBuffer(level, layer, faceSlice, src, src.position(), src.remaining());
+    }
+
+    private native int setImageFromBuffer(int level, int layer, int faceSlice,
+                                          ByteBuffer src, int srcOffset, int srcLength);
+
     /**
      * Write the KTX image to the given destination file in KTX format
      *
@@ -73,4 +135,24 @@ public abstract class KtxTexture {
      * This **might** not work (INVALID_OPERATION for some reason)
      */
     public native byte[] writeToMemory();
+
+    /**
+     * Write the KTX image to memory allocated by libktx and return a direct buffer
+     * over it. Nothing is copied.
+     *
+     * The memory is not managed by the garbage collector. Release it with
+     * {@link KtxTexture#freeDirectBuffer} once done with the buffer. It remains valid
+     * after the texture is destroyed.
+     *
+     * @return The KTX file data or null on failure.
+     * @throws IllegalStateException if the file is larger than Integer.MAX_VALUE bytes,
+     *         the most a ByteBuffer can hold. Nothing is leaked in that case.
+     */
+    public native ByteBuffer writeToDirectBuffer();
+
+    /**
+     * Free a buffer returned by {@link KtxTexture#writeToDirectBuffer}. The buffer must
+     * not be used afterwards. Do not pass any other buffer.
+     */
+    public static native void freeDirectBuffer(ByteBuffer buffer);
 }
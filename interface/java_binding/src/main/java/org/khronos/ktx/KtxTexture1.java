@@ -5,6 +5,8 @@
 
 package org.khronos.ktx;
 
+import java.nio.ByteBuffer;
+
 public class KtxTexture1 extends KtxTexture {
     protected KtxTexture1(long instance) {
         super(instance);
@@ -38,4 +40,34 @@ public class KtxTexture1 extends KtxTexture {
     public static KtxTexture1 createFromNamedFile(String filename) {
         return createFromNamedFile(filename, KtxTextureCreateFlagBits.LOAD_IMAGE_DATA_BIT);
     }
+
+    /**
+     * Create a {@link KTXTexture1} from KTX file data in a direct buffer.
+     *
+     * The bytes between the buffer's position and limit are read in place. The texture
+     * keeps a reference to the buffer, so image data not loaded now can be loaded later.
+     * Do not modify the buffer while the texture is in use.
+     *
+     * @param src - The file data. Must be a direct buffer.
+     * @param createFlags - Pass {@link KTXTextureCreateFlagBits.LOAD_IMAGE_DATA_BIT} if you
+     *                   want to read image data! Otherwise, {@link KTXTexture.getData()} will
+     *                    return null.
+     */
+    public static KtxTexture1 createFromMemory(ByteBuffer src, int createFlags) {
+        if (!src.isDirect()) {
+            throw new IllegalArgumentException("src must be a direct ByteBuffer");
+        }
+        KtxTexture1 texture = createFromBuffer(src, src.position(), src.remaining(), createFlags);
+        if (texture != null) {
+            texture.source = src;
+        }
+        return texture;
+    }
+
+    public static KtxTexture1 createFromMemory(ByteBuffer src) {
+        return createFromMemory(src, KtxTextureCreateFlagBits.LOAD_IMAGE_DATA_BIT);
+    }
+
+    private static native KtxTexture1 createFromBuffer(ByteBuffer src, int srcOffset,
+                                                      int srcLength, int createFlags);
 }
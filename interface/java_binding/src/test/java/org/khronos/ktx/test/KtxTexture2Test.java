@@ -10,12 +10,16 @@ import org.junit.jupiter.api.extension.ExtendWith;
 import org.khronos.ktx.*;
 
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.nio.file.Paths;
 
 import static org.junit.jupiter.api.Assertions.assertEquals;
 import static org.junit.jupiter.api.Assertions.assertNotNull;
+import static org.junit.jupiter.api.Assertions.assertNull;
+import static org.junit.jupiter.api.Assertions.assertThrows;
+import static org.junit.jupiter.api.Assertions.assertTrue;
 
 @ExtendWith({ KtxTestLibraryLoader.class })
 public class KtxTexture2Test {
@@ -211,6 +215,99 @@ public class KtxTexture2Test {
         assertEquals(VkFormat.VK_FORMAT_ASTC_4x4_SRGB_BLOCK, texture.getVkFormat());
     }
 
+    @Test
+    public void testGetDataBuffer() {
+        Path testKtxFile = Paths.get("")
+                .resolve("../../tests/testimages/astc_mipmap_ldr_4x4_posx.ktx2")
+                .toAbsolutePath()
+                .normalize();
+
+        KtxTexture2 texture = KtxTexture2.createFromNamedFile(testKtxFile.toString(),
+                KtxTextureCreateFlagBits.LOAD_IMAGE_DATA_BIT);
+
+        assertNotNull(texture);
+
+        byte[] data = texture.getData();
+        ByteBuffer dataBuffer = texture.getDataBuffer();
+
+        assertTrue(dataBuffer.isDirect());
+        assertEquals(texture.getDataSize(), dataBuffer.capacity());
+        assertEquals(ByteBuffer.wrap(data), dataBuffer);
+
+        for (int level = 0; level < texture.getNumLevels(); level++) {
+            ByteBuffer levelBuffer = texture.getLevelBuffer(level);
+            ByteBuffer imageBuffer = texture.getImageBuffer(level, 0, 0);
+            int offset = (int) texture.getImageOffset(level, 0, 0);
+
+            assertEquals(texture.getImageSize(level), levelBuffer.capacity());
+            assertEquals(texture.getImageSize(level), imageBuffer.capacity());
+            assertEquals(ByteBuffer.wrap(data, offset, imageBuffer.capacity()), imageBuffer);
+        }
+        assertNull(texture.getLevelBuffer(texture.getNumLevels()));
+
+        texture.destroy();
+    }
+
+    @Test
+    public void testCreateFromMemory() throws IOException {
+        Path testKtxFile = Paths.get("")
+                .resolve("../../tests/testimages/astc_mipmap_ldr_4x4_posx.ktx2")
+                .toAbsolutePath()
+                .normalize();
+
+        byte[] file = Files.readAllBytes(testKtxFile);
+        ByteBuffer src = ByteBuffer.allocateDirect(file.length);
+        src.put(file).flip();
+
+        KtxTexture2 texture = KtxTexture2.createFromMemory(src);
+
+        assertNotNull(texture);
+        assertEquals(texture.getNumLevels(), 12);
+
+        KtxTexture2 reference = KtxTexture2.createFromNamedFile(testKtxFile.toString());
+        assertEquals(ByteBuffer.wrap(reference.getData()), texture.getDataBuffer());
+        reference.destroy();
+
+        ByteBuffer written = texture.writeToDirectBuffer();
+        assertNotNull(written);
+        assertTrue(written.isDirect());
+
+        KtxTexture2 copy = KtxTexture2.createFromMemory(written);
+        assertNotNull(copy);
+        assertEquals(texture.getDataBuffer(), copy.getDataBuffer());
+        copy.destroy();
+        KtxTexture.freeDirectBuffer(written);
+
+        texture.destroy();
+
+        assertThrows(IllegalArgumentException.class,
+                () -> KtxTexture2.createFromMemory(ByteBuffer.wrap(file)));
+    }
+
+    @Test
+    public void testSetImageFromBuffer() {
+        KtxTextureCreateInfo info = new KtxTextureCreateInfo();
+
+        info.setBaseWidth(16);
+        info.setBaseHeight(16);
+        info.setVkFormat(VkFormat.VK_FORMAT_R8G8B8A8_UNORM);
+
+        KtxTexture2 texture = KtxTexture2.create(info, KtxCreateStorage.ALLOC);
+        assertNotNull(texture);
+
+        ByteBuffer image = ByteBuffer.allocateDirect(16 * 16 * 4);
+        for (int i = 0; i < image.capacity(); i++) {
+            image.put(i, (byte) i);
+        }
+
+        assertEquals(KtxErrorCode.SUCCESS,
+                texture.setImageFromMemory(0, 0, 0, image));
+        assertEquals(0, texture.getBufferListSize());
+        assertEquals(image, texture.getImageBuffer(0, 0, 0));
+
+        texture.destroy();
+    }
+
     @Test
     public void testCreate() {
         KtxTextureCreateInfo info = new KtxTextureCreateInfo();
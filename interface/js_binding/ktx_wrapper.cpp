@@ -8,7 +8,9 @@
 
 #include <emscripten/bind.h>
 #include <ktx.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 using namespace emscripten;
 
@@ -68,6 +70,26 @@ namespace ktx
             return m_ptr->baseHeight;
         }
 
+        uint32_t baseDepth() const
+        {
+            return m_ptr->baseDepth;
+        }
+
+        uint32_t numLevels() const
+        {
+            return m_ptr->numLevels;
+        }
+
+        uint32_t numLayers() const
+        {
+            return m_ptr->numLayers;
+        }
+
+        uint32_t numFaces() const
+        {
+            return m_ptr->numFaces;
+        }
+
         bool needsTranscoding() const
         {
             return ktxTexture_NeedsTranscoding(m_ptr.get());
@@ -135,6 +157,87 @@ namespace ktx
             return result;
         }
 
+        // Returns a view of one image of the texture's data in the WASM heap.
+        // Nothing is copied. The view is invalidated by transcodeBasis, by
+        // delete() and by growth of the WASM memory so upload or copy it
+        // before calling into the module again.
+        emscripten::val getImageData(uint32_t level, uint32_t layer, uint32_t faceSlice)
+        {
+            ktx_uint8_t* data = ktxTexture_GetData(m_ptr.get());
+            if (data == nullptr)
+            {
+                std::cout << "ERROR: getImageData: texture has no image data" << std::endl;
+                return val::null();
+            }
+
+            ktx_size_t offset = 0;
+            KTX_error_code result = ktxTexture_GetImageOffset(m_ptr.get(), level, layer, faceSlice, &offset);
+            if (result != KTX_SUCCESS)
+            {
+                std::cout << "ERROR: Failed to get image data: " << ktxErrorString(result) << std::endl;
+                return val::null();
+            }
+
+            ktx_size_t imageSize = ktxTexture_GetImageSize(m_ptr.get(), level);
+            return val(typed_memory_view(imageSize, data + offset));
+        }
+
+        // Transcodes the images of one level so large textures can be
+        // transcoded a level at a time, e.g. one per animation frame. The
+        // texture itself is not modified. The returned data holds the level's
+        // images in the same order as in a KTX2 file and is a view into a
+        // buffer that is reused by the next call, so upload or copy it before
+        // calling into the module again. Video textures must be transcoded
+        // with transcodeBasis.
+        emscripten::val transcodeBasisLevel(uint32_t level, const val& targetFormat, const val& decodeFlags)
+        {
+            val ret = val::object();
+            if (m_ptr->classId != ktxTexture2_c)
+            {
+                std::cout << "ERROR: transcodeBasisLevel is only supported for KTX2" << std::endl;
+                ret.set("error", KTX_INVALID_VALUE);
+                return ret;
+            }
+
+            ktxTexture2* texture = ktxTexture2(m_ptr.get());
+            ktx_transcode_fmt_e format = targetFormat.as<ktx_texture_transcode_fmt_e>();
+            ktx_transcode_flags flags = decodeFlags.as<ktx_transcode_flags>();
+            ktx_size_t imageSize = 0;
+            KTX_error_code result = ktxTexture2_GetTranscodedImageSize(texture, level, format,
+                                                                       flags, &imageSize);
+            if (result != KTX_SUCCESS)
+            {
+                std::cout << "ERROR: transcodeBasisLevel: " << ktxErrorString(result) << std::endl;
+                ret.set("error", result);
+                return ret;
+            }
+
+            uint32_t numSlices = texture->numFaces * std::max(1U, texture->baseDepth >> level);
+            m_transcodedLevel.resize(imageSize * texture->numLayers * numSlices);
+            uint8_t* dst = m_transcodedLevel.data();
+            for (uint32_t layer = 0; layer < texture->numLayers && result == KTX_SUCCESS; layer++)
+            {
+                for (uint32_t slice = 0; slice < numSlices && result == KTX_SUCCESS; slice++)
+                {
+                    result = ktxTexture2_TranscodeBasisImage(texture, level, layer, slice,
+                                                             format, flags,
+                                                             dst, imageSize, 0);
+                    dst += imageSize;
+                }
+            }
+
+            if (result != KTX_SUCCESS)
+            {
+                std::cout << "ERROR: Failed to transcode level: " << ktxErrorString(result) << std::endl;
+            }
+            else
+            {
+                ret.set("data", val(typed_memory_view(m_transcodedLevel.size(), m_transcodedLevel.data())));
+            }
+            ret.set("error", result);
+            return ret;
+        }
+
         // NOTE: WebGLTexture objects are completely opaque so the option of passing in the texture
         // to use is not viable. Unknown at present is how to find the WebGLTexture for the texture
         // created by ktxTexture_GLUpload via the Emscripten OpenGL ES emulation.
@@ -170,6 +273,8 @@ namespace ktx
         }
 
         std::unique_ptr<ktxTexture, decltype(&destroy)> m_ptr;
+        // Output of transcodeBasisLevel.
+        std::vector<uint8_t> m_transcodedLevel;
     };
 }
 
@@ -199,13 +304,25 @@ interface ktxUploadResult {
     readonly attribute GLenum error;
 };
 
+interface ktxTranscodedLevel {
+    readonly attribute ErrorCode error;
+    readonly attribute Uint8Array? data;
+};
+
 interface ktxTexture {
     void ktxTexture(ArrayBufferView fileData);
     UploadResult glUpload();
     ErrorCode transcodeBasis();
+    ktxTranscodedLevel transcodeBasisLevel(long level, TranscodeTarget target,
+                                           long decodeFlags);
+    Uint8Array? getImageData(long level, long layer, long faceSlice);
 
     readonly attribute long baseWidth;
     readonly attribute long baseHeight;
+    readonly attribute long baseDepth;
+    readonly attribute long numLevels;
+    readonly attribute long numLayers;
+    readonly attribute long numFaces;
     readonly attribute bool isPremultiplied;
     readonly attribute bool needsTranscoding;
     readonly attribute long numComponents;
@@ -397,6 +514,35 @@ a function like the following to be executed.
     xhr.send();
 @endcode
 
+### Using the image data directly
+
+@c getImageData returns a Uint8Array view of an image in the texture with no
+copy, for use with, e.g. WebGPU's @c writeTexture or to post to a worker. A
+Basis Universal texture can be transcoded a level at a time with
+@c transcodeBasisLevel, spreading the work of a large texture over several
+animation frames. The texture is not modified so each level can be
+transcoded when it is needed.
+
+@code{.unparsed}
+    let level = ktexture.numLevels;
+    function transcodeNextLevel() {
+      if (level-- == 0)
+        return;
+      const { error, data } = ktexture.transcodeBasisLevel(level, format, 0);
+      if (error != LIBKTX.ErrorCode.SUCCESS) {
+        alert('Level transcode failed. See console for details.');
+        return;
+      }
+      // Upload data now. It is overwritten by the next call.
+      requestAnimationFrame(transcodeNextLevel);
+    }
+    requestAnimationFrame(transcodeNextLevel);
+@endcode
+
+Both return views into the module's memory. They must be used, or
+copied, before anything else is called in the module because the memory
+may grow and detach them.
+
 @note It is not clear if glUpload can be used with, e.g. THREE.js. It may
 be necessary to expose the ktxTexture_IterateLevelFaces or
 ktxTexture_IterateLoadLevelFaces API to JS with those calling a
@@ -487,6 +633,10 @@ EMSCRIPTEN_BINDINGS(ktx)
         // .property("data", &ktx::texture::getData)
         .property("baseWidth", &ktx::texture::baseWidth)
         .property("baseHeight", &ktx::texture::baseHeight)
+        .property("baseDepth", &ktx::texture::baseDepth)
+        .property("numLevels", &ktx::texture::numLevels)
+        .property("numLayers", &ktx::texture::numLayers)
+        .property("numFaces", &ktx::texture::numFaces)
         .property("isPremultiplied", &ktx::texture::isPremultiplied)
         .property("needsTranscoding", &ktx::texture::needsTranscoding)
         .property("numComponents", &ktx::texture::numComponents)
@@ -494,6 +644,8 @@ EMSCRIPTEN_BINDINGS(ktx)
         .property("supercompressScheme", &ktx::texture::supercompressionScheme)
         .property("vkFormat", &ktx::texture::vkFormat)
         .function("transcodeBasis", &ktx::texture::transcodeBasis)
+        .function("transcodeBasisLevel", &ktx::texture::transcodeBasisLevel)
+        .function("getImageData", &ktx::texture::getImageData)
         .function("glUpload", &ktx::texture::glUpload)
     ;
 }
@@ -16,6 +16,7 @@
  * @author Wasim Abbas , www.arm.com
  */
 
+#include <cstddef>
 #include <cstring>
 #include <inttypes.h>
 #include <iostream>
@@ -29,39 +30,16 @@
 #include "ktx.h"
 #include "ktxint.h"
 #include "texture2.h"
+#include "threadpool.h"
 #include "vkformat_enum.h"
 #include "vk_format.h"
 
 #include "astc-encoder/Source/astcenc.h"
+#include "astcenc_dispatch.h"
 
-// Provide pthreads support on windows
-#if defined(_WIN32) && !defined(WIN32_HAS_PTHREADS)
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
-typedef HANDLE pthread_t;
-typedef int pthread_attr_t;
-
-/* Public function, see header file for detailed documentation */
-static int
-pthread_create(pthread_t* thread, const pthread_attr_t* attribs,
-               void* (*threadfunc)(void*), void* thread_arg) {
-    (void)attribs;
-    LPTHREAD_START_ROUTINE func = (LPTHREAD_START_ROUTINE)threadfunc;
-    *thread = CreateThread(nullptr, 0, func, thread_arg, 0, nullptr);
-    return 0;
-}
-
-/* Public function, see header file for detailed documentation */
-static int
-pthread_join(pthread_t thread, void** value) {
-    (void)value;
-    WaitForSingleObject(thread, INFINITE);
-    return 0;
-}
-
-#endif
+// Size of ktxAstcParams before threadPool was appended.
+static const ktx_uint32_t ktxAstcParams_v1Size =
+    offsetof(ktxAstcParams, inputSwizzle) + sizeof(ktxAstcParams::inputSwizzle);
 
 static astcenc_image*
 imageAllocate(uint32_t bitness,
@@ -404,89 +382,128 @@ astcQuality(ktx_uint32_t quality_level) {
     return ASTCENC_PRE_MEDIUM;
 }
 
-struct CompressionWorkload {
-    astcenc_context* context;
-    astcenc_image* image;
-    astcenc_swizzle swizzle;
-    uint8_t* data_out;
-    size_t data_len;
-    astcenc_error error;
-};
-
-static void
-compressionWorkloadRunner(int threadCount, int threadId, void* payload) {
-    (void)threadCount;
-
-    CompressionWorkload* work = static_cast<CompressionWorkload*>(payload);
-    astcenc_error error = astcenc_compress_image(
-                           work->context, work->image, &work->swizzle,
-                           work->data_out, work->data_len, threadId);
-
-    // This is a racy update, so which error gets returned is a random, but it
-    // will reliably report an error if an error occurs
-    if (error != ASTCENC_SUCCESS) {
-        work->error = error;
-    }
-}
+// Images with fewer blocks than this per thread are compressed by a single
+// thread. Several such images are compressed concurrently instead.
+#define KTX_ASTC_MIN_BLOCKS_PER_THREAD 256
 
-/**
- * @brief Worker thread helper payload for launchThreads.
- */
-struct LaunchDesc {
-    /** The native thread handle. */
-    pthread_t threadHandle;
-    /** The total number of threads in the thread pool. */
-    int threadCount;
-    /** The thread index in the thread pool. */
-    int threadId;
-    /** The user thread function to execute. */
-    void (*func)(int, int, void*);
-    /** The user thread payload. */
-    void* payload;
+struct AstcImageRef {
+    ktx_uint32_t level;
+    ktx_uint32_t image;
 };
 
 /**
- * @brief Helper function to translate thread entry points.
- *
- * Convert a (void*) thread entry to an (int, void*) thread entry, where the
- * integer contains the thread ID in the thread pool.
+ * @internal
+ * @~English
+ * @brief State shared by the jobs compressing the images of a texture.
  *
- * @param p The thread launch helper payload.
+ * Large images are compressed one at a time by all workers cooperating via
+ * @c sharedContext, a context allocated for the full thread count. Small
+ * images, typically the tail of the mip chain, are compressed concurrently,
+ * one per job, each worker using its own single-thread context.
  */
-static void*
-launchThreadsHelper(void *p) {
-    LaunchDesc* ltd = (LaunchDesc*)p;
-    ltd->func(ltd->threadCount, ltd->threadId, ltd->payload);
-    return nullptr;
-}
+struct AstcCompressJobs {
+    const ktxAstcencFuncs* astcenc;
+    ktxTexture2* This;
+    ktxTexture2* prototype;
+    const astcenc_config* config;
+    astcenc_swizzle swizzle;
+    uint32_t numComponents;
+
+    astcenc_context* sharedContext;
+    astcenc_image* sharedImage;
+    AstcImageRef sharedImageRef;
+    std::vector<astcenc_context*> workerContexts;
+    std::vector<AstcImageRef> smallImages;
+    // Indexed by job for shared compression, by worker for small images.
+    std::vector<astcenc_error> errors;
+};
 
-/* Public function, see header file for detailed documentation */
-static void
-launchThreads(int threadCount, void (*func)(int, int, void*), void *payload) {
-    // Directly execute single threaded workloads on this thread
-    if (threadCount <= 1) {
-        func(1, 0, payload);
-        return;
-    }
+static astcenc_image*
+astcInputImage(const AstcCompressJobs& jobs, const AstcImageRef& ref) {
+    ktxTexture2* This = jobs.This;
+    uint32_t width = MAX(1, This->baseWidth >> ref.level);
+    uint32_t height = MAX(1, This->baseHeight >> ref.level);
+    ktx_size_t imageSize = ktxTexture_calcImageSize(ktxTexture(This),
+                                                    ref.level,
+                                                    KTX_FORMAT_VERSION_TWO);
+    uint8_t* data = This->pData + ktxTexture2_levelDataOffset(This, ref.level)
+                    + ref.image * imageSize;
+
+    if (jobs.numComponents == 1)
+        return unorm8x1ArrayToImage(data, width, height);
+    else if (jobs.numComponents == 2)
+        return unorm8x2ArrayToImage(data, width, height);
+    else if (jobs.numComponents == 3)
+        return unorm8x3ArrayToImage(data, width, height);
+    else // assume (numComponents == 4)
+        return unorm8x4ArrayToImage(data, width, height);
+}
 
-    // Otherwise spawn worker threads
-    LaunchDesc *threadDescs = new LaunchDesc[threadCount];
-    for (int i = 0; i < threadCount; i++) {
-        threadDescs[i].threadCount = threadCount;
-        threadDescs[i].threadId = i;
-        threadDescs[i].payload = payload;
-        threadDescs[i].func = func;
+static uint8_t*
+astcOutputImage(const AstcCompressJobs& jobs, const AstcImageRef& ref,
+                ktx_size_t* imageSize) {
+    ktxTexture2* prototype = jobs.prototype;
+    *imageSize = ktxTexture_calcImageSize(ktxTexture(prototype), ref.level,
+                                          KTX_FORMAT_VERSION_TWO);
+    return prototype->pData + ktxTexture2_levelDataOffset(prototype, ref.level)
+           + ref.image * *imageSize;
+}
 
-        pthread_create(&(threadDescs[i].threadHandle), nullptr,
-                       launchThreadsHelper, (void*)&(threadDescs[i]));
+// Job compressing part of jobs.sharedImage. The job index is the
+// astcenc thread index.
+static KTX_error_code
+compressAstcSharedJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t job) {
+    (void)worker;
+    AstcCompressJobs& jobs = *static_cast<AstcCompressJobs*>(userdata);
+    ktx_size_t imageSize;
+    uint8_t* out = astcOutputImage(jobs, jobs.sharedImageRef, &imageSize);
+
+    astcenc_error error = jobs.astcenc->compress_image(jobs.sharedContext,
+                                                       jobs.sharedImage,
+                                                       &jobs.swizzle,
+                                                       out, imageSize, job);
+    if (error != ASTCENC_SUCCESS) {
+        jobs.errors[job] = error;
+        return KTX_INVALID_OPERATION;
     }
+    return KTX_SUCCESS;
+}
 
-    // ... and then wait for them to complete
-    for (int i = 0; i < threadCount; i++) {
-        pthread_join(threadDescs[i].threadHandle, nullptr);
+// Job compressing the whole of jobs.smallImages[job] on a single thread.
+static KTX_error_code
+compressAstcSmallJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t job) {
+    AstcCompressJobs& jobs = *static_cast<AstcCompressJobs*>(userdata);
+    astcenc_context*& context = jobs.workerContexts[worker];
+    astcenc_error error = ASTCENC_SUCCESS;
+
+    if (context == nullptr)
+        error = jobs.astcenc->context_alloc(jobs.config, 1, &context);
+
+    if (error == ASTCENC_SUCCESS) {
+        const AstcImageRef& ref = jobs.smallImages[job];
+        astcenc_image* input = astcInputImage(jobs, ref);
+        ktx_size_t imageSize;
+        uint8_t* out = astcOutputImage(jobs, ref, &imageSize);
+
+        // Single-thread contexts are reset by astcenc after each image.
+        error = jobs.astcenc->compress_image(context, input, &jobs.swizzle,
+                                             out, imageSize, 0);
+        imageFree(input);
     }
+    if (error != ASTCENC_SUCCESS) {
+        jobs.errors[worker] = error;
+        return KTX_INVALID_OPERATION;
+    }
+    return KTX_SUCCESS;
+}
 
-    delete[] threadDescs;
+static astcenc_error
+firstAstcError(const std::vector<astcenc_error>& errors) {
+    for (astcenc_error e : errors) {
+        if (e != ASTCENC_SUCCESS)
+            return e;
+    }
+    return ASTCENC_SUCCESS;
 }
 
 /**
@@ -534,8 +551,15 @@ ktxTexture2_CompressAstcEx(ktxTexture2* This, ktxAstcParams* params) {
     if (!params)
         return KTX_INVALID_VALUE;
 
-    if (params->structSize != sizeof(struct ktxAstcParams))
+    // Accept the struct from before threadPool was appended as well as the
+    // current one. Fields beyond the caller's structSize default to 0.
+    if (params->structSize < ktxAstcParams_v1Size
+        || params->structSize > sizeof(struct ktxAstcParams))
         return KTX_INVALID_VALUE;
+    ktxAstcParams paramsCopy;
+    memset(&paramsCopy, 0, sizeof(paramsCopy));
+    memcpy(&paramsCopy, params, params->structSize);
+    params = &paramsCopy;
 
     if (This->supercompressionScheme != KTX_SS_NONE)
         return KTX_INVALID_OPERATION; // Can't apply multiple schemes.
@@ -563,7 +587,11 @@ ktxTexture2_CompressAstcEx(ktxTexture2* This, ktxAstcParams* params) {
             return result;
     }
 
-    ktx_uint32_t threadCount = params->threadCount;
+    // With a caller's pool, use all of its workers. They are shared with
+    // the pool's other users so this does not oversubscribe the CPU.
+    ktx_uint32_t threadCount = params->threadPool
+                     ? ktxThreadPool_workerCount(params->threadPool)
+                     : params->threadCount;
     if (threadCount < 1)
         threadCount = 1;
 
@@ -621,93 +649,118 @@ ktxTexture2_CompressAstcEx(ktxTexture2* This, ktxAstcParams* params) {
     if(params->perceptual)
         flags |= ASTCENC_FLG_USE_PERCEPTUAL;
 
+    // astcenc compiled for the best ISA supported by this CPU.
+    const ktxAstcencFuncs& astcenc = ktxAstcencFuncs_get();
+
     astcenc_config   astc_config;
-    astcenc_context *astc_context;
-    astcenc_error astc_error = astcenc_config_init(profile,
+    astcenc_error astc_error = astcenc.config_init(profile,
                                                    block_size_x, block_size_y, block_size_z,
                                                    quality, flags,
                                                    &astc_config);
 
-    if (astc_error != ASTCENC_SUCCESS)
-        return KTX_INVALID_OPERATION;
-
-    astc_error  = astcenc_context_alloc(&astc_config, threadCount,
-                                        &astc_context);
-
-    if (astc_error != ASTCENC_SUCCESS)
+    if (astc_error != ASTCENC_SUCCESS) {
+        ktxTexture2_Destroy(prototype);
         return KTX_INVALID_OPERATION;
+    }
 
-    // Walk in reverse on levels so we don't have to do this later
     assert(prototype->dataSize && "Prototype texture size not initialized.\n");
 
     if (!prototype->pData) {
+        ktxTexture2_Destroy(prototype);
         return KTX_OUT_OF_MEMORY;
     }
 
-    uint8_t* buffer_out  = prototype->pData;
+    // One pool serves all the images so threads are created only once.
+    ktxThreadPool* pool = params->threadPool;
+    if (pool == nullptr) {
+        result = ktxThreadPool_Create(threadCount, &pool);
+        if (result != KTX_SUCCESS) {
+            ktxTexture2_Destroy(prototype);
+            return result;
+        }
+    }
 
-    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
+    AstcCompressJobs jobs;
+    jobs.astcenc = &astcenc;
+    jobs.This = This;
+    jobs.prototype = prototype;
+    jobs.config = &astc_config;
+    jobs.swizzle = swizzle;
+    jobs.numComponents = num_components;
+    jobs.sharedContext = nullptr;
+    jobs.sharedImage = nullptr;
+    jobs.workerContexts.assign(ktxThreadPool_workerCount(pool), nullptr);
+    jobs.errors.assign(MAX(threadCount, ktxThreadPool_workerCount(pool)),
+                       ASTCENC_SUCCESS);
+
+    for (ktx_uint32_t level = 0; level < This->numLevels; level++) {
         uint32_t width = MAX(1, This->baseWidth >> level);
         uint32_t height = MAX(1, This->baseHeight >> level);
         uint32_t depth = MAX(1, This->baseDepth >> level);
-        ktx_size_t levelImageSizeIn = 0;
-        ktx_size_t levelImageSizeOut = 0;
-        ktx_uint32_t levelImages = 0;
+        ktx_uint32_t levelImages = This->numLayers * This->numFaces * depth;
+        ktx_uint32_t blocks = ((width + block_size_x - 1) / block_size_x)
+                              * ((height + block_size_y - 1) / block_size_y);
+
+        if (threadCount == 1
+            || blocks < threadCount * KTX_ASTC_MIN_BLOCKS_PER_THREAD) {
+            for (ktx_uint32_t image = 0; image < levelImages; image++)
+                jobs.smallImages.push_back({level, image});
+            continue;
+        }
 
-        levelImages = This->numLayers * This->numFaces * depth;
-        levelImageSizeIn = ktxTexture_calcImageSize(ktxTexture(This), level,
-                                                    KTX_FORMAT_VERSION_TWO);
-        levelImageSizeOut = ktxTexture_calcImageSize(ktxTexture(prototype), level,
-                                                     KTX_FORMAT_VERSION_TWO);
-        ktx_size_t offset = ktxTexture2_levelDataOffset(This, level);
-
-        for (uint32_t image = 0; image < levelImages; image++) {
-            astcenc_image *input_image = nullptr;
-            if (num_components == 1)
-                input_image = unorm8x1ArrayToImage(This->pData + offset,
-                                                   width, height);
-            else if (num_components == 2)
-                input_image = unorm8x2ArrayToImage(This->pData + offset,
-                                                   width, height);
-            else if (num_components == 3)
-                input_image = unorm8x3ArrayToImage(This->pData + offset,
-                                                   width, height);
-            else // assume (num_components == 4)
-                input_image = unorm8x4ArrayToImage(This->pData + offset,
-                                                   width, height);
-
-            assert(input_image);
-
-            CompressionWorkload work;
-            work.context = astc_context;
-            work.image = input_image;
-            work.swizzle = swizzle;
-            work.data_out = buffer_out;
-            work.data_len = levelImageSizeOut;
-            work.error = ASTCENC_SUCCESS;
-
-            launchThreads(threadCount, compressionWorkloadRunner, &work);
-
-            if (work.error != ASTCENC_SUCCESS) {
-                std::cout << "ASTC compressor failed\n" <<
-                             astcenc_get_error_string(work.error) << std::endl;
-
-                imageFree(input_image);
-
-                astcenc_context_free(astc_context);
-                return KTX_INVALID_OPERATION;
+        if (jobs.sharedContext == nullptr) {
+            astc_error = astcenc.context_alloc(&astc_config, threadCount,
+                                               &jobs.sharedContext);
+            if (astc_error != ASTCENC_SUCCESS) {
+                jobs.errors[0] = astc_error;
+                result = KTX_INVALID_OPERATION;
+                break;
             }
-
-            buffer_out += levelImageSizeOut;
+        }
+        for (ktx_uint32_t image = 0; image < levelImages; image++) {
+            jobs.sharedImageRef = {level, image};
+            jobs.sharedImage = astcInputImage(jobs, jobs.sharedImageRef);
+            assert(jobs.sharedImage);
+
+            result = ktxThreadPool_run(pool, threadCount,
+                                       compressAstcSharedJob, &jobs);
+            imageFree(jobs.sharedImage);
+            jobs.sharedImage = nullptr;
+            if (result != KTX_SUCCESS)
+                break;
 
             // Reset ASTC context for next image
-            astcenc_compress_reset(astc_context);
-            offset += levelImageSizeIn;
+            astcenc.compress_reset(jobs.sharedContext);
         }
+        if (result != KTX_SUCCESS)
+            break;
+    }
+
+    if (result == KTX_SUCCESS && !jobs.smallImages.empty()) {
+        result = ktxThreadPool_run(pool,
+                                   (ktx_uint32_t)jobs.smallImages.size(),
+                                   compressAstcSmallJob, &jobs);
     }
 
     // We are done with astcencoder
-    astcenc_context_free(astc_context);
+    if (pool != params->threadPool)
+        ktxThreadPool_Destroy(pool);
+    if (jobs.sharedContext)
+        astcenc.context_free(jobs.sharedContext);
+    for (astcenc_context* context : jobs.workerContexts) {
+        if (context)
+            astcenc.context_free(context);
+    }
+
+    if (result != KTX_SUCCESS) {
+        astc_error = firstAstcError(jobs.errors);
+        if (astc_error != ASTCENC_SUCCESS) {
+            std::cout << "ASTC compressor failed\n" <<
+                         astcenc.get_error_string(astc_error) << std::endl;
+        }
+        ktxTexture2_Destroy(prototype);
+        return result;
+    }
 
     assert(KHR_DFDVAL(prototype->pDfd+1, MODEL) == KHR_DF_MODEL_ASTC
            && "Invalid dfd generated for ASTC image\n");
@@ -737,7 +790,7 @@ ktxTexture2_CompressAstcEx(ktxTexture2* This, ktxAstcParams* params) {
     free(This->pDfd);
     This->pDfd = prototype->pDfd;
     prototype->pDfd = 0;
-    free(This->pData);
+    ktxTexture_freeData(ktxTexture(This));
     This->pData = prototype->pData;
     This->dataSize = prototype->dataSize;
     prototype->pData = 0;
@@ -0,0 +1,78 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file astcenc_dispatch.cpp
+ * @~English
+ *
+ * @brief Select the astcenc entry points to use on the running CPU.
+ */
+
+#include "astcenc_dispatch.h"
+
+#if KTX_ASTCENC_ISA_DISPATCH
+
+namespace ktx_astcenc_sse2 {
+    extern const ktxAstcencFuncs astcencFuncs;
+    bool cpu_supports_sse41();
+    bool cpu_supports_popcnt();
+    bool cpu_supports_f16c();
+    bool cpu_supports_avx2();
+}
+namespace ktx_astcenc_sse41 {
+    extern const ktxAstcencFuncs astcencFuncs;
+}
+namespace ktx_astcenc_avx2 {
+    extern const ktxAstcencFuncs astcencFuncs;
+}
+
+static const ktxAstcencFuncs&
+selectAstcencFuncs() {
+    // The SSE2 copy runs on every x86_64 CPU so use its detection functions.
+    using namespace ktx_astcenc_sse2;
+
+    if (cpu_supports_avx2() && cpu_supports_popcnt() && cpu_supports_f16c())
+        return ktx_astcenc_avx2::astcencFuncs;
+    if (cpu_supports_sse41() && cpu_supports_popcnt())
+        return ktx_astcenc_sse41::astcencFuncs;
+    return ktx_astcenc_sse2::astcencFuncs;
+}
+
+#else
+
+static const ktxAstcencFuncs&
+selectAstcencFuncs() {
+    static const ktxAstcencFuncs funcs = {
+        "static",
+        astcenc_config_init,
+        astcenc_context_alloc,
+        astcenc_compress_image,
+        astcenc_compress_reset,
+        astcenc_decompress_image,
+        astcenc_decompress_reset,
+        astcenc_context_free,
+        astcenc_get_error_string
+    };
+    return funcs;
+}
+
+#endif
+
+/**
+ * @internal
+ * @~English
+ * @brief Return the astcenc entry points to use.
+ *
+ * The CPU is checked on the first call only.
+ */
+const ktxAstcencFuncs&
+ktxAstcencFuncs_get() {
+    static const ktxAstcencFuncs& funcs = selectAstcencFuncs();
+    return funcs;
+}
@@ -0,0 +1,55 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file astcenc_dispatch.h
+ * @~English
+ *
+ * @brief Table of the astcenc entry points used by libktx.
+ *
+ * When libktx is built with KTX_ASTCENC_ISA_DISPATCH, the astcenc core is
+ * compiled once for each supported x86 ISA, each copy in its own namespace,
+ * and ktxAstcencFuncs_get() returns the entry points of the best copy the
+ * running CPU supports. Otherwise it returns the entry points of the single
+ * astcenc library libktx was linked with.
+ */
+
+#ifndef ASTCENC_DISPATCH_H
+#define ASTCENC_DISPATCH_H
+
+#include "astc-encoder/Source/astcenc.h"
+
+struct ktxAstcencFuncs {
+    const char* isa;    //!< Name of the ISA the functions were compiled for.
+    astcenc_error (*config_init)(astcenc_profile profile,
+                                 unsigned int block_x, unsigned int block_y,
+                                 unsigned int block_z, float quality,
+                                 unsigned int flags, astcenc_config* config);
+    astcenc_error (*context_alloc)(const astcenc_config* config,
+                                   unsigned int thread_count,
+                                   astcenc_context** context);
+    astcenc_error (*compress_image)(astcenc_context* context,
+                                    astcenc_image* image,
+                                    const astcenc_swizzle* swizzle,
+                                    uint8_t* data_out, size_t data_len,
+                                    unsigned int thread_index);
+    astcenc_error (*compress_reset)(astcenc_context* context);
+    astcenc_error (*decompress_image)(astcenc_context* context,
+                                      const uint8_t* data, size_t data_len,
+                                      astcenc_image* image_out,
+                                      const astcenc_swizzle* swizzle,
+                                      unsigned int thread_index);
+    astcenc_error (*decompress_reset)(astcenc_context* context);
+    void (*context_free)(astcenc_context* context);
+    const char* (*get_error_string)(astcenc_error status);
+};
+
+const ktxAstcencFuncs& ktxAstcencFuncs_get();
+
+#endif /* ASTCENC_DISPATCH_H */
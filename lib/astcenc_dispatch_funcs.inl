@@ -0,0 +1,82 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file astcenc_dispatch_funcs.inl
+ * @~English
+ *
+ * @brief Define the ktxAstcencFuncs table of one ISA's copy of astcenc.
+ *
+ * Included inside namespace ktx_astcenc_<isa> in the same way as the astcenc
+ * sources. Within the namespace astcenc_context names that copy's context
+ * type; the table exposes it to libktx as the opaque global one declared in
+ * astcenc.h.
+ */
+
+namespace {
+
+inline astcenc_context*
+ctx(::astcenc_context* context) {
+    return reinterpret_cast<astcenc_context*>(context);
+}
+
+astcenc_error
+contextAlloc(const astcenc_config* config, unsigned int thread_count,
+             ::astcenc_context** context) {
+    astcenc_context* c;
+    astcenc_error error = astcenc_context_alloc(config, thread_count, &c);
+    if (error == ASTCENC_SUCCESS)
+        *context = reinterpret_cast<::astcenc_context*>(c);
+    return error;
+}
+
+astcenc_error
+compressImage(::astcenc_context* context, astcenc_image* image,
+              const astcenc_swizzle* swizzle, uint8_t* data_out,
+              size_t data_len, unsigned int thread_index) {
+    return astcenc_compress_image(ctx(context), image, swizzle,
+                                  data_out, data_len, thread_index);
+}
+
+astcenc_error
+compressReset(::astcenc_context* context) {
+    return astcenc_compress_reset(ctx(context));
+}
+
+astcenc_error
+decompressImage(::astcenc_context* context, const uint8_t* data,
+                size_t data_len, astcenc_image* image_out,
+                const astcenc_swizzle* swizzle, unsigned int thread_index) {
+    return astcenc_decompress_image(ctx(context), data, data_len,
+                                    image_out, swizzle, thread_index);
+}
+
+astcenc_error
+decompressReset(::astcenc_context* context) {
+    return astcenc_decompress_reset(ctx(context));
+}
+
+void
+contextFree(::astcenc_context* context) {
+    astcenc_context_free(ctx(context));
+}
+
+} // namespace
+
+const ktxAstcencFuncs astcencFuncs = {
+    KTX_ASTCENC_ISA,
+    astcenc_config_init,
+    contextAlloc,
+    compressImage,
+    compressReset,
+    decompressImage,
+    decompressReset,
+    contextFree,
+    astcenc_get_error_string
+};
@@ -0,0 +1,116 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file astcenc_dispatch_isa.h
+ * @~English
+ *
+ * @brief Prefix for the sources compiling one ISA's copy of astcenc.
+ *
+ * Each generated astcenc_dispatch_<isa>_<source>.cpp includes this then
+ * includes the astcenc source inside namespace ktx_astcenc_<isa>. Every
+ * system header used by astcenc must be included here, outside the
+ * namespace, so that its include guard stops it being included again
+ * inside. The public astcenc.h is also included here so the API types are
+ * shared by all copies and by libktx.
+ *
+ * The ISA is enabled only between KTX_ASTCENC_TARGET_BEGIN and
+ * KTX_ASTCENC_TARGET_END, which enclose the namespace. Inline and template
+ * functions from the system headers are therefore compiled for the
+ * baseline ISA in every copy, so it does not matter which copy of a weak
+ * definition the linker keeps.
+ */
+
+#ifndef ASTCENC_DISPATCH_ISA_H
+#define ASTCENC_DISPATCH_ISA_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cfenv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+
+#include <immintrin.h>
+#if !defined(__clang__) && defined(_MSC_VER)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+  #include <intrin.h>
+#else
+  #include <cpuid.h>
+#endif
+
+#include "astc-encoder/Source/astcenc.h"
+#include "astcenc_dispatch.h"
+
+#define KTX_ASTCENC_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+  #define KTX_ASTCENC_TARGET_BEGIN(isa)                                      \
+      KTX_ASTCENC_PRAGMA(clang attribute push(                               \
+          __attribute__((target(isa))), apply_to = function))
+  #define KTX_ASTCENC_TARGET_END KTX_ASTCENC_PRAGMA(clang attribute pop)
+#elif defined(__GNUC__)
+  #define KTX_ASTCENC_TARGET_BEGIN(isa)                                      \
+      KTX_ASTCENC_PRAGMA(GCC push_options)                                   \
+      KTX_ASTCENC_PRAGMA(GCC target(isa))
+  #define KTX_ASTCENC_TARGET_END KTX_ASTCENC_PRAGMA(GCC pop_options)
+#else
+  // MSVC compiles intrinsics of any ISA without /arch.
+  #define KTX_ASTCENC_TARGET_BEGIN(isa)
+  #define KTX_ASTCENC_TARGET_END
+#endif
+
+// Declare the API inside the ISA's namespace before any astcenc source is
+// included. Without this the unqualified calls astcenc makes to its own API
+// would find the global declarations from astcenc.h, whose definitions are
+// not compiled, instead of the namespaced definitions. The using declaration
+// stops astcenc's vector abs() hiding the C library's abs(int).
+#define KTX_ASTCENC_DECLARE_API                                              \
+    struct astcenc_context;                                                  \
+    astcenc_error astcenc_config_init(astcenc_profile profile,               \
+        unsigned int block_x, unsigned int block_y, unsigned int block_z,    \
+        float quality, unsigned int flags, astcenc_config* config);          \
+    astcenc_error astcenc_context_alloc(const astcenc_config* config,        \
+        unsigned int thread_count, astcenc_context** context);               \
+    astcenc_error astcenc_compress_image(astcenc_context* context,           \
+        astcenc_image* image, const astcenc_swizzle* swizzle,                \
+        uint8_t* data_out, size_t data_len, unsigned int thread_index);      \
+    astcenc_error astcenc_compress_reset(astcenc_context* context);          \
+    astcenc_error astcenc_decompress_image(astcenc_context* context,         \
+        const uint8_t* data, size_t data_len, astcenc_image* image_out,      \
+        const astcenc_swizzle* swizzle, unsigned int thread_index);          \
+    astcenc_error astcenc_decompress_reset(astcenc_context* context);        \
+    void astcenc_context_free(astcenc_context* context);                     \
+    astcenc_error astcenc_get_block_info(astcenc_context* context,           \
+        const uint8_t data[16], astcenc_block_info* info);                   \
+    const char* astcenc_get_error_string(astcenc_error status);              \
+    extern const ktxAstcencFuncs astcencFuncs;                               \
+    bool cpu_supports_sse41();                                               \
+    bool cpu_supports_popcnt();                                              \
+    bool cpu_supports_f16c();                                                \
+    bool cpu_supports_avx2();                                                \
+    using ::abs;
+
+#endif /* ASTCENC_DISPATCH_ISA_H */
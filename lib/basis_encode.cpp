@@ -18,8 +18,13 @@
  * @author Mark Callow, www.edgewise-consulting.com
  */
 
+#include <cstddef>
+#include <cstring>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <functional>
+#include <memory>
+#include <vector>
 #include <zstd.h>
 #include <KHR/khr_df.h>
 
@@ -29,6 +34,7 @@
 #include "vkformat_enum.h"
 #include "vk_format.h"
 #include "basis_sgd.h"
+#include "threadpool.h"
 #if (EMSCRIPTEN)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-parameter"
@@ -44,6 +50,10 @@
 using namespace basisu;
 using namespace basist;
 
+// Size of ktxBasisParams before threadPool was appended.
+static const ktx_uint32_t ktxBasisParams_v1Size =
+    offsetof(ktxBasisParams, uastcRDONoMultithreading) + sizeof(ktx_bool_t);
+
 typedef struct ktxBasisParamsV1 {
     ktx_uint32_t structSize;
     ktx_uint32_t threadCount;
@@ -365,6 +375,438 @@ ktxTexture2_rewriteDfd4Uastc(ktxTexture2* This,
 
 static bool basisuEncoderInitialized = false;
 
+// State for lending the threads of a ktxThreadPool to a basisu job_pool
+// created with external workers.
+struct lent_job_pool {
+    job_pool& jpool;
+    const std::function<void()>& body;
+};
+
+static KTX_error_code
+serve_lent_job_pool(void* userdata, ktx_uint32_t, ktx_uint32_t job)
+{
+    lent_job_pool& lent = *static_cast<lent_job_pool*>(userdata);
+    if (job == 0) {
+        // wait_for_all() runs queued jobs on this thread so body completes
+        // however few of the other jobs the pool gets round to starting.
+        lent.body();
+        lent.jpool.stop_workers();
+    } else {
+        lent.jpool.run_worker();
+    }
+    return KTX_SUCCESS;
+}
+
+// Run body, which uses jpool, while the threads of pool serve jpool.
+static void
+run_with_lent_workers(ktxThreadPool* pool, job_pool& jpool,
+                      const std::function<void()>& body)
+{
+    lent_job_pool lent = { jpool, body };
+    ktxThreadPool_run(pool, (ktx_uint32_t)jpool.get_total_threads(),
+                      serve_lent_job_pool, &lent);
+}
+
+// State shared by the jobs encoding one image to UASTC. Each job encodes
+// one row of blocks.
+struct uastc_image_jobs {
+    const uint8_t* src;         // The image in the texture's format.
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_components;
+    uint32_t num_blocks_x;
+    PFNBUCOPYCB copycb;
+    swizzle_e* comp_mapping;
+    uint32_t uastc_flags;
+    bool check_alpha;           // False if the images are known to be opaque.
+    basist::uastc_block* dst;
+    color_rgba* block_pixels;   // If not null, RGBA pixels of each block are
+                                // kept here for the RDO post-process.
+    std::vector<uint8_t> row_has_alpha;
+};
+
+static KTX_error_code
+encode_uastc_block_row(void* userdata, ktx_uint32_t, ktx_uint32_t block_y)
+{
+    uastc_image_jobs& jobs = *static_cast<uastc_image_jobs*>(userdata);
+    const uint32_t nc = jobs.num_components;
+    uint8_t src_pixels[16 * 4];
+    color_rgba local_pixels[16];
+    bool has_alpha = false;
+
+    for (uint32_t block_x = 0; block_x < jobs.num_blocks_x; block_x++) {
+        uint32_t block = block_y * jobs.num_blocks_x + block_x;
+        color_rgba* pixels = jobs.block_pixels
+                           ? jobs.block_pixels + block * 16 : local_pixels;
+
+        // Gather the block's pixels, replicating the edge pixels when the
+        // block extends beyond the image as basis_compressor does.
+        for (uint32_t y = 0; y < 4; y++) {
+            uint32_t sy = minimum(block_y * 4 + y, jobs.height - 1);
+            for (uint32_t x = 0; x < 4; x++) {
+                uint32_t sx = minimum(block_x * 4 + x, jobs.width - 1);
+                memcpy(&src_pixels[(y * 4 + x) * nc],
+                       jobs.src + ((size_t)sy * jobs.width + sx) * nc, nc);
+            }
+        }
+        jobs.copycb(reinterpret_cast<uint8_t*>(pixels), src_pixels, nc,
+                    16 * nc, jobs.comp_mapping);
+        if (jobs.check_alpha) {
+            for (uint32_t i = 0; i < 16; i++)
+                has_alpha |= pixels[i].a != 255;
+        }
+
+        encode_uastc(&pixels[0].r, jobs.dst[block], jobs.uastc_flags);
+    }
+    jobs.row_has_alpha[block_y] = has_alpha;
+    return KTX_SUCCESS;
+}
+
+// Encode the images of This to UASTC one at a time, writing the blocks
+// straight into the new level data. Unlike going through basis_compressor
+// only the source texture, its encoded data and, when RDO is enabled, the
+// RGBA pixels of a single image are in memory at once. The result is
+// identical to basis_compressor's as it performs the same steps per image.
+static KTX_error_code
+ktxTexture2_encodeUastc(ktxTexture2* This, ktxBasisParams* params,
+                        PFNBUCOPYCB copycb, swizzle_e* comp_mapping,
+                        uint32_t num_components,
+                        alpha_content_e alphaContent, bool isLuminance)
+{
+    ktxTexture2_private& priv = *This->_private;
+    std::vector<ktx_size_t> level_offsets(This->numLevels);
+    std::vector<ktx_size_t> level_lengths(This->numLevels);
+    ktx_size_t image_data_size = 0;
+    // UASTC levels must be aligned to the block size.
+    const uint32_t level_alignment = sizeof(uastc_block);
+    KTX_error_code result;
+
+    // Enforce the limits basis_compressor checks when given the images.
+    if (This->baseWidth > BASISU_MAX_SUPPORTED_TEXTURE_DIMENSION
+        || This->baseHeight > BASISU_MAX_SUPPORTED_TEXTURE_DIMENSION)
+        return KTX_INVALID_OPERATION;
+    uint64_t num_images = 0;
+    for (uint32_t level = 0; level < This->numLevels; level++) {
+        num_images += (uint64_t)This->numLayers * This->numFaces
+                    * MAX(1, This->baseDepth >> level);
+    }
+    if (num_images > BASISU_MAX_SLICES)
+        return KTX_INVALID_OPERATION;
+
+    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
+        uint32_t width = MAX(1, This->baseWidth >> level);
+        uint32_t height = MAX(1, This->baseHeight >> level);
+        uint32_t depth = MAX(1, This->baseDepth >> level);
+        ktx_size_t image_length = (ktx_size_t)((width + 3) / 4)
+                                * ((height + 3) / 4) * sizeof(uastc_block);
+        level_offsets[level] = image_data_size;
+        level_lengths[level] = image_length * This->numLayers
+                             * This->numFaces * depth;
+        image_data_size += _KTX_PADN(level_alignment, level_lengths[level]);
+    }
+
+    uint8_t* new_data = (uint8_t*)malloc(image_data_size);
+    if (!new_data)
+        return KTX_OUT_OF_MEMORY;
+
+    ktxThreadPool* pool = params->threadPool;
+    ktx_uint32_t threadCount;
+    if (pool) {
+        threadCount = ktxThreadPool_workerCount(pool);
+    } else {
+        threadCount = params->threadCount;
+        if (threadCount < 1)
+            threadCount = 1;
+        result = ktxThreadPool_Create(threadCount, &pool);
+        if (result != KTX_SUCCESS) {
+            free(new_data);
+            return result;
+        }
+    }
+
+    uint32_t uastc_flags = params->uastcFlags;
+    bool rdo_multithreading = !params->uastcRDONoMultithreading;
+    uastc_rdo_params rdo_params;
+    std::unique_ptr<job_pool> rdo_pool;
+    if (params->uastcRDO) {
+        if (!params->uastcRDODontFavorSimplerModes)
+            uastc_flags |= cPackUASTCFavorSimplerModes;
+        // Same defaults and ranges as basis_compressor_params.
+        rdo_params.m_lambda = params->uastcRDOQualityScalar > 0.0f
+                    ? clamp(params->uastcRDOQualityScalar, 0.001f, 50.0f)
+                    : 1.0f;
+        rdo_params.m_lz_dict_size = params->uastcRDODictSize > 0
+                    ? clamp<int>(params->uastcRDODictSize,
+                                 BASISU_RDO_UASTC_DICT_SIZE_MIN,
+                                 BASISU_RDO_UASTC_DICT_SIZE_MAX)
+                    : BASISU_RDO_UASTC_DICT_SIZE_DEFAULT;
+        if (params->uastcRDOMaxSmoothBlockErrorScale > 0) {
+            rdo_params.m_smooth_block_max_error_scale =
+                    clamp(params->uastcRDOMaxSmoothBlockErrorScale,
+                          1.0f, 300.0f);
+        }
+        if (params->uastcRDOMaxSmoothBlockStdDev > 0) {
+            rdo_params.m_max_smooth_block_std_dev =
+                    clamp(params->uastcRDOMaxSmoothBlockStdDev,
+                          0.01f, 65536.0f);
+        }
+        if (rdo_multithreading)
+            rdo_pool.reset(new job_pool(threadCount,
+                                        params->threadPool != nullptr));
+    }
+
+    bool any_alpha = false;
+    std::vector<color_rgba> block_pixels;
+    uastc_image_jobs jobs;
+    jobs.num_components = num_components;
+    jobs.copycb = copycb;
+    jobs.comp_mapping = comp_mapping;
+    jobs.uastc_flags = uastc_flags;
+    jobs.check_alpha = alphaContent != eNone;
+    for (uint32_t level = 0; level < This->numLevels; level++) {
+        uint32_t width = MAX(1, This->baseWidth >> level);
+        uint32_t height = MAX(1, This->baseHeight >> level);
+        uint32_t depth = MAX(1, This->baseDepth >> level);
+        uint32_t num_blocks_x = (width + 3) / 4;
+        uint32_t num_blocks_y = (height + 3) / 4;
+        uint32_t num_blocks = num_blocks_x * num_blocks_y;
+        uint32_t faceSlices = This->numFaces == 1 ? depth : This->numFaces;
+        uastc_block* dst = reinterpret_cast<uastc_block*>(
+                                          new_data + level_offsets[level]);
+
+        jobs.width = width;
+        jobs.height = height;
+        jobs.num_blocks_x = num_blocks_x;
+        jobs.row_has_alpha.assign(num_blocks_y, 0);
+        if (params->uastcRDO) {
+            block_pixels.resize((size_t)num_blocks * 16);
+            jobs.block_pixels = block_pixels.data();
+        } else {
+            jobs.block_pixels = nullptr;
+        }
+        for (uint32_t layer = 0; layer < This->numLayers; layer++) {
+            for (uint32_t slice = 0; slice < faceSlices; slice++) {
+                ktx_size_t offset;
+                ktxTexture2_GetImageOffset(This, level, layer, slice, &offset);
+                jobs.src = This->pData + offset;
+                jobs.dst = dst;
+                result = ktxThreadPool_run(pool, num_blocks_y,
+                                           encode_uastc_block_row, &jobs);
+                if (result != KTX_SUCCESS) {
+                    if (pool != params->threadPool)
+                        ktxThreadPool_Destroy(pool);
+                    free(new_data);
+                    return result;
+                }
+                for (uint8_t a : jobs.row_has_alpha)
+                    any_alpha |= a != 0;
+
+                if (params->uastcRDO) {
+                    uint32_t rdo_jobs = rdo_pool
+                                      ? minimum<uint32_t>(4, threadCount) : 0;
+                    bool ok = true;
+                    auto rdo = [&] {
+                        ok = uastc_rdo(num_blocks, dst, block_pixels.data(),
+                                       rdo_params, params->uastcFlags,
+                                       rdo_pool.get(), rdo_jobs);
+                    };
+                    if (rdo_pool && params->threadPool)
+                        run_with_lent_workers(pool, *rdo_pool, rdo);
+                    else
+                        rdo();
+                    if (!ok) {
+                        if (pool != params->threadPool)
+                            ktxThreadPool_Destroy(pool);
+                        free(new_data);
+                        return KTX_INVALID_OPERATION;
+                    }
+                }
+                dst += num_blocks;
+            }
+        }
+    }
+    if (pool != params->threadPool)
+        ktxThreadPool_Destroy(pool);
+
+    // The DFD must reflect the encoded data. As basis_compressor does, treat
+    // images whose alpha is 255 everywhere as having no alpha.
+    if (!any_alpha)
+        alphaContent = eNone;
+    result = ktxTexture2_rewriteDfd4Uastc(This, alphaContent, isLuminance,
+                                          comp_mapping);
+    if (result != KTX_SUCCESS) {
+        free(new_data);
+        return result;
+    }
+
+    ktxFormatSize& formatSize = This->_protected->_formatSize;
+    ktxFormatSize_initFromDfd(&formatSize, This->pDfd);
+    priv._requiredLevelAlignment = level_alignment;
+    This->vkFormat = VK_FORMAT_UNDEFINED;
+    This->isCompressed = KTX_TRUE;
+    // Block-compressed textures never need byte swapping so typeSize is 1.
+    assert(This->_protected->_typeSize == 1);
+
+    ktxTexture_freeData(ktxTexture(This));
+    This->pData = new_data;
+    This->dataSize = image_data_size;
+    for (uint32_t level = 0; level < This->numLevels; level++) {
+        priv._levelIndex[level].byteOffset = level_offsets[level];
+        priv._levelIndex[level].byteLength = level_lengths[level];
+        priv._levelIndex[level].uncompressedByteLength = level_lengths[level];
+    }
+    return KTX_SUCCESS;
+}
+
+// Receives the ETC1S slices and codebooks from basis_compressor and lays them
+// out as KTX2 level data and BasisLZ global data. This avoids creating a
+// .basis file only to parse it and copy everything out again.
+class ktxBasisLzEtc1sSink : public basis_compressor_output_sink {
+  public:
+    ktxBasisLzEtc1sSink(ktxTexture2* texture)
+        : This(texture), levelIndex(texture->numLevels) { }
+    ~ktxBasisLzEtc1sSink() {
+        free(bgd);
+        free(levelData);
+    }
+
+    bool consume(basisu_backend_output& output) override;
+
+    ktxTexture2* This;
+    std::vector<ktxLevelIndexEntry> levelIndex;
+    uint8_t* bgd = nullptr;
+    size_t bgdSize = 0;
+    uint8_t* levelData = nullptr;
+    size_t levelDataSize = 0;
+    bool hasAlpha = false;
+};
+
+bool
+ktxBasisLzEtc1sSink::consume(basisu_backend_output& output)
+{
+    const basisu_backend_slice_desc_vec& slices = output.m_slice_desc;
+
+    // The encoder removes the alpha channel if every alpha pixel in every
+    // image is 255. Otherwise every image has an alpha slice following its
+    // rgb slice.
+    for (uint32_t i = 0; i < slices.size(); i++)
+        hasAlpha |= slices[i].m_alpha;
+    const uint32_t slicesPerImage = hasAlpha ? 2 : 1;
+    const uint32_t numImages = (uint32_t)slices.size() / slicesPerImage;
+    assert(!output.m_uses_global_codebooks);
+
+    //
+    // Allocate supercompression global data and write its header.
+    //
+    bgdSize = sizeof(ktxBasisLzGlobalHeader)
+            + sizeof(ktxBasisLzEtc1sImageDesc) * numImages
+            + output.m_endpoint_palette.size()
+            + output.m_selector_palette.size()
+            + output.m_slice_image_tables.size();
+    bgd = (uint8_t*)malloc(bgdSize);
+    if (!bgd)
+        return false;
+    ktxBasisLzGlobalHeader& bgdh = *reinterpret_cast<ktxBasisLzGlobalHeader*>(bgd);
+    bgdh.endpointCount = (uint16_t)output.m_num_endpoints;
+    bgdh.endpointsByteLength = (uint32_t)output.m_endpoint_palette.size();
+    bgdh.selectorCount = (uint16_t)output.m_num_selectors;
+    bgdh.selectorsByteLength = (uint32_t)output.m_selector_palette.size();
+    bgdh.tablesByteLength = (uint32_t)output.m_slice_image_tables.size();
+    bgdh.extendedByteLength = 0;
+
+    //
+    // Write the image descriptions and calculate the level layout.
+    //
+
+    ktxBasisLzEtc1sImageDesc* kimages = BGD_ETC1S_IMAGE_DESCS(bgd);
+
+    // Slices are in the order we passed the images to the compressor, i.e.
+    // ordered by mip level then layer then face or slice. Image descriptor
+    // offsets are relative to the start of the mip level.
+    uint32_t image = 0;
+    for (uint32_t level = 0; level < This->numLevels; level++) {
+        uint32_t depth = MAX(1, This->baseDepth >> level);
+        uint32_t faceSlices = This->numFaces == 1 ? depth : This->numFaces;
+        uint64_t levelByteLength = 0;
+
+        for (uint32_t i = 0; i < This->numLayers * faceSlices; i++, image++) {
+            const uint32_t rgbSlice = image * slicesPerImage;
+            const uint32_t rgbLength
+                    = (uint32_t)output.m_slice_image_data[rgbSlice].size();
+            assert(!slices[rgbSlice].m_alpha);
+            kimages[image].rgbSliceByteOffset = (uint32_t)levelByteLength;
+            kimages[image].rgbSliceByteLength = rgbLength;
+            levelByteLength += rgbLength;
+            if (hasAlpha) {
+                const uint32_t alphaLength
+                    = (uint32_t)output.m_slice_image_data[rgbSlice + 1].size();
+                kimages[image].alphaSliceByteOffset = (uint32_t)levelByteLength;
+                kimages[image].alphaSliceByteLength = alphaLength;
+                levelByteLength += alphaLength;
+            } else {
+                kimages[image].alphaSliceByteOffset = 0;
+                kimages[image].alphaSliceByteLength = 0;
+            }
+            // Set the PFrame flag, inverse of the encoder's IFrame flag.
+            if (This->isVideo && !slices[rgbSlice].m_iframe)
+                kimages[image].imageFlags = eBUImageIsPframe;
+            else
+                kimages[image].imageFlags = 0;
+        }
+        levelIndex[level].byteLength = levelByteLength;
+        levelIndex[level].uncompressedByteLength = 0;
+    }
+    assert(image == numImages);
+
+    //
+    // Copy the global code books & huffman tables to global data.
+    //
+
+    // As image is now the number of image descriptions, &kimages[image]
+    // points at the first byte where the endpoints, etc. must be written.
+    uint8_t* dstptr = reinterpret_cast<uint8_t*>(&kimages[image]);
+    if (bgdh.endpointsByteLength)
+        memcpy(dstptr, &output.m_endpoint_palette[0], bgdh.endpointsByteLength);
+    dstptr += bgdh.endpointsByteLength;
+    if (bgdh.selectorsByteLength)
+        memcpy(dstptr, &output.m_selector_palette[0], bgdh.selectorsByteLength);
+    dstptr += bgdh.selectorsByteLength;
+    if (bgdh.tablesByteLength)
+        memcpy(dstptr, &output.m_slice_image_tables[0], bgdh.tablesByteLength);
+    assert((size_t)(dstptr + bgdh.tablesByteLength - bgd) == bgdSize);
+
+    //
+    // Copy the slices to the level data, smallest level first.
+    //
+
+    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
+        levelIndex[level].byteOffset = levelDataSize;
+        levelDataSize += levelIndex[level].byteLength;
+    }
+    levelData = (uint8_t*)malloc(levelDataSize);
+    if (!levelData)
+        return false;
+
+    uint32_t slice = 0;
+    for (uint32_t level = 0; level < This->numLevels; level++) {
+        uint32_t depth = MAX(1, This->baseDepth >> level);
+        uint32_t faceSlices = This->numFaces == 1 ? depth : This->numFaces;
+        uint32_t levelSlices = This->numLayers * faceSlices * slicesPerImage;
+        uint8_t* dst = levelData + levelIndex[level].byteOffset;
+
+        for (uint32_t i = 0; i < levelSlices; i++, slice++) {
+            uint8_vec& data = output.m_slice_image_data[slice];
+            memcpy(dst, data.data(), data.size());
+            dst += data.size();
+            // Free each slice as it is copied to limit peak memory use.
+            uint8_vec().swap(data);
+        }
+        assert(dst == levelData + levelIndex[level].byteOffset
+                      + levelIndex[level].byteLength);
+    }
+    return true;
+}
+
 /**
  * @memberof ktxTexture2
  * @ingroup writer
@@ -413,8 +855,15 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
     if (!params)
         return KTX_INVALID_VALUE;
 
-    if (params->structSize != sizeof(struct ktxBasisParams))
+    // Accept the struct from before threadPool was appended as well as the
+    // current one. Fields beyond the caller's structSize default to 0.
+    if (params->structSize < ktxBasisParams_v1Size
+        || params->structSize > sizeof(struct ktxBasisParams))
         return KTX_INVALID_VALUE;
+    ktxBasisParams paramsCopy;
+    memset(&paramsCopy, 0, sizeof(paramsCopy));
+    memcpy(&paramsCopy, params, params->structSize);
+    params = &paramsCopy;
 
     if (This->supercompressionScheme != KTX_SS_NONE)
         return KTX_INVALID_OPERATION; // Can't apply multiple schemes.
@@ -470,15 +919,6 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
         num_images += layersFaces * MAX(This->baseDepth >> (level - 1), 1);
     }
 
-    //
-    // Copy images into compressor parameters.
-    //
-    // Darn it! m_source_images is a vector of an internal image class which
-    // has its own array of RGBA-only pixels. Pending modifications to the
-    // basisu code we'll have to copy in the images.
-    cparams.m_source_images.resize(num_images);
-    basisu::vector<image>::iterator iit = cparams.m_source_images.begin();
-
     // Since we have to copy the data into the vector image anyway do the
     // separation here to avoid another loop over the image inside
     // basis_compressor.
@@ -584,6 +1024,41 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
         }
     }
 
+    // The images copycb makes are opaque when the swizzle sets alpha to
+    // one or, without a swizzle, the input is RGB. Their alpha is 255
+    // everywhere so the UASTC row encoder need not look at it. This only
+    // helps UASTC. For ETC1S basis_compressor still scans every image for
+    // alpha. Clearing m_check_for_alpha would not avoid that pass, it
+    // makes basis_compressor set every alpha to 255 instead.
+    if (comp_mapping ? comp_mapping[3] == ONE : num_components == 3)
+        alphaContent = eNone;
+
+    if (params->uastc) {
+        // UASTC blocks are encoded independently so there is no need to
+        // gather every image before encoding as basis_compressor does.
+#if BASISU_SUPPORT_SSE
+        bool prevSSESupport = g_cpu_supports_sse41;
+        if (params->noSSE)
+            g_cpu_supports_sse41 = false;
+#endif
+        result = ktxTexture2_encodeUastc(This, params, copycb, comp_mapping,
+                                         num_components, alphaContent,
+                                         isLuminance);
+#if BASISU_SUPPORT_SSE
+        g_cpu_supports_sse41 = prevSSESupport;
+#endif
+        return result;
+    }
+
+    //
+    // Copy images into compressor parameters.
+    //
+    // Darn it! m_source_images is a vector of an internal image class which
+    // has its own array of RGBA-only pixels. Pending modifications to the
+    // basisu code we'll have to copy in the images.
+    cparams.m_source_images.resize(num_images);
+    basisu::vector<image>::iterator iit = cparams.m_source_images.begin();
+
     // NOTA BENE: It is advantageous for Basis LZ compression to order
     // mipmap levels from largest to smallest.
     for (uint32_t level = 0; level < This->numLevels; level++) {
@@ -605,18 +1080,25 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
         }
     }
 
-    free(This->pData); // No longer needed. Reduce memory footprint.
-    This->pData = NULL;
+    // No longer needed. Reduce memory footprint.
+    ktxTexture_freeData(ktxTexture(This));
     This->dataSize = 0;
 
     //
     // Setup rest of compressor parameters
     //
 
-    ktx_uint32_t threadCount = params->threadCount;
-    if (threadCount < 1)
-        threadCount = 1;
-    job_pool jpool(threadCount);
+    // With a caller's pool, its threads are lent to the job_pool while
+    // compressing instead of the job_pool creating its own.
+    ktx_uint32_t threadCount;
+    if (params->threadPool) {
+        threadCount = ktxThreadPool_workerCount(params->threadPool);
+    } else {
+        threadCount = params->threadCount;
+        if (threadCount < 1)
+            threadCount = 1;
+    }
+    job_pool jpool(threadCount, params->threadPool != nullptr);
     cparams.m_pJob_pool = &jpool;
 
 #if BASISU_SUPPORT_SSE
@@ -633,82 +1115,55 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
 
     cparams.m_mip_gen = false; // We provide the mip levels.
 
-    cparams.m_uastc = params->uastc;
-    if (params->uastc) {
-        cparams.m_pack_uastc_flags = params->uastcFlags;
-        if (params->uastcRDO) {
-            cparams.m_rdo_uastc = true;
-            if (params->uastcRDOQualityScalar > 0.0f) {
-                cparams.m_rdo_uastc_quality_scalar =
-                                params->uastcRDOQualityScalar;
-            }
-            if (params->uastcRDODictSize > 0) {
-                cparams.m_rdo_uastc_dict_size = params->uastcRDODictSize;
-            }
-            if (params->uastcRDOMaxSmoothBlockErrorScale > 0) {
-              cparams.m_rdo_uastc_max_smooth_block_error_scale =
-                               params->uastcRDOMaxSmoothBlockErrorScale;
-            }
-            if (params->uastcRDOMaxSmoothBlockStdDev > 0) {
-                cparams.m_rdo_uastc_smooth_block_max_std_dev =
-                                params->uastcRDOMaxSmoothBlockStdDev;
-            }
-            cparams.m_rdo_uastc_favor_simpler_modes_in_rdo_mode =
-                                    !params->uastcRDODontFavorSimplerModes;
-            cparams.m_rdo_uastc_favor_simpler_modes_in_rdo_mode =
-                                    !params->uastcRDONoMultithreading;
-        }
+    // ETC1S-related params.
+    //
+    // Explicit specification is required as 0 is a valid value
+    // in the basis_compressor leaving us without a good way to
+    // indicate the parameter has not been set by the caller. (If we
+    // leave m_compression_level unset it will default to 1. We don't
+    // want the default to differ from `basisu` so 0 can't be the default.
+    cparams.m_compression_level = params->compressionLevel;
+
+    // There's no default for m_quality_level. `basisu` tool overrides
+    // any explicit m_{endpoint,selector}_clusters settings with those
+    // calculated from m_quality_level, if the user set that option. On
+    // the other hand the basis_compressor overrides the values of
+    // m_{endpoint,selector}_rdo_thresh calculated from m_quality_level
+    // with explicit settings made by the user. Note that, unlike the
+    // first pair where both have to be set, each of the second pair
+    // independently override the value for it calculated from
+    // m_quality_level.
+    //
+    // This is confusing for the user and tricky to document clearly.
+    // Therefore we override qualityLevel if both of max{Endpoint,Selector}s
+    // have been set so both sets of parameters are treated the same,
+    // except that intentionally we require the caller to have set both
+    // of max{Endpoint,Selector}s
+    if (params->maxEndpoints && params->maxSelectors) {
+        cparams.m_max_endpoint_clusters = params->maxEndpoints;
+        cparams.m_max_selector_clusters = params->maxSelectors;
+        // cparams.m_quality_level = -1; // Default setting.
+    } else if (params->qualityLevel != 0) {
+        cparams.m_max_endpoint_clusters = 0;
+        cparams.m_max_selector_clusters = 0;
+        cparams.m_quality_level = params->qualityLevel;
     } else {
-        // ETC1S-related params.
-
-        // Explicit specification is required as 0 is a valid value
-        // in the basis_compressor leaving us without a good way to
-        // indicate the parameter has not been set by the caller. (If we
-        // leave m_compression_level unset it will default to 1. We don't
-        // want the default to differ from `basisu` so 0 can't be the default.
-        cparams.m_compression_level = params->compressionLevel;
-
-        // There's no default for m_quality_level. `basisu` tool overrides
-        // any explicit m_{endpoint,selector}_clusters settings with those
-        // calculated from m_quality_level, if the user set that option. On
-        // the other hand the basis_compressor overrides the values of
-        // m_{endpoint,selector}_rdo_thresh calculated from m_quality_level
-        // with explicit settings made by the user. Note that, unlike the
-        // first pair where both have to be set, each of the second pair
-        // independently override the value for it calculated from
-        // m_quality_level.
-        //
-        // This is confusing for the user and tricky to document clearly.
-        // Therefore we override qualityLevel if both of max{Endpoint,Selector}s
-        // have been set so both sets of parameters are treated the same,
-        // except that intentionally we require the caller to have set both
-        // of max{Endpoint,Selector}s
-        if (params->maxEndpoints && params->maxSelectors) {
-            cparams.m_max_endpoint_clusters = params->maxEndpoints;
-            cparams.m_max_selector_clusters = params->maxSelectors;
-            // cparams.m_quality_level = -1; // Default setting.
-        } else if (params->qualityLevel != 0) {
-            cparams.m_max_endpoint_clusters = 0;
-            cparams.m_max_selector_clusters = 0;
-            cparams.m_quality_level = params->qualityLevel;
-        } else {
-            cparams.m_max_endpoint_clusters = 0;
-            cparams.m_max_selector_clusters = 0;
-            cparams.m_quality_level = 128;
-        }
+        cparams.m_max_endpoint_clusters = 0;
+        cparams.m_max_selector_clusters = 0;
+        cparams.m_quality_level = 128;
+    }
 
-        if (params->endpointRDOThreshold > 0)
-            cparams.m_endpoint_rdo_thresh = params->endpointRDOThreshold;
-        if (params->selectorRDOThreshold > 0)
-            cparams.m_selector_rdo_thresh = params->selectorRDOThreshold;
+    if (params->endpointRDOThreshold > 0)
+        cparams.m_endpoint_rdo_thresh = params->endpointRDOThreshold;
+    if (params->selectorRDOThreshold > 0)
+        cparams.m_selector_rdo_thresh = params->selectorRDOThreshold;
 
-        if (params->normalMap) {
-            cparams.m_no_endpoint_rdo = true;
-            cparams.m_no_selector_rdo = true;
-        } else {
-            cparams.m_no_endpoint_rdo = params->noEndpointRDO;
-            cparams.m_no_selector_rdo = params->noSelectorRDO;
-        }
+    if (params->normalMap) {
+        cparams.m_no_endpoint_rdo = true;
+        cparams.m_no_selector_rdo = true;
+    } else {
+        cparams.m_no_endpoint_rdo = params->noEndpointRDO;
+        cparams.m_no_selector_rdo = params->noSelectorRDO;
     }
 
     // Flip images across Y axis
@@ -756,6 +1211,13 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
     g_debug_printf = true;
 #endif
 
+    // Have the encoder hand its output straight to us rather than
+    // creating a .basis file.
+    ktxBasisLzEtc1sSink sink(This);
+#if !DUMP_BASIS_FILE
+    cparams.m_pOutput_sink = &sink;
+#endif
+
     basis_compressor c;
 
     // As we don't use it, file reading support has been removed from the
@@ -768,7 +1230,12 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
     (void)c.init(cparams);
     //enable_debug_printf(true);
 
-    basis_compressor::error_code ec = c.process();
+    basis_compressor::error_code ec;
+    auto process = [&] { ec = c.process(); };
+    if (params->threadPool)
+        run_with_lent_workers(params->threadPool, jpool, process);
+    else
+        process();
 
     if (ec != basis_compressor::cECSuccess) {
         // We should be sending valid 2d arrays, cubemaps or video ...
@@ -814,168 +1281,17 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
     return KTX_UNSUPPORTED_FEATURE;
 #endif
 
-    //
-    // Compression successful. Now we have to unpick the basis output and
-    // copy the info and images to This texture.
-    //
-
 #if BASISU_SUPPORT_SSE
     g_cpu_supports_sse41 = prevSSESupport;
 #endif
 
-    const uint8_vec& bf = c.get_output_basis_file();
-    const basis_file_header& bfh = *reinterpret_cast<const basis_file_header*>(bf.data());
-
-    assert(bfh.m_total_images == num_images);
-
-    uint8_t* bgd = nullptr;
-    size_t bgd_size;
-    uint32_t image_data_size = 0;
-    ktxTexture2_private& priv = *This->_private;
-    uint32_t base_offset = bfh.m_slice_desc_file_ofs;
-    const basis_slice_desc* slice
-            = reinterpret_cast<const basis_slice_desc*>(&bf[base_offset]);
-    std::vector<uint32_t> level_file_offsets(This->numLevels);
-
-    if (params->uastc) {
-        for (uint32_t level = 0; level < This->numLevels; level++) {
-            uint32_t depth = MAX(1, This->baseDepth >> level);
-            uint32_t levelByteLength = 0;
-            uint32_t levelImageCount = This->numLayers * This->numFaces * depth;
-
-            level_file_offsets[level] = slice->m_file_ofs;
-            for (uint32_t image = 0; image < levelImageCount; image++, slice++) {
-                image_data_size += slice->m_file_size;
-                levelByteLength += slice->m_file_size;
-            }
-            priv._levelIndex[level].byteLength = levelByteLength;
-            priv._levelIndex[level].uncompressedByteLength = levelByteLength;
-        }
-    } else {
-        //
-        // Allocate supercompression global data and write its header.
-        //
-        uint32_t image_desc_size = sizeof(ktxBasisLzEtc1sImageDesc);
-
-        bgd_size = sizeof(ktxBasisLzGlobalHeader)
-                 + image_desc_size * num_images
-                 + bfh.m_endpoint_cb_file_size + bfh.m_selector_cb_file_size
-                 + bfh.m_tables_file_size;
-        bgd = new ktx_uint8_t[bgd_size];
-        ktxBasisLzGlobalHeader& bgdh = *reinterpret_cast<ktxBasisLzGlobalHeader*>(bgd);
-        bgdh.endpointCount = (uint16_t)bfh.m_total_endpoints;
-        bgdh.endpointsByteLength = bfh.m_endpoint_cb_file_size;
-        bgdh.selectorCount = (uint16_t)bfh.m_total_selectors;
-        bgdh.selectorsByteLength = bfh.m_selector_cb_file_size;
-        bgdh.tablesByteLength = bfh.m_tables_file_size;
-        bgdh.extendedByteLength = 0;
-
-        //
-        // Write the index of slice descriptions to the global data.
-        //
-
-        ktxBasisLzEtc1sImageDesc* kimages = BGD_ETC1S_IMAGE_DESCS(bgd);
-
-        // 3 things to remember about offsets:
-        //    1. levelIndex offsets at this point are relative to This->pData;
-        //    2. In the ktx image descriptors, slice offsets are relative to the
-        //       start of the mip level;
-        //    3. basis_slice_desc offsets are relative to the end of the basis
-        //       header. Hence base_offset set above is used to rebase offsets
-        //       relative to the start of the slice data.
-
-        // Assumption here is that slices produced by the compressor are in the
-        // same order as we passed them in above, i.e. ordered by mip level.
-        // Note also that slice->m_level_index is always 0, unless the compressor
-        // generated mip levels, so essentially useless. Alpha slices are always
-        // the odd numbered slices.
-        uint32_t image = 0;
-        for (uint32_t level = 0; level < This->numLevels; level++) {
-            uint32_t depth = MAX(1, This->baseDepth >> level);
-            uint32_t level_byte_length = 0;
-
-            assert(!(slice->m_flags & cSliceDescFlagsHasAlpha));
-            level_file_offsets[level] = slice->m_file_ofs;
-            for (uint32_t layer = 0; layer < This->numLayers; layer++) {
-                uint32_t faceSlices = This->numFaces == 1 ? depth
-                                                          : This->numFaces;
-                for (uint32_t faceSlice = 0; faceSlice < faceSlices; faceSlice++) {
-                    level_byte_length += slice->m_file_size;
-                    kimages[image].rgbSliceByteOffset = slice->m_file_ofs
-                                                   - level_file_offsets[level];
-                    kimages[image].rgbSliceByteLength = slice->m_file_size;
-                    if (bfh.m_flags & cBASISHeaderFlagHasAlphaSlices) {
-                        slice++;
-                        level_byte_length += slice->m_file_size;
-                        kimages[image].alphaSliceByteOffset =
-                                slice->m_file_ofs - level_file_offsets[level];
-                        kimages[image].alphaSliceByteLength =
-                                slice->m_file_size;
-                    } else {
-                        kimages[image].alphaSliceByteOffset = 0;
-                        kimages[image].alphaSliceByteLength = 0;
-                    }
-                    // Set the PFrame flag, inverse of the .basis IFrame flag.
-                    if (This->isVideo) {
-                        // Extract FrameIsIFrame
-                        kimages[image].imageFlags =
-                                    (slice->m_flags & ~cSliceDescFlagsHasAlpha);
-                        // Set our flag to the inverse.
-                        kimages[image].imageFlags ^=
-                                    cSliceDescFlagsFrameIsIFrame;
-                    } else {
-                        kimages[image].imageFlags = 0;
-                    }
-                    slice++;
-                    image++;
-                }
-            }
-            priv._levelIndex[level].byteLength = level_byte_length;
-            priv._levelIndex[level].uncompressedByteLength = 0;
-            image_data_size += level_byte_length;
-        }
-
-        //
-        // Copy the global code books & huffman tables to global data.
-        //
-
-        // Slightly sleazy but as image is now the last valid index in the
-        // slice description array plus 1, &kimages[image] points at the first
-        // byte where the endpoints, etc. must be written.
-        uint8_t* dstptr = reinterpret_cast<uint8_t*>(&kimages[image]);
-        // Copy the endpoints ...
-        memcpy(dstptr,
-               &bf[bfh.m_endpoint_cb_file_ofs],
-               bfh.m_endpoint_cb_file_size);
-        dstptr += bgdh.endpointsByteLength;
-        // selectors ...
-        memcpy(dstptr,
-               &bf[bfh.m_selector_cb_file_ofs],
-               bfh.m_selector_cb_file_size);
-        dstptr += bgdh.selectorsByteLength;
-        // and the huffman tables.
-        memcpy(dstptr,
-               &bf[bfh.m_tables_file_ofs],
-               bfh.m_tables_file_size);
-
-        assert((size_t)(dstptr + bgdh.tablesByteLength - bgd) <= bgd_size);
-
-        //
-        // We have a complete global data package.
-        //
-
-        priv._supercompressionGlobalData = bgd;
-        priv._sgdByteLength = bgd_size;
-    }
-
     //
-    // Update This texture and copy compressed image data to it.
+    // Compression successful. The sink now holds the level data and global
+    // data. Update This texture to use them.
     //
 
-    // Declare here so can use goto cleanup.
-    uint8_t* new_data = 0;
+    ktxTexture2_private& priv = *This->_private;
     ktxFormatSize& formatSize = This->_protected->_formatSize;
-    uint64_t level_offset = 0;
 
     // Since we've left m_check_for_alpha set and m_force_alpha unset in
     // the compressor parameters, the basis encoder will have removed an input
@@ -983,72 +1299,41 @@ ktxTexture2_CompressBasisEx(ktxTexture2* This, ktxBasisParams* params)
     // encoding and supercompression. The DFD needs to reflect the encoded data
     // not the input texture. Override the alphacontent setting, if this has
     // happened.
-    if ((bfh.m_flags & cBASISHeaderFlagHasAlphaSlices) == 0) {
+    if (!sink.hasAlpha) {
         alphaContent = eNone;
     }
 
-    new_data = (uint8_t*) malloc(image_data_size);
-    if (!new_data) {
-        result = KTX_OUT_OF_MEMORY;
-        goto cleanup;
-    }
-
     // Delayed modifying texture until here so it's after points of
     // possible failure.
-    if (params->uastc) {
-        result = ktxTexture2_rewriteDfd4Uastc(This, alphaContent,
-                                              isLuminance,
-                                              comp_mapping);
-        if (result != KTX_SUCCESS) goto cleanup;
-
-        // Reflect this in the formatSize
-        ktxFormatSize_initFromDfd(&formatSize, This->pDfd);
-        // and the requiredLevelAlignment.
-        priv._requiredLevelAlignment = 4 * 4;
-    } else {
-        result = ktxTexture2_rewriteDfd4BasisLzETC1S(This, alphaContent,
-                                                     isLuminance,
-                                                     comp_mapping);
-        if (result != KTX_SUCCESS) goto cleanup;
-
-        This->supercompressionScheme = KTX_SS_BASIS_LZ;
-        // Reflect this in the formatSize
-        ktxFormatSize_initFromDfd(&formatSize, This->pDfd);
-        // and the requiredLevelAlignment.
-        priv._requiredLevelAlignment = 1;
-    }
+    result = ktxTexture2_rewriteDfd4BasisLzETC1S(This, alphaContent,
+                                                 isLuminance,
+                                                 comp_mapping);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    This->supercompressionScheme = KTX_SS_BASIS_LZ;
+    // Reflect this in the formatSize
+    ktxFormatSize_initFromDfd(&formatSize, This->pDfd);
+    // and the requiredLevelAlignment.
+    priv._requiredLevelAlignment = 1;
     This->vkFormat = VK_FORMAT_UNDEFINED;
     This->isCompressed = KTX_TRUE;
 
     // Block-compressed textures never need byte swapping so typeSize is 1.
     assert(This->_protected->_typeSize == 1);
 
-    // Copy in the compressed image data.
+    ktxTexture2_freeBasisLzCodebooks(This);
+    priv._supercompressionGlobalData = sink.bgd;
+    priv._sgdByteLength = sink.bgdSize;
+    sink.bgd = nullptr;
 
-    This->pData = new_data;
-
-    This->dataSize = image_data_size;
-
-    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
-        priv._levelIndex[level].byteOffset = level_offset;
-        // byteLength was set in loop above
-        memcpy(This->pData + level_offset,
-               &bf[level_file_offsets[level]],
-               priv._levelIndex[level].byteLength);
-        level_offset += _KTX_PADN(priv._requiredLevelAlignment,
-                                  priv._levelIndex[level].byteLength);
-    }
+    This->pData = sink.levelData;
+    This->dataSize = sink.levelDataSize;
+    sink.levelData = nullptr;
+    for (uint32_t level = 0; level < This->numLevels; level++)
+        priv._levelIndex[level] = sink.levelIndex[level];
 
     return KTX_SUCCESS;
-
-cleanup:
-    if (bgd) {
-        delete bgd;
-        priv._supercompressionGlobalData = 0;
-        priv._sgdByteLength = 0;
-    }
-    if (new_data) free(new_data);
-    return result;
 }
 
 extern "C" KTX_API const ktx_uint32_t KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL
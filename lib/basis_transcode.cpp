@@ -20,6 +20,8 @@
 
 #include <inttypes.h>
 #include <stdio.h>
+#include <algorithm>
+#include <new>
 #include <KHR/khr_df.h>
 
 #include "dfdutils/dfd.h"
@@ -29,6 +31,7 @@
 #include "vkformat_enum.h"
 #include "vk_format.h"
 #include "basis_sgd.h"
+#include "threadpool.h"
 #include "basisu/transcoder/basisu_file_headers.h"
 #include "basisu/transcoder/basisu_transcoder.h"
 #include "basisu/transcoder/basisu_transcoder_internal.h"
@@ -50,90 +53,52 @@ ktxTexture2_transcodeLzEtc1s(ktxTexture2* This,
                            alpha_content_e alphaContent,
                            ktxTexture2* prototype,
                            ktx_transcode_fmt_e outputFormat,
-                           ktx_transcode_flags transcodeFlags);
+                           ktx_transcode_flags transcodeFlags,
+                           ktxThreadPool* pool, ktx_uint32_t threadCount);
 KTX_error_code
 ktxTexture2_transcodeUastc(ktxTexture2* This,
                            alpha_content_e alphaContent,
                            ktxTexture2* prototype,
                            ktx_transcode_fmt_e outputFormat,
-                           ktx_transcode_flags transcodeFlags);
+                           ktx_transcode_flags transcodeFlags,
+                           ktxThreadPool* pool, ktx_uint32_t threadCount);
+static KTX_error_code
+ktxTexture2_transcodeBasisOn(ktxTexture2* This,
+                             ktx_transcode_fmt_e outputFormat,
+                             ktx_transcode_flags transcodeFlags,
+                             ktxThreadPool* pool, ktx_uint32_t threadCount);
 
 /**
- * @memberof ktxTexture2
+ * @memberof ktxTexture2 @private
  * @ingroup reader
  * @~English
- * @brief Transcode a KTX2 texture with BasisLZ/ETC1S or UASTC images.
- *
- * If the texture contains BasisLZ supercompressed images, Inflates them from
- * back to ETC1S then transcodes them to the specified block-compressed
- * format. If the texture contains UASTC images, inflates them, if they have been
- * supercompressed with zstd, then transcodes then to the specified format, The
- * transcoded images replace the original images and the texture's fields including
- * the DFD are modified to reflect the new format.
- *
- * These types of textures must be transcoded to a desired target
- * block-compressed format before they can be uploaded to a GPU via a
- * graphics API.
- *
- * The following block compressed transcode targets are available: @c KTX_TTF_ETC1_RGB,
- * @c KTX_TTF_ETC2_RGBA, @c KTX_TTF_BC1_RGB, @c KTX_TTF_BC3_RGBA,
- * @c KTX_TTF_BC4_R, @c KTX_TTF_BC5_RG, @c KTX_TTF_BC7_RGBA,
- * @c @c KTX_TTF_PVRTC1_4_RGB, @c KTX_TTF_PVRTC1_4_RGBA,
- * @c KTX_TTF_PVRTC2_4_RGB, @c KTX_TTF_PVRTC2_4_RGBA, @c KTX_TTF_ASTC_4x4_RGBA,
- * @c KTX_TTF_ETC2_EAC_R11, @c KTX_TTF_ETC2_EAC_RG11, @c KTX_TTF_ETC and
- * @c KTX_TTF_BC1_OR_3.
- *
- * @c KTX_TTF_ETC automatically selects between @c KTX_TTF_ETC1_RGB and
- * @c KTX_TTF_ETC2_RGBA according to whether an alpha channel is available. @c KTX_TTF_BC1_OR_3
- * does likewise between @c KTX_TTF_BC1_RGB and @c KTX_TTF_BC3_RGBA. Note that if
- * @c KTX_TTF_PVRTC1_4_RGBA or @c KTX_TTF_PVRTC2_4_RGBA is specified and there is no alpha
- * channel @c KTX_TTF_PVRTC1_4_RGB or @c KTX_TTF_PVRTC2_4_RGB respectively will be selected.
- *
- * Transcoding to ATC & FXT1 formats is not supported by libktx as there
- * are no equivalent Vulkan formats.
+ * @brief Validate a transcode request and prepare for carrying it out.
  *
- * The following uncompressed transcode targets are also available: @c KTX_TTF_RGBA32,
- * @c KTX_TTF_RGB565, KTX_TTF_BGR565 and KTX_TTF_RGBA4444.
- *
- * The following @p transcodeFlags are available.
+ * Checks the texture is transcodable to @p outputFormat, resolves the
+ * alpha-dependent targets such as @c KTX_TTF_ETC to an actual target,
+ * completes any pending load of the image data and initializes the
+ * transcoder.
  *
- * @sa ktxtexture2_CompressBasis().
- *
- * @param[in]   This         pointer to the ktxTexture2 object of interest.
- * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
- *                                             specifying the target format.
- * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
- *                                                operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]     This           pointer to the ktxTexture2 object of interest.
+ * @param[in,out] outputFormat   the requested target format. Set to the
+ *                               format that will actually be written.
+ * @param[in]     transcodeFlags bitfield of flags modifying the transcode
+ *                               operation.
+ * @param[out]    alphaContent   set to the alpha content of the texture.
+ * @param[out]    vkFormat       set to the VkFormat of the transcoded data.
+ * @param[out]    textureFormat  set to the basis format of the texture.
  *
  * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
  *
- * @exception KTX_FILE_DATA_ERROR
- *                              Supercompression global data is corrupted.
- * @exception KTX_INVALID_OPERATION
- *                              The texture's format is not transcodable (not
- *                              ETC1S/BasisLZ or UASTC).
- * @exception KTX_INVALID_OPERATION
- *                              Supercompression global data is missing, i.e.,
- *                              the texture object is invalid.
- * @exception KTX_INVALID_OPERATION
- *                              Image data is missing, i.e., the texture object
- *                              is invalid.
- * @exception KTX_INVALID_OPERATION
- *                              @p outputFormat is PVRTC1 but the texture does
- *                              does not have power-of-two dimensions.
- * @exception KTX_INVALID_VALUE @p outputFormat is invalid.
- * @exception KTX_TRANSCODE_FAILED
- *                              Something went wrong during transcoding.
- * @exception KTX_UNSUPPORTED_FEATURE
- *                              KTX_TF_PVRTC_DECODE_TO_NEXT_POW2 was requested
- *                              or the specified transcode target has not been
- *                              included in the library being used.
- * @exception KTX_OUT_OF_MEMORY Not enough memory to carry out transcoding.
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
  */
- KTX_error_code
- ktxTexture2_TranscodeBasis(ktxTexture2* This,
-                            ktx_transcode_fmt_e outputFormat,
-                            ktx_transcode_flags transcodeFlags)
+static KTX_error_code
+ktxTexture2_prepareTranscode(ktxTexture2* This,
+                             ktx_transcode_fmt_e& outputFormat,
+                             ktx_transcode_flags transcodeFlags,
+                             alpha_content_e& alphaContent,
+                             VkFormat& vkFormat,
+                             basis_tex_format& textureFormat)
 {
     uint32_t* BDB = This->pDfd + 1;
     khr_df_model_e colorModel = (khr_df_model_e)KHR_DFDVAL(BDB, MODEL);
@@ -164,7 +129,7 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
     }
 
     const bool srgb = (KHR_DFDVAL(BDB, TRANSFER) == KHR_DF_TRANSFER_SRGB);
-    alpha_content_e alphaContent = eNone;
+    alphaContent = eNone;
     if (colorModel == KHR_DF_MODEL_ETC1S) {
         if (KHR_DFDSAMPLECOUNT(BDB) == 2) {
             uint32_t channelId = KHR_DFDSVAL(BDB, 1, CHANNELID);
@@ -184,8 +149,6 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
             alphaContent = eGreen;
     }
 
-    VkFormat vkFormat;
-
     // Do some format mapping.
     switch (outputFormat) {
       case KTX_TTF_BC1_OR_3:
@@ -275,7 +238,6 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
         return KTX_INVALID_VALUE;
     }
 
-    basis_tex_format textureFormat;
     if (colorModel == KHR_DF_MODEL_UASTC)
         textureFormat = basis_tex_format::cUASTC4x4;
     else
@@ -286,46 +248,14 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
         return KTX_UNSUPPORTED_FEATURE;
     }
 
-
-    // Create a prototype texture to use for calculating sizes in the target
-    // format and, as useful side effects, provide us with a properly sized
-    // data allocation and the DFD for the target format.
-    ktxTextureCreateInfo createInfo;
-    createInfo.glInternalformat = 0;
-    createInfo.vkFormat = vkFormat;
-    createInfo.baseWidth = This->baseWidth;
-    createInfo.baseHeight = This->baseHeight;
-    createInfo.baseDepth = This->baseDepth;
-    createInfo.generateMipmaps = This->generateMipmaps;
-    createInfo.isArray = This->isArray;
-    createInfo.numDimensions = This->numDimensions;
-    createInfo.numFaces = This->numFaces;
-    createInfo.numLayers = This->numLayers;
-    createInfo.numLevels = This->numLevels;
-    createInfo.pDfd = nullptr;
-
-    KTX_error_code result;
-    ktxTexture2* prototype;
-    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
-                                &prototype);
-
-    if (result != KTX_SUCCESS) {
-        assert(result == KTX_OUT_OF_MEMORY); // The only run time error
-        return result;
-    }
-
     if (!This->pData) {
         if (ktxTexture_isActiveStream((ktxTexture*)This)) {
              // Load pending. Complete it.
-            result = ktxTexture2_LoadImageData(This, NULL, 0);
+            KTX_error_code result = ktxTexture2_LoadImageData(This, NULL, 0);
             if (result != KTX_SUCCESS)
-            {
-                ktxTexture2_Destroy(prototype);
                 return result;
-            }
         } else {
             // No data to transcode.
-            ktxTexture2_Destroy(prototype);
             return KTX_INVALID_OPERATION;
         }
     }
@@ -338,59 +268,70 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
         basisu_transcoder_init();
         transcoderInitialized = true;
     }
+    return KTX_SUCCESS;
+}
 
-    if (textureFormat == basis_tex_format::cETC1S) {
-        result = ktxTexture2_transcodeLzEtc1s(This, alphaContent,
-                                            prototype, outputFormat,
-                                            transcodeFlags);
-    } else {
-        result = ktxTexture2_transcodeUastc(This, alphaContent,
-                                            prototype, outputFormat,
-                                            transcodeFlags);
-    }
+/**
+ * @memberof ktxTexture2 @private
+ * @ingroup reader
+ * @~English
+ * @brief Create a prototype texture for transcoding a texture to @p vkFormat.
+ *
+ * The prototype is used for calculating sizes in the target format and, as
+ * useful side effects, provides a properly sized data allocation and the DFD
+ * for the target format.
+ *
+ * @param[in]  This        pointer to the ktxTexture2 being transcoded.
+ * @param[in]  vkFormat    the VkFormat of the transcoded images.
+ * @param[out] ppPrototype pointer to location to store the address of the
+ *                         prototype.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_OUT_OF_MEMORY Not enough memory for the prototype.
+ */
+static KTX_error_code
+ktxTexture2_createTranscodePrototype(ktxTexture2* This, VkFormat vkFormat,
+                                     ktxTexture2** ppPrototype)
+{
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = vkFormat;
+    createInfo.baseWidth = This->baseWidth;
+    createInfo.baseHeight = This->baseHeight;
+    createInfo.baseDepth = This->baseDepth;
+    createInfo.generateMipmaps = This->generateMipmaps;
+    createInfo.isArray = This->isArray;
+    createInfo.numDimensions = This->numDimensions;
+    createInfo.numFaces = This->numFaces;
+    createInfo.numLayers = This->numLayers;
+    createInfo.numLevels = This->numLevels;
+    createInfo.pDfd = nullptr;
 
-    if (result == KTX_SUCCESS) {
-        // Fix up the current texture
-        DECLARE_PROTECTED(thisPrtctd, This);
-        DECLARE_PRIVATE(protoPriv, prototype);
-        DECLARE_PROTECTED(protoPrtctd, prototype);
-        memcpy(&thisPrtctd._formatSize, &protoPrtctd._formatSize,
-               sizeof(ktxFormatSize));
-        This->vkFormat = vkFormat;
-        This->isCompressed = prototype->isCompressed;
-        This->supercompressionScheme = KTX_SS_NONE;
-        priv._requiredLevelAlignment = protoPriv._requiredLevelAlignment;
-        // Copy the levelIndex from the prototype to This.
-        memcpy(priv._levelIndex, protoPriv._levelIndex,
-               This->numLevels * sizeof(ktxLevelIndexEntry));
-        // Move the DFD and data from the prototype to This.
-        free(This->pDfd);
-        This->pDfd = prototype->pDfd;
-        prototype->pDfd = 0;
-        free(This->pData);
-        This->pData = prototype->pData;
-        This->dataSize = prototype->dataSize;
-        prototype->pData = 0;
-        prototype->dataSize = 0;
-    }
-    ktxTexture2_Destroy(prototype);
+    KTX_error_code result;
+    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                                ppPrototype);
+    // The only run time error
+    assert(result == KTX_SUCCESS || result == KTX_OUT_OF_MEMORY);
     return result;
- }
+}
 
 /**
- * @memberof ktxTexture2 @private
+ * @memberof ktxTexture2
  * @ingroup reader
  * @~English
- * @brief Transcode a KTX2 texture with BasisLZ supercompressed ETC1S images.
+ * @brief Transcode a KTX2 texture with BasisLZ/ETC1S or UASTC images.
  *
- * Inflates the images from BasisLZ supercompression back to ETC1S
- * then transcodes them to the specified block-compressed format. The
- * transcoded images replace the original images and the texture's fields
- * including the DFD are modified to reflect the new format.
+ * If the texture contains BasisLZ supercompressed images, Inflates them from
+ * back to ETC1S then transcodes them to the specified block-compressed
+ * format. If the texture contains UASTC images, inflates them, if they have been
+ * supercompressed with zstd, then transcodes then to the specified format, The
+ * transcoded images replace the original images and the texture's fields including
+ * the DFD are modified to reflect the new format.
  *
- * BasisLZ supercompressed textures must be transcoded to a desired target
- * block-compressed format before they can be uploaded to a GPU via a graphics
- * API.
+ * These types of textures must be transcoded to a desired target
+ * block-compressed format before they can be uploaded to a GPU via a
+ * graphics API.
  *
  * The following block compressed transcode targets are available: @c KTX_TTF_ETC1_RGB,
  * @c KTX_TTF_ETC2_RGBA, @c KTX_TTF_BC1_RGB, @c KTX_TTF_BC3_RGBA,
@@ -406,7 +347,8 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
  * @c KTX_TTF_PVRTC1_4_RGBA or @c KTX_TTF_PVRTC2_4_RGBA is specified and there is no alpha
  * channel @c KTX_TTF_PVRTC1_4_RGB or @c KTX_TTF_PVRTC2_4_RGB respectively will be selected.
  *
- * ATC & FXT1 formats are not supported by KTX2 & libktx as there are no equivalent Vulkan formats.
+ * Transcoding to ATC & FXT1 formats is not supported by libktx as there
+ * are no equivalent Vulkan formats.
  *
  * The following uncompressed transcode targets are also available: @c KTX_TTF_RGBA32,
  * @c KTX_TTF_RGB565, KTX_TTF_BGR565 and KTX_TTF_RGBA4444.
@@ -417,9 +359,9 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
  *
  * @param[in]   This         pointer to the ktxTexture2 object of interest.
  * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
- *                           specifying the target format.
+ *                                             specifying the target format.
  * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
- *                           operation. @sa ktx_texture_decode_flags_e.
+ *                                                operation. @sa ktx_texture_decode_flags_e.
  *
  * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
  *
@@ -439,46 +381,501 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
  *                              does not have power-of-two dimensions.
  * @exception KTX_INVALID_VALUE @p outputFormat is invalid.
  * @exception KTX_TRANSCODE_FAILED
- *                              Something went wrong during transcoding. The
- *                              texture object will be corrupted.
+ *                              Something went wrong during transcoding.
  * @exception KTX_UNSUPPORTED_FEATURE
  *                              KTX_TF_PVRTC_DECODE_TO_NEXT_POW2 was requested
  *                              or the specified transcode target has not been
  *                              included in the library being used.
  * @exception KTX_OUT_OF_MEMORY Not enough memory to carry out transcoding.
  */
+ KTX_error_code
+ ktxTexture2_TranscodeBasis(ktxTexture2* This,
+                            ktx_transcode_fmt_e outputFormat,
+                            ktx_transcode_flags transcodeFlags)
+{
+    return ktxTexture2_TranscodeBasisEx(This, outputFormat, transcodeFlags, 1);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Transcode a KTX2 texture with BasisLZ/ETC1S or UASTC images using
+ *        multiple threads.
+ *
+ * Identical to ktxTexture2_TranscodeBasis() except that the images of the
+ * texture are transcoded concurrently on up to @p threadCount threads. The
+ * output of every image goes to a disjoint region of the new image data so
+ * the result is the same as that of ktxTexture2_TranscodeBasis() for any
+ * thread count.
+ *
+ * For video textures, i.e. those whose @c isVideo is true, each frame may
+ * depend on the preceding frame of the same face and level. Frames of a
+ * given face and level are therefore transcoded in order on a single thread
+ * while different faces and levels are transcoded concurrently.
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
+ *                           specifying the target format.
+ * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
+ *                           operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]   threadCount  maximum number of threads to use, including the
+ *                           calling thread. 0 and 1 both mean transcode on
+ *                           the calling thread only.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
+ */
+ KTX_error_code
+ ktxTexture2_TranscodeBasisEx(ktxTexture2* This,
+                              ktx_transcode_fmt_e outputFormat,
+                              ktx_transcode_flags transcodeFlags,
+                              ktx_uint32_t threadCount)
+{
+    return ktxTexture2_transcodeBasisOn(This, outputFormat, transcodeFlags,
+                                        nullptr, threadCount);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Transcode a KTX2 texture with BasisLZ/ETC1S or UASTC images using
+ *        the threads of a ktxThreadPool.
+ *
+ * Identical to ktxTexture2_TranscodeBasisEx() except that the images are
+ * transcoded on the threads of @p pool, shared with any other concurrent
+ * users of the pool.
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
+ *                           specifying the target format.
+ * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
+ *                           operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]   pool         pointer to the pool whose threads to use. If
+ *                           @c NULL the images are transcoded on the calling
+ *                           thread.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
+ */
 KTX_error_code
-ktxTexture2_transcodeLzEtc1s(ktxTexture2* This,
-                             alpha_content_e alphaContent,
-                             ktxTexture2* prototype,
-                             ktx_transcode_fmt_e outputFormat,
-                             ktx_transcode_flags transcodeFlags)
+ktxTexture2_TranscodeBasisWithPool(ktxTexture2* This,
+                                   ktx_transcode_fmt_e outputFormat,
+                                   ktx_transcode_flags transcodeFlags,
+                                   ktxThreadPool* pool)
 {
-    DECLARE_PRIVATE(priv, This);
-    DECLARE_PRIVATE(protoPriv, prototype);
-    KTX_error_code result = KTX_SUCCESS;
+    return ktxTexture2_transcodeBasisOn(This, outputFormat, transcodeFlags,
+                                        pool, 1);
+}
 
-    assert(This->supercompressionScheme == KTX_SS_BASIS_LZ);
+/*
+ * Transcode on @p pool, if not NULL, otherwise on up to @p threadCount new
+ * threads.
+ */
+static KTX_error_code
+ktxTexture2_transcodeBasisOn(ktxTexture2* This,
+                             ktx_transcode_fmt_e outputFormat,
+                             ktx_transcode_flags transcodeFlags,
+                             ktxThreadPool* pool, ktx_uint32_t threadCount)
+{
+    KTX_error_code result;
+    alpha_content_e alphaContent;
+    VkFormat vkFormat;
+    basis_tex_format textureFormat;
 
-    uint8_t* bgd = priv._supercompressionGlobalData;
-    ktxBasisLzGlobalHeader& bgdh = *reinterpret_cast<ktxBasisLzGlobalHeader*>(bgd);
-    if (!(bgdh.endpointsByteLength && bgdh.selectorsByteLength && bgdh.tablesByteLength)) {
-        debug_printf("ktxTexture_TranscodeBasis: missing endpoints, selectors or tables");
-        return KTX_FILE_DATA_ERROR;
-    }
+    result = ktxTexture2_prepareTranscode(This, outputFormat, transcodeFlags,
+                                          alphaContent, vkFormat,
+                                          textureFormat);
+    if (result != KTX_SUCCESS)
+        return result;
 
-    // Compute some helpful numbers.
-    //
-    // firstImages contains the indices of the first images for each level to
-    // ease finding the correct slice description when iterating from smallest
-    // level to largest or when randomly accessing them (t.b.c). The last array
-    // entry contains the total number of images, for calculating the offsets
-    // of the endpoints, etc.
-    uint32_t* firstImages = new uint32_t[This->numLevels+1];
+    ktxTexture2* prototype;
+    result = ktxTexture2_createTranscodePrototype(This, vkFormat, &prototype);
+    if (result != KTX_SUCCESS)
+        return result;
 
-    // Temporary invariant value
-    uint32_t layersFaces = This->numLayers * This->numFaces;
-    firstImages[0] = 0;
+    if (textureFormat == basis_tex_format::cETC1S) {
+        result = ktxTexture2_transcodeLzEtc1s(This, alphaContent,
+                                            prototype, outputFormat,
+                                            transcodeFlags, pool,
+                                            threadCount);
+    } else {
+        result = ktxTexture2_transcodeUastc(This, alphaContent,
+                                            prototype, outputFormat,
+                                            transcodeFlags, pool,
+                                            threadCount);
+    }
+
+    if (result == KTX_SUCCESS) {
+        // Fix up the current texture
+        DECLARE_PRIVATE(priv, This);
+        DECLARE_PROTECTED(thisPrtctd, This);
+        DECLARE_PRIVATE(protoPriv, prototype);
+        DECLARE_PROTECTED(protoPrtctd, prototype);
+        memcpy(&thisPrtctd._formatSize, &protoPrtctd._formatSize,
+               sizeof(ktxFormatSize));
+        This->vkFormat = vkFormat;
+        This->isCompressed = prototype->isCompressed;
+        This->supercompressionScheme = KTX_SS_NONE;
+        // No longer needed.
+        ktxTexture2_freeBasisLzCodebooks(This);
+        priv._requiredLevelAlignment = protoPriv._requiredLevelAlignment;
+        // Copy the levelIndex from the prototype to This.
+        memcpy(priv._levelIndex, protoPriv._levelIndex,
+               This->numLevels * sizeof(ktxLevelIndexEntry));
+        // Move the DFD and data from the prototype to This.
+        free(This->pDfd);
+        This->pDfd = prototype->pDfd;
+        prototype->pDfd = 0;
+        ktxTexture_freeData(ktxTexture(This));
+        This->pData = prototype->pData;
+        This->dataSize = prototype->dataSize;
+        prototype->pData = 0;
+        prototype->dataSize = 0;
+    }
+    ktxTexture2_Destroy(prototype);
+    return result;
+ }
+
+/*
+ * Transcoding jobs.
+ *
+ * Every image of a texture can be transcoded independently of the others
+ * except for video P-frames which depend on the preceding frame of the same
+ * face and level. A job is therefore a run of one or more images of a single
+ * level that must be transcoded in order. For non-video textures each job is
+ * a single image. For video textures each job is the sequence of frames of
+ * one face of one level. The output location of every image is known before
+ * transcoding starts so jobs write to disjoint regions of the prototype's
+ * data and need no synchronization.
+ */
+struct TranscodeJob {
+    uint32_t level;
+    uint32_t firstImage;  // Index of first image within the level.
+    uint32_t imageCount;
+    uint32_t imageStride; // Distance between consecutive images of the job.
+};
+
+struct TranscodeJobs {
+    ktxTexture2* This;
+    ktxTexture2* prototype;
+    transcoder_texture_format outputFormat;
+    ktx_transcode_flags transcodeFlags;
+    bool hasAlpha;
+    ktx_uint32_t outputBlockByteLength;
+    ktx_size_t xcodedDataLength;
+    std::vector<TranscodeJob> jobs;
+    // One state per worker. basisu_transcoder_state tracks the previous
+    // frame for each level when decoding video P-frames and holds scratch
+    // buffers for ETC1S decoding so cannot be shared between threads.
+    std::vector<basisu_transcoder_state> xcoderStates;
+    // Used only for ETC1S.
+    basisu_lowlevel_etc1s_transcoder* etc1sTranscoder;
+    const ktxBasisLzEtc1sImageDesc* imageDescs;
+    const uint32_t* firstImages;
+    // Used only for UASTC.
+    basisu_lowlevel_uastc_transcoder* uastcTranscoder;
+
+    void
+    makeJobs(ktxThreadPool* pool, uint32_t threadCount)
+    {
+        for (uint32_t level = 0; level < This->numLevels; level++) {
+            uint32_t depth = MAX(1, This->baseDepth >> level);
+            uint32_t levelImages = This->numLayers * This->numFaces * depth;
+            if (This->isVideo) {
+                // We have face0 [face1 ...] within each layer so the frames
+                // of a face are numFaces images apart. This works for
+                // non-array cube maps as well as cube map arrays without
+                // special casing.
+                for (uint32_t face = 0; face < This->numFaces; face++) {
+                    jobs.push_back({level, face,
+                                    levelImages / This->numFaces,
+                                    This->numFaces});
+                }
+            } else {
+                for (uint32_t image = 0; image < levelImages; image++)
+                    jobs.push_back({level, image, 1, 1});
+            }
+        }
+        xcoderStates.resize(ktxJobWorkerCountOn(pool, threadCount,
+                                                (ktx_uint32_t)jobs.size()));
+    }
+};
+
+/*
+ * Transcode one image to @p pDst. @p dstSize and @p dstRowPitch are in
+ * blocks for block-compressed targets and in pixels for uncompressed
+ * targets, as the transcoder requires. A @p dstRowPitch of 0 means rows are
+ * tightly packed.
+ */
+static KTX_error_code
+transcodeEtc1sImage(ktxTexture2* This, basisu_lowlevel_etc1s_transcoder& bit,
+                    const ktxBasisLzEtc1sImageDesc& imageDesc, uint32_t level,
+                    transcoder_texture_format outputFormat,
+                    ktx_transcode_flags transcodeFlags, bool hasAlpha,
+                    void* pDst, uint32_t dstSize, uint32_t dstRowPitch,
+                    basisu_transcoder_state& xcoderState)
+{
+    uint64_t levelOffset = ktxTexture2_levelDataOffset(This, level);
+    uint32_t levelWidth = MAX(1, This->baseWidth >> level);
+    uint32_t levelHeight = MAX(1, This->baseHeight >> level);
+    // ETC1S texel block dimensions
+    const uint32_t bw = 4, bh = 4;
+    uint32_t levelBlocksX = (levelWidth + (bw - 1)) / bw;
+    uint32_t levelBlocksY = (levelHeight + (bh - 1)) / bh;
+
+    if (hasAlpha)
+    {
+        // The slice descriptions should have alpha information.
+        if (imageDesc.alphaSliceByteOffset == 0
+            || imageDesc.alphaSliceByteLength == 0)
+            return KTX_FILE_DATA_ERROR;
+    }
+
+    bool status;
+    status = bit.transcode_image(
+              outputFormat,
+              pDst,
+              dstSize,
+              This->pData,
+              (uint32_t)This->dataSize,
+              levelBlocksX,
+              levelBlocksY,
+              levelWidth,
+              levelHeight,
+              level,
+              (uint32_t)(levelOffset + imageDesc.rgbSliceByteOffset),
+              imageDesc.rgbSliceByteLength,
+              (uint32_t)(levelOffset + imageDesc.alphaSliceByteOffset),
+              imageDesc.alphaSliceByteLength,
+              transcodeFlags,
+              hasAlpha,
+              This->isVideo,
+              // Our P-Frame flag is in the same bit as
+              // cSliceDescFlagsFrameIsIFrame. We have to
+              // invert it to make it an I-Frame flag.
+              //
+              // API currently doesn't have any way to pass
+              // the I-Frame flag.
+              //imageDesc.imageFlags ^ cSliceDescFlagsFrameIsIFrame,
+              dstRowPitch, // output_row_pitch_in_blocks_or_pixels
+              &xcoderState,
+              0  // output_rows_in_pixels
+              );
+    return status ? KTX_SUCCESS : KTX_TRANSCODE_FAILED;
+}
+
+/*
+ * Transcode image @p levelImage of @p level to @p pDst. Sizes are as for
+ * transcodeEtc1sImage().
+ */
+static KTX_error_code
+transcodeUastcImage(ktxTexture2* This, basisu_lowlevel_uastc_transcoder& uit,
+                    uint32_t level, uint32_t levelImage,
+                    transcoder_texture_format outputFormat,
+                    ktx_transcode_flags transcodeFlags, bool hasAlpha,
+                    void* pDst, uint32_t dstSize, uint32_t dstRowPitch,
+                    basisu_transcoder_state& xcoderState)
+{
+    uint32_t levelWidth = MAX(1, This->baseWidth >> level);
+    uint32_t levelHeight = MAX(1, This->baseHeight >> level);
+    // UASTC texel block dimensions
+    const uint32_t bw = 4, bh = 4;
+    uint32_t levelBlocksX = (levelWidth + (bw - 1)) / bw;
+    uint32_t levelBlocksY = (levelHeight + (bh - 1)) / bh;
+    ktx_size_t levelImageSizeIn = ktxTexture_calcImageSize(ktxTexture(This),
+                                                level, KTX_FORMAT_VERSION_TWO);
+    uint64_t readOffset = ktxTexture2_levelDataOffset(This, level)
+                        + levelImage * levelImageSizeIn;
+
+    bool status;
+    status = uit.transcode_image(
+                  outputFormat,
+                  pDst,
+                  dstSize,
+                  This->pData,
+                  (uint32_t)This->dataSize,
+                  levelBlocksX,
+                  levelBlocksY,
+                  levelWidth,
+                  levelHeight,
+                  level,
+                  (uint32_t)readOffset,
+                  (uint32_t)levelImageSizeIn,
+                  transcodeFlags,
+                  hasAlpha,
+                  This->isVideo, // is_video
+                  //imageDesc.imageFlags ^ cSliceDescFlagsFrameIsIFrame,
+                  dstRowPitch, // output_row_pitch_in_blocks_or_pixels
+                  &xcoderState, // pState
+                  0, // output_rows_in_pixels,
+                  -1, // channel0
+                  -1  // channel1
+                  );
+    return status ? KTX_SUCCESS : KTX_TRANSCODE_FAILED;
+}
+
+static KTX_error_code
+transcodeEtc1sJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t jobIndex)
+{
+    TranscodeJobs& t = *static_cast<TranscodeJobs*>(userdata);
+    ktxTexture2* This = t.This;
+    const TranscodeJob& job = t.jobs[jobIndex];
+    const uint32_t level = job.level;
+    basisu_transcoder_state& xcoderState = t.xcoderStates[worker];
+
+    // FIXME: Figure out a way to get the size out of the transcoder.
+    ktx_size_t levelImageSizeOut = ktxTexture2_GetImageSize(t.prototype, level);
+
+    // Each video job starts at the first frame of a sequence.
+    if (This->isVideo)
+        xcoderState.clear();
+
+    for (uint32_t i = 0; i < job.imageCount; i++) {
+        uint32_t levelImage = job.firstImage + i * job.imageStride;
+        const ktxBasisLzEtc1sImageDesc& imageDesc
+                            = t.imageDescs[t.firstImages[level] + levelImage];
+        uint64_t writeOffset = ktxTexture2_levelDataOffset(t.prototype, level)
+                             + levelImage * levelImageSizeOut;
+        uint64_t writeOffsetBlocks = writeOffset / t.outputBlockByteLength;
+
+        KTX_error_code result;
+        result = transcodeEtc1sImage(This, *t.etc1sTranscoder, imageDesc,
+                                level, t.outputFormat, t.transcodeFlags,
+                                t.hasAlpha, t.prototype->pData + writeOffset,
+                                (uint32_t)(t.xcodedDataLength - writeOffsetBlocks),
+                                0, xcoderState);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+    return KTX_SUCCESS;
+}
+
+static KTX_error_code
+transcodeUastcJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t jobIndex)
+{
+    TranscodeJobs& t = *static_cast<TranscodeJobs*>(userdata);
+    ktxTexture2* This = t.This;
+    const TranscodeJob& job = t.jobs[jobIndex];
+    const uint32_t level = job.level;
+    basisu_transcoder_state& xcoderState = t.xcoderStates[worker];
+
+    ktx_size_t levelImageSizeOut
+                = ktxTexture_calcImageSize(ktxTexture(t.prototype), level,
+                                           KTX_FORMAT_VERSION_TWO);
+
+    if (This->isVideo)
+        xcoderState.clear();
+
+    for (uint32_t i = 0; i < job.imageCount; i++) {
+        uint32_t levelImage = job.firstImage + i * job.imageStride;
+        uint64_t writeOffset = ktxTexture2_levelDataOffset(t.prototype, level)
+                             + levelImage * levelImageSizeOut;
+        uint64_t writeOffsetBlocks = writeOffset / t.outputBlockByteLength;
+
+        KTX_error_code result;
+        result = transcodeUastcImage(This, *t.uastcTranscoder, level,
+                                levelImage, t.outputFormat, t.transcodeFlags,
+                                t.hasAlpha, t.prototype->pData + writeOffset,
+                                (uint32_t)(t.xcodedDataLength - writeOffsetBlocks),
+                                0, xcoderState);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+    return KTX_SUCCESS;
+}
+
+/*
+ * Codebooks decoded from the supercompression global data of a BasisLZ
+ * texture. Decoding the endpoint and selector palettes and the Huffman
+ * tables is a significant part of the cost of transcoding a small texture
+ * or a single image so the result is kept with the texture and reused by
+ * later transcodes of it, e.g. to other targets or of other images.
+ */
+struct ktxBasisLzCodebooks {
+    // The global data from which the codebooks were decoded.
+    const ktx_uint8_t* sgd;
+    // Low-level transcoder holding the decoded codebooks.
+    basisu_lowlevel_etc1s_transcoder bit;
+    // Indices of the first images for each level to ease finding the
+    // correct slice description when iterating from smallest level to
+    // largest or when randomly accessing them. The last array entry
+    // contains the total number of images, for calculating the offsets
+    // of the endpoints, etc.
+    std::vector<uint32_t> firstImages;
+};
+
+/**
+ * @memberof ktxTexture2 @private
+ * @~English
+ * @brief Free the codebooks cached by BasisLZ transcoding, if any.
+ *
+ * @param[in] This  pointer to the ktxTexture2 object of interest.
+ */
+void
+ktxTexture2_freeBasisLzCodebooks(ktxTexture2* This)
+{
+    DECLARE_PRIVATE(priv, This);
+    delete priv._basisLzCodebooks;
+    priv._basisLzCodebooks = nullptr;
+}
+
+/**
+ * @memberof ktxTexture2 @private
+ * @~English
+ * @brief Get a low-level transcoder prepared for transcoding the
+ *        BasisLZ/ETC1S images of a texture.
+ *
+ * The codebooks are decoded from the supercompression global data the
+ * first time this is called and cached with the texture. Later calls
+ * return the cached codebooks until the global data changes.
+ *
+ * @param[in]  This         pointer to the ktxTexture2 object of interest.
+ * @param[out] ppCodebooks  pointer to location to store the address of the
+ *                          codebooks. Owned by @p This.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_FILE_DATA_ERROR
+ *                              Supercompression global data is corrupted.
+ * @exception KTX_OUT_OF_MEMORY Not enough memory for the codebooks.
+ */
+static KTX_error_code
+ktxTexture2_getBasisLzCodebooks(ktxTexture2* This,
+                                ktxBasisLzCodebooks** ppCodebooks)
+{
+    DECLARE_PRIVATE(priv, This);
+
+    assert(This->supercompressionScheme == KTX_SS_BASIS_LZ);
+
+    uint8_t* bgd = priv._supercompressionGlobalData;
+    if (priv._basisLzCodebooks) {
+        if (priv._basisLzCodebooks->sgd == bgd) {
+            *ppCodebooks = priv._basisLzCodebooks;
+            return KTX_SUCCESS;
+        }
+        ktxTexture2_freeBasisLzCodebooks(This);
+    }
+
+    ktxBasisLzGlobalHeader& bgdh = *reinterpret_cast<ktxBasisLzGlobalHeader*>(bgd);
+    if (!(bgdh.endpointsByteLength && bgdh.selectorsByteLength && bgdh.tablesByteLength)) {
+        debug_printf("ktxTexture_TranscodeBasis: missing endpoints, selectors or tables");
+        return KTX_FILE_DATA_ERROR;
+    }
+
+    ktxBasisLzCodebooks* codebooks = new (std::nothrow) ktxBasisLzCodebooks;
+    if (!codebooks)
+        return KTX_OUT_OF_MEMORY;
+    codebooks->sgd = bgd;
+    std::vector<uint32_t>& firstImages = codebooks->firstImages;
+    firstImages.resize(This->numLevels+1);
+
+    // Temporary invariant value
+    uint32_t layersFaces = This->numLayers * This->numFaces;
+    firstImages[0] = 0;
     for (uint32_t level = 1; level <= This->numLevels; level++) {
         // NOTA BENE: numFaces * depth is only reasonable because they can't
         // both be > 1. I.e there are no 3d cubemaps.
@@ -488,148 +885,178 @@ ktxTexture2_transcodeLzEtc1s(ktxTexture2* This,
     uint32_t& imageCount = firstImages[This->numLevels];
 
     if (BGD_TABLES_ADDR(0, bgdh, imageCount) + bgdh.tablesByteLength > priv._sgdByteLength) {
+        delete codebooks;
         return KTX_FILE_DATA_ERROR;
     }
     // FIXME: Do more validation.
 
-    // Prepare low-level transcoder for transcoding slices.
-    basist::basisu_lowlevel_etc1s_transcoder bit;
-
-    // basisu_transcoder_state is used to find the previous frame when
-    // decoding a video P-Frame. It tracks the previous frame for each mip
-    // level. For cube map array textures we need to find the previous frame
-    // for each face so we a state per face. Although providing this is only
-    // needed for video, it is easier to always pass our own.
-    std::vector<basisu_transcoder_state> xcoderStates;
-    xcoderStates.resize(This->isVideo ? This->numFaces : 1);
-
-    bit.decode_palettes(bgdh.endpointCount, BGD_ENDPOINTS_ADDR(bgd, imageCount),
-                        bgdh.endpointsByteLength,
-                        bgdh.selectorCount, BGD_SELECTORS_ADDR(bgd, bgdh, imageCount),
-                        bgdh.selectorsByteLength);
-
-    bit.decode_tables(BGD_TABLES_ADDR(bgd, bgdh, imageCount),
-                      bgdh.tablesByteLength);
-
-    // Find matching VkFormat and calculate output sizes.
+    basisu_lowlevel_etc1s_transcoder& bit = codebooks->bit;
+    if (!bit.decode_palettes(bgdh.endpointCount,
+                             BGD_ENDPOINTS_ADDR(bgd, imageCount),
+                             bgdh.endpointsByteLength,
+                             bgdh.selectorCount,
+                             BGD_SELECTORS_ADDR(bgd, bgdh, imageCount),
+                             bgdh.selectorsByteLength)
+        || !bit.decode_tables(BGD_TABLES_ADDR(bgd, bgdh, imageCount),
+                              bgdh.tablesByteLength)) {
+        delete codebooks;
+        return KTX_FILE_DATA_ERROR;
+    }
 
-    const bool isVideo = This->isVideo;
+    priv._basisLzCodebooks = codebooks;
+    *ppCodebooks = codebooks;
+    return KTX_SUCCESS;
+}
 
-    ktx_uint8_t* pXcodedData = prototype->pData;
+/*
+ * Set up @p t for transcoding the images of @p This to @p prototype. @p uit
+ * is used for UASTC textures. It holds no per-image state so it can be
+ * shared by all the jobs.
+ */
+static KTX_error_code
+initTranscodeJobs(TranscodeJobs& t, ktxTexture2* This,
+                  alpha_content_e alphaContent, ktxTexture2* prototype,
+                  ktx_transcode_fmt_e outputFormat,
+                  ktx_transcode_flags transcodeFlags,
+                  basisu_lowlevel_uastc_transcoder* uit,
+                  ktxThreadPool* pool, ktx_uint32_t threadCount)
+{
+    t.This = This;
+    t.prototype = prototype;
+    t.outputFormat = (transcoder_texture_format)outputFormat;
+    t.transcodeFlags = transcodeFlags;
+    t.hasAlpha = alphaContent != eNone;
     // Inconveniently, the output buffer size parameter of transcode_image
     // has to be in pixels for uncompressed output and in blocks for
     // compressed output. The only reason for humouring the API is so
     // its buffer size tests provide a real check. An alternative is to
     // always provide the size in bytes which will always pass.
-    ktx_uint32_t outputBlockByteLength
+    t.outputBlockByteLength
                       = prototype->_protected->_formatSize.blockSizeInBits / 8;
-    ktx_size_t xcodedDataLength
-                      = prototype->dataSize / outputBlockByteLength;
-    ktxLevelIndexEntry* protoLevelIndex;
-    uint64_t levelOffsetWrite;
-    const ktxBasisLzEtc1sImageDesc* imageDescs = BGD_ETC1S_IMAGE_DESCS(bgd);
-
-    // Finally we're ready to transcode the slices.
-
-    // FIXME: Iframe flag needs to be queryable by the application. In Basis
-    // the app can query file_info and image_info from the transcoder which
-    // returns a structure with lots of info about the image.
-
-    protoLevelIndex = protoPriv._levelIndex;
-    levelOffsetWrite = 0;
-    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
-        uint64_t levelOffset = ktxTexture2_levelDataOffset(This, level);
-        uint64_t writeOffset = levelOffsetWrite;
-        uint64_t writeOffsetBlocks = levelOffsetWrite / outputBlockByteLength;
-        uint32_t levelWidth = MAX(1, This->baseWidth >> level);
-        uint32_t levelHeight = MAX(1, This->baseHeight >> level);
-        // ETC1S texel block dimensions
-        const uint32_t bw = 4, bh = 4;
-        uint32_t levelBlocksX = (levelWidth + (bw - 1)) / bw;
-        uint32_t levelBlocksY = (levelHeight + (bh - 1)) / bh;
-        uint32_t depth = MAX(1, This->baseDepth >> level);
-        //uint32_t faceSlices = This->numFaces == 1 ? depth : This->numFaces;
-        uint32_t faceSlices = This->numFaces * depth;
-        uint32_t numImages = This->numLayers * faceSlices;
-        uint32_t image = firstImages[level];
-        uint32_t endImage = image + numImages;
-        ktx_size_t levelImageSizeOut, levelSizeOut;
-        uint32_t stateIndex = 0;
-
-        levelSizeOut = 0;
-        // FIXME: Figure out a way to get the size out of the transcoder.
-        levelImageSizeOut = ktxTexture2_GetImageSize(prototype, level);
-        for (; image < endImage; image++) {
-            const ktxBasisLzEtc1sImageDesc& imageDesc = imageDescs[image];
-
-            basisu_transcoder_state& xcoderState = xcoderStates[stateIndex];
-            // We have face0 [face1 ...] within each layer. Use `stateIndex`
-            // rather than a double loop of layers and faceSlices as this
-            // works for 3d texture and non-array cube maps as well as
-            // cube map arrays without special casing.
-            if (++stateIndex == xcoderStates.size())
-                stateIndex = 0;
-
-            if (alphaContent != eNone)
-            {
-                // The slice descriptions should have alpha information.
-                if (imageDesc.alphaSliceByteOffset == 0
-                    || imageDesc.alphaSliceByteLength == 0)
-                    return KTX_FILE_DATA_ERROR;
-            }
+    t.xcodedDataLength = prototype->dataSize / t.outputBlockByteLength;
+    if (This->supercompressionScheme == KTX_SS_BASIS_LZ) {
+        // Get low-level transcoder for transcoding slices.
+        ktxBasisLzCodebooks* codebooks;
+        KTX_error_code result;
+        result = ktxTexture2_getBasisLzCodebooks(This, &codebooks);
+        if (result != KTX_SUCCESS)
+            return result;
 
-            bool status;
-            status = bit.transcode_image(
-                      (transcoder_texture_format)outputFormat,
-                      pXcodedData + writeOffset,
-                      (uint32_t)(xcodedDataLength - writeOffsetBlocks),
-                      This->pData,
-                      (uint32_t)This->dataSize,
-                      levelBlocksX,
-                      levelBlocksY,
-                      levelWidth,
-                      levelHeight,
-                      level,
-                      (uint32_t)(levelOffset + imageDesc.rgbSliceByteOffset),
-                      imageDesc.rgbSliceByteLength,
-                      (uint32_t)(levelOffset + imageDesc.alphaSliceByteOffset),
-                      imageDesc.alphaSliceByteLength,
-                      transcodeFlags,
-                      alphaContent != eNone,
-                      isVideo,
-                      // Our P-Frame flag is in the same bit as
-                      // cSliceDescFlagsFrameIsIFrame. We have to
-                      // invert it to make it an I-Frame flag.
-                      //
-                      // API currently doesn't have any way to pass
-                      // the I-Frame flag.
-                      //imageDesc.imageFlags ^ cSliceDescFlagsFrameIsIFrame,
-                      0, // output_row_pitch_in_blocks_or_pixels
-                      &xcoderState,
-                      0  // output_rows_in_pixels
-                      );
-            if (!status) {
-                result = KTX_TRANSCODE_FAILED;
-                goto cleanup;
-            }
+        // FIXME: Iframe flag needs to be queryable by the application. In
+        // Basis the app can query file_info and image_info from the
+        // transcoder which returns a structure with lots of info about the
+        // image.
+        DECLARE_PRIVATE(priv, This);
+        t.etc1sTranscoder = &codebooks->bit;
+        t.imageDescs = BGD_ETC1S_IMAGE_DESCS(priv._supercompressionGlobalData);
+        t.firstImages = codebooks->firstImages.data();
+        t.uastcTranscoder = nullptr;
+    } else {
+        t.etc1sTranscoder = nullptr;
+        t.imageDescs = nullptr;
+        t.firstImages = nullptr;
+        t.uastcTranscoder = uit;
+    }
+    t.makeJobs(pool, threadCount);
+    return KTX_SUCCESS;
+}
 
-            writeOffset += levelImageSizeOut;
-            levelSizeOut += levelImageSizeOut;
-        } // end images loop
-        protoLevelIndex[level].byteOffset = levelOffsetWrite;
-        protoLevelIndex[level].byteLength = levelSizeOut;
-        protoLevelIndex[level].uncompressedByteLength = levelSizeOut;
-        levelOffsetWrite += levelSizeOut;
-        assert(levelOffsetWrite == writeOffset);
-        // In case of transcoding to uncompressed.
-        levelOffsetWrite = _KTX_PADN(protoPriv._requiredLevelAlignment,
-                                     levelOffsetWrite);
-    } // level loop
-
-    result = KTX_SUCCESS;
+/**
+ * @memberof ktxTexture2 @private
+ * @ingroup reader
+ * @~English
+ * @brief Transcode a KTX2 texture with BasisLZ supercompressed ETC1S images.
+ *
+ * Inflates the images from BasisLZ supercompression back to ETC1S
+ * then transcodes them to the specified block-compressed format. The
+ * transcoded images replace the original images and the texture's fields
+ * including the DFD are modified to reflect the new format.
+ *
+ * BasisLZ supercompressed textures must be transcoded to a desired target
+ * block-compressed format before they can be uploaded to a GPU via a graphics
+ * API.
+ *
+ * The following block compressed transcode targets are available: @c KTX_TTF_ETC1_RGB,
+ * @c KTX_TTF_ETC2_RGBA, @c KTX_TTF_BC1_RGB, @c KTX_TTF_BC3_RGBA,
+ * @c KTX_TTF_BC4_R, @c KTX_TTF_BC5_RG, @c KTX_TTF_BC7_RGBA,
+ * @c @c KTX_TTF_PVRTC1_4_RGB, @c KTX_TTF_PVRTC1_4_RGBA,
+ * @c KTX_TTF_PVRTC2_4_RGB, @c KTX_TTF_PVRTC2_4_RGBA, @c KTX_TTF_ASTC_4x4_RGBA,
+ * @c KTX_TTF_ETC2_EAC_R11, @c KTX_TTF_ETC2_EAC_RG11, @c KTX_TTF_ETC and
+ * @c KTX_TTF_BC1_OR_3.
+ *
+ * @c KTX_TTF_ETC automatically selects between @c KTX_TTF_ETC1_RGB and
+ * @c KTX_TTF_ETC2_RGBA according to whether an alpha channel is available. @c KTX_TTF_BC1_OR_3
+ * does likewise between @c KTX_TTF_BC1_RGB and @c KTX_TTF_BC3_RGBA. Note that if
+ * @c KTX_TTF_PVRTC1_4_RGBA or @c KTX_TTF_PVRTC2_4_RGBA is specified and there is no alpha
+ * channel @c KTX_TTF_PVRTC1_4_RGB or @c KTX_TTF_PVRTC2_4_RGB respectively will be selected.
+ *
+ * ATC & FXT1 formats are not supported by KTX2 & libktx as there are no equivalent Vulkan formats.
+ *
+ * The following uncompressed transcode targets are also available: @c KTX_TTF_RGBA32,
+ * @c KTX_TTF_RGB565, KTX_TTF_BGR565 and KTX_TTF_RGBA4444.
+ *
+ * The following @p transcodeFlags are available.
+ *
+ * @sa ktxtexture2_CompressBasis().
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
+ *                           specifying the target format.
+ * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
+ *                           operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]   pool         pointer to the pool whose threads to use or
+ *                           @c NULL.
+ * @param[in]   threadCount  maximum number of threads to use if @p pool is
+ *                           @c NULL.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_FILE_DATA_ERROR
+ *                              Supercompression global data is corrupted.
+ * @exception KTX_INVALID_OPERATION
+ *                              The texture's format is not transcodable (not
+ *                              ETC1S/BasisLZ or UASTC).
+ * @exception KTX_INVALID_OPERATION
+ *                              Supercompression global data is missing, i.e.,
+ *                              the texture object is invalid.
+ * @exception KTX_INVALID_OPERATION
+ *                              Image data is missing, i.e., the texture object
+ *                              is invalid.
+ * @exception KTX_INVALID_OPERATION
+ *                              @p outputFormat is PVRTC1 but the texture does
+ *                              does not have power-of-two dimensions.
+ * @exception KTX_INVALID_VALUE @p outputFormat is invalid.
+ * @exception KTX_TRANSCODE_FAILED
+ *                              Something went wrong during transcoding. The
+ *                              texture object will be corrupted.
+ * @exception KTX_UNSUPPORTED_FEATURE
+ *                              KTX_TF_PVRTC_DECODE_TO_NEXT_POW2 was requested
+ *                              or the specified transcode target has not been
+ *                              included in the library being used.
+ * @exception KTX_OUT_OF_MEMORY Not enough memory to carry out transcoding.
+ */
+KTX_error_code
+ktxTexture2_transcodeLzEtc1s(ktxTexture2* This,
+                             alpha_content_e alphaContent,
+                             ktxTexture2* prototype,
+                             ktx_transcode_fmt_e outputFormat,
+                             ktx_transcode_flags transcodeFlags,
+                             ktxThreadPool* pool, ktx_uint32_t threadCount)
+{
+    assert(This->supercompressionScheme == KTX_SS_BASIS_LZ);
 
-cleanup:
-    delete[] firstImages;
+    TranscodeJobs t;
+    KTX_error_code result;
+    result = initTranscodeJobs(t, This, alphaContent, prototype,
+                               outputFormat, transcodeFlags, nullptr,
+                               pool, threadCount);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    // Finally we're ready to transcode the slices. The prototype's level
+    // index already holds the offsets and lengths of the transcoded levels.
+    result = ktxRunJobsOn(pool, threadCount, (ktx_uint32_t)t.jobs.size(),
+                          transcodeEtc1sJob, &t);
     return result;
 }
 
@@ -639,95 +1066,419 @@ ktxTexture2_transcodeUastc(ktxTexture2* This,
                            alpha_content_e alphaContent,
                            ktxTexture2* prototype,
                            ktx_transcode_fmt_e outputFormat,
-                           ktx_transcode_flags transcodeFlags)
+                           ktx_transcode_flags transcodeFlags,
+                           ktxThreadPool* pool, ktx_uint32_t threadCount)
 {
     assert(This->supercompressionScheme != KTX_SS_BASIS_LZ);
 
-    ktx_uint8_t* pXcodedData = prototype->pData;
-    ktx_uint32_t outputBlockByteLength
-                      = prototype->_protected->_formatSize.blockSizeInBits / 8;
-    ktx_size_t xcodedDataLength
-                      = prototype->dataSize / outputBlockByteLength;
-    DECLARE_PRIVATE(protoPriv, prototype);
-    ktxLevelIndexEntry* protoLevelIndex = protoPriv._levelIndex;
-    ktx_size_t levelOffsetWrite = 0;
+    basisu_lowlevel_uastc_transcoder uit;
+
+    TranscodeJobs t;
+    KTX_error_code result;
+    result = initTranscodeJobs(t, This, alphaContent, prototype,
+                               outputFormat, transcodeFlags, &uit,
+                               pool, threadCount);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    // The prototype's level index already holds the offsets and lengths of
+    // the transcoded levels.
+    return ktxRunJobsOn(pool, threadCount, (ktx_uint32_t)t.jobs.size(),
+                        transcodeUastcJob, &t);
+}
+
+/**
+ * @memberof ktxTexture2 @private
+ * @ingroup reader
+ * @~English
+ * @brief Work out the layout of an image of @p level transcoded to
+ *        @p targetFormat.
+ *
+ * As for the transcode jobs, sizes passed to the transcoder are in pixels
+ * for uncompressed output and in blocks for compressed output so the layout
+ * is given in those units.
+ *
+ * @param[in]  This           pointer to the ktxTexture2 being transcoded.
+ * @param[in]  level          mip level of the image.
+ * @param[in]  targetFormat   the resolved target format.
+ * @param[out] unitByteLength size in bytes of a block or pixel.
+ * @param[out] rowUnits       number of blocks or pixels in a row.
+ * @param[out] rows           number of rows of blocks or pixels.
+ */
+static void
+getTranscodedImageLayout(ktxTexture2* This, ktx_uint32_t level,
+                         transcoder_texture_format targetFormat,
+                         uint32_t& unitByteLength, uint32_t& rowUnits,
+                         uint32_t& rows)
+{
+    uint32_t levelWidth = MAX(1, This->baseWidth >> level);
+    uint32_t levelHeight = MAX(1, This->baseHeight >> level);
+    unitByteLength = basis_get_bytes_per_block_or_pixel(targetFormat);
+    if (basis_transcoder_format_is_uncompressed(targetFormat)) {
+        rowUnits = levelWidth;
+        rows = levelHeight;
+    } else {
+        uint32_t bw = basis_get_block_width(targetFormat);
+        uint32_t bh = basis_get_block_height(targetFormat);
+        rowUnits = (levelWidth + (bw - 1)) / bw;
+        rows = (levelHeight + (bh - 1)) / bh;
+    }
+}
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Return the size of an image of a KTX2 texture with BasisLZ/ETC1S
+ *        or UASTC images transcoded to @p outputFormat.
+ *
+ * The size is the smallest @p dstSize ktxTexture2_TranscodeBasisImage()
+ * accepts for an image of @p level when its @p dstRowPitch is 0. Use it to
+ * size the destination buffer. Alpha-dependent targets, such as
+ * @c KTX_TTF_ETC, are resolved as they are by
+ * ktxTexture2_TranscodeBasisImage().
+ *
+ * Image data is loaded first if it has not already been loaded.
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   level        mip level of the image.
+ * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
+ *                           specifying the target format.
+ * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
+ *                           operation. @sa ktx_texture_decode_flags_e.
+ * @param[out]  pSize        pointer to the location to store the size in
+ *                           bytes.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This or @p pSize is @c NULL.
+ * @exception KTX_INVALID_VALUE @p level is out of range.
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
+ */
+KTX_error_code
+ktxTexture2_GetTranscodedImageSize(ktxTexture2* This, ktx_uint32_t level,
+                                   ktx_transcode_fmt_e outputFormat,
+                                   ktx_transcode_flags transcodeFlags,
+                                   ktx_size_t* pSize)
+{
+    if (!This || !pSize || level >= This->numLevels)
+        return KTX_INVALID_VALUE;
+
+    KTX_error_code result;
+    alpha_content_e alphaContent;
+    VkFormat vkFormat;
+    basis_tex_format textureFormat;
 
+    result = ktxTexture2_prepareTranscode(This, outputFormat, transcodeFlags,
+                                          alphaContent, vkFormat,
+                                          textureFormat);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    uint32_t unitByteLength, rowUnits, rows;
+    getTranscodedImageLayout(This, level,
+                             (transcoder_texture_format)outputFormat,
+                             unitByteLength, rowUnits, rows);
+    *pSize = (ktx_size_t)unitByteLength * rowUnits * rows;
+    return KTX_SUCCESS;
+}
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Transcode a single image of a KTX2 texture with BasisLZ/ETC1S or
+ *        UASTC images into a caller-provided buffer.
+ *
+ * Transcodes the image at @p level, @p layer and @p faceSlice to
+ * @p outputFormat writing the result directly to @p pDst. Unlike
+ * ktxTexture2_TranscodeBasis() the texture is not modified and no memory is
+ * allocated for the transcoded image so this can be used to transcode
+ * straight into, e.g., mapped staging memory of a graphics API. To transcode
+ * a whole texture call this for each of its images.
+ *
+ * Rows of the output start @p dstRowPitch bytes apart. For block-compressed
+ * targets a row is a row of blocks. For uncompressed targets it is a row of
+ * pixels. @p dstSize must be at least the number of rows multiplied by the
+ * row pitch. With @p dstRowPitch 0 that is the size returned by
+ * ktxTexture2_GetTranscodedImageSize().
+ *
+ * The available targets and the meaning of @p transcodeFlags are as
+ * described for ktxTexture2_TranscodeBasis(). Alpha-dependent targets, such
+ * as @c KTX_TTF_ETC, are resolved the same way so
+ * ktxTexture2_TranscodeBasis() can be used on a copy of a texture to find out
+ * the VkFormat of the data written.
+ *
+ * Image data is loaded first if it has not already been loaded.
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   level        mip level of the image to transcode.
+ * @param[in]   layer        array layer of the image to transcode.
+ * @param[in]   faceSlice    cube map face or depth slice of the image to
+ *                           transcode.
+ * @param[in]   outputFormat a value from the ktx_texture_transcode_fmt_e enum
+ *                           specifying the target format.
+ * @param[in]   transcodeFlags  bitfield of flags modifying the transcode
+ *                           operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]   pDst         pointer to the buffer to receive the image.
+ * @param[in]   dstSize      size in bytes of the buffer pointed at by
+ *                           @p pDst.
+ * @param[in]   dstRowPitch  number of bytes between the starts of
+ *                           consecutive rows of blocks or pixels. 0 means
+ *                           rows are tightly packed.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This or @p pDst is @c NULL.
+ * @exception KTX_INVALID_VALUE @p level, @p layer or @p faceSlice is out of
+ *                              range.
+ * @exception KTX_INVALID_VALUE @p dstRowPitch is less than the size of a row
+ *                              or not a multiple of the size of a block or
+ *                              pixel of @p outputFormat.
+ * @exception KTX_INVALID_VALUE @p dstRowPitch is not 0 for a PVRTC1 target.
+ *                              PVRTC1 images are not stored in rows.
+ * @exception KTX_INVALID_VALUE @p dstSize is too small.
+ * @exception KTX_INVALID_OPERATION
+ *                              The image is a BasisLZ/ETC1S video P-frame
+ *                              which can only be transcoded after the
+ *                              preceding frames. Use
+ *                              ktxTexture2_TranscodeBasis() for such textures.
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
+ */
+KTX_error_code
+ktxTexture2_TranscodeBasisImage(ktxTexture2* This, ktx_uint32_t level,
+                                ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                                ktx_transcode_fmt_e outputFormat,
+                                ktx_transcode_flags transcodeFlags,
+                                ktx_uint8_t* pDst, ktx_size_t dstSize,
+                                ktx_uint32_t dstRowPitch)
+{
+    if (!This || !pDst)
+        return KTX_INVALID_VALUE;
+
+    if (level >= This->numLevels || layer >= This->numLayers)
+        return KTX_INVALID_VALUE;
+    // level is now known to be small enough to shift by.
+    uint32_t depth = MAX(1, This->baseDepth >> level);
+    if (faceSlice >= This->numFaces * depth)
+        return KTX_INVALID_VALUE;
+
+    KTX_error_code result;
+    alpha_content_e alphaContent;
+    VkFormat vkFormat;
+    basis_tex_format textureFormat;
+
+    result = ktxTexture2_prepareTranscode(This, outputFormat, transcodeFlags,
+                                          alphaContent, vkFormat,
+                                          textureFormat);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    transcoder_texture_format targetFormat
+                                = (transcoder_texture_format)outputFormat;
+    uint32_t unitByteLength, rowUnits, rows;
+    getTranscodedImageLayout(This, level, targetFormat,
+                             unitByteLength, rowUnits, rows);
+
+    if (dstRowPitch == 0) {
+        dstRowPitch = rowUnits * unitByteLength;
+    } else {
+        if (outputFormat == KTX_TTF_PVRTC1_4_RGB
+            || outputFormat == KTX_TTF_PVRTC1_4_RGBA)
+            return KTX_INVALID_VALUE;
+        if (dstRowPitch % unitByteLength != 0
+            || dstRowPitch / unitByteLength < rowUnits)
+            return KTX_INVALID_VALUE;
+    }
+    if (dstSize < (ktx_size_t)dstRowPitch * rows)
+        return KTX_INVALID_VALUE;
+    // Pass 0 for tightly packed rows so the transcoder uses its own layout.
+    // PVRTC1 blocks are not stored in row order.
+    uint32_t rowPitchUnits = dstRowPitch == rowUnits * unitByteLength
+                           ? 0 : dstRowPitch / unitByteLength;
+    ktx_size_t dstUnits = dstSize / unitByteLength;
+    uint32_t dstSizeUnits = dstUnits > UINT32_MAX ? UINT32_MAX
+                                                  : (uint32_t)dstUnits;
+
+    uint32_t levelImage = layer * This->numFaces * depth + faceSlice;
+    bool hasAlpha = alphaContent != eNone;
+    basisu_transcoder_state xcoderState;
+
+    if (textureFormat == basis_tex_format::cETC1S) {
+        ktxBasisLzCodebooks* codebooks;
+        result = ktxTexture2_getBasisLzCodebooks(This, &codebooks);
+        if (result != KTX_SUCCESS)
+            return result;
+
+        DECLARE_PRIVATE(priv, This);
+        const ktxBasisLzEtc1sImageDesc& imageDesc
+            = BGD_ETC1S_IMAGE_DESCS(priv._supercompressionGlobalData)
+                                [codebooks->firstImages[level] + levelImage];
+        if (This->isVideo && (imageDesc.imageFlags & eBUImageIsPframe))
+            return KTX_INVALID_OPERATION;
+
+        result = transcodeEtc1sImage(This, codebooks->bit, imageDesc, level,
+                                     targetFormat, transcodeFlags, hasAlpha,
+                                     pDst, dstSizeUnits, rowPitchUnits,
+                                     xcoderState);
+    } else {
+        basisu_lowlevel_uastc_transcoder uit;
+
+        result = transcodeUastcImage(This, uit, level, levelImage,
+                                     targetFormat, transcodeFlags, hasAlpha,
+                                     pDst, dstSizeUnits, rowPitchUnits,
+                                     xcoderState);
+    }
+    return result;
+}
+
+/*
+ * Jobs for transcoding one texture to several targets. The jobs of all the
+ * targets are run as a single batch so threads are kept busy even when the
+ * texture has only a few images.
+ */
+struct MultiTranscodeJobs {
+    std::vector<TranscodeJobs> targets;
+    // Index of the first job of each target. The last entry is the total
+    // number of jobs.
+    std::vector<ktx_uint32_t> firstJobs;
+};
+
+static KTX_error_code
+transcodeMultiJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t jobIndex)
+{
+    MultiTranscodeJobs& m = *static_cast<MultiTranscodeJobs*>(userdata);
+    size_t target = std::upper_bound(m.firstJobs.begin(), m.firstJobs.end(),
+                                     jobIndex) - m.firstJobs.begin() - 1;
+    TranscodeJobs& t = m.targets[target];
+    jobIndex -= m.firstJobs[target];
+    if (t.etc1sTranscoder)
+        return transcodeEtc1sJob(&t, worker, jobIndex);
+    else
+        return transcodeUastcJob(&t, worker, jobIndex);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Transcode a KTX2 texture with BasisLZ/ETC1S or UASTC images to
+ *        several target formats.
+ *
+ * Creates a new ktxTexture2 for each of the @p numTargets formats in
+ * @p outputFormats holding the images of @p This transcoded to that format.
+ * Unlike ktxTexture2_TranscodeBasis(), @p This is not modified so there is
+ * no need to recreate it for each target. Image data is loaded and, if
+ * needed, inflated only once and BasisLZ codebooks are decoded only once.
+ * The images of all targets are transcoded concurrently on up to
+ * @p threadCount threads.
+ *
+ * The output textures have the same dimensions, orientation, video
+ * parameters and metadata as @p This. Their format, DFD and level index
+ * are as ktxTexture2_TranscodeBasis() would have set. They must be destroyed
+ * by the caller.
+ *
+ * @param[in]   This           pointer to the ktxTexture2 object of interest.
+ * @param[in]   numTargets     number of target formats.
+ * @param[in]   outputFormats  pointer to an array of @p numTargets values
+ *                             from the ktx_texture_transcode_fmt_e enum
+ *                             specifying the target formats.
+ * @param[in]   transcodeFlags bitfield of flags modifying the transcode
+ *                             operation. @sa ktx_texture_decode_flags_e.
+ * @param[in]   threadCount    maximum number of threads to use, including
+ *                             the calling thread. 0 and 1 both mean
+ *                             transcode on the calling thread only.
+ * @param[out]  outputs        pointer to an array of @p numTargets locations
+ *                             in which to store the addresses of the new
+ *                             textures. Set to @c NULL on error.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This, @p outputFormats or @p outputs is
+ *                              @c NULL or @p numTargets is 0.
+ * @exception KTX_* As for ktxTexture2_TranscodeBasis().
+ */
+KTX_error_code
+ktxTexture2_TranscodeBasisMulti(ktxTexture2* This, ktx_uint32_t numTargets,
+                                const ktx_transcode_fmt_e* outputFormats,
+                                ktx_transcode_flags transcodeFlags,
+                                ktx_uint32_t threadCount,
+                                ktxTexture2** outputs)
+{
+    if (!This || !outputFormats || !outputs || numTargets == 0)
+        return KTX_INVALID_VALUE;
+
+    for (ktx_uint32_t i = 0; i < numTargets; i++)
+        outputs[i] = nullptr;
+
+    KTX_error_code result = KTX_SUCCESS;
     basisu_lowlevel_uastc_transcoder uit;
-    // See comment on same declaration in transcodeEtc1s.
-    std::vector<basisu_transcoder_state> xcoderStates;
-    xcoderStates.resize(This->isVideo ? This->numFaces : 1);
+    MultiTranscodeJobs m;
+    m.targets.resize(numTargets);
+    m.firstJobs.resize(numTargets + 1);
+    m.firstJobs[0] = 0;
+
+    for (ktx_uint32_t i = 0; i < numTargets; i++) {
+        ktx_transcode_fmt_e outputFormat = outputFormats[i];
+        alpha_content_e alphaContent;
+        VkFormat vkFormat;
+        basis_tex_format textureFormat;
+
+        result = ktxTexture2_prepareTranscode(This, outputFormat,
+                                              transcodeFlags, alphaContent,
+                                              vkFormat, textureFormat);
+        if (result != KTX_SUCCESS)
+            goto cleanup;
+        result = ktxTexture2_createTranscodePrototype(This, vkFormat,
+                                                      &outputs[i]);
+        if (result != KTX_SUCCESS)
+            goto cleanup;
+        result = initTranscodeJobs(m.targets[i], This, alphaContent,
+                                   outputs[i], outputFormat, transcodeFlags,
+                                   &uit, nullptr, threadCount);
+        if (result != KTX_SUCCESS)
+            goto cleanup;
+        m.firstJobs[i + 1] = m.firstJobs[i]
+                           + (ktx_uint32_t)m.targets[i].jobs.size();
+    }
 
-    for (ktx_int32_t level = This->numLevels - 1; level >= 0; level--)
     {
-        ktx_uint32_t depth;
-        uint64_t writeOffset = levelOffsetWrite;
-        uint64_t writeOffsetBlocks = levelOffsetWrite / outputBlockByteLength;
-        ktx_size_t levelImageSizeIn, levelImageOffsetIn;
-        ktx_size_t levelImageSizeOut, levelSizeOut;
-        ktx_uint32_t levelImageCount;
-        uint32_t levelWidth = MAX(1, This->baseWidth >> level);
-        uint32_t levelHeight = MAX(1, This->baseHeight >> level);
-        // UASTC texel block dimensions
-        const uint32_t bw = 4, bh = 4;
-        uint32_t levelBlocksX = (levelWidth + (bw - 1)) / bw;
-        uint32_t levelBlocksY = (levelHeight + (bh - 1)) / bh;
-        uint32_t stateIndex = 0;
-
-        depth = MAX(1, This->baseDepth  >> level);
-
-        levelImageCount = This->numLayers * This->numFaces * depth;
-        levelImageSizeIn = ktxTexture_calcImageSize(ktxTexture(This), level,
-                                                    KTX_FORMAT_VERSION_TWO);
-        levelImageSizeOut = ktxTexture_calcImageSize(ktxTexture(prototype),
-                                                     level,
-                                                     KTX_FORMAT_VERSION_TWO);
-
-        levelImageOffsetIn = ktxTexture2_levelDataOffset(This, level);
-        levelSizeOut = 0;
-        bool status;
-        for (uint32_t image = 0; image < levelImageCount; image++) {
-            basisu_transcoder_state& xcoderState = xcoderStates[stateIndex];
-            // See comment before same lines in transcodeEtc1s.
-            if (++stateIndex == xcoderStates.size())
-                stateIndex = 0;
-
-            status = uit.transcode_image(
-                          (transcoder_texture_format)outputFormat,
-                          pXcodedData + writeOffset,
-                          (uint32_t)(xcodedDataLength - writeOffsetBlocks),
-                          This->pData,
-                          (uint32_t)This->dataSize,
-                          levelBlocksX,
-                          levelBlocksY,
-                          levelWidth,
-                          levelHeight,
-                          level,
-                          (uint32_t)levelImageOffsetIn,
-                          (uint32_t)levelImageSizeIn,
-                          transcodeFlags,
-                          alphaContent != eNone,
-                          This->isVideo, // is_video
-                          //imageDesc.imageFlags ^ cSliceDescFlagsFrameIsIFrame,
-                          0, // output_row_pitch_in_blocks_or_pixels
-                          &xcoderState, // pState
-                          0, // output_rows_in_pixels,
-                          -1, // channel0
-                          -1  // channel1
-                          );
-            if (!status)
-                return KTX_TRANSCODE_FAILED;
-            writeOffset += levelImageSizeOut;
-            levelSizeOut += levelImageSizeOut;
-            levelImageOffsetIn += levelImageSizeIn;
+        // Every target needs a transcoder state for each worker of the
+        // combined batch.
+        ktx_uint32_t jobCount = m.firstJobs[numTargets];
+        for (auto& t : m.targets)
+            t.xcoderStates.resize(ktxJobWorkerCount(threadCount, jobCount));
+        result = ktxRunJobs(threadCount, jobCount, transcodeMultiJob, &m);
+        if (result != KTX_SUCCESS)
+            goto cleanup;
+    }
+
+    for (ktx_uint32_t i = 0; i < numTargets; i++) {
+        ktxTexture2* output = outputs[i];
+        output->orientation = This->orientation;
+        output->isVideo = This->isVideo;
+        output->duration = This->duration;
+        output->timescale = This->timescale;
+        output->loopcount = This->loopcount;
+        if (This->kvDataHead) {
+            ktxHashList_ConstructCopy(&output->kvDataHead, This->kvDataHead);
+        } else if (This->kvData) {
+            output->kvData = (ktx_uint8_t*)malloc(This->kvDataLen);
+            if (!output->kvData) {
+                result = KTX_OUT_OF_MEMORY;
+                goto cleanup;
+            }
+            memcpy(output->kvData, This->kvData, This->kvDataLen);
+            output->kvDataLen = This->kvDataLen;
         }
-        protoLevelIndex[level].byteOffset = levelOffsetWrite;
-        // writeOffset will be equal to total size of the images in the level.
-        protoLevelIndex[level].byteLength = levelSizeOut;
-        protoLevelIndex[level].uncompressedByteLength = levelSizeOut;
-        levelOffsetWrite += levelSizeOut;
     }
-    // In case of transcoding to uncompressed.
-    levelOffsetWrite = _KTX_PADN(protoPriv._requiredLevelAlignment,
-                                 levelOffsetWrite);
     return KTX_SUCCESS;
+
+cleanup:
+    for (ktx_uint32_t i = 0; i < numTargets; i++) {
+        if (outputs[i])
+            ktxTexture2_Destroy(outputs[i]);
+        outputs[i] = nullptr;
+    }
+    return result;
 }
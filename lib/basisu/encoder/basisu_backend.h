@@ -278,6 +278,7 @@ namespace basisu
 		uint32_t encode();
 
 		const basisu_backend_output &get_output() const { return m_output; }
+		basisu_backend_output &get_output() { return m_output; }
 		const basisu_backend_params& get_params() const { return m_params; }
 
 	private:
@@ -252,6 +252,15 @@ namespace basisu
 				return cECFailedBackend;
 		}
 
+		if (m_params.m_pOutput_sink)
+		{
+			basisu_backend_output& encoded_output = m_params.m_uastc ? m_uastc_backend_output : m_backend.get_output();
+			if (!m_params.m_pOutput_sink->consume(encoded_output))
+				return cECFailedCreateBasisFile;
+
+			return cECSuccess;
+		}
+
 		if (!create_basis_file_and_transcode())
 			return cECFailedCreateBasisFile;
 		
@@ -202,6 +202,21 @@ namespace basisu
 		bool m_changed;
 	};
 
+	// Receives the back end's output from basis_compressor::process() in place
+	// of a .basis file. When basis_compressor_params::m_pOutput_sink is set
+	// no .basis or .ktx2 file is created, so the options that operate on
+	// those (m_create_ktx2_file, m_write_output_basis_files,
+	// m_validate_output_data and m_compute_stats) have no effect. consume()
+	// may move data out of output, e.g. to avoid copying the slices.
+	class basis_compressor_output_sink
+	{
+	public:
+		virtual ~basis_compressor_output_sink() { }
+
+		// Return false to make process() fail with cECFailedCreateBasisFile.
+		virtual bool consume(basisu_backend_output& output) = 0;
+	};
+
 	struct basis_compressor_params
 	{
 		basis_compressor_params() :
@@ -225,7 +240,8 @@ namespace basisu
 			m_resample_factor(0.0f, .00125f, 100.0f),
 			m_ktx2_uastc_supercompression(basist::KTX2_SS_NONE),
 			m_ktx2_zstd_supercompression_level(6, INT_MIN, INT_MAX),
-			m_pJob_pool(nullptr)
+			m_pJob_pool(nullptr),
+			m_pOutput_sink(nullptr)
 		{
 			clear();
 		}
@@ -313,6 +329,7 @@ namespace basisu
 			m_validate_output_data.clear();
 
 			m_pJob_pool = nullptr;
+			m_pOutput_sink = nullptr;
 		}
 						
 		// True to generate UASTC .basis file data, otherwise ETC1S.
@@ -443,6 +460,10 @@ namespace basisu
 		bool_param<false> m_validate_output_data;
 
 		job_pool *m_pJob_pool;
+
+		// If not null, process() passes the encoded data here instead of
+		// creating a .basis file. See basis_compressor_output_sink.
+		basis_compressor_output_sink *m_pOutput_sink;
 	};
 
 	// Important: basisu_encoder_init() MUST be called first before using this class.
@@ -1512,7 +1512,8 @@ namespace basisu
 		return h;
 	}
 
-	job_pool::job_pool(uint32_t num_threads) : 
+	job_pool::job_pool(uint32_t num_threads, bool external_workers) : 
+		m_total_threads(num_threads),
 		m_num_active_jobs(0),
 		m_kill_flag(false)
 	{
@@ -1520,7 +1521,7 @@ namespace basisu
 
 		debug_printf("job_pool::job_pool: %u total threads\n", num_threads);
 
-		if (num_threads > 1)
+		if (!external_workers && num_threads > 1)
 		{
 			m_threads.resize(num_threads - 1);
 
@@ -1594,6 +1595,20 @@ namespace basisu
 		m_no_more_jobs.wait(lock, [this]{ return !m_num_active_jobs; } );
 	}
 
+	void job_pool::run_worker()
+	{
+		job_thread(0);
+	}
+
+	void job_pool::stop_workers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_kill_flag = true;
+		}
+		m_has_work.notify_all();
+	}
+
 	void job_pool::job_thread(uint32_t index)
 	{
 		BASISU_NOTE_UNUSED(index);
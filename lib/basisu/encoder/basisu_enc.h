@@ -697,7 +697,9 @@ namespace basisu
 
 	public:
 		// num_threads is the TOTAL number of job pool threads, including the calling thread! So 2=1 new thread, 3=2 new threads, etc.
-		job_pool(uint32_t num_threads);
+		// If external_workers is true no threads are created. Instead up to num_threads - 1 threads owned by the caller
+		// must call run_worker() to serve the pool until stop_workers() is called.
+		job_pool(uint32_t num_threads, bool external_workers = false);
 		~job_pool();
 				
 		void add_job(const std::function<void()>& job);
@@ -705,9 +707,14 @@ namespace basisu
 
 		void wait_for_all();
 
-		size_t get_total_threads() const { return 1 + m_threads.size(); }
+		size_t get_total_threads() const { return m_total_threads; }
+
+		// For pools with external workers. run_worker() runs jobs on the calling thread until stop_workers() is called.
+		void run_worker();
+		void stop_workers();
 		
 	private:
+		uint32_t m_total_threads;
 		std::vector<std::thread> m_threads;
 		std::vector<std::function<void()> > m_queue;
 		
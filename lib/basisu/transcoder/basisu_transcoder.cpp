@@ -139,6 +139,30 @@
 	#endif
 #endif
 
+// Set BASISD_SUPPORT_UASTC_SIMD to 0 to disable the SSE4.1 and AVX2 kernels used when unpacking UASTC blocks.
+// The kernels are chosen at runtime according to the CPU so enabling them does not require compiling for SSE4.1 or AVX2.
+#ifndef BASISD_SUPPORT_UASTC_SIMD
+	#if BASISD_SUPPORT_UASTC && !defined(__EMSCRIPTEN__) && (defined(_M_AMD64) || defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__))
+		#define BASISD_SUPPORT_UASTC_SIMD 1
+	#else
+		#define BASISD_SUPPORT_UASTC_SIMD 0
+	#endif
+#endif
+
+#if BASISD_SUPPORT_UASTC_SIMD
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		// MSVC allows any intrinsic to be used without changing the target ISA.
+		#define BASISD_TARGET_SSE41
+		#define BASISD_TARGET_AVX2
+	#else
+		#include <cpuid.h>
+		#define BASISD_TARGET_SSE41 __attribute__((target("sse4.1")))
+		#define BASISD_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
 #define BASISD_WRITE_NEW_BC7_MODE5_TABLES			0
 #define BASISD_WRITE_NEW_DXT1_TABLES				0
 #define BASISD_WRITE_NEW_ETC2_EAC_A8_TABLES		0
@@ -12598,6 +12622,145 @@ namespace basist
 
 	static const uint32_t* g_astc_weight_tables[6] = { nullptr, g_bc7_weights1, g_bc7_weights2, g_bc7_weights3, g_astc_weights4, g_astc_weights5 };
 
+#if BASISD_SUPPORT_UASTC_SIMD
+	// Expands the endpoint components to 16 bits, as astc_interpolate() does, in 4 32-bit lanes.
+	static inline BASISD_TARGET_SSE41 __m128i uastc_expand_endpoint_sse41(const color32& c, bool srgb)
+	{
+		const __m128i v = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)c.m));
+		return _mm_or_si128(_mm_slli_epi32(v, 8), srgb ? _mm_set1_epi32(0x80) : v);
+	}
+
+	static BASISD_TARGET_SSE41 void uastc_palette_sse41(const color32& l, const color32& h, const uint32_t* pWeights, uint32_t num_weights, bool srgb, color32* pColors)
+	{
+		const __m128i vl = uastc_expand_endpoint_sse41(l, srgb);
+		const __m128i vd = _mm_sub_epi32(uastc_expand_endpoint_sse41(h, srgb), vl);
+		// l * (64 - w) + h * w == l * 64 + (h - l) * w, which is never negative.
+		const __m128i vbase = _mm_add_epi32(_mm_slli_epi32(vl, 6), _mm_set1_epi32(32));
+
+		for (uint32_t i = 0; i < num_weights; i++)
+		{
+			__m128i k = _mm_add_epi32(vbase, _mm_mullo_epi32(vd, _mm_set1_epi32((int)pWeights[i])));
+			k = _mm_srli_epi32(k, 6 + 8);
+			k = _mm_packus_epi32(k, k);
+			pColors[i].m = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(k, k));
+		}
+	}
+
+	// As uastc_palette_sse41() but computes 2 palette entries per iteration.
+	static BASISD_TARGET_AVX2 void uastc_palette_avx2(const color32& l, const color32& h, const uint32_t* pWeights, uint32_t num_weights, bool srgb, color32* pColors)
+	{
+		const __m128i l4 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)l.m));
+		const __m128i h4 = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)h.m));
+		const __m256i vl8 = _mm256_broadcastsi128_si256(l4);
+		const __m256i vh8 = _mm256_broadcastsi128_si256(h4);
+		const __m256i vl = _mm256_or_si256(_mm256_slli_epi32(vl8, 8), srgb ? _mm256_set1_epi32(0x80) : vl8);
+		const __m256i vh = _mm256_or_si256(_mm256_slli_epi32(vh8, 8), srgb ? _mm256_set1_epi32(0x80) : vh8);
+		const __m256i vd = _mm256_sub_epi32(vh, vl);
+		const __m256i vbase = _mm256_add_epi32(_mm256_slli_epi32(vl, 6), _mm256_set1_epi32(32));
+
+		uint32_t i = 0;
+		for (; i + 1 < num_weights; i += 2)
+		{
+			const __m256i w = _mm256_setr_epi32((int)pWeights[i], (int)pWeights[i], (int)pWeights[i], (int)pWeights[i],
+				(int)pWeights[i + 1], (int)pWeights[i + 1], (int)pWeights[i + 1], (int)pWeights[i + 1]);
+			__m256i k = _mm256_add_epi32(vbase, _mm256_mullo_epi32(vd, w));
+			k = _mm256_srli_epi32(k, 6 + 8);
+			// Packing works within each 128-bit lane, leaving one palette entry in the low 32 bits of each lane.
+			k = _mm256_packus_epi32(k, k);
+			k = _mm256_packus_epi16(k, k);
+			pColors[i].m = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(k));
+			pColors[i + 1].m = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(k, 1));
+		}
+
+		for (; i < num_weights; i++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+				pColors[i][c] = (uint8_t)astc_interpolate(l[c], h[c], pWeights[i], srgb);
+		}
+	}
+
+	static void uastc_cpuid(uint32_t leaf, uint32_t regs[4])
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int r[4];
+		__cpuidex(r, (int)leaf, 0);
+		for (uint32_t i = 0; i < 4; i++)
+			regs[i] = (uint32_t)r[i];
+#else
+		if (!__get_cpuid_count(leaf, 0, &regs[0], &regs[1], &regs[2], &regs[3]))
+			regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+	}
+
+	static void uastc_cpu_features(bool& has_sse41, bool& has_avx2)
+	{
+		has_sse41 = has_avx2 = false;
+
+		uint32_t regs[4];
+		uastc_cpuid(0, regs);
+		const uint32_t max_leaf = regs[0];
+		if (max_leaf < 1)
+			return;
+
+		uastc_cpuid(1, regs);
+		has_sse41 = (regs[2] & (1U << 19)) != 0;
+		// AVX state must also be enabled by the OS.
+		bool has_avx = false;
+		if ((regs[2] & (1U << 27)) && (regs[2] & (1U << 28)))
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			const uint64_t xcr0 = _xgetbv(0);
+#else
+			uint32_t xcr0_lo, xcr0_hi;
+			__asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+			const uint64_t xcr0 = ((uint64_t)xcr0_hi << 32) | xcr0_lo;
+#endif
+			has_avx = (xcr0 & 6) == 6;
+		}
+
+		if (has_avx && max_leaf >= 7)
+		{
+			uastc_cpuid(7, regs);
+			has_avx2 = (regs[1] & (1U << 5)) != 0;
+		}
+	}
+
+	static uastc_palette_kernel_func select_uastc_palette_kernel()
+	{
+		bool has_sse41, has_avx2;
+		uastc_cpu_features(has_sse41, has_avx2);
+
+		if (has_avx2)
+			return uastc_palette_avx2;
+		if (has_sse41)
+			return uastc_palette_sse41;
+		return nullptr;
+	}
+
+	// Returns the fastest palette kernel the CPU supports, or nullptr to use the scalar code.
+	static uastc_palette_kernel_func get_uastc_palette_kernel()
+	{
+		static const uastc_palette_kernel_func s_kernel = select_uastc_palette_kernel();
+		return s_kernel;
+	}
+#endif // BASISD_SUPPORT_UASTC_SIMD
+
+	void get_uastc_palette_kernels(uastc_palette_kernel_func& sse41, uastc_palette_kernel_func& avx2)
+	{
+		sse41 = nullptr;
+		avx2 = nullptr;
+
+#if BASISD_SUPPORT_UASTC_SIMD
+		bool has_sse41, has_avx2;
+		uastc_cpu_features(has_sse41, has_avx2);
+
+		if (has_sse41)
+			sse41 = uastc_palette_sse41;
+		if (has_avx2)
+			avx2 = uastc_palette_avx2;
+#endif
+	}
+
 	bool unpack_uastc(uint32_t mode, uint32_t common_pattern, const color32& solid_color, const astc_block_desc& astc, color32* pPixels, bool srgb)
 	{
 		if (mode == UASTC_MODE_INDEX_SOLID_COLOR)
@@ -12648,8 +12811,20 @@ namespace basist
 
 		const uint32_t* pWeights = g_astc_weight_tables[weight_bits];
 
+#if BASISD_SUPPORT_UASTC_SIMD
+		const uastc_palette_kernel_func palette_kernel = get_uastc_palette_kernel();
+#endif
+
 		for (uint32_t subset_index = 0; subset_index < total_subsets; subset_index++)
 		{
+#if BASISD_SUPPORT_UASTC_SIMD
+			if (palette_kernel)
+			{
+				palette_kernel(endpoints[subset_index][0], endpoints[subset_index][1], pWeights, weight_levels, srgb, block_colors[subset_index]);
+				continue;
+			}
+#endif
+
 			for (uint32_t l = 0; l < weight_levels; l++)
 			{
 				if (total_comps == 2)
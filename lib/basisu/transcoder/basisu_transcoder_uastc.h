@@ -244,6 +244,14 @@ namespace basist
 	bool unpack_uastc(const uastc_block& blk, color32* pPixels, bool srgb);
 	bool unpack_uastc(const uastc_block& blk, unpacked_uastc_block& unpacked, bool undo_blue_contract, bool read_hints = true);
 
+	// Computes the palette of a UASTC subset: pColors[i] = astc_interpolate(l, h, pWeights[i], srgb) for all 4 components.
+	// Components a mode doesn't use have l = h = 255, which interpolates to 255, so no special cases are needed.
+	typedef void (*uastc_palette_kernel_func)(const color32& l, const color32& h, const uint32_t* pWeights, uint32_t num_weights, bool srgb, color32* pColors);
+
+	// Returns the SSE4.1 and AVX2 palette kernels unpack_uastc() chooses from, or nullptr for those the build or CPU lacks.
+	// Exposed so tests can compare each kernel with astc_interpolate().
+	void get_uastc_palette_kernels(uastc_palette_kernel_func& sse41, uastc_palette_kernel_func& avx2);
+
 	bool transcode_uastc_to_astc(const uastc_block& src_blk, void* pDst);
 
 	bool transcode_uastc_to_bc7(const unpacked_uastc_block& unpacked_src_blk, bc7_optimization_results& dst_blk);
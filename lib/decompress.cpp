@@ -0,0 +1,739 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file decompress.cpp
+ * @~English
+ *
+ * @brief Function for decoding a block-compressed texture to RGBA pixels.
+ *
+ * BCn blocks are decoded by basisu's unpackers, ASTC blocks by astcenc and
+ * ETC2/EAC blocks by ktxTexture2_DecodeEtcImage(). The rows of blocks of
+ * every image of the texture are split into jobs run by ktxRunJobs().
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <KHR/khr_df.h>
+
+#include "ktx.h"
+#include "ktxint.h"
+#include "texture2.h"
+#include "threadpool.h"
+#include "vkformat_enum.h"
+
+#include "astc-encoder/Source/astcenc.h"
+#include "astcenc_dispatch.h"
+#if (EMSCRIPTEN)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#include "basisu/encoder/basisu_gpu_texture.h"
+#if (EMSCRIPTEN)
+#pragma clang diagnostic pop
+#endif
+
+using basisu::color_rgba;
+
+namespace {
+
+enum codec_e {
+    CODEC_BC1_RGB,
+    CODEC_BC1_RGBA,
+    CODEC_BC2,
+    CODEC_BC3,
+    CODEC_BC4,
+    CODEC_BC5,
+    CODEC_BC7,
+    CODEC_ASTC,
+    CODEC_ETC2,     // ETC2 RGB, RGB A1 and RGBA, decoded to RGBA8.
+    CODEC_EAC_R11,  // Decoded to R16.
+    CODEC_EAC_RG11  // Decoded to R16G16.
+};
+
+struct DecodeFormat {
+    codec_e codec;
+    bool isSigned;  // SNORM values. Only decodable to R16G16B16A16_SFLOAT.
+    bool hdr;       // ASTC HDR. Only decodable to R16G16B16A16_SFLOAT.
+};
+
+// Returns false for compressed formats that cannot be decoded.
+bool
+getDecodeFormat(ktx_uint32_t vkFormat, DecodeFormat& fmt)
+{
+    fmt.isSigned = false;
+    fmt.hdr = false;
+    switch (vkFormat) {
+      case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+      case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        fmt.codec = CODEC_BC1_RGB;
+        return true;
+      case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+      case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        fmt.codec = CODEC_BC1_RGBA;
+        return true;
+      case VK_FORMAT_BC2_UNORM_BLOCK:
+      case VK_FORMAT_BC2_SRGB_BLOCK:
+        fmt.codec = CODEC_BC2;
+        return true;
+      case VK_FORMAT_BC3_UNORM_BLOCK:
+      case VK_FORMAT_BC3_SRGB_BLOCK:
+        fmt.codec = CODEC_BC3;
+        return true;
+      case VK_FORMAT_BC4_SNORM_BLOCK:
+        fmt.isSigned = true;
+        // Fall through.
+      case VK_FORMAT_BC4_UNORM_BLOCK:
+        fmt.codec = CODEC_BC4;
+        return true;
+      case VK_FORMAT_BC5_SNORM_BLOCK:
+        fmt.isSigned = true;
+        // Fall through.
+      case VK_FORMAT_BC5_UNORM_BLOCK:
+        fmt.codec = CODEC_BC5;
+        return true;
+      case VK_FORMAT_BC7_UNORM_BLOCK:
+      case VK_FORMAT_BC7_SRGB_BLOCK:
+        fmt.codec = CODEC_BC7;
+        return true;
+      case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+      case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+      case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+      case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+      case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+      case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        fmt.codec = CODEC_ETC2;
+        return true;
+      case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+        fmt.isSigned = true;
+        // Fall through.
+      case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        fmt.codec = CODEC_EAC_R11;
+        return true;
+      case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+        fmt.isSigned = true;
+        // Fall through.
+      case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        fmt.codec = CODEC_EAC_RG11;
+        return true;
+      default:
+        break;
+    }
+    if (vkFormat >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+        && vkFormat <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+        fmt.codec = CODEC_ASTC;
+        return true;
+    }
+    if (vkFormat >= VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK_EXT
+        && vkFormat <= VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK_EXT) {
+        fmt.codec = CODEC_ASTC;
+        fmt.hdr = true;
+        return true;
+    }
+    if (vkFormat >= VK_FORMAT_ASTC_3x3x3_UNORM_BLOCK_EXT
+        && vkFormat <= VK_FORMAT_ASTC_6x6x6_SFLOAT_BLOCK_EXT) {
+        // UNORM, SRGB and SFLOAT alternate for each block size.
+        fmt.codec = CODEC_ASTC;
+        fmt.hdr = (vkFormat - VK_FORMAT_ASTC_3x3x3_UNORM_BLOCK_EXT) % 3 == 2;
+        return true;
+    }
+    return false;
+}
+
+// Round to nearest even. Infinities and NaNs are not expected.
+ktx_uint16_t
+floatToHalf(float f)
+{
+    ktx_uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    ktx_uint32_t sign = (x >> 16) & 0x8000;
+    int exp = (int)((x >> 23) & 0xff) - 127 + 15;
+    ktx_uint32_t mant = x & 0x7fffff;
+
+    if (exp >= 31)
+        return (ktx_uint16_t)(sign | 0x7c00);
+    if (exp <= 0) {
+        if (exp < -10)
+            return (ktx_uint16_t)sign;
+        mant |= 0x800000;
+        ktx_uint32_t shift = (ktx_uint32_t)(14 - exp);
+        ktx_uint32_t h = mant >> shift;
+        ktx_uint32_t rem = mant & ((1u << shift) - 1);
+        ktx_uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            h++;
+        return (ktx_uint16_t)(sign | h);
+    }
+    ktx_uint32_t h = ((ktx_uint32_t)exp << 10) | (mant >> 13);
+    ktx_uint32_t rem = mant & 0x1fff;
+    // A carry out of the mantissa correctly increments the exponent.
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        h++;
+    return (ktx_uint16_t)(sign | h);
+}
+
+// Decode a BC4 SNORM block to @p stride spaced floats in [-1, 1].
+void
+decodeBc4Snorm(const ktx_uint8_t* block, float* out, ktx_uint32_t stride)
+{
+    int e0 = (signed char)block[0];
+    int e1 = (signed char)block[1];
+    if (e0 == -128) e0 = -127;
+    if (e1 == -128) e1 = -127;
+
+    float values[8];
+    values[0] = (float)e0;
+    values[1] = (float)e1;
+    if (e0 > e1) {
+        for (int i = 1; i < 7; i++)
+            values[i + 1] = ((7 - i) * e0 + i * e1) / 7.0f;
+    } else {
+        for (int i = 1; i < 5; i++)
+            values[i + 1] = ((5 - i) * e0 + i * e1) / 5.0f;
+        values[6] = -127.0f;
+        values[7] = 127.0f;
+    }
+
+    ktx_uint64_t selectors = 0;
+    for (int i = 7; i >= 2; i--)
+        selectors = selectors << 8 | block[i];
+    for (ktx_uint32_t i = 0; i < 16; i++, selectors >>= 3)
+        out[i * stride] = values[selectors & 7] / 127.0f;
+}
+
+// Decode the colour half of a BC2 or BC3 block to the RGB of @p pixels.
+// Unlike BC1 these always use 4 colours, whatever the endpoint order.
+void
+decodeBc23Color(const ktx_uint8_t* block, color_rgba pixels[16])
+{
+    ktx_uint32_t rgb[4][3];
+    for (ktx_uint32_t e = 0; e < 2; e++) {
+        ktx_uint32_t c = block[e * 2] | block[e * 2 + 1] << 8;
+        ktx_uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[e][0] = (r << 3) | (r >> 2);
+        rgb[e][1] = (g << 2) | (g >> 4);
+        rgb[e][2] = (b << 3) | (b >> 2);
+    }
+    for (ktx_uint32_t i = 0; i < 3; i++) {
+        rgb[2][i] = (rgb[0][i] * 2 + rgb[1][i]) / 3;
+        rgb[3][i] = (rgb[1][i] * 2 + rgb[0][i]) / 3;
+    }
+    for (ktx_uint32_t i = 0; i < 16; i++) {
+        const ktx_uint32_t* c = rgb[(block[4 + i / 4] >> (i % 4) * 2) & 3];
+        pixels[i].r = (ktx_uint8_t)c[0];
+        pixels[i].g = (ktx_uint8_t)c[1];
+        pixels[i].b = (ktx_uint8_t)c[2];
+    }
+}
+
+// Decode a BCn block to 4x4 RGBA8 pixels, rows of 4.
+void
+decodeBcBlock(codec_e codec, const ktx_uint8_t* block, color_rgba pixels[16])
+{
+    switch (codec) {
+      case CODEC_BC1_RGB:
+        for (ktx_uint32_t i = 0; i < 16; i++)
+            pixels[i].set_noclamp_rgba(0, 0, 0, 255);
+        basisu::unpack_bc1(block, pixels, false);
+        break;
+      case CODEC_BC1_RGBA:
+        basisu::unpack_bc1(block, pixels, true);
+        break;
+      case CODEC_BC2:
+        decodeBc23Color(block + 8, pixels);
+        for (ktx_uint32_t i = 0; i < 16; i++)
+            pixels[i].a = (ktx_uint8_t)(((block[i / 2] >> (i & 1) * 4) & 15)
+                                        * 17);
+        break;
+      case CODEC_BC3:
+        decodeBc23Color(block + 8, pixels);
+        basisu::unpack_bc4(block, &pixels[0].a, sizeof(color_rgba));
+        break;
+      case CODEC_BC4:
+        for (ktx_uint32_t i = 0; i < 16; i++)
+            pixels[i].set_noclamp_rgba(0, 0, 0, 255);
+        basisu::unpack_bc4(block, &pixels[0].r, sizeof(color_rgba));
+        break;
+      case CODEC_BC5:
+        for (ktx_uint32_t i = 0; i < 16; i++)
+            pixels[i].set_noclamp_rgba(0, 0, 0, 255);
+        basisu::unpack_bc5(block, pixels);
+        break;
+      case CODEC_BC7:
+        // Reserved modes decode to 0.
+        for (ktx_uint32_t i = 0; i < 16; i++)
+            pixels[i].set_noclamp_rgba(0, 0, 0, 0);
+        basisu::unpack_bc7(block, pixels);
+        break;
+      default:
+        assert(false && "Not a BCn codec");
+        break;
+    }
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief A row of blocks to be decoded by one job.
+ *
+ * For 3D ASTC block sizes a row covers @c slices depth slices.
+ */
+struct BlockRow {
+    const ktx_uint8_t* src;
+    ktx_uint8_t* dst;
+    ktx_uint32_t width;     // Of the image, in pixels.
+    ktx_uint32_t rows;      // Pixel rows in this block row.
+    ktx_uint32_t slices;    // Depth slices in this block row.
+    ktx_size_t slicePitch;  // Of the destination.
+};
+
+struct DecodeJobs {
+    DecodeFormat fmt;
+    ktx_uint32_t blockWidth;
+    ktx_uint32_t blockSize;     // In bytes.
+    bool toHalf;
+    ktx_uint16_t unorm8ToHalf[256];
+    std::vector<BlockRow> rows;
+
+    const ktxAstcencFuncs* astcenc;
+    astcenc_config astcConfig;
+    std::vector<astcenc_context*> astcContexts;  // Indexed by worker.
+    std::vector<astcenc_error> astcErrors;       // Indexed by worker.
+};
+
+KTX_error_code
+decodeBcRowJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t job)
+{
+    (void)worker;
+    const DecodeJobs& jobs = *static_cast<const DecodeJobs*>(userdata);
+    const BlockRow& row = jobs.rows[job];
+    const ktx_uint32_t pixelSize = jobs.toHalf ? 8 : 4;
+    const ktx_size_t rowPitch = (ktx_size_t)row.width * pixelSize;
+    const ktx_uint32_t blocks = (row.width + 3) / 4;
+    const ktx_uint8_t* src = row.src;
+
+    for (ktx_uint32_t bx = 0; bx < blocks; bx++, src += jobs.blockSize) {
+        const ktx_uint32_t cols = row.width - bx * 4 < 4 ? row.width - bx * 4
+                                                         : 4;
+        ktx_uint8_t* dst = row.dst + (ktx_size_t)bx * 4 * pixelSize;
+
+        if (jobs.fmt.isSigned) {
+            float pixels[16][4];
+            for (ktx_uint32_t i = 0; i < 16; i++) {
+                pixels[i][1] = pixels[i][2] = 0.0f;
+                pixels[i][3] = 1.0f;
+            }
+            decodeBc4Snorm(src, &pixels[0][0], 4);
+            if (jobs.fmt.codec == CODEC_BC5)
+                decodeBc4Snorm(src + 8, &pixels[0][1], 4);
+            for (ktx_uint32_t y = 0; y < row.rows; y++) {
+                ktx_uint16_t* d = reinterpret_cast<ktx_uint16_t*>(
+                                                        dst + y * rowPitch);
+                for (ktx_uint32_t x = 0; x < cols * 4; x++)
+                    d[x] = floatToHalf(pixels[y * 4 + x / 4][x % 4]);
+            }
+            continue;
+        }
+
+        color_rgba pixels[16];
+        decodeBcBlock(jobs.fmt.codec, src, pixels);
+        for (ktx_uint32_t y = 0; y < row.rows; y++) {
+            const ktx_uint8_t* p = &pixels[y * 4].r;
+            if (jobs.toHalf) {
+                ktx_uint16_t* d = reinterpret_cast<ktx_uint16_t*>(
+                                                        dst + y * rowPitch);
+                for (ktx_uint32_t x = 0; x < cols * 4; x++)
+                    d[x] = jobs.unorm8ToHalf[p[x]];
+            } else {
+                memcpy(dst + y * rowPitch, p, cols * 4);
+            }
+        }
+    }
+    return KTX_SUCCESS;
+}
+
+// Decode a row with a single-thread astcenc context owned by the worker.
+KTX_error_code
+decodeAstcRowJob(void* userdata, ktx_uint32_t worker, ktx_uint32_t job)
+{
+    DecodeJobs& jobs = *static_cast<DecodeJobs*>(userdata);
+    const BlockRow& row = jobs.rows[job];
+    astcenc_context*& context = jobs.astcContexts[worker];
+    astcenc_error error = ASTCENC_SUCCESS;
+
+    if (context == nullptr)
+        error = jobs.astcenc->context_alloc(&jobs.astcConfig, 1, &context);
+
+    if (error == ASTCENC_SUCCESS) {
+        void* slices[6];    // Largest ASTC block depth.
+        for (ktx_uint32_t z = 0; z < row.slices; z++)
+            slices[z] = row.dst + z * row.slicePitch;
+
+        astcenc_image image;
+        image.dim_x = row.width;
+        image.dim_y = row.rows;
+        image.dim_z = row.slices;
+        image.data_type = jobs.toHalf ? ASTCENC_TYPE_F16 : ASTCENC_TYPE_U8;
+        image.data = slices;
+        const astcenc_swizzle swizzle{ASTCENC_SWZ_R, ASTCENC_SWZ_G,
+                                      ASTCENC_SWZ_B, ASTCENC_SWZ_A};
+        const ktx_size_t blocks = (row.width + jobs.blockWidth - 1)
+                                  / jobs.blockWidth;
+        // Single-thread contexts are reset by astcenc for each image.
+        error = jobs.astcenc->decompress_image(context, row.src,
+                                               blocks * jobs.blockSize,
+                                               &image, &swizzle, 0);
+    }
+    if (error != ASTCENC_SUCCESS) {
+        jobs.astcErrors[worker] = error;
+        return KTX_INVALID_OPERATION;
+    }
+    return KTX_SUCCESS;
+}
+
+// Decode an image with ktxTexture2_DecodeEtcImage and convert it to the
+// target format if that is not the decoder's output format.
+KTX_error_code
+decodeEtcImage(ktxTexture2* This, const DecodeJobs& jobs,
+               ktx_uint32_t level, ktx_uint32_t layer, ktx_uint32_t faceSlice,
+               ktx_uint8_t* dst, ktx_uint32_t width, ktx_uint32_t height,
+               ktx_uint32_t threadCount, std::vector<ktx_uint8_t>& scratch)
+{
+    const ktx_size_t pixels = (ktx_size_t)width * height;
+    const ktx_uint32_t channels = jobs.fmt.codec == CODEC_EAC_R11 ? 1
+                                : jobs.fmt.codec == CODEC_EAC_RG11 ? 2 : 4;
+
+    if (jobs.fmt.codec == CODEC_ETC2 && !jobs.toHalf) {
+        return ktxTexture2_DecodeEtcImage(This, level, layer, faceSlice, dst,
+                                          pixels * 4, 0, threadCount);
+    }
+
+    const ktx_size_t srcPixelSize = jobs.fmt.codec == CODEC_ETC2
+                                    ? 4 : channels * 2;
+    try {
+        scratch.resize(pixels * srcPixelSize);
+    } catch (std::bad_alloc&) {
+        return KTX_OUT_OF_MEMORY;
+    }
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(This, level, layer, faceSlice,
+                                        scratch.data(), scratch.size(), 0,
+                                        threadCount);
+    if (result != KTX_SUCCESS)
+        return result;
+
+    if (jobs.fmt.codec == CODEC_ETC2) {
+        ktx_uint16_t* d = reinterpret_cast<ktx_uint16_t*>(dst);
+        for (ktx_size_t i = 0; i < pixels * 4; i++)
+            d[i] = jobs.unorm8ToHalf[scratch[i]];
+        return KTX_SUCCESS;
+    }
+
+    const ktx_uint16_t* s = reinterpret_cast<const ktx_uint16_t*>(
+                                                            scratch.data());
+    for (ktx_size_t i = 0; i < pixels; i++, s += channels) {
+        if (jobs.toHalf) {
+            ktx_uint16_t* d = reinterpret_cast<ktx_uint16_t*>(dst) + i * 4;
+            for (ktx_uint32_t c = 0; c < 3; c++) {
+                float v = 0.0f;
+                if (c < channels && jobs.fmt.isSigned) {
+                    v = (ktx_int16_t)s[c] / 32767.0f;
+                    v = v < -1.0f ? -1.0f : v;
+                } else if (c < channels) {
+                    v = s[c] / 65535.0f;
+                }
+                d[c] = floatToHalf(v);
+            }
+            d[3] = floatToHalf(1.0f);
+        } else {
+            ktx_uint8_t* d = dst + i * 4;
+            for (ktx_uint32_t c = 0; c < 3; c++)
+                d[c] = c < channels
+                       ? (ktx_uint8_t)((s[c] * 255u + 32767u) / 65535u) : 0;
+            d[3] = 255;
+        }
+    }
+    return KTX_SUCCESS;
+}
+
+} // namespace
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup writer
+ * @~English
+ * @brief Decode the images of a block-compressed texture to RGBA pixels.
+ *
+ * The decoded images replace the original images and the texture's fields,
+ * including the DFD, are modified to reflect the new state. To keep the
+ * compressed texture, decode a copy made with ktxTexture2_CreateCopy().
+ *
+ * BC1-5 and BC7 images are decoded with the BCn decoders of the Basis
+ * Universal encoder, ASTC images with astcenc and ETC2 and EAC images with
+ * ktxTexture2_DecodeEtcImage(). BC6H and PVRTC images cannot be decoded.
+ *
+ * @p targetVkFormat must be one of
+ * - @c VK_FORMAT_R8G8B8A8_UNORM or @c VK_FORMAT_R8G8B8A8_SRGB, matching the
+ *   transfer function of the texture. 8-bit values are the texture's
+ *   values; sRGB values are not converted to linear. Not available for
+ *   SNORM and ASTC HDR formats.
+ * - @c VK_FORMAT_R16G16B16A16_SFLOAT. Not available for sRGB formats.
+ * - @c VK_FORMAT_UNDEFINED to select whichever of the above applies,
+ *   @c VK_FORMAT_R16G16B16A16_SFLOAT only for SNORM and HDR formats.
+ *
+ * Components missing from the texture's format are set to 0 for G and B
+ * and to 1 for A.
+ *
+ * Rows of blocks are decoded on up to @p threadCount threads. Image data
+ * is loaded and, if necessary, inflated first if it has not already been
+ * loaded.
+ *
+ * @param[in]   This            pointer to the ktxTexture2 object of interest.
+ * @param[in]   targetVkFormat  the format of the decoded images.
+ * @param[in]   threadCount     the maximum number of threads to use. 0 is
+ *                              treated as 1.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE     @p This is @c NULL or @p targetVkFormat
+ *                                  is not one of the above.
+ * @exception KTX_INVALID_OPERATION The texture's images are not block
+ *                                  compressed or are Basis Universal
+ *                                  encoded. Use ktxTexture2_TranscodeBasis()
+ *                                  for those.
+ * @exception KTX_INVALID_OPERATION @p targetVkFormat cannot represent the
+ *                                  values of the texture's format.
+ * @exception KTX_INVALID_OPERATION astcenc failed to decode the images.
+ * @exception KTX_UNSUPPORTED_FEATURE
+ *                                  The texture's format is BC6H or PVRTC.
+ * @exception KTX_OUT_OF_MEMORY     Not enough memory to carry out the
+ *                                  operation.
+ */
+extern "C" KTX_error_code
+ktxTexture2_Decompress(ktxTexture2* This, ktx_uint32_t targetVkFormat,
+                       ktx_uint32_t threadCount)
+{
+    if (This == NULL)
+        return KTX_INVALID_VALUE;
+    if (targetVkFormat != VK_FORMAT_UNDEFINED
+        && targetVkFormat != VK_FORMAT_R8G8B8A8_UNORM
+        && targetVkFormat != VK_FORMAT_R8G8B8A8_SRGB
+        && targetVkFormat != VK_FORMAT_R16G16B16A16_SFLOAT)
+        return KTX_INVALID_VALUE;
+    if (!This->isCompressed || This->vkFormat == VK_FORMAT_UNDEFINED
+        || This->supercompressionScheme == KTX_SS_BASIS_LZ)
+        return KTX_INVALID_OPERATION;
+
+    DecodeJobs jobs;
+    if (!getDecodeFormat(This->vkFormat, jobs.fmt))
+        return KTX_UNSUPPORTED_FEATURE;
+
+    const bool sRGB = KHR_DFDVAL(This->pDfd + 1, TRANSFER)
+                      == KHR_DF_TRANSFER_SRGB;
+    if (targetVkFormat == VK_FORMAT_UNDEFINED) {
+        if (jobs.fmt.isSigned || jobs.fmt.hdr)
+            targetVkFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        else
+            targetVkFormat = sRGB ? VK_FORMAT_R8G8B8A8_SRGB
+                                  : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    jobs.toHalf = targetVkFormat == VK_FORMAT_R16G16B16A16_SFLOAT;
+    if (jobs.toHalf) {
+        if (sRGB)
+            return KTX_INVALID_OPERATION;
+    } else if (jobs.fmt.isSigned || jobs.fmt.hdr
+               || sRGB != (targetVkFormat == VK_FORMAT_R8G8B8A8_SRGB)) {
+        return KTX_INVALID_OPERATION;
+    }
+
+    KTX_error_code result;
+    if (This->pData == NULL) {
+        result = ktxTexture2_LoadImageData(This, NULL, 0);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+    if (This->supercompressionScheme != KTX_SS_NONE)
+        return KTX_INVALID_OPERATION;
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    for (ktx_uint32_t i = 0; i < 256; i++)
+        jobs.unorm8ToHalf[i] = floatToHalf(i / 255.0f);
+
+    const ktxFormatSize& formatSize = This->_protected->_formatSize;
+    jobs.blockWidth = formatSize.blockWidth;
+    jobs.blockSize = formatSize.blockSizeInBits / 8;
+    const ktx_uint32_t blockHeight = formatSize.blockHeight;
+    const ktx_uint32_t blockDepth = formatSize.blockDepth;
+
+    // Create a prototype texture to provide a properly sized data
+    // allocation and the DFD for the target format.
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = targetVkFormat;
+    createInfo.baseWidth = This->baseWidth;
+    createInfo.baseHeight = This->baseHeight;
+    createInfo.baseDepth = This->baseDepth;
+    createInfo.generateMipmaps = This->generateMipmaps;
+    createInfo.isArray = This->isArray;
+    createInfo.numDimensions = This->numDimensions;
+    createInfo.numFaces = This->numFaces;
+    createInfo.numLayers = This->numLayers;
+    createInfo.numLevels = MAX(1, This->numLevels);
+    createInfo.pDfd = nullptr;
+
+    ktxTexture2* prototype;
+    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                                &prototype);
+    if (result != KTX_SUCCESS)
+        return result;
+    if (!prototype->pData) {
+        ktxTexture2_Destroy(prototype);
+        return KTX_OUT_OF_MEMORY;
+    }
+
+    const ktx_uint32_t pixelSize = jobs.toHalf ? 8 : 4;
+    const bool isEtc = jobs.fmt.codec == CODEC_ETC2
+                       || jobs.fmt.codec == CODEC_EAC_R11
+                       || jobs.fmt.codec == CODEC_EAC_RG11;
+    std::vector<ktx_uint8_t> scratch;
+
+    for (ktx_uint32_t level = 0; level < prototype->numLevels
+                                 && result == KTX_SUCCESS; level++) {
+        const ktx_uint32_t width = MAX(1, This->baseWidth >> level);
+        const ktx_uint32_t height = MAX(1, This->baseHeight >> level);
+        const ktx_uint32_t depth = MAX(1, This->baseDepth >> level);
+        const ktx_size_t imageSize = ktxTexture_calcImageSize(
+                                            ktxTexture(This), level,
+                                            KTX_FORMAT_VERSION_TWO);
+        // Each face of each layer holds all the depth of a 3D texture.
+        const ktx_size_t srcFaceSize = ktxTexture_layerSize(
+                                            ktxTexture(This), level,
+                                            KTX_FORMAT_VERSION_TWO)
+                                       / This->numFaces;
+        const ktx_size_t rowPitch = (ktx_size_t)width * pixelSize;
+        const ktx_size_t slicePitch = rowPitch * height;
+        const ktx_uint32_t xBlocks = (width + jobs.blockWidth - 1)
+                                     / jobs.blockWidth;
+        const ktx_uint32_t yBlocks = (height + blockHeight - 1)
+                                     / blockHeight;
+        ktx_uint32_t zBlocks = (depth + blockDepth - 1) / blockDepth;
+        if (zBlocks > srcFaceSize / imageSize)
+            zBlocks = (ktx_uint32_t)(srcFaceSize / imageSize);
+
+        const ktx_uint8_t* srcLevel = This->pData
+                                + ktxTexture2_levelDataOffset(This, level);
+        ktx_uint8_t* dstLevel = prototype->pData
+                                + ktxTexture2_levelDataOffset(prototype,
+                                                              level);
+
+        for (ktx_uint32_t layer = 0; layer < This->numLayers; layer++) {
+            for (ktx_uint32_t face = 0; face < This->numFaces; face++) {
+                const ktx_uint32_t index = layer * This->numFaces + face;
+                const ktx_uint8_t* src = srcLevel + index * srcFaceSize;
+                ktx_uint8_t* dst = dstLevel + index * slicePitch * depth;
+
+                if (isEtc) {
+                    for (ktx_uint32_t z = 0; z < depth
+                                             && result == KTX_SUCCESS; z++) {
+                        result = decodeEtcImage(This, jobs, level, layer,
+                                                This->numFaces > 1 ? face : z,
+                                                dst + z * slicePitch,
+                                                width, height, threadCount,
+                                                scratch);
+                    }
+                    continue;
+                }
+
+                for (ktx_uint32_t bz = 0; bz < zBlocks; bz++) {
+                    for (ktx_uint32_t by = 0; by < yBlocks; by++) {
+                        BlockRow row;
+                        row.src = src + ((ktx_size_t)bz * yBlocks + by)
+                                        * xBlocks * jobs.blockSize;
+                        row.dst = dst + (ktx_size_t)bz * blockDepth
+                                        * slicePitch
+                                      + (ktx_size_t)by * blockHeight
+                                        * rowPitch;
+                        row.width = width;
+                        row.rows = std::min(blockHeight, height - by * blockHeight);
+                        row.slices = std::min(blockDepth, depth - bz * blockDepth);
+                        row.slicePitch = slicePitch;
+                        try {
+                            jobs.rows.push_back(row);
+                        } catch (std::bad_alloc&) {
+                            result = KTX_OUT_OF_MEMORY;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (result == KTX_SUCCESS && jobs.fmt.codec == CODEC_ASTC
+        && !jobs.rows.empty()) {
+        jobs.astcenc = &ktxAstcencFuncs_get();
+        astcenc_error error = jobs.astcenc->config_init(
+                jobs.fmt.hdr ? ASTCENC_PRF_HDR
+                             : sRGB ? ASTCENC_PRF_LDR_SRGB : ASTCENC_PRF_LDR,
+                jobs.blockWidth, blockHeight, blockDepth,
+                ASTCENC_PRE_FASTEST, ASTCENC_FLG_DECOMPRESS_ONLY,
+                &jobs.astcConfig);
+        if (error != ASTCENC_SUCCESS) {
+            result = KTX_INVALID_OPERATION;
+        } else {
+            ktx_uint32_t workers = ktxJobWorkerCount(
+                                        threadCount,
+                                        (ktx_uint32_t)jobs.rows.size());
+            jobs.astcContexts.assign(workers, nullptr);
+            jobs.astcErrors.assign(workers, ASTCENC_SUCCESS);
+            result = ktxRunJobs(threadCount, (ktx_uint32_t)jobs.rows.size(),
+                                decodeAstcRowJob, &jobs);
+            for (astcenc_context* context : jobs.astcContexts) {
+                if (context)
+                    jobs.astcenc->context_free(context);
+            }
+        }
+    } else if (result == KTX_SUCCESS && !jobs.rows.empty()) {
+        result = ktxRunJobs(threadCount, (ktx_uint32_t)jobs.rows.size(),
+                            decodeBcRowJob, &jobs);
+    }
+
+    if (result != KTX_SUCCESS) {
+        ktxTexture2_Destroy(prototype);
+        return result;
+    }
+
+    // Move the DFD, data and format information from the prototype to This.
+    ktxTexture_protected& thisPrtctd = *This->_protected;
+    ktxTexture_protected& protoPrtctd = *prototype->_protected;
+    memcpy(&thisPrtctd._formatSize, &protoPrtctd._formatSize,
+           sizeof(ktxFormatSize));
+    thisPrtctd._typeSize = protoPrtctd._typeSize;
+    This->vkFormat = targetVkFormat;
+    This->isCompressed = KTX_FALSE;
+    This->numLevels = prototype->numLevels;
+    This->_private->_requiredLevelAlignment
+                        = prototype->_private->_requiredLevelAlignment;
+    memcpy(This->_private->_levelIndex, prototype->_private->_levelIndex,
+           This->numLevels * sizeof(ktxLevelIndexEntry));
+    free(This->pDfd);
+    This->pDfd = prototype->pDfd;
+    prototype->pDfd = 0;
+    ktxTexture_freeData(ktxTexture(This));
+    This->pData = prototype->pData;
+    This->dataSize = prototype->dataSize;
+    prototype->pData = 0;
+    prototype->dataSize = 0;
+
+    ktxTexture2_Destroy(prototype);
+    return KTX_SUCCESS;
+}
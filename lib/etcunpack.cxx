@@ -12,46 +12,697 @@
  * @~English
  * @file
  *
- * Unpack a texture compressed with ETC1
+ * Unpack a texture compressed with ETC1, ETC2 or EAC
  *
  * @author Mark Callow, HI Corporation.
  */
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "GL/glcorearb.h"
 // Not defined in glcorearb.h.
 #define GL_ETC1_RGB8_OES                0x8D64
 #include "ktx.h"
 #include "ktxint.h"
+#include "texture2.h"
+#include "threadpool.h"
+#include "vkformat_enum.h"
 
-#if SUPPORT_SOFTWARE_ETC_UNPACK
-typedef unsigned int uint;
-typedef unsigned char uint8;
+/*
+ * The decoder keeps no state outside the image being decoded so any number
+ * of images can be decoded at once. Each block's palette of colors, or
+ * values, is computed once and its pixels are then simple lookups.
+ */
+
+namespace {
+
+enum etc_format_e {
+	ETC_RGB8,           // ETC1 or ETC2 RGB.
+	ETC_RGB8A1,         // ETC2 RGB with punch-through alpha.
+	ETC_RGBA8,          // ETC2 RGB with EAC alpha.
+	ETC_R11,
+	ETC_SIGNED_R11,
+	ETC_RG11,
+	ETC_SIGNED_RG11
+};
+
+const int etc1Modifiers[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+	{ 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Distances for the T and H modes.
+const int etc2Distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+const int eacModifiers[16][8] = {
+	{ -3, -6, -9, -15, 2, 5, 8, 14 },
+	{ -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5, -8, -13, 1, 4, 7, 12 },
+	{ -2, -4, -6, -13, 1, 3, 5, 12 },
+	{ -3, -6, -8, -12, 2, 5, 7, 11 },
+	{ -3, -7, -9, -11, 2, 6, 8, 10 },
+	{ -4, -7, -8, -11, 3, 6, 7, 10 },
+	{ -3, -5, -8, -11, 2, 4, 7, 10 },
+	{ -2, -6, -8, -10, 1, 5, 7, 9 },
+	{ -2, -5, -8, -10, 1, 4, 7, 9 },
+	{ -2, -4, -8, -10, 1, 3, 7, 9 },
+	{ -2, -5, -7, -10, 1, 4, 6, 9 },
+	{ -3, -4, -7, -10, 2, 3, 6, 9 },
+	{ -1, -2, -3, -10, 0, 1, 2, 9 },
+	{ -4, -6, -8, -9, 3, 5, 7, 8 },
+	{ -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+inline ktx_uint64_t
+readBigEndian8(const ktx_uint8_t* s)
+{
+	ktx_uint64_t v = 0;
+	for (int i = 0; i < 8; i++)
+		v = (v << 8) | s[i];
+	return v;
+}
+
+inline ktx_uint8_t
+clamp255(int v)
+{
+	return (ktx_uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+inline int
+extend4(ktx_uint32_t c) { return (int)(c << 4 | c); }
+inline int
+extend5(ktx_uint32_t c) { return (int)(c << 3 | c >> 2); }
+inline int
+extend6(ktx_uint32_t c) { return (int)(c << 2 | c >> 4); }
+inline int
+extend7(ktx_uint32_t c) { return (int)(c << 1 | c >> 6); }
+
+struct rgba {
+	ktx_uint8_t r, g, b, a;
+};
+
+inline rgba
+makeRgba(int r, int g, int b)
+{
+	rgba c = { clamp255(r), clamp255(g), clamp255(b), 255 };
+	return c;
+}
+
+// Pixels of a decoded block, row-major.
+typedef rgba colorBlock[16];
+
+// Move the 16 bits of v to the even bits of the result.
+inline ktx_uint32_t
+spreadBits(ktx_uint32_t v)
+{
+	v = (v | v << 8) & 0x00FF00FF;
+	v = (v | v << 4) & 0x0F0F0F0F;
+	v = (v | v << 2) & 0x33333333;
+	return (v | v << 1) & 0x55555555;
+}
+
+// The 2-bit indices of the pixels of the ETC block. That of pixel i, in
+// column-major order, is in bits 2i and 2i + 1. The block stores the high
+// bits of all the indices followed by the low bits.
+inline ktx_uint32_t
+pixelIndices(ktx_uint64_t block)
+{
+	return spreadBits((ktx_uint32_t)(block >> 16 & 0xFFFF)) << 1
+	       | spreadBits((ktx_uint32_t)(block & 0xFFFF));
+}
+
+// Set the pixels of a T or H mode block from its palette.
+void
+paletteToPixels(ktx_uint64_t block, const rgba palette[4], bool transparent,
+                colorBlock pixels)
+{
+	ktx_uint32_t indices = pixelIndices(block);
+	for (ktx_uint32_t i = 0; i < 16; i++, indices >>= 2) {
+		ktx_uint32_t index = indices & 3;
+		rgba c = palette[index];
+		if (transparent && index == 2)
+			c.r = c.g = c.b = c.a = 0;
+		pixels[(i & 3) * 4 + (i >> 2)] = c;
+	}
+}
+
+void
+decodeTBlock(ktx_uint64_t block, bool transparent, colorBlock pixels)
+{
+	ktx_uint32_t r1 = (ktx_uint32_t)((block >> 57 & 12) | (block >> 56 & 3));
+	int c2r = extend4(block >> 44 & 15);
+	int c2g = extend4(block >> 40 & 15);
+	int c2b = extend4(block >> 36 & 15);
+	int d = etc2Distances[(block >> 33 & 6) | (block >> 32 & 1)];
+	rgba palette[4];
+	palette[0] = makeRgba(extend4(r1), extend4(block >> 52 & 15),
+	                      extend4(block >> 48 & 15));
+	palette[1] = makeRgba(c2r + d, c2g + d, c2b + d);
+	palette[2] = makeRgba(c2r, c2g, c2b);
+	palette[3] = makeRgba(c2r - d, c2g - d, c2b - d);
+	paletteToPixels(block, palette, transparent, pixels);
+}
+
+void
+decodeHBlock(ktx_uint64_t block, bool transparent, colorBlock pixels)
+{
+	ktx_uint32_t r1 = (ktx_uint32_t)(block >> 59 & 15);
+	ktx_uint32_t g1 = (ktx_uint32_t)((block >> 55 & 14) | (block >> 52 & 1));
+	ktx_uint32_t b1 = (ktx_uint32_t)((block >> 48 & 8) | (block >> 47 & 7));
+	ktx_uint32_t r2 = (ktx_uint32_t)(block >> 43 & 15);
+	ktx_uint32_t g2 = (ktx_uint32_t)(block >> 39 & 15);
+	ktx_uint32_t b2 = (ktx_uint32_t)(block >> 35 & 15);
+	// The lowest bit of the distance index is given by the order of the
+	// two colors.
+	ktx_uint32_t di = (ktx_uint32_t)((block >> 32 & 4) | (block >> 31 & 2));
+	if ((r1 << 8 | g1 << 4 | b1) >= (r2 << 8 | g2 << 4 | b2))
+		di |= 1;
+	int d = etc2Distances[di];
+	rgba palette[4];
+	palette[0] = makeRgba(extend4(r1) + d, extend4(g1) + d, extend4(b1) + d);
+	palette[1] = makeRgba(extend4(r1) - d, extend4(g1) - d, extend4(b1) - d);
+	palette[2] = makeRgba(extend4(r2) + d, extend4(g2) + d, extend4(b2) + d);
+	palette[3] = makeRgba(extend4(r2) - d, extend4(g2) - d, extend4(b2) - d);
+	paletteToPixels(block, palette, transparent, pixels);
+}
+
+// Planar blocks are always opaque.
+void
+decodePlanarBlock(ktx_uint64_t block, colorBlock pixels)
+{
+	int ro = extend6(block >> 57 & 63);
+	int go = extend7((ktx_uint32_t)((block >> 50 & 64) | (block >> 49 & 63)));
+	int bo = extend6((ktx_uint32_t)((block >> 43 & 32) | (block >> 40 & 24)
+	                                | (block >> 39 & 7)));
+	int rh = extend6((ktx_uint32_t)((block >> 33 & 62) | (block >> 32 & 1)));
+	int gh = extend7(block >> 25 & 127);
+	int bh = extend6(block >> 19 & 63);
+	int rv = extend6(block >> 13 & 63);
+	int gv = extend7(block >> 6 & 127);
+	int bv = extend6(block & 63);
+	for (int y = 0; y < 4; y++) {
+		for (int x = 0; x < 4; x++) {
+			pixels[y * 4 + x] = makeRgba(
+				(x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+				(x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+				(x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+		}
+	}
+}
+
+// Decode an ETC1 block or an ETC2 RGB block, possibly with punch-through
+// alpha, into pixels.
+void
+decodeEtc2Block(ktx_uint64_t block, bool punchThrough, colorBlock pixels)
+{
+	// In the punch-through format the differential bit is instead the
+	// opaque bit and only the differential mode, or the ETC2 modes, are
+	// available.
+	bool diff = punchThrough || (block >> 33 & 1);
+	bool transparent = punchThrough && !(block >> 33 & 1);
+	int base[2][3];
+
+	if (diff) {
+		// A base color plus delta outside the 5-bit range selects one of
+		// the ETC2 modes.
+		for (int c = 0; c < 3; c++) {
+			int v = (int)(block >> (59 - 8 * c) & 31);
+			int d = (int)(block >> (56 - 8 * c) & 7);
+			d = (d ^ 4) - 4;    // Sign extend.
+			if (v + d < 0 || v + d > 31) {
+				if (c == 0)
+					decodeTBlock(block, transparent, pixels);
+				else if (c == 1)
+					decodeHBlock(block, transparent, pixels);
+				else
+					decodePlanarBlock(block, pixels);
+				return;
+			}
+			base[0][c] = extend5((ktx_uint32_t)v);
+			base[1][c] = extend5((ktx_uint32_t)(v + d));
+		}
+	} else {
+		for (int c = 0; c < 3; c++) {
+			base[0][c] = extend4(block >> (60 - 8 * c) & 15);
+			base[1][c] = extend4(block >> (56 - 8 * c) & 15);
+		}
+	}
 
-extern void decompressBlockETC2c(uint block_part1, uint block_part2, uint8* img,
-								 int width, int height, int startx, int starty, int channels);
-extern void decompressBlockETC21BitAlphaC(uint block_part1, uint block_part2, uint8* img, uint8* alphaimg,
-										  int width, int height, int startx, int starty, int channels);
-extern void decompressBlockAlphaC(uint8* data, uint8* img,
-								  int width, int height, int startx, int starty, int channels);
-extern void decompressBlockAlpha16bitC(uint8* data, uint8* img,
-									   int width, int height, int startx, int starty, int channels);
+	// Individual or differential mode. Two subblocks, side by side or, if
+	// flipped, one above the other, each with a base color and modifier
+	// table.
+	rgba palettes[2][4];
+	for (int s = 0; s < 2; s++) {
+		const int* m = etc1Modifiers[block >> (37 - 3 * s) & 7];
+		// Index order is +small, +large, -small, -large. Without the opaque
+		// bit the small modifier is 0 and index 2 is transparent.
+		int small = transparent ? 0 : m[0];
+		const int mods[4] = { small, m[1], -small, -m[1] };
+		for (int i = 0; i < 4; i++) {
+			palettes[s][i] = makeRgba(base[s][0] + mods[i],
+			                          base[s][1] + mods[i],
+			                          base[s][2] + mods[i]);
+		}
+		if (transparent) {
+			palettes[s][2].r = palettes[s][2].g = palettes[s][2].b = 0;
+			palettes[s][2].a = 0;
+		}
+	}
+	bool flip = block >> 32 & 1;
+	ktx_uint32_t indices = pixelIndices(block);
+	for (ktx_uint32_t i = 0; i < 16; i++, indices >>= 2) {
+		ktx_uint32_t x = i >> 2, y = i & 3;
+		ktx_uint32_t s = flip ? y >> 1 : x >> 1;
+		pixels[y * 4 + x] = palettes[s][indices & 3];
+	}
+}
 
-extern void setupAlphaTable();
+// Decode the 8-bit alpha of an ETC2 RGBA block into pixels.
+void
+decodeEacAlphaBlock(ktx_uint64_t block, colorBlock pixels)
+{
+	int base = (int)(block >> 56);
+	int mul = (int)(block >> 52 & 15);
+	const int* mods = eacModifiers[block >> 48 & 15];
+	ktx_uint8_t values[8];
+	for (int i = 0; i < 8; i++)
+		values[i] = clamp255(base + mods[i] * mul);
+	for (ktx_uint32_t i = 0; i < 16; i++)
+		pixels[(i & 3) * 4 + (i >> 2)].a = values[block >> (45 - 3 * i) & 7];
+}
+
+// Decode an 11-bit EAC block to 16-bit values, row-major.
+void
+decodeEac11Block(ktx_uint64_t block, bool isSigned, ktx_uint16_t values16[16])
+{
+	int mul = (int)(block >> 52 & 15);
+	const int* mods = eacModifiers[block >> 48 & 15];
+	ktx_uint16_t values[8];
+	for (int i = 0; i < 8; i++) {
+		int mod = mul ? mods[i] * mul * 8 : mods[i];
+		if (isSigned) {
+			int base = (signed char)(block >> 56);
+			if (base == -128)
+				base = -127;
+			int v = base * 8 + mod;
+			v = v < -1023 ? -1023 : (v > 1023 ? 1023 : v);
+			int a = v < 0 ? -v : v;
+			int v16 = (a << 5) + (a >> 5);
+			values[i] = (ktx_uint16_t)(ktx_int16_t)(v < 0 ? -v16 : v16);
+		} else {
+			int base = (int)(block >> 56);
+			int v = base * 8 + 4 + mod;
+			v = v < 0 ? 0 : (v > 2047 ? 2047 : v);
+			values[i] = (ktx_uint16_t)(v << 5 | v >> 6);
+		}
+	}
+	for (ktx_uint32_t i = 0; i < 16; i++)
+		values16[(i & 3) * 4 + (i >> 2)] = values[block >> (45 - 3 * i) & 7];
+}
+
+struct etcImage {
+	etc_format_e format;
+	const ktx_uint8_t* src;
+	ktx_uint32_t width;
+	ktx_uint32_t height;
+	ktx_uint8_t* dst;
+	ktx_size_t dstRowPitch;
+	ktx_uint32_t dstChannels;   // 3 or 4 for color formats. For the 11-bit
+	                            // formats the number of 16-bit channels.
+};
+
+ktx_uint32_t
+etcBlockSize(etc_format_e format)
+{
+	return format == ETC_RGBA8 || format == ETC_RG11
+	       || format == ETC_SIGNED_RG11 ? 16 : 8;
+}
+
+// Decode one row of blocks of the image. Edge blocks are clipped to the
+// image.
+KTX_error_code
+decodeEtcBlockRow(void* userdata, ktx_uint32_t, ktx_uint32_t blockRow)
+{
+	const etcImage& img = *static_cast<const etcImage*>(userdata);
+	ktx_uint32_t blocksX = (img.width + 3) / 4;
+	ktx_uint32_t blockSize = etcBlockSize(img.format);
+	const ktx_uint8_t* src = img.src + (ktx_size_t)blockRow * blocksX
+	                                   * blockSize;
+	ktx_uint32_t rows = img.height - blockRow * 4;
+	if (rows > 4)
+		rows = 4;
+	ktx_uint8_t* dstRows = img.dst + (ktx_size_t)blockRow * 4
+	                                 * img.dstRowPitch;
+
+	for (ktx_uint32_t bx = 0; bx < blocksX; bx++, src += blockSize) {
+		ktx_uint32_t cols = img.width - bx * 4;
+		if (cols > 4)
+			cols = 4;
+		if (img.format <= ETC_RGBA8) {
+			colorBlock pixels;
+			const ktx_uint8_t* color = src;
+			if (img.format == ETC_RGBA8)
+				color += 8;
+			decodeEtc2Block(readBigEndian8(color),
+			                img.format == ETC_RGB8A1, pixels);
+			if (img.format == ETC_RGBA8)
+				decodeEacAlphaBlock(readBigEndian8(src), pixels);
+			ktx_uint32_t nc = img.dstChannels;
+			for (ktx_uint32_t y = 0; y < rows; y++) {
+				ktx_uint8_t* d = dstRows + y * img.dstRowPitch + bx * 4 * nc;
+				if (nc == 4 && cols == 4) {
+					memcpy(d, &pixels[y * 4], 16);
+				} else if (nc == 4) {
+					memcpy(d, &pixels[y * 4], cols * 4);
+				} else {
+					for (ktx_uint32_t x = 0; x < cols; x++, d += nc)
+						memcpy(d, &pixels[y * 4 + x], nc);
+				}
+			}
+		} else {
+			bool isSigned = img.format == ETC_SIGNED_R11
+			                || img.format == ETC_SIGNED_RG11;
+			ktx_uint32_t nc = img.dstChannels;
+			for (ktx_uint32_t c = 0; c < nc; c++) {
+				ktx_uint16_t values[16];
+				decodeEac11Block(readBigEndian8(src + 8 * c), isSigned,
+				                 values);
+				for (ktx_uint32_t y = 0; y < rows; y++) {
+					ktx_uint16_t* d = reinterpret_cast<ktx_uint16_t*>(
+					    dstRows + y * img.dstRowPitch) + bx * 4 * nc + c;
+					for (ktx_uint32_t x = 0; x < cols; x++, d += nc)
+						*d = values[y * 4 + x];
+				}
+			}
+		}
+	}
+	return KTX_SUCCESS;
+}
 
-// This global variable affects the behaviour of decompressBlockAlpha16bitC.
-extern int formatSigned;
+// Decode an image. The destination rows start dstRowPitch bytes apart.
+void
+decodeEtcImage(etcImage& img, ktx_uint32_t threadCount)
+{
+	ktx_uint32_t blockRows = (img.height + 3) / 4;
+	if (threadCount > 1)
+		ktxRunJobs(threadCount, blockRows, decodeEtcBlockRow, &img);
+	else
+		for (ktx_uint32_t row = 0; row < blockRows; row++)
+			decodeEtcBlockRow(&img, 0, row);
+}
 
-static void
-readBigEndian4byteWord(ktx_uint32_t* pBlock, const GLubyte *s)
+// Return true if This has an image at level, layer and faceSlice.
+bool
+validImageIndex(ktxTexture* This, ktx_uint32_t level, ktx_uint32_t layer,
+                ktx_uint32_t faceSlice)
 {
-	*pBlock = (s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3];
+	if (level >= This->numLevels || layer >= This->numLayers)
+		return false;
+	// level is now known to be small enough to shift by.
+	ktx_uint32_t depth = MAX(1, This->baseDepth >> level);
+	return faceSlice < This->numFaces * depth;
 }
 
+// Set the format and channel count of img, and the size of a decoded
+// pixel, for a KTX2 texture's vkFormat. Return false if it is not an ETC2
+// or EAC format.
+bool
+etcFormatFromVkFormat(ktx_uint32_t vkFormat, etcImage& img,
+                      ktx_uint32_t& pixelSize)
+{
+	switch (vkFormat) {
+	  case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	  case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		img.format = ETC_RGB8; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	  case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+		img.format = ETC_RGB8A1; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	  case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		img.format = ETC_RGBA8; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+		img.format = ETC_R11; img.dstChannels = 1; pixelSize = 2;
+		break;
+	  case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		img.format = ETC_SIGNED_R11; img.dstChannels = 1; pixelSize = 2;
+		break;
+	  case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+		img.format = ETC_RG11; img.dstChannels = 2; pixelSize = 4;
+		break;
+	  case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		img.format = ETC_SIGNED_RG11; img.dstChannels = 2; pixelSize = 4;
+		break;
+	  default:
+		return false;
+	}
+	return true;
+}
 
-/* Unpack an ETC1_RGB8_OES format compressed texture */
+// As etcFormatFromVkFormat for a KTX texture's glInternalformat. ETC1 is
+// decoded as ETC2 RGB, of which it is a subset.
+bool
+etcFormatFromGlFormat(ktx_uint32_t glInternalformat, etcImage& img,
+                      ktx_uint32_t& pixelSize)
+{
+	switch (glInternalformat) {
+	  case GL_ETC1_RGB8_OES:
+	  case GL_COMPRESSED_RGB8_ETC2:
+	  case GL_COMPRESSED_SRGB8_ETC2:
+		img.format = ETC_RGB8; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+	  case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		img.format = ETC_RGB8A1; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case GL_COMPRESSED_RGBA8_ETC2_EAC:
+	  case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+		img.format = ETC_RGBA8; img.dstChannels = 4; pixelSize = 4;
+		break;
+	  case GL_COMPRESSED_R11_EAC:
+		img.format = ETC_R11; img.dstChannels = 1; pixelSize = 2;
+		break;
+	  case GL_COMPRESSED_SIGNED_R11_EAC:
+		img.format = ETC_SIGNED_R11; img.dstChannels = 1; pixelSize = 2;
+		break;
+	  case GL_COMPRESSED_RG11_EAC:
+		img.format = ETC_RG11; img.dstChannels = 2; pixelSize = 4;
+		break;
+	  case GL_COMPRESSED_SIGNED_RG11_EAC:
+		img.format = ETC_SIGNED_RG11; img.dstChannels = 2; pixelSize = 4;
+		break;
+	  default:
+		return false;
+	}
+	return true;
+}
+
+// Decode the image at level, layer and faceSlice of This, a KTX or KTX2
+// texture, into pDst. The format of img must have been set.
+KTX_error_code
+decodeTextureImage(ktxTexture* This, etcImage& img, ktx_uint32_t pixelSize,
+                   ktx_uint32_t level, ktx_uint32_t layer,
+                   ktx_uint32_t faceSlice, ktx_uint8_t* pDst,
+                   ktx_size_t dstSize, ktx_uint32_t dstRowPitch,
+                   ktx_uint32_t threadCount)
+{
+	if (!This->pData) {
+		if (ktxTexture_isActiveStream(This)) {
+			// Load pending. Complete it.
+			KTX_error_code result = ktxTexture_LoadImageData(This, NULL, 0);
+			if (result != KTX_SUCCESS)
+				return result;
+		} else {
+			// No data to decode.
+			return KTX_INVALID_OPERATION;
+		}
+	}
+
+	img.width = MAX(1, This->baseWidth >> level);
+	img.height = MAX(1, This->baseHeight >> level);
+	if (dstRowPitch == 0) {
+		dstRowPitch = img.width * pixelSize;
+	} else if (dstRowPitch % pixelSize != 0
+	           || dstRowPitch / pixelSize < img.width) {
+		return KTX_INVALID_VALUE;
+	}
+	if (dstSize < (ktx_size_t)dstRowPitch * img.height)
+		return KTX_INVALID_VALUE;
+
+	ktx_size_t offset;
+	KTX_error_code result = ktxTexture_GetImageOffset(This, level, layer,
+	                                                  faceSlice, &offset);
+	if (result != KTX_SUCCESS)
+		return result;
+	img.src = This->pData + offset;
+	img.dst = pDst;
+	img.dstRowPitch = dstRowPitch;
+	decodeEtcImage(img, threadCount);
+	return KTX_SUCCESS;
+}
+
+} // namespace
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup reader
+ * @~English
+ * @brief Decode a single image of a KTX2 texture in an ETC2 or EAC format
+ *        into a caller-provided buffer.
+ *
+ * Decodes the image at @p level, @p layer and @p faceSlice writing the
+ * result to @p pDst. The texture is not modified. Textures in ETC1 format are
+ * decoded as their vkFormat, @c VK_FORMAT_ETC2_R8G8B8_*, is a superset.
+ *
+ * The decoded format depends on the texture's format:
+ *
+ * | Texture format                       | Decoded format             |
+ * | ------------------------------------ | -------------------------- |
+ * | @c VK_FORMAT_ETC2_R8G8B8*_BLOCK       | R8G8B8A8, alpha is 255     |
+ * | @c VK_FORMAT_ETC2_R8G8B8A1*_BLOCK     | R8G8B8A8                   |
+ * | @c VK_FORMAT_ETC2_R8G8B8A8*_BLOCK     | R8G8B8A8                   |
+ * | @c VK_FORMAT_EAC_R11_UNORM_BLOCK      | R16_UNORM                  |
+ * | @c VK_FORMAT_EAC_R11_SNORM_BLOCK      | R16_SNORM                  |
+ * | @c VK_FORMAT_EAC_R11G11_UNORM_BLOCK   | R16G16_UNORM               |
+ * | @c VK_FORMAT_EAC_R11G11_SNORM_BLOCK   | R16G16_SNORM               |
+ *
+ * 8-bit outputs have the same transfer function as the texture. 16-bit
+ * values are in the native byte order.
+ *
+ * The function keeps no global state so any number of images, of the same
+ * or different textures, can be decoded concurrently. Rows of blocks of the
+ * image are decoded on up to @p threadCount threads.
+ *
+ * Image data is loaded first if it has not already been loaded.
+ *
+ * @param[in]   This         pointer to the ktxTexture2 object of interest.
+ * @param[in]   level        mip level of the image to decode.
+ * @param[in]   layer        array layer of the image to decode.
+ * @param[in]   faceSlice    cube map face or depth slice of the image to
+ *                           decode.
+ * @param[in]   pDst         pointer to the buffer to receive the image.
+ * @param[in]   dstSize      size in bytes of the buffer pointed at by
+ *                           @p pDst.
+ * @param[in]   dstRowPitch  number of bytes between the starts of
+ *                           consecutive rows of pixels. 0 means rows are
+ *                           tightly packed.
+ * @param[in]   threadCount  number of threads to use. 0 is treated as 1.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This or @p pDst is @c NULL.
+ * @exception KTX_INVALID_VALUE @p level, @p layer or @p faceSlice is out of
+ *                              range.
+ * @exception KTX_INVALID_VALUE @p dstRowPitch is less than the size of a row
+ *                              or not a multiple of the size of a pixel.
+ * @exception KTX_INVALID_VALUE @p dstSize is too small.
+ * @exception KTX_INVALID_OPERATION
+ *                              The texture's format is not an ETC2 or EAC
+ *                              format, its data is supercompressed or it
+ *                              has no image data.
+ */
+extern "C" KTX_error_code
+ktxTexture2_DecodeEtcImage(ktxTexture2* This, ktx_uint32_t level,
+                           ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                           ktx_uint8_t* pDst, ktx_size_t dstSize,
+                           ktx_uint32_t dstRowPitch, ktx_uint32_t threadCount)
+{
+	if (!This || !pDst)
+		return KTX_INVALID_VALUE;
+
+	if (!validImageIndex(ktxTexture(This), level, layer, faceSlice))
+		return KTX_INVALID_VALUE;
+
+	etcImage img;
+	ktx_uint32_t pixelSize;
+	if (!etcFormatFromVkFormat(This->vkFormat, img, pixelSize))
+		return KTX_INVALID_OPERATION;
+	if (This->supercompressionScheme != KTX_SS_NONE)
+		return KTX_INVALID_OPERATION;
+
+	return decodeTextureImage(ktxTexture(This), img, pixelSize, level, layer,
+	                          faceSlice, pDst, dstSize, dstRowPitch,
+	                          threadCount);
+}
+
+/**
+ * @memberof ktxTexture
+ * @ingroup reader
+ * @~English
+ * @brief Decode a single image of a KTX or KTX2 texture in an ETC1, ETC2 or
+ *        EAC format into a caller-provided buffer.
+ *
+ * KTX2 textures are decoded by ktxTexture2_DecodeEtcImage(). KTX textures
+ * are decoded in the same way according to their glInternalformat, e.g. for
+ * an OpenGL {,ES} implementation lacking ETC2 support:
+ *
+ * | Texture format                                  | Decoded format      |
+ * | ----------------------------------------------- | ------------------- |
+ * | @c GL_ETC1_RGB8_OES                              | R8G8B8A8, alpha 255 |
+ * | @c GL_COMPRESSED_*RGB8_ETC2                      | R8G8B8A8, alpha 255 |
+ * | @c GL_COMPRESSED_*RGB8_PUNCHTHROUGH_ALPHA1_ETC2  | R8G8B8A8            |
+ * | @c GL_COMPRESSED_RGBA8_ETC2_EAC                  | R8G8B8A8            |
+ * | @c GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC           | R8G8B8A8            |
+ * | @c GL_COMPRESSED_R11_EAC                         | R16_UNORM           |
+ * | @c GL_COMPRESSED_SIGNED_R11_EAC                  | R16_SNORM           |
+ * | @c GL_COMPRESSED_RG11_EAC                        | R16G16_UNORM        |
+ * | @c GL_COMPRESSED_SIGNED_RG11_EAC                 | R16G16_SNORM        |
+ *
+ * The parameters, threading and errors are as for
+ * ktxTexture2_DecodeEtcImage().
+ *
+ * @param[in]   This         pointer to the ktxTexture object of interest.
+ * @param[in]   level        mip level of the image to decode.
+ * @param[in]   layer        array layer of the image to decode.
+ * @param[in]   faceSlice    cube map face or depth slice of the image to
+ *                           decode.
+ * @param[in]   pDst         pointer to the buffer to receive the image.
+ * @param[in]   dstSize      size in bytes of the buffer pointed at by
+ *                           @p pDst.
+ * @param[in]   dstRowPitch  number of bytes between the starts of
+ *                           consecutive rows of pixels. 0 means rows are
+ *                           tightly packed.
+ * @param[in]   threadCount  number of threads to use. 0 is treated as 1.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ */
+extern "C" KTX_error_code
+ktxTexture_DecodeEtcImage(ktxTexture* This, ktx_uint32_t level,
+                          ktx_uint32_t layer, ktx_uint32_t faceSlice,
+                          ktx_uint8_t* pDst, ktx_size_t dstSize,
+                          ktx_uint32_t dstRowPitch, ktx_uint32_t threadCount)
+{
+	if (!This)
+		return KTX_INVALID_VALUE;
+
+	if (This->classId == ktxTexture2_c)
+		return ktxTexture2_DecodeEtcImage((ktxTexture2*)This, level, layer,
+		                                  faceSlice, pDst, dstSize,
+		                                  dstRowPitch, threadCount);
+
+	if (!pDst)
+		return KTX_INVALID_VALUE;
+
+	if (!validImageIndex(This, level, layer, faceSlice))
+		return KTX_INVALID_VALUE;
+
+	etcImage img;
+	ktx_uint32_t pixelSize;
+	if (!etcFormatFromGlFormat(((ktxTexture1*)This)->glInternalformat, img,
+	                           pixelSize))
+		return KTX_INVALID_OPERATION;
+
+	return decodeTextureImage(This, img, pixelSize, level, layer, faceSlice,
+	                          pDst, dstSize, dstRowPitch, threadCount);
+}
+
+#if SUPPORT_SOFTWARE_ETC_UNPACK
+
+/* Unpack an ETC1, ETC2 or EAC format compressed texture */
 extern "C" KTX_error_code
 _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 			  ktx_uint32_t activeWidth, ktx_uint32_t activeHeight,
@@ -59,24 +710,18 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 			  GLenum* format, GLenum* internalFormat, GLenum* type,
 			  GLint R16Formats, GLboolean supportsSRGB)
 {
-	unsigned int width, height;
-	unsigned int block_part1, block_part2;
-	unsigned int x, y;
-	/*const*/ GLubyte* src = (GLubyte*)srcETC;
-	// AF_11BIT is used to compress R11 & RG11 though its not alpha data.
-	enum {AF_NONE, AF_1BIT, AF_8BIT, AF_11BIT} alphaFormat = AF_NONE;
-	int dstChannels, dstChannelBytes;
+	etcImage img;
+	int dstChannelBytes;
 
 	switch (srcFormat) {
 	  case GL_COMPRESSED_SIGNED_R11_EAC:
 		if (R16Formats & _KTX_R16_FORMATS_SNORM) {
 			dstChannelBytes = sizeof(GLshort);
-			dstChannels = 1;
-			formatSigned = GL_TRUE;
+			img.dstChannels = 1;
+			img.format = ETC_SIGNED_R11;
 			*internalFormat = GL_R16_SNORM;
 			*format = GL_RED;
 			*type = GL_SHORT;
-			alphaFormat = AF_11BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
 		break;
@@ -84,12 +729,11 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_COMPRESSED_R11_EAC:
 		if (R16Formats & _KTX_R16_FORMATS_NORM) {
 			dstChannelBytes = sizeof(GLshort);
-			dstChannels = 1;
-			formatSigned = GL_FALSE;
+			img.dstChannels = 1;
+			img.format = ETC_R11;
 			*internalFormat = GL_R16;
 			*format = GL_RED;
 			*type = GL_UNSIGNED_SHORT;
-			alphaFormat = AF_11BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
         break;
@@ -97,12 +741,11 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_COMPRESSED_SIGNED_RG11_EAC:
 		if (R16Formats & _KTX_R16_FORMATS_SNORM) {
 			dstChannelBytes = sizeof(GLshort);
-			dstChannels = 2;
-			formatSigned = GL_TRUE;
+			img.dstChannels = 2;
+			img.format = ETC_SIGNED_RG11;
 			*internalFormat = GL_RG16_SNORM;
 			*format = GL_RG;
 			*type = GL_SHORT;
-			alphaFormat = AF_11BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
         break;
@@ -110,12 +753,11 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_COMPRESSED_RG11_EAC:
 		if (R16Formats & _KTX_R16_FORMATS_NORM) {
 			dstChannelBytes = sizeof(GLshort);
-			dstChannels = 2;
-			formatSigned = GL_FALSE;
+			img.dstChannels = 2;
+			img.format = ETC_RG11;
 			*internalFormat = GL_RG16;
 			*format = GL_RG;
 			*type = GL_UNSIGNED_SHORT;
-			alphaFormat = AF_11BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
         break;
@@ -123,7 +765,8 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_ETC1_RGB8_OES:
 	  case GL_COMPRESSED_RGB8_ETC2:
 	    dstChannelBytes = sizeof(GLubyte);
-		dstChannels = 3;
+		img.dstChannels = 3;
+		img.format = ETC_RGB8;
 		*internalFormat = GL_RGB8;
 		*format = GL_RGB;
 		*type = GL_UNSIGNED_BYTE;
@@ -131,26 +774,27 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 
 	  case GL_COMPRESSED_RGBA8_ETC2_EAC:
 	    dstChannelBytes = sizeof(GLubyte);
-		dstChannels = 4;
+		img.dstChannels = 4;
+		img.format = ETC_RGBA8;
 		*internalFormat = GL_RGBA8;
 		*format = GL_RGBA;
 		*type = GL_UNSIGNED_BYTE;
-	    alphaFormat = AF_8BIT;
 		break;
 
 	  case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
 	    dstChannelBytes = sizeof(GLubyte);
-		dstChannels = 4;
+		img.dstChannels = 4;
+		img.format = ETC_RGB8A1;
 		*internalFormat = GL_RGBA8;
 		*format = GL_RGBA;
 		*type = GL_UNSIGNED_BYTE;
-		alphaFormat = AF_1BIT;
         break;
 
 	  case GL_COMPRESSED_SRGB8_ETC2:
 		if (supportsSRGB) {
 			dstChannelBytes = sizeof(GLubyte);
-			dstChannels = 3;
+			img.dstChannels = 3;
+			img.format = ETC_RGB8;
 			*internalFormat = GL_SRGB8;
 			*format = GL_RGB;
 			*type = GL_UNSIGNED_BYTE;
@@ -161,11 +805,11 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
 		if (supportsSRGB) {
 			dstChannelBytes = sizeof(GLubyte);
-			dstChannels = 4;
+			img.dstChannels = 4;
+			img.format = ETC_RGBA8;
 			*internalFormat = GL_SRGB8_ALPHA8;
  			*format = GL_RGBA;
 			*type = GL_UNSIGNED_BYTE;
-			alphaFormat = AF_8BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
 		break;
@@ -173,11 +817,11 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
 	  case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
 		if (supportsSRGB) {
 			dstChannelBytes = sizeof(GLubyte);
-			dstChannels = 4;
+			img.dstChannels = 4;
+			img.format = ETC_RGB8A1;
 			*internalFormat = GL_SRGB8_ALPHA8;
  			*format = GL_RGBA;
 			*type = GL_UNSIGNED_BYTE;
-			alphaFormat = AF_1BIT;
 		} else
 			return KTX_UNSUPPORTED_TEXTURE_TYPE; 
         break;
@@ -187,89 +831,20 @@ _ktxUnpackETC(const GLubyte* srcETC, const GLenum srcFormat,
         return KTX_UNSUPPORTED_TEXTURE_TYPE; // For Release configurations.
 	}
 
-    /* active_{width,height} show how many pixels contain active data,
-	 * (the rest are just for making sure we have a 2*a x 4*b size).
+	/* Decode straight into an image of the active size. Blocks extending
+	 * beyond it are clipped.
 	 */
-
-	/* Compute the full width & height. */
-	width = ((activeWidth+3)/4)*4;
-	height = ((activeHeight+3)/4)*4;
-
-	/* printf("Width = %d, Height = %d\n", width, height); */
-	/* printf("active pixel area: top left %d x %d area.\n", activeWidth, activeHeight); */
-
-	*dstImage = (GLubyte*)malloc(dstChannels*dstChannelBytes*width*height);
+	img.dstRowPitch = (ktx_size_t)activeWidth * img.dstChannels
+	                  * dstChannelBytes;
+	*dstImage = (GLubyte*)malloc(img.dstRowPitch * activeHeight);
 	if (!*dstImage) {
 		return KTX_OUT_OF_MEMORY;
 	}
-	
-	if (alphaFormat != AF_NONE)
-		setupAlphaTable();
-
-	// NOTE: none of the decompress functions actually use the <height> parameter
-	if (alphaFormat == AF_11BIT) {
-		// One or two 11-bit alpha channels for R or RG.
-		for (y=0; y < height/4; y++) {
-			for (x=0; x < width/4; x++) {
-				decompressBlockAlpha16bitC(src, *dstImage, width, height, 4*x, 4*y, dstChannels);
-				src += 8;
-				if (srcFormat == GL_COMPRESSED_RG11_EAC || srcFormat == GL_COMPRESSED_SIGNED_RG11_EAC) {
-					decompressBlockAlpha16bitC(src, *dstImage + dstChannelBytes, width, height, 4*x, 4*y, dstChannels);
-					src += 8;
-				}
-			}
-		}
-	} else {
-		for (y=0; y < height/4; y++) {
-			for (x=0; x < width/4; x++) {
-				// Decode alpha channel for RGBA
-				if (alphaFormat == AF_8BIT) {
-					decompressBlockAlphaC(src, *dstImage + 3, width, height, 4*x, 4*y, dstChannels);
-					src += 8;
-				}
-				// Decode color dstChannels
-				readBigEndian4byteWord(&block_part1, src);
-				src += 4;
-				readBigEndian4byteWord(&block_part2, src);
-				src += 4;
-				if (alphaFormat == AF_1BIT)
-				    decompressBlockETC21BitAlphaC(block_part1, block_part2, *dstImage, 0, width, height, 4*x, 4*y, dstChannels);
-				else
-				    decompressBlockETC2c(block_part1, block_part2, *dstImage, width, height, 4*x, 4*y, dstChannels);
-			}
-		}
-	}
-
-	/* Ok, now write out the active pixels to the destination image.
-	 * (But only if the active pixels differ from the total pixels)
-	 */
-
-	if( !(height == activeHeight && width == activeWidth) ) {
-		int dstPixelBytes = dstChannels * dstChannelBytes;
-		int dstRowBytes = dstPixelBytes * width;
-		int activeRowBytes = activeWidth * dstPixelBytes;
-		GLubyte *newimg = (GLubyte*)malloc(dstPixelBytes * activeWidth * activeHeight);
-		unsigned int xx, yy;
-		int zz;
-
-		if (!newimg) {
-			free(*dstImage);
-			return KTX_OUT_OF_MEMORY;
-		}
-		
-		/* Convert from total area to active area: */
-
-		for (yy = 0; yy < activeHeight; yy++) {
-			for (xx = 0; xx < activeWidth; xx++) {
-				for (zz = 0; zz < dstPixelBytes; zz++) {
-					newimg[ yy*activeRowBytes + xx*dstPixelBytes + zz ] = (*dstImage)[ yy*dstRowBytes + xx*dstPixelBytes + zz];
-				}
-			}
-		}
-
-		free(*dstImage);
-		*dstImage = newimg;
-	}
+	img.src = srcETC;
+	img.width = activeWidth;
+	img.height = activeHeight;
+	img.dst = *dstImage;
+	decodeEtcImage(img, 1);
 
 	return KTX_SUCCESS;
 }
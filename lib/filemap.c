@@ -0,0 +1,141 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file
+ * @~English
+ *
+ * @brief Map a whole file into memory.
+ *
+ * Used to implement KTX_TEXTURE_CREATE_MMAP_BIT. The mapping is private and
+ * copy-on-write so applications may modify the image data of a texture
+ * whose data points into the mapping without affecting the file.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+  #define KTX_HAVE_MMAP 1
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "ktx.h"
+#include "filemap.h"
+
+/**
+ * @internal
+ * @~English
+ * @brief Map the named file into memory.
+ *
+ * @param [out] map     pointer to the ktxFileMap to initialize.
+ * @param [in] filename pointer to a char array containing the file name.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p map or @p filename is @c NULL.
+ * @exception KTX_FILE_OPEN_FAILED The file could not be opened.
+ * @exception KTX_UNSUPPORTED_FEATURE
+ *                              The file is empty, is not a regular file or
+ *                              could not be mapped, or mapping is not
+ *                              supported on this platform. Callers should
+ *                              fall back to reading the file.
+ */
+KTX_error_code
+ktxFileMap_open(ktxFileMap* map, const char* const filename)
+{
+    if (!map || !filename)
+        return KTX_INVALID_VALUE;
+
+    map->bytes = NULL;
+    map->size = 0;
+
+#if defined(_WIN32)
+    HANDLE file, mapping;
+    LARGE_INTEGER fileSize;
+    void* view;
+
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return KTX_FILE_OPEN_FAILED;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0
+        || (ULONGLONG)fileSize.QuadPart > (SIZE_T)-1) {
+        CloseHandle(file);
+        return KTX_UNSUPPORTED_FEATURE;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return KTX_UNSUPPORTED_FEATURE;
+    view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    // The view keeps the mapping object alive.
+    CloseHandle(mapping);
+    if (view == NULL)
+        return KTX_UNSUPPORTED_FEATURE;
+    map->bytes = (ktx_uint8_t*)view;
+    map->size = (ktx_size_t)fileSize.QuadPart;
+    return KTX_SUCCESS;
+#elif KTX_HAVE_MMAP
+    struct stat st;
+    void* view;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return KTX_FILE_OPEN_FAILED;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        // Not something mmap can handle, e.g. a pipe, or an empty file.
+        close(fd);
+        return KTX_UNSUPPORTED_FEATURE;
+    }
+    view = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, 0);
+    // The mapping keeps a reference to the file.
+    close(fd);
+    if (view == MAP_FAILED)
+        return KTX_UNSUPPORTED_FEATURE;
+    map->bytes = (ktx_uint8_t*)view;
+    map->size = (ktx_size_t)st.st_size;
+    return KTX_SUCCESS;
+#else
+    return KTX_UNSUPPORTED_FEATURE;
+#endif
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Unmap a file previously mapped with ktxFileMap_open().
+ *
+ * Does nothing if @p map is not mapped.
+ *
+ * @param [in] map      pointer to the ktxFileMap to close.
+ */
+void
+ktxFileMap_close(ktxFileMap* map)
+{
+    assert(map != NULL);
+
+    if (map->bytes == NULL)
+        return;
+#if defined(_WIN32)
+    UnmapViewOfFile(map->bytes);
+#elif KTX_HAVE_MMAP
+    munmap(map->bytes, map->size);
+#endif
+    map->bytes = NULL;
+    map->size = 0;
+}
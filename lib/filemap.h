@@ -0,0 +1,41 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include "ktx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A read-only, copy-on-write view of an entire file.
+ */
+typedef struct ktxFileMap {
+    ktx_uint8_t* bytes;     /*!< start of the mapping or NULL if none. */
+    ktx_size_t size;        /*!< size of the mapped file. */
+} ktxFileMap;
+
+KTX_error_code ktxFileMap_open(ktxFileMap* map, const char* const filename);
+
+void ktxFileMap_close(ktxFileMap* map);
+
+/*
+ * True if @p ptr points into the mapping described by @p map.
+ */
+#define ktxFileMap_contains(map, ptr)                                   \
+    ((map)->bytes != NULL && (const ktx_uint8_t*)(ptr) >= (map)->bytes  \
+     && (const ktx_uint8_t*)(ptr) < (map)->bytes + (map)->size)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILEMAP_H */
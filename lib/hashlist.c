@@ -508,6 +508,8 @@ ktxHashList_Sort(ktxHashList* pHead)
  *
  * @exception KTX_INVALID_OPERATION if @p pHead does not point to an empty list.
  * @exception KTX_INVALID_VALUE if @p pKvd or @p pHt is NULL or kvdLen == 0.
+ * @exception KTX_FILE_DATA_ERROR a key-value length runs past the end of the
+ *                              data or a key is not NUL terminated.
  * @exception KTX_OUT_OF_MEMORY there was not enough memory to create the hash
  *                              table.
  */
@@ -515,24 +517,34 @@ KTX_error_code
 ktxHashList_Deserialize(ktxHashList* pHead, unsigned int kvdLen, void* pKvd)
 {
     char* src = pKvd;
+    char* end;
     KTX_error_code result;
 
     if (kvdLen == 0 || pKvd == NULL || pHead == NULL)
         return KTX_INVALID_VALUE;
+    end = src + kvdLen;
 
     if (*pHead != NULL)
         return KTX_INVALID_OPERATION;
 
     result = KTX_SUCCESS;
-    while (result == KTX_SUCCESS && src < (char *)pKvd + kvdLen) {
+    while (result == KTX_SUCCESS && src < end) {
         char* key;
         unsigned int keyLen, valueLen;
         void* value;
-        ktx_uint32_t keyAndValueByteSize = *((ktx_uint32_t*)src);
+        ktx_uint32_t keyAndValueByteSize;
 
+        if ((size_t)(end - src) < sizeof(keyAndValueByteSize))
+            return KTX_FILE_DATA_ERROR;
+        memcpy(&keyAndValueByteSize, src, sizeof(keyAndValueByteSize));
         src += sizeof(keyAndValueByteSize);
+        if (keyAndValueByteSize > (size_t)(end - src))
+            return KTX_FILE_DATA_ERROR;
         key = src;
-        keyLen = (unsigned int)strlen(key) + 1;
+        value = memchr(key, '\0', keyAndValueByteSize);
+        if (value == NULL)
+            return KTX_FILE_DATA_ERROR;   // Key not NUL terminated.
+        keyLen = (unsigned int)((char*)value - key) + 1;
         value = key + keyLen;
 
         valueLen = keyAndValueByteSize - keyLen;
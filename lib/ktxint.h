@@ -187,6 +187,17 @@ KTX_error_code ktxCheckHeader1_(KTX_header* pHeader,
 KTX_error_code ktxCheckHeader2_(KTX_header2* pHeader,
                                 KTX_supplemental_info* pSuppInfo);
 
+/*
+ * @internal
+ * ValidateMemory
+ *
+ * As ktxValidateMemory but transcodes on @p pool, which may be NULL.
+ */
+KTX_error_code ktxValidateMemory_(const ktx_uint8_t* bytes, ktx_size_t size,
+                                  ktxValidateFlags flags,
+                                  PFNKTXVALIDATECALLBACK callback,
+                                  void* userdata, ktxThreadPool* pool);
+
 /*
  * SwapEndian16: Swaps endianness in an array of 16-bit values
  */
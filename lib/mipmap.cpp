@@ -0,0 +1,487 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file mipmap.cpp
+ * @~English
+ *
+ * @brief Function for generating the mip levels of an uncompressed texture.
+ *
+ * The base level is converted once to linear float. Each smaller level is
+ * made by separable 1D resampling passes along x, then y, then z, with the
+ * lines of each pass split into jobs run by ktxRunJobs(). The results are
+ * converted back to the texture's format and stored in the level's images.
+ */
+
+#include <cmath>
+#include <new>
+#include <vector>
+
+#include "ktx.h"
+#include "ktxint.h"
+#include "texture2.h"
+#include "threadpool.h"
+#include "vkformat_enum.h"
+
+namespace {
+
+struct MipFormat {
+    ktx_uint32_t components;
+    ktx_uint32_t componentSize;   // In bytes.
+    bool isFloat;
+    bool srgb;
+};
+
+bool
+getMipFormat(ktx_uint32_t vkFormat, MipFormat& fmt)
+{
+    switch (vkFormat) {
+      case VK_FORMAT_R8_UNORM:            fmt = {1, 1, false, false}; break;
+      case VK_FORMAT_R8_SRGB:             fmt = {1, 1, false, true}; break;
+      case VK_FORMAT_R8G8_UNORM:          fmt = {2, 1, false, false}; break;
+      case VK_FORMAT_R8G8_SRGB:           fmt = {2, 1, false, true}; break;
+      case VK_FORMAT_R8G8B8_UNORM:
+      case VK_FORMAT_B8G8R8_UNORM:        fmt = {3, 1, false, false}; break;
+      case VK_FORMAT_R8G8B8_SRGB:
+      case VK_FORMAT_B8G8R8_SRGB:         fmt = {3, 1, false, true}; break;
+      case VK_FORMAT_R8G8B8A8_UNORM:
+      case VK_FORMAT_B8G8R8A8_UNORM:      fmt = {4, 1, false, false}; break;
+      case VK_FORMAT_R8G8B8A8_SRGB:
+      case VK_FORMAT_B8G8R8A8_SRGB:       fmt = {4, 1, false, true}; break;
+      case VK_FORMAT_R16_UNORM:           fmt = {1, 2, false, false}; break;
+      case VK_FORMAT_R16G16_UNORM:        fmt = {2, 2, false, false}; break;
+      case VK_FORMAT_R16G16B16_UNORM:     fmt = {3, 2, false, false}; break;
+      case VK_FORMAT_R16G16B16A16_UNORM:  fmt = {4, 2, false, false}; break;
+      case VK_FORMAT_R32_SFLOAT:          fmt = {1, 4, true, false}; break;
+      case VK_FORMAT_R32G32_SFLOAT:       fmt = {2, 4, true, false}; break;
+      case VK_FORMAT_R32G32B32_SFLOAT:    fmt = {3, 4, true, false}; break;
+      case VK_FORMAT_R32G32B32A32_SFLOAT: fmt = {4, 4, true, false}; break;
+      default:
+        return false;
+    }
+    return true;
+}
+
+// Filter kernels, in units of destination texels.
+
+float
+boxFilter(float x)
+{
+    return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+}
+
+float
+tentFilter(float x)
+{
+    x = std::fabs(x);
+    return x < 1.0f ? 1.0f - x : 0.0f;
+}
+
+float
+mitchellFilter(float x)
+{
+    // Mitchell-Netravali with B = C = 1/3.
+    const float B = 1.0f / 3.0f, C = 1.0f / 3.0f;
+    x = std::fabs(x);
+    float x2 = x * x, x3 = x2 * x;
+    if (x < 1.0f)
+        return ((12 - 9 * B - 6 * C) * x3 + (-18 + 12 * B + 6 * C) * x2
+                + (6 - 2 * B)) / 6.0f;
+    if (x < 2.0f)
+        return ((-B - 6 * C) * x3 + (6 * B + 30 * C) * x2
+                + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0f;
+    return 0.0f;
+}
+
+float
+sinc(float x)
+{
+    if (x == 0.0f)
+        return 1.0f;
+    x *= 3.14159265358979323846f;
+    return std::sin(x) / x;
+}
+
+float
+lanczos3Filter(float x)
+{
+    return std::fabs(x) < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+}
+
+float
+lanczos4Filter(float x)
+{
+    return std::fabs(x) < 4.0f ? sinc(x) * sinc(x / 4.0f) : 0.0f;
+}
+
+struct FilterDesc {
+    float (*func)(float);
+    float support;
+};
+
+const FilterDesc filters[] = {
+    { boxFilter, 0.5f },        // KTX_MIPMAP_FILTER_BOX
+    { tentFilter, 1.0f },       // KTX_MIPMAP_FILTER_TENT
+    { mitchellFilter, 2.0f },   // KTX_MIPMAP_FILTER_MITCHELL
+    { lanczos3Filter, 3.0f },   // KTX_MIPMAP_FILTER_LANCZOS3
+    { lanczos4Filter, 4.0f },   // KTX_MIPMAP_FILTER_LANCZOS4
+};
+
+// The source samples, and their weights, contributing to each destination
+// sample of one axis. Indices have the boundary mode already applied.
+struct AxisContribs {
+    std::vector<ktx_uint32_t> first;    // dstSize + 1 entries.
+    std::vector<ktx_uint32_t> index;
+    std::vector<float> weight;
+};
+
+void
+makeContribs(ktx_uint32_t srcSize, ktx_uint32_t dstSize,
+             const FilterDesc& filter, bool wrap, AxisContribs& axis)
+{
+    float scale = (float)dstSize / srcSize;
+    // Widen the filter when minifying so it covers all source samples.
+    float filterScale = scale < 1.0f ? scale : 1.0f;
+    float halfWidth = filter.support / filterScale;
+    int n = (int)srcSize;
+
+    axis.first.resize(dstSize + 1);
+    axis.index.clear();
+    axis.weight.clear();
+    for (ktx_uint32_t i = 0; i < dstSize; i++) {
+        float center = (i + 0.5f) / scale - 0.5f;
+        int lo = (int)std::floor(center - halfWidth);
+        int hi = (int)std::ceil(center + halfWidth);
+        ktx_uint32_t start = (ktx_uint32_t)axis.index.size();
+        float total = 0.0f;
+
+        axis.first[i] = start;
+        for (int j = lo; j <= hi; j++) {
+            float w = filter.func((j - center) * filterScale);
+            if (w == 0.0f)
+                continue;
+            int s;
+            if (wrap)
+                s = ((j % n) + n) % n;
+            else
+                s = j < 0 ? 0 : (j >= n ? n - 1 : j);
+            axis.index.push_back((ktx_uint32_t)s);
+            axis.weight.push_back(w);
+            total += w;
+        }
+        if (total != 0.0f) {
+            for (size_t k = start; k < axis.weight.size(); k++)
+                axis.weight[k] /= total;
+        }
+    }
+    axis.first[dstSize] = (ktx_uint32_t)axis.index.size();
+}
+
+// One resampling pass. The buffers are viewed as [outer][size][inner]
+// where size is the length of the axis being resampled and inner covers
+// all the components of all the samples of the faster varying axes.
+struct ResamplePass {
+    const float* src;
+    float* dst;
+    const AxisContribs* axis;
+    ktx_uint32_t srcSize;
+    ktx_uint32_t dstSize;
+    size_t inner;
+    size_t rowCount;        // outer * dstSize
+    ktx_uint32_t jobCount;
+};
+
+KTX_error_code
+resampleJob(void* userdata, ktx_uint32_t, ktx_uint32_t job)
+{
+    const ResamplePass& p = *static_cast<const ResamplePass*>(userdata);
+    size_t begin = p.rowCount * job / p.jobCount;
+    size_t end = p.rowCount * (job + 1) / p.jobCount;
+
+    for (size_t row = begin; row < end; row++) {
+        size_t outer = row / p.dstSize;
+        ktx_uint32_t i = (ktx_uint32_t)(row % p.dstSize);
+        float* out = p.dst + row * p.inner;
+        const float* srcBase = p.src + outer * p.srcSize * p.inner;
+
+        for (size_t k = 0; k < p.inner; k++)
+            out[k] = 0.0f;
+        for (ktx_uint32_t c = p.axis->first[i]; c < p.axis->first[i + 1]; c++) {
+            const float* in = srcBase + p.axis->index[c] * p.inner;
+            float w = p.axis->weight[c];
+            for (size_t k = 0; k < p.inner; k++)
+                out[k] += w * in[k];
+        }
+    }
+    return KTX_SUCCESS;
+}
+
+float
+srgbDecode(float v)
+{
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+float
+srgbEncode(float v)
+{
+    return v <= 0.0031308f ? v * 12.92f
+                           : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// Conversion of the images of one level between the texture's format and
+// the [image][z][y][x][component] float layout.
+struct LevelConvert {
+    ktxTexture2* texture;
+    const MipFormat* format;
+    ktx_uint32_t level;
+    ktx_uint32_t width, height, depth;
+    bool decodeSrgb;
+    const float* srgbTable;     // 8-bit sRGB to linear.
+    float* floats;
+};
+
+// Each job converts one z slice of one face or layer.
+void
+sliceLocation(const LevelConvert& lc, ktx_uint32_t job,
+              ktx_uint8_t*& pixels, float*& floats)
+{
+    ktxTexture2* This = lc.texture;
+    ktx_uint32_t image = job / lc.depth;
+    ktx_uint32_t z = job % lc.depth;
+    ktx_uint32_t layer = image / This->numFaces;
+    ktx_uint32_t faceSlice = This->numFaces > 1 ? image % This->numFaces : z;
+    ktx_size_t offset;
+
+    ktxTexture2_GetImageOffset(This, lc.level, layer, faceSlice, &offset);
+    pixels = This->pData + offset;
+    floats = lc.floats + (size_t)job * lc.width * lc.height
+                         * lc.format->components;
+}
+
+KTX_error_code
+decodeJob(void* userdata, ktx_uint32_t, ktx_uint32_t job)
+{
+    const LevelConvert& lc = *static_cast<const LevelConvert*>(userdata);
+    const MipFormat& fmt = *lc.format;
+    ktx_uint8_t* pixels;
+    float* out;
+    size_t count = (size_t)lc.width * lc.height * fmt.components;
+
+    sliceLocation(lc, job, pixels, out);
+    for (size_t i = 0; i < count; i++) {
+        ktx_uint32_t c = (ktx_uint32_t)(i % fmt.components);
+        if (fmt.isFloat) {
+            out[i] = reinterpret_cast<const float*>(pixels)[i];
+        } else if (fmt.componentSize == 2) {
+            out[i] = reinterpret_cast<const ktx_uint16_t*>(pixels)[i]
+                     / 65535.0f;
+        } else if (lc.decodeSrgb && c < 3) {
+            out[i] = lc.srgbTable[pixels[i]];
+        } else {
+            out[i] = pixels[i] / 255.0f;
+        }
+    }
+    return KTX_SUCCESS;
+}
+
+KTX_error_code
+encodeJob(void* userdata, ktx_uint32_t, ktx_uint32_t job)
+{
+    const LevelConvert& lc = *static_cast<const LevelConvert*>(userdata);
+    const MipFormat& fmt = *lc.format;
+    ktx_uint8_t* pixels;
+    float* in;
+    size_t count = (size_t)lc.width * lc.height * fmt.components;
+
+    sliceLocation(lc, job, pixels, in);
+    for (size_t i = 0; i < count; i++) {
+        float v = in[i];
+        if (fmt.isFloat) {
+            reinterpret_cast<float*>(pixels)[i] = v;
+            continue;
+        }
+        v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+        if (fmt.componentSize == 2) {
+            reinterpret_cast<ktx_uint16_t*>(pixels)[i]
+                = (ktx_uint16_t)(v * 65535.0f + 0.5f);
+        } else {
+            if (lc.decodeSrgb && i % fmt.components < 3)
+                v = srgbEncode(v);
+            pixels[i] = (ktx_uint8_t)(v * 255.0f + 0.5f);
+        }
+    }
+    return KTX_SUCCESS;
+}
+
+// Resample one axis of @p src into @p dst. Returns src if the axis does not
+// change size.
+const float*
+resampleAxis(const float* src, std::vector<float>& dst,
+             ktx_uint32_t srcSize, ktx_uint32_t dstSize,
+             size_t outer, size_t inner,
+             const FilterDesc& filter, bool wrap, ktx_uint32_t threadCount)
+{
+    if (srcSize == dstSize)
+        return src;
+
+    AxisContribs axis;
+    makeContribs(srcSize, dstSize, filter, wrap, axis);
+    dst.resize(outer * dstSize * inner);
+
+    ResamplePass pass;
+    pass.src = src;
+    pass.dst = dst.data();
+    pass.axis = &axis;
+    pass.srcSize = srcSize;
+    pass.dstSize = dstSize;
+    pass.inner = inner;
+    pass.rowCount = outer * dstSize;
+    // Several jobs per thread to even out the load while keeping each job
+    // large enough to be worth handing out.
+    size_t jobs = (size_t)ktxJobWorkerCount(threadCount, ~0U) * 4;
+    if (jobs > pass.rowCount)
+        jobs = pass.rowCount;
+    pass.jobCount = (ktx_uint32_t)jobs;
+    ktxRunJobs(threadCount, pass.jobCount, resampleJob, &pass);
+    return dst.data();
+}
+
+} // namespace
+
+/**
+ * @memberof ktxTexture2
+ * @ingroup writer
+ * @~English
+ * @brief Generate the mip levels of a texture from its base level.
+ *
+ * Levels 1 and up are overwritten with images resampled from level 0 using
+ * @p filter. Faces, array layers and, for 3D textures, depth are handled so
+ * each image of a level is made from the corresponding images of the base
+ * level. By default each level is resampled directly from the base level;
+ * with @c KTX_MIPMAP_CASCADE_BIT each level is resampled from the previous
+ * one which is faster for large filters but less accurate.
+ *
+ * The color components of textures with an sRGB format are converted to
+ * linear before filtering and back to sRGB afterwards, unless
+ * @c KTX_MIPMAP_LINEAR_BIT is set. Alpha is always filtered linearly.
+ *
+ * The texture must have been created with the desired number of levels.
+ * Supported formats are the 8-bit UNORM and SRGB formats with R, RG, RGB,
+ * BGR, RGBA or BGRA components, the 16-bit UNORM formats and the 32-bit
+ * SFLOAT formats with R, RG, RGB or RGBA components.
+ *
+ * @param[in]   This        pointer to the ktxTexture2 object of interest.
+ * @param[in]   filter      the filter used to resample the images.
+ * @param[in]   flags       bitwise OR of @c ktx_mipmap_flag_bits_e values.
+ * @param[in]   threadCount the maximum number of threads to use. 0 is
+ *                          treated as 1.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE     @p This is @c NULL or @p filter is not a
+ *                                  valid @c ktx_mipmap_filter_e value.
+ * @exception KTX_INVALID_OPERATION The texture's images are supercompressed
+ *                                  or block compressed.
+ * @exception KTX_INVALID_OPERATION The texture's format is not supported.
+ * @exception KTX_INVALID_OPERATION The texture has only 1 level.
+ * @exception KTX_OUT_OF_MEMORY     Not enough memory to carry out the
+ *                                  operation.
+ */
+extern "C" KTX_error_code
+ktxTexture2_GenerateMipmaps(ktxTexture2* This, ktx_mipmap_filter_e filter,
+                            ktx_mipmap_flags flags, ktx_uint32_t threadCount)
+{
+    if (This == NULL)
+        return KTX_INVALID_VALUE;
+    if ((ktx_uint32_t)filter >= sizeof(filters) / sizeof(filters[0]))
+        return KTX_INVALID_VALUE;
+    if (This->supercompressionScheme != KTX_SS_NONE
+        || This->isCompressed)
+        return KTX_INVALID_OPERATION;
+    if (This->numLevels < 2)
+        return KTX_INVALID_OPERATION;
+
+    MipFormat fmt;
+    if (!getMipFormat(This->vkFormat, fmt))
+        return KTX_INVALID_OPERATION;
+
+    if (This->pData == NULL) {
+        KTX_error_code result = ktxTexture2_LoadImageData(This, NULL, 0);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+
+    const FilterDesc& filterDesc = filters[filter];
+    bool wrap = (flags & KTX_MIPMAP_WRAP_BIT) != 0;
+    bool cascade = (flags & KTX_MIPMAP_CASCADE_BIT) != 0;
+    ktx_uint32_t numImages = This->numLayers * This->numFaces;
+    ktx_uint32_t comps = fmt.components;
+
+    float srgbTable[256];
+    for (int i = 0; i < 256; i++)
+        srgbTable[i] = srgbDecode(i / 255.0f);
+
+    LevelConvert lc;
+    lc.texture = This;
+    lc.format = &fmt;
+    lc.decodeSrgb = fmt.srgb && !(flags & KTX_MIPMAP_LINEAR_BIT);
+    lc.srgbTable = srgbTable;
+
+    try {
+        std::vector<float> base, prev, tmpX, tmpY, tmpZ;
+        ktx_uint32_t baseWidth = This->baseWidth;
+        ktx_uint32_t baseHeight = This->baseHeight;
+        ktx_uint32_t baseDepth = This->baseDepth;
+
+        base.resize((size_t)numImages * baseDepth * baseHeight
+                    * baseWidth * comps);
+        lc.level = 0;
+        lc.width = baseWidth;
+        lc.height = baseHeight;
+        lc.depth = baseDepth;
+        lc.floats = base.data();
+        ktxRunJobs(threadCount, numImages * baseDepth, decodeJob, &lc);
+
+        const float* src = base.data();
+        ktx_uint32_t sw = baseWidth, sh = baseHeight, sd = baseDepth;
+        for (ktx_uint32_t level = 1; level < This->numLevels; level++) {
+            ktx_uint32_t dw = MAX(1, baseWidth >> level);
+            ktx_uint32_t dh = MAX(1, baseHeight >> level);
+            ktx_uint32_t dd = MAX(1, baseDepth >> level);
+            const float* out;
+
+            out = resampleAxis(src, tmpX, sw, dw,
+                               (size_t)numImages * sd * sh, comps,
+                               filterDesc, wrap, threadCount);
+            out = resampleAxis(out, tmpY, sh, dh,
+                               (size_t)numImages * sd, (size_t)dw * comps,
+                               filterDesc, wrap, threadCount);
+            out = resampleAxis(out, tmpZ, sd, dd,
+                               numImages, (size_t)dh * dw * comps,
+                               filterDesc, wrap, threadCount);
+
+            lc.level = level;
+            lc.width = dw;
+            lc.height = dh;
+            lc.depth = dd;
+            lc.floats = const_cast<float*>(out);
+            ktxRunJobs(threadCount, numImages * dd, encodeJob, &lc);
+
+            if (cascade) {
+                prev.assign(out, out + (size_t)numImages * dd * dh * dw * comps);
+                src = prev.data();
+                sw = dw; sh = dh; sd = dd;
+            }
+        }
+    } catch (const std::bad_alloc&) {
+        return KTX_OUT_OF_MEMORY;
+    }
+    return KTX_SUCCESS;
+}
@@ -205,6 +205,8 @@ ktxTexture_constructFromStream(ktxTexture* This, ktxStream* pStream,
     stream = ktxTexture_getStream(This);
     // Copy stream info into struct for later use.
     *stream = *pStream;
+    This->_protected->_fileMap.bytes = NULL;
+    This->_protected->_fileMap.size = 0;
 
     This->orientation.x = KTX_ORIENT_X_RIGHT;
     This->orientation.y = KTX_ORIENT_Y_DOWN;
@@ -233,11 +235,51 @@ ktxTexture_destruct(ktxTexture* This)
         ktxHashList_Destruct(&This->kvDataHead);
     if (This->kvData != NULL)
         free(This->kvData);
-    if (This->pData != NULL)
+    if (This->pData != NULL && !ktxTexture_isDataMapped(This))
         free(This->pData);
+    ktxFileMap_close(&This->_protected->_fileMap);
     free(This->_protected);
 }
 
+/**
+ * @memberof ktxTexture @private
+ * @~English
+ * @brief Release the image data of a texture.
+ *
+ * Use this instead of free() when replacing a texture's image data as
+ * @c pData may point into a file mapping rather than to allocated memory.
+ * The mapping is closed if no longer needed to read the source.
+ *
+ * @param[in] This pointer to the ktxTexture whose image data is to be
+ *                 released.
+ */
+void
+ktxTexture_freeData(ktxTexture* This)
+{
+    if (This->pData != NULL && !ktxTexture_isDataMapped(This))
+        free(This->pData);
+    This->pData = NULL;
+    if (!ktxTexture_isActiveStream(This))
+        ktxFileMap_close(&This->_protected->_fileMap);
+}
+
+/**
+ * @memberof ktxTexture @private
+ * @~English
+ * @brief Query if a texture's image data points into a file mapping.
+ *
+ * @param[in] This pointer to the ktxTexture of interest.
+ *
+ * @return KTX_TRUE if @c pData points into the mapping of the source file,
+ *         KTX_FALSE otherwise.
+ */
+ktx_bool_t
+ktxTexture_isDataMapped(ktxTexture* This)
+{
+    return ktxFileMap_contains(&This->_protected->_fileMap, This->pData)
+           ? KTX_TRUE : KTX_FALSE;
+}
+
 
 /**
  * @defgroup reader Reader
@@ -421,6 +463,45 @@ ktxTexture_CreateFromNamedFile(const char* const filename,
     if (filename == NULL || newTex == NULL)
         return KTX_INVALID_VALUE;
 
+    if (createFlags & KTX_TEXTURE_CREATE_MMAP_BIT) {
+        ktxFileMap map;
+
+        result = ktxFileMap_open(&map, filename);
+        if (result == KTX_FILE_OPEN_FAILED)
+            return result;
+        if (result == KTX_SUCCESS) {
+            ktxTexture* tex;
+
+            result = ktxMemStream_construct_ro(&stream, map.bytes, map.size);
+            if (result == KTX_SUCCESS) {
+                // Defer loading until the texture owns the mapping. See
+                // ktxTexture2_constructFromNamedFile.
+                result = ktxTexture_CreateFromStream(&stream,
+                          createFlags & ~KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                          &tex);
+            }
+            if (result != KTX_SUCCESS) {
+                ktxFileMap_close(&map);
+                return result;
+            }
+            tex->_protected->_fileMap = map;
+            if (createFlags & KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT) {
+                result = ktxTexture_LoadImageData(tex, NULL, 0);
+                if (result != KTX_SUCCESS) {
+                    ktxTexture_Destroy(tex);
+                    return result;
+                }
+                // A ktxTexture1 always copies its data.
+                if (!ktxTexture_isActiveStream(tex)
+                    && !ktxTexture_isDataMapped(tex))
+                    ktxFileMap_close(&tex->_protected->_fileMap);
+            }
+            *newTex = tex;
+            return KTX_SUCCESS;
+        }
+        // Fall back to reading the file.
+    }
+
     file = fopen(filename, "rb");
     if (!file)
        return KTX_FILE_OPEN_FAILED;
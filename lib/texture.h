@@ -21,6 +21,7 @@
 #define _TEXTURE_H_
 
 #include "ktx.h"
+#include "filemap.h"
 #include "formatsize.h"
 
 #define DECLARE_PRIVATE(class) class ## _private* private = This->_private
@@ -63,6 +64,8 @@ typedef struct ktxTexture_protected {
     ktxFormatSize _formatSize;
     ktx_uint32_t _typeSize;
     ktxStream _stream;
+    ktxFileMap _fileMap; /*!< Mapping of the source file when created with
+                              KTX_TEXTURE_CREATE_MMAP_BIT. */
 } ktxTexture_protected;
 
 #define ktxTexture_getStream(t) ((ktxStream*)(&(t)->_protected->_stream))
@@ -100,6 +103,12 @@ ktxTexture_constructFromStream(ktxTexture* This, ktxStream* pStream,
 void
 ktxTexture_destruct(ktxTexture* This);
 
+void
+ktxTexture_freeData(ktxTexture* This);
+
+ktx_bool_t
+ktxTexture_isDataMapped(ktxTexture* This);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #include "filestream.h"
 #include "memstream.h"
 #include "texture2.h"
+#include "threadpool.h"
 #include "unused.h"
 #include "vk_format.h"
 
@@ -525,6 +526,9 @@ ktxTexture2_constructCopy(ktxTexture2* This, ktxTexture2* orig)
     if (!orig->pData && ktxTexture_isActiveStream((ktxTexture*)orig))
         ktxTexture2_LoadImageData(orig, NULL, 0);
     memcpy(This->_protected, orig->_protected, sizeof(ktxTexture_protected));
+    // The copy gets its own image data so it must not share the mapping.
+    This->_protected->_fileMap.bytes = NULL;
+    This->_protected->_fileMap.size = 0;
 
     ktx_size_t privateSize = sizeof(ktxTexture2_private)
                            + sizeof(ktxLevelIndexEntry) * (orig->numLevels - 1);
@@ -534,6 +538,8 @@ ktxTexture2_constructCopy(ktxTexture2* This, ktxTexture2* orig)
         goto cleanup;
     }
     memcpy(This->_private, orig->_private, privateSize);
+    // The copy decodes its own codebooks if it needs them.
+    This->_private->_basisLzCodebooks = NULL;
     if (orig->_private->_sgdByteLength > 0) {
         This->_private->_supercompressionGlobalData
                         = (ktx_uint8_t*)malloc(orig->_private->_sgdByteLength);
@@ -984,6 +990,12 @@ ktxTexture2_constructFromStdioStream(ktxTexture2* This, FILE* stdioStream,
  *
  * See ktxTextureInt_constructFromStream for details.
  *
+ * If KTX_TEXTURE_CREATE_MMAP_BIT is set in @p createFlags the file is mapped
+ * into memory and read through a ktxMemStream. The mapping is retained by the
+ * texture so ktxTexture2_LoadImageData() can point @c pData directly at the
+ * image data in the mapping. If the file cannot be mapped it is read as
+ * though the bit was not set.
+ *
  * @param[in] This pointer to a ktxTextureInt-sized block of memory to
  *                 initialize.
  * @param[in] filename    pointer to a char array containing the file name.
@@ -1008,6 +1020,37 @@ ktxTexture2_constructFromNamedFile(ktxTexture2* This,
     if (This == NULL || filename == NULL)
         return KTX_INVALID_VALUE;
 
+    if (createFlags & KTX_TEXTURE_CREATE_MMAP_BIT) {
+        ktxFileMap map;
+
+        result = ktxFileMap_open(&map, filename);
+        if (result == KTX_FILE_OPEN_FAILED)
+            return result;
+        if (result == KTX_SUCCESS) {
+            result = ktxMemStream_construct_ro(&stream, map.bytes, map.size);
+            if (result != KTX_SUCCESS) {
+                ktxFileMap_close(&map);
+                return result;
+            }
+            // Load the image data, if requested, only after the texture
+            // owns the mapping so it can be used in place.
+            result = ktxTexture2_constructFromStream(This, &stream,
+                          createFlags & ~KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT);
+            if (result != KTX_SUCCESS) {
+                ktxFileMap_close(&map);
+                return result;
+            }
+            This->_protected->_fileMap = map;
+            if (createFlags & KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT) {
+                result = ktxTexture2_LoadImageData(This, NULL, 0);
+                if (result != KTX_SUCCESS)
+                    ktxTexture2_destruct(This);
+            }
+            return result;
+        }
+        // Fall back to reading the file.
+    }
+
     file = fopen(filename, "rb");
     if (!file)
        return KTX_FILE_OPEN_FAILED;
@@ -1071,6 +1114,7 @@ ktxTexture2_destruct(ktxTexture2* This)
     if (This->_private) {
       ktx_uint8_t* sgd = This->_private->_supercompressionGlobalData;
       if (sgd) free(sgd);
+      ktxTexture2_freeBasisLzCodebooks(This);
       free(This->_private);
     }
     ktxTexture_destruct(ktxTexture(This));
@@ -2155,7 +2199,12 @@ cleanup:
 KTX_error_code
 ktxTexture2_inflateZstdInt(ktxTexture2* This, ktx_uint8_t* pDeflatedData,
                            ktx_uint8_t* pInflatedData,
-                           ktx_size_t inflatedDataCapacity);
+                           ktx_size_t inflatedDataCapacity,
+                           ktxThreadPool* pool, ktx_uint32_t threadCount);
+static KTX_error_code
+ktxTexture2_loadImageDataOn(ktxTexture2* This,
+                            ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                            ktxThreadPool* pool, ktx_uint32_t threadCount);
 /**
  * @memberof ktxTexture2
  * @~English
@@ -2170,6 +2219,11 @@ ktxTexture2_inflateZstdInt(ktxTexture2* This, ktx_uint8_t* pDeflatedData,
  * The texture's levelIndex, dataSize, DFD  and supercompressionScheme will
  * all be updated after successful inflation to reflect the inflated data.
  *
+ * If the texture was created with KTX_TEXTURE_CREATE_MMAP_BIT, @p pBuffer is
+ * @c NULL and the data needs neither inflation nor endianness conversion,
+ * no copy is made. @c pData is set to point at the image data in the mapped
+ * file. The mapping is private so the data can still be modified.
+ *
  * @param[in] This pointer to the ktxTexture object of interest.
  * @param[in] pBuffer pointer to the buffer in which to load the image data.
  * @param[in] bufSize size of the buffer pointed at by @p pBuffer.
@@ -2182,15 +2236,87 @@ ktxTexture2_inflateZstdInt(ktxTexture2* This, ktx_uint8_t* pDeflatedData,
  *                              The data has already been loaded or the
  *                              ktxTexture was not created from a KTX source.
  * @exception KTX_OUT_OF_MEMORY Insufficient memory for the image data.
+ * @exception KTX_FILE_UNEXPECTED_EOF
+ *                              The mapped file is too short to contain the
+ *                              image data.
  */
 KTX_error_code
 ktxTexture2_LoadImageData(ktxTexture2* This,
                           ktx_uint8_t* pBuffer, ktx_size_t bufSize)
+{
+    return ktxTexture2_LoadImageDataEx(This, pBuffer, bufSize, 1);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Load all the image data from the ktxTexture2's source using multiple
+ *        threads to inflate it.
+ *
+ * The same as ktxTexture2_LoadImageData() except that when
+ * supercompressionScheme == SUPERCOMPRESSION_ZSTD the levels are inflated
+ * concurrently using up to @p threadCount threads.
+ *
+ * @param[in] This pointer to the ktxTexture object of interest.
+ * @param[in] pBuffer pointer to the buffer in which to load the image data.
+ * @param[in] bufSize size of the buffer pointed at by @p pBuffer.
+ * @param[in] threadCount maximum number of threads to use.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * For exceptions see ktxTexture2_LoadImageData().
+ */
+KTX_error_code
+ktxTexture2_LoadImageDataEx(ktxTexture2* This,
+                            ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                            ktx_uint32_t threadCount)
+{
+    return ktxTexture2_loadImageDataOn(This, pBuffer, bufSize, NULL,
+                                       threadCount);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Load all the image data from the ktxTexture2's source using the
+ *        threads of a ktxThreadPool to inflate it.
+ *
+ * The same as ktxTexture2_LoadImageDataEx() except that the levels of a
+ * texture with supercompressionScheme == SUPERCOMPRESSION_ZSTD are
+ * inflated on the threads of @p pool.
+ *
+ * @param[in] This pointer to the ktxTexture object of interest.
+ * @param[in] pBuffer pointer to the buffer in which to load the image data.
+ * @param[in] bufSize size of the buffer pointed at by @p pBuffer.
+ * @param[in] pool pointer to the pool whose threads to use. If @c NULL the
+ *            levels are inflated on the calling thread.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * For exceptions see ktxTexture2_LoadImageData().
+ */
+KTX_error_code
+ktxTexture2_LoadImageDataWithPool(ktxTexture2* This,
+                                  ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                                  ktxThreadPool* pool)
+{
+    return ktxTexture2_loadImageDataOn(This, pBuffer, bufSize, pool, 1);
+}
+
+/*
+ * Load the image data, inflating it on @p pool, if not NULL, otherwise on up
+ * to @p threadCount new threads.
+ */
+static KTX_error_code
+ktxTexture2_loadImageDataOn(ktxTexture2* This,
+                            ktx_uint8_t* pBuffer, ktx_size_t bufSize,
+                            ktxThreadPool* pool, ktx_uint32_t threadCount)
 {
     DECLARE_PROTECTED(ktxTexture);
     DECLARE_PRIVATE(ktxTexture2);
     ktx_uint8_t*    pDest;
     ktx_uint8_t*    pDeflatedData = 0;
+    ktx_uint8_t*    pMappedData = 0;
     ktx_uint8_t*    pReadBuf;
     KTX_error_code  result = KTX_SUCCESS;
     ktx_size_t inflatedDataCapacity = ktxTexture2_GetDataSizeUncompressed(This);
@@ -2205,6 +2331,28 @@ ktxTexture2_LoadImageData(ktxTexture2* This,
         // This Texture not created from a stream or images already loaded;
         return KTX_INVALID_OPERATION;
 
+    if (prtctd->_fileMap.bytes != NULL) {
+        if (private->_firstLevelFileOffset > prtctd->_fileMap.size
+            || This->dataSize
+               > prtctd->_fileMap.size - private->_firstLevelFileOffset)
+            return KTX_FILE_UNEXPECTED_EOF;
+        pMappedData = prtctd->_fileMap.bytes + private->_firstLevelFileOffset;
+        if (pBuffer == NULL && This->supercompressionScheme != KTX_SS_ZSTD
+            && !IS_BIG_ENDIAN) {
+            // Use the data in place.
+            This->pData = pMappedData;
+            prtctd->_stream.destruct(&prtctd->_stream);
+            private->_firstLevelFileOffset = 0;
+            return KTX_SUCCESS;
+        }
+    }
+
+    if (This->supercompressionScheme != KTX_SS_ZSTD
+        && inflatedDataCapacity < This->dataSize) {
+        // An unknown supercompression scheme, whose data cannot be read.
+        return KTX_UNSUPPORTED_FEATURE;
+    }
+
     if (pBuffer == NULL) {
         This->pData = malloc(inflatedDataCapacity);
         if (This->pData == NULL)
@@ -2216,7 +2364,10 @@ ktxTexture2_LoadImageData(ktxTexture2* This,
         pDest = pBuffer;
     }
 
-    if (This->supercompressionScheme == KTX_SS_ZSTD) {
+    if (This->supercompressionScheme == KTX_SS_ZSTD && pMappedData) {
+        // Inflate straight from the mapping.
+        pReadBuf = pMappedData;
+    } else if (This->supercompressionScheme == KTX_SS_ZSTD) {
         // Create buffer to hold deflated data.
         pDeflatedData = malloc(This->dataSize);
         if (pDeflatedData == NULL)
@@ -2226,23 +2377,26 @@ ktxTexture2_LoadImageData(ktxTexture2* This,
         pReadBuf = pDest;
     }
 
-    // Seek to data for first level as there may be padding between the
-    // metadata/sgd and the image data.
+    if (pReadBuf != pMappedData) {
+        // Seek to data for first level as there may be padding between the
+        // metadata/sgd and the image data.
 
-    result = prtctd->_stream.setpos(&prtctd->_stream,
-                                    private->_firstLevelFileOffset);
-    if (result != KTX_SUCCESS)
-        return result;
+        result = prtctd->_stream.setpos(&prtctd->_stream,
+                                        private->_firstLevelFileOffset);
+        if (result != KTX_SUCCESS)
+            return result;
 
-    result = prtctd->_stream.read(&prtctd->_stream, pReadBuf,
-                                  This->dataSize);
-    if (result != KTX_SUCCESS)
-        return result;
+        result = prtctd->_stream.read(&prtctd->_stream, pReadBuf,
+                                      This->dataSize);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
 
     if (This->supercompressionScheme == KTX_SS_ZSTD) {
-        assert(pDeflatedData != NULL);
-        result = ktxTexture2_inflateZstdInt(This, pDeflatedData, pDest,
-                                            inflatedDataCapacity);
+        assert(pReadBuf != NULL);
+        result = ktxTexture2_inflateZstdInt(This, pReadBuf, pDest,
+                                            inflatedDataCapacity,
+                                            pool, threadCount);
         free(pDeflatedData);
         if (result != KTX_SUCCESS) {
             if (pBuffer == NULL) {
@@ -2278,12 +2432,206 @@ ktxTexture2_LoadImageData(ktxTexture2* This,
         }
     }
 
-    // No further need for stream or file offset.
+    // No further need for stream, file mapping or file offset.
     prtctd->_stream.destruct(&prtctd->_stream);
+    ktxFileMap_close(&prtctd->_fileMap);
     private->_firstLevelFileOffset = 0;
     return result;
 }
 
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Return the size in bytes of a mip level's image data after any
+ *        Zstd inflation.
+ *
+ * This is the buffer size needed by ktxTexture2_LoadLevel(). For Basis
+ * supercompression the uncompressed size cannot be known until the data is
+ * transcoded so 0 is returned.
+ *
+ * @param[in] This     pointer to the ktxTexture2 object of interest.
+ * @param[in] level    mip level of interest.
+ */
+ktx_size_t
+ktxTexture2_GetLevelSizeUncompressed(ktxTexture2* This, ktx_uint32_t level)
+{
+    if (This == NULL || level >= This->numLevels)
+        return 0;
+
+    switch (This->supercompressionScheme) {
+      case KTX_SS_NONE:
+        return This->_private->_levelIndex[level].byteLength;
+      case KTX_SS_ZSTD:
+        return This->_private->_levelIndex[level].uncompressedByteLength;
+      default:
+        return 0;
+    }
+}
+
+/*
+ * Inflate the @p srcSize bytes of a single zstd deflated level at @p pSrc
+ * into the @p levelSize bytes at @p pDst.
+ */
+static KTX_error_code
+ktxTexture2_inflateZstdLevelTo(ktx_uint8_t* pDst, ktx_size_t levelSize,
+                               const ktx_uint8_t* pSrc, ktx_size_t srcSize)
+{
+    size_t inflatedSize = ZSTD_decompress(pDst, levelSize, pSrc, srcSize);
+    if (ZSTD_isError(inflatedSize)) {
+        if (ZSTD_getErrorCode(inflatedSize) == ZSTD_error_memory_allocation)
+            return KTX_OUT_OF_MEMORY;
+        return KTX_FILE_DATA_ERROR;
+    }
+    if (inflatedSize != levelSize)
+        return KTX_FILE_DATA_ERROR;
+    return KTX_SUCCESS;
+}
+
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Load the image data of a single mip level from the ktxTexture2's
+ *        source.
+ *
+ * Levels can be loaded in any order and any number of times so applications
+ * can, for example, show the smallest levels immediately and fetch the
+ * larger levels when needed. Only the requested level is read and, if
+ * supercompressionScheme == KTX_SS_ZSTD, inflated. The texture itself is
+ * not modified and its source is left open so ktxTexture2_LoadImageData()
+ * can still be called afterwards. If the texture already has image data,
+ * e.g. because it has been loaded, the level is copied, or inflated if the
+ * data has since been deflated, from it.
+ *
+ * The data is written to @p pBuffer laid out as it would be in the level of
+ * a loaded texture. @p bufSize must be at least
+ * ktxTexture2_GetLevelSizeUncompressed().
+ *
+ * Calls on the same texture must not be made concurrently as they share the
+ * texture's source stream.
+ *
+ * @param[in] This      pointer to the ktxTexture2 object of interest.
+ * @param[in] level     mip level to load.
+ * @param[in] pBuffer   pointer to the buffer in which to load the level.
+ * @param[in] bufSize   size of the buffer pointed at by @p pBuffer.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This or @p pBuffer is @c NULL.
+ * @exception KTX_INVALID_VALUE @p level is not less than @c numLevels.
+ * @exception KTX_INVALID_VALUE @p bufSize is less than the level's size.
+ * @exception KTX_INVALID_OPERATION
+ *                              supercompressionScheme is neither
+ *                              KTX_SS_NONE nor KTX_SS_ZSTD.
+ * @exception KTX_INVALID_OPERATION
+ *                              The ktxTexture2 was not created from a KTX
+ *                              source and has no image data.
+ * @exception KTX_FILE_DATA_ERROR
+ *                              The level's deflated data is invalid.
+ * @exception KTX_FILE_UNEXPECTED_EOF
+ *                              The source is too short to contain the level.
+ * @exception KTX_OUT_OF_MEMORY Insufficient memory for the deflated data.
+ */
+KTX_error_code
+ktxTexture2_LoadLevel(ktxTexture2* This, ktx_uint32_t level,
+                      ktx_uint8_t* pBuffer, ktx_size_t bufSize)
+{
+    DECLARE_PROTECTED(ktxTexture);
+    ktxLevelIndexEntry* levelIndex;
+    ktx_size_t levelSize;
+    ktx_uint64_t fileOffset;
+    ktx_uint8_t* pDeflatedData = NULL;
+    const ktx_uint8_t* pReadBuf;
+    KTX_error_code result;
+
+    if (This == NULL || pBuffer == NULL)
+        return KTX_INVALID_VALUE;
+
+    if (level >= This->numLevels)
+        return KTX_INVALID_VALUE;
+
+    if (This->supercompressionScheme != KTX_SS_NONE &&
+        This->supercompressionScheme != KTX_SS_ZSTD)
+        return KTX_INVALID_OPERATION;
+
+    levelIndex = This->_private->_levelIndex;
+    levelSize = ktxTexture2_GetLevelSizeUncompressed(This, level);
+    if (bufSize < levelSize)
+        return KTX_INVALID_VALUE;
+
+    if (This->pData != NULL) {
+        // The data is in memory and in native byte order. It is deflated if
+        // the texture was supercompressed after loading or creation.
+        if (levelIndex[level].byteOffset > This->dataSize
+            || levelIndex[level].byteLength
+               > This->dataSize - levelIndex[level].byteOffset)
+            return KTX_INVALID_OPERATION;
+        pReadBuf = This->pData + levelIndex[level].byteOffset;
+        if (This->supercompressionScheme == KTX_SS_NONE) {
+            memcpy(pBuffer, pReadBuf, levelSize);
+            return KTX_SUCCESS;
+        }
+        return ktxTexture2_inflateZstdLevelTo(pBuffer, levelSize, pReadBuf,
+                                              levelIndex[level].byteLength);
+    }
+
+    if (prtctd->_stream.data.file == NULL)
+        // This Texture not created from a stream.
+        return KTX_INVALID_OPERATION;
+
+    fileOffset = ktxTexture2_levelFileOffset(This, level);
+    if (prtctd->_fileMap.bytes != NULL) {
+        if (fileOffset > prtctd->_fileMap.size
+            || levelIndex[level].byteLength
+               > prtctd->_fileMap.size - fileOffset)
+            return KTX_FILE_UNEXPECTED_EOF;
+        pReadBuf = prtctd->_fileMap.bytes + fileOffset;
+        if (This->supercompressionScheme == KTX_SS_NONE)
+            memcpy(pBuffer, pReadBuf, levelSize);
+    } else {
+        ktx_uint8_t* pDest;
+        if (This->supercompressionScheme == KTX_SS_ZSTD) {
+            pDeflatedData = malloc(levelIndex[level].byteLength);
+            if (pDeflatedData == NULL)
+                return KTX_OUT_OF_MEMORY;
+            pDest = pDeflatedData;
+        } else {
+            pDest = pBuffer;
+        }
+        result = prtctd->_stream.setpos(&prtctd->_stream, fileOffset);
+        if (result == KTX_SUCCESS)
+            result = prtctd->_stream.read(&prtctd->_stream, pDest,
+                                          levelIndex[level].byteLength);
+        if (result != KTX_SUCCESS) {
+            free(pDeflatedData);
+            return result;
+        }
+        pReadBuf = pDest;
+    }
+
+    if (This->supercompressionScheme == KTX_SS_ZSTD) {
+        result = ktxTexture2_inflateZstdLevelTo(pBuffer, levelSize, pReadBuf,
+                                                levelIndex[level].byteLength);
+        free(pDeflatedData);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+
+    if (IS_BIG_ENDIAN) {
+        switch (prtctd->_typeSize) {
+          case 2:
+            _ktxSwapEndian16((ktx_uint16_t*)pBuffer, levelSize / 2);
+            break;
+          case 4:
+            _ktxSwapEndian32((ktx_uint32_t*)pBuffer, levelSize / 4);
+            break;
+          case 8:
+            _ktxSwapEndian64((ktx_uint64_t*)pBuffer, levelSize / 8);
+            break;
+        }
+    }
+    return KTX_SUCCESS;
+}
+
 /**
  * @memberof ktxTexture2 @private
  * @~English
@@ -2297,11 +2645,64 @@ ktx_uint64_t ktxTexture2_levelDataOffset(ktxTexture2* This, ktx_uint32_t level)
     return This->_private->_levelIndex[level].byteOffset;
 }
 
+typedef struct {
+    ktxTexture2* This;
+    const ktx_uint8_t* pDeflatedData;
+    ktx_uint8_t* pInflatedData;
+    const ktxLevelIndexEntry* nindex; /* Index of the inflated data. */
+    ZSTD_DCtx** dctxs;                /* One per worker. */
+} ktxInflateZstdJobs;
+
+/*
+ * Inflate a single level into its place in the inflated data. Job @p job
+ * inflates level @p job so the largest levels are started first.
+ */
+static KTX_error_code
+ktxTexture2_inflateZstdLevel(void* userdata, ktx_uint32_t worker,
+                             ktx_uint32_t job)
+{
+    ktxInflateZstdJobs* jobs = (ktxInflateZstdJobs*)userdata;
+    ktxLevelIndexEntry* cindex = jobs->This->_private->_levelIndex;
+    ktx_uint32_t level = job;
+
+    if (jobs->dctxs[worker] == NULL) {
+        jobs->dctxs[worker] = ZSTD_createDCtx();
+        if (jobs->dctxs[worker] == NULL)
+            return KTX_OUT_OF_MEMORY;
+    }
+
+    size_t levelByteLength =
+        ZSTD_decompressDCtx(jobs->dctxs[worker],
+                            jobs->pInflatedData + jobs->nindex[level].byteOffset,
+                            jobs->nindex[level].byteLength,
+                            &jobs->pDeflatedData[cindex[level].byteOffset],
+                            cindex[level].byteLength);
+    if (ZSTD_isError(levelByteLength)) {
+        ZSTD_ErrorCode error = ZSTD_getErrorCode(levelByteLength);
+        switch(error) {
+          case ZSTD_error_memory_allocation:
+            return KTX_OUT_OF_MEMORY;
+          default:
+            // Including dstSize_tooSmall as the destination size is the
+            // uncompressedByteLength from the level index.
+            return KTX_FILE_DATA_ERROR;
+        }
+    }
+    if (levelByteLength != jobs->nindex[level].byteLength)
+        return KTX_FILE_DATA_ERROR;
+    return KTX_SUCCESS;
+}
+
 /**
  * @memberof ktxTexture2 @private
  * @~English
  * @brief Inflate the data in a ktxTexture2 object using Zstandard.
  *
+ * Each level is an independent Zstandard frame whose inflated size is
+ * given by the level index so levels are inflated concurrently, on the
+ * threads of @p pool or, if that is @c NULL, using up to @p threadCount
+ * threads.
+ *
  * The texture's levelIndex, dataSize, DFD  and supercompressionScheme will
  * all be updated after successful inflation to reflect the inflated data.
  *
@@ -2312,21 +2713,27 @@ ktx_uint64_t ktxTexture2_levelDataOffset(ktxTexture2* This, ktx_uint32_t level)
  *                             data.
  * @param[in] inflatedDataCapacity capacity of the buffer pointed at by
  *                                @p pInflatedData.
+ * @param[in] pool          pointer to the pool whose threads to use or
+ *                          @c NULL.
+ * @param[in] threadCount   maximum number of threads to use if @p pool is
+ *                          @c NULL.
  */
 KTX_error_code
 ktxTexture2_inflateZstdInt(ktxTexture2* This, ktx_uint8_t* pDeflatedData,
                            ktx_uint8_t* pInflatedData,
-                           ktx_size_t inflatedDataCapacity)
+                           ktx_size_t inflatedDataCapacity,
+                           ktxThreadPool* pool, ktx_uint32_t threadCount)
 {
     DECLARE_PROTECTED(ktxTexture);
     ktx_uint32_t levelIndexByteLength =
                             This->numLevels * sizeof(ktxLevelIndexEntry);
-    uint32_t levelOffset = 0;
+    ktx_size_t levelOffset = 0;
     ktxLevelIndexEntry* cindex = This->_private->_levelIndex;
     ktxLevelIndexEntry* nindex;
     ktx_uint32_t uncompressedLevelAlignment;
-
-    ZSTD_DCtx* dctx;
+    ktxInflateZstdJobs jobs;
+    ktx_uint32_t workers, w;
+    KTX_error_code result;
 
     if (pDeflatedData == NULL)
         return KTX_INVALID_VALUE;
@@ -2344,37 +2751,43 @@ ktxTexture2_inflateZstdInt(ktxTexture2* This, ktx_uint8_t* pDeflatedData,
     uncompressedLevelAlignment =
         ktxTexture2_calcPostInflationLevelAlignment(This);
 
-    ktx_size_t inflatedByteLength = 0;
-    dctx = ZSTD_createDCtx();
+    // Lay out the inflated levels before inflating them so each level's
+    // destination is known up front.
     for (int32_t level = This->numLevels - 1; level >= 0; level--) {
-        size_t levelByteLength =
-            ZSTD_decompressDCtx(dctx, pInflatedData + levelOffset,
-                              inflatedDataCapacity,
-                              &pDeflatedData[cindex[level].byteOffset],
-                              cindex[level].byteLength);
-        if (ZSTD_isError(levelByteLength)) {
-            ZSTD_ErrorCode error = ZSTD_getErrorCode(levelByteLength);
-            switch(error) {
-              case ZSTD_error_dstSize_tooSmall:
-                return KTX_INVALID_VALUE; // inflatedDataCapacity too small.
-              case ZSTD_error_memory_allocation:
-                return KTX_OUT_OF_MEMORY;
-              default:
-                return KTX_FILE_DATA_ERROR;
-            }
-        }
+        levelOffset = _KTX_PADN(uncompressedLevelAlignment, levelOffset);
         nindex[level].byteOffset = levelOffset;
         nindex[level].uncompressedByteLength = nindex[level].byteLength =
-                                                            levelByteLength;
-        inflatedByteLength += levelByteLength;
-        levelOffset += _KTX_PADN(uncompressedLevelAlignment, levelByteLength);
-        inflatedDataCapacity -= levelByteLength;
+                                        cindex[level].uncompressedByteLength;
+        levelOffset += nindex[level].byteLength;
+    }
+    if (levelOffset > inflatedDataCapacity) {
+        free(nindex);
+        return KTX_INVALID_VALUE; // inflatedDataCapacity too small.
+    }
+
+    workers = ktxJobWorkerCountOn(pool, threadCount, This->numLevels);
+    jobs.This = This;
+    jobs.pDeflatedData = pDeflatedData;
+    jobs.pInflatedData = pInflatedData;
+    jobs.nindex = nindex;
+    jobs.dctxs = calloc(workers, sizeof(ZSTD_DCtx*));
+    if (jobs.dctxs == NULL) {
+        free(nindex);
+        return KTX_OUT_OF_MEMORY;
+    }
+    result = ktxRunJobsOn(pool, threadCount, This->numLevels,
+                          ktxTexture2_inflateZstdLevel, &jobs);
+    for (w = 0; w < workers; w++)
+        ZSTD_freeDCtx(jobs.dctxs[w]);
+    free(jobs.dctxs);
+    if (result != KTX_SUCCESS) {
+        free(nindex);
+        return result;
     }
-    ZSTD_freeDCtx(dctx);
 
     // Now modify the texture.
 
-    This->dataSize = inflatedByteLength;
+    This->dataSize = levelOffset;
     This->supercompressionScheme = KTX_SS_NONE;
     memcpy(cindex, nindex, levelIndexByteLength); // Update level index
     free(nindex);
@@ -30,6 +30,8 @@ extern "C" {
 #include "texture_funcs.inl"
 #undef CLASS
 
+struct ktxBasisLzCodebooks;
+
 typedef struct ktxTexture2_private {
     ktx_uint8_t* _supercompressionGlobalData;
     ktx_uint32_t _requiredLevelAlignment;
@@ -37,6 +39,10 @@ typedef struct ktxTexture2_private {
     ktx_uint64_t _firstLevelFileOffset; /*!< Always 0, unless the texture was
                                          created from a stream and the image
                                          data is not yet loaded. */
+    struct ktxBasisLzCodebooks* _basisLzCodebooks; /*!< Codebooks decoded
+                                         from _supercompressionGlobalData by
+                                         the first BasisLZ transcode. NULL
+                                         until then. */
     // Must be last so it can grow.
     ktxLevelIndexEntry _levelIndex[1]; /*!< Offsets in this index are from the
                                         start of the image data. Use
@@ -60,6 +66,7 @@ ktx_size_t ktxTexture2_calcLevelOffset(ktxTexture2* This, ktx_uint32_t level);
 ktx_uint32_t ktxTexture2_calcRequiredLevelAlignment(ktxTexture2* This);
 ktx_uint64_t ktxTexture2_levelFileOffset(ktxTexture2* This, ktx_uint32_t level);
 ktx_uint64_t ktxTexture2_levelDataOffset(ktxTexture2* This, ktx_uint32_t level);
+void ktxTexture2_freeBasisLzCodebooks(ktxTexture2* This);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,404 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file threadpool.cpp
+ * @~English
+ *
+ * @brief Functions for running independent jobs on multiple threads.
+ *
+ * Used by the transcoding, supercompression and encoding code paths whose
+ * images or levels can be processed independently of each other.
+ * ktxRunJobs() starts threads for a single batch of jobs. A ktxThreadPool
+ * keeps its threads for running many batches, avoiding the cost of thread
+ * creation when batches are small. Applications can create a ktxThreadPool
+ * and pass it to libktx functions so all their work shares one set of
+ * threads.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "ktx.h"
+#include "threadpool.h"
+
+// Without pthreads support, std::thread compiles under Emscripten but throws
+// when a thread is started so always run jobs on the calling thread.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  #define KTX_NO_THREADS 1
+#endif
+
+namespace {
+
+struct JobQueue {
+    PFNKTXJOB job;
+    void* userdata;
+    ktx_uint32_t jobCount;
+    std::atomic<ktx_uint32_t> nextJob;
+    std::atomic<bool> failed;
+    std::mutex errorMutex;
+    ktx_uint32_t errorJob;
+    KTX_error_code error;
+    ktx_uint32_t helpers = 0;   // Pool threads working on this batch.
+
+    bool
+    hasWork() const {
+        return !failed.load(std::memory_order_relaxed)
+               && nextJob.load(std::memory_order_relaxed) < jobCount;
+    }
+
+    // Claim jobs until none remain or one of the workers has failed.
+    void
+    work(ktx_uint32_t worker) {
+        while (!failed.load(std::memory_order_relaxed)) {
+            ktx_uint32_t j = nextJob.fetch_add(1, std::memory_order_relaxed);
+            if (j >= jobCount)
+                break;
+            KTX_error_code result = job(userdata, worker, j);
+            if (result != KTX_SUCCESS) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                // Report the error of the lowest numbered failing job so
+                // results do not depend on thread scheduling.
+                if (error == KTX_SUCCESS || j < errorJob) {
+                    error = result;
+                    errorJob = j;
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+} // namespace
+
+/**
+ * @internal
+ * @~English
+ * @brief Return the number of workers ktxRunJobs() will use.
+ *
+ * Callers use this to size arrays of per-worker scratch state.
+ *
+ * @param[in] threadCount   the maximum number of threads requested.
+ * @param[in] jobCount      the number of jobs to be run.
+ *
+ * @return the number of workers, at least 1.
+ */
+ktx_uint32_t
+ktxJobWorkerCount(ktx_uint32_t threadCount, ktx_uint32_t jobCount)
+{
+#if KTX_NO_THREADS
+    (void)threadCount; (void)jobCount;
+    return 1;
+#else
+    ktx_uint32_t workers = threadCount < jobCount ? threadCount : jobCount;
+    return workers < 1 ? 1 : workers;
+#endif
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Run @p jobCount independent jobs using up to @p threadCount threads.
+ *
+ * The calling thread is used as one of the workers so at most
+ * @p threadCount - 1 additional threads are created. When only 1 worker is
+ * needed all jobs are run, in order, on the calling thread. Jobs are handed
+ * out in increasing index order. Once any job fails no further jobs are
+ * started.
+ *
+ * @param[in] threadCount   the maximum number of threads to use. 0 is
+ *                          treated as 1.
+ * @param[in] jobCount      the number of jobs to run.
+ * @param[in] job           function to call for each job.
+ * @param[in] userdata      pointer passed to each call of @p job.
+ *
+ * @return KTX_SUCCESS if all jobs succeeded, otherwise the error returned by
+ *         the lowest numbered failing job.
+ */
+KTX_error_code
+ktxRunJobs(ktx_uint32_t threadCount, ktx_uint32_t jobCount,
+           PFNKTXJOB job, void* userdata)
+{
+    ktx_uint32_t workers = ktxJobWorkerCount(threadCount, jobCount);
+
+    if (workers == 1) {
+        for (ktx_uint32_t j = 0; j < jobCount; j++) {
+            KTX_error_code result = job(userdata, 0, j);
+            if (result != KTX_SUCCESS)
+                return result;
+        }
+        return KTX_SUCCESS;
+    }
+
+    JobQueue queue;
+    queue.job = job;
+    queue.userdata = userdata;
+    queue.jobCount = jobCount;
+    queue.nextJob = 0;
+    queue.failed = false;
+    queue.errorJob = 0;
+    queue.error = KTX_SUCCESS;
+
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(workers - 1);
+        for (ktx_uint32_t w = 1; w < workers; w++)
+            threads.emplace_back(&JobQueue::work, &queue, w);
+    } catch (const std::exception&) {
+        // Thread creation failed. Continue with however many threads were
+        // started; the calling thread alone can run all the jobs.
+    }
+
+    queue.work(0);
+    for (auto& t : threads)
+        t.join();
+
+    return queue.error;
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief A set of threads persisting across batches of jobs.
+ *
+ * Any number of batches, submitted by different callers, may be in progress
+ * at once. Each caller works on its own batch while the pool's threads
+ * spread themselves over the batches that still have unclaimed jobs.
+ */
+struct ktxThreadPool {
+    std::vector<std::thread> threads;
+    std::mutex mutex;              // Protects the following.
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<JobQueue*> batches; // Batches in progress, oldest first.
+    bool stop = false;
+
+    // Return the batch with unclaimed jobs having the fewest pool threads
+    // working on it, or nullptr if there is none. mutex must be held.
+    JobQueue*
+    pickBatch() {
+        JobQueue* best = nullptr;
+        for (JobQueue* q : batches) {
+            if (q->hasWork() && (best == nullptr || q->helpers < best->helpers))
+                best = q;
+        }
+        return best;
+    }
+
+    void
+    threadMain(ktx_uint32_t worker) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            JobQueue* q = nullptr;
+            wake.wait(lock, [&] {
+                return stop || (q = pickBatch()) != nullptr;
+            });
+            if (stop)
+                return;
+            q->helpers++;
+            lock.unlock();
+            q->work(worker);
+            lock.lock();
+            if (--q->helpers == 0)
+                done.notify_all();
+        }
+    }
+};
+
+/**
+ * @memberof ktxThreadPool
+ * @~English
+ * @brief Create a pool of worker threads for use by libktx functions.
+ *
+ * The pool may be passed to ktxTexture2_CompressBasisEx(),
+ * ktxTexture2_CompressAstcEx(), ktxTexture2_TranscodeBasisWithPool(),
+ * ktxTexture2_DeflateZstdWithPool() and ktxTexture2_LoadImageDataWithPool().
+ * Those calls may be made concurrently from any number of threads. All of
+ * them share the pool's threads so, however many calls are in progress, no
+ * more than @p threadCount - 1 threads plus the calling threads do their
+ * work. The thread calling one of these functions always works on its own
+ * call's jobs and the pool's threads help with whichever calls have the
+ * fewest helpers.
+ *
+ * @param[in] threadCount   the number of workers, including the thread
+ *                          making a call, that can work on a single call.
+ *                          @p threadCount - 1 threads are created. 0 is
+ *                          treated as 1.
+ * @param[out] newPool      pointer to location to store the pool's address.
+ *
+ * @return KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p newPool is @c NULL.
+ * @exception KTX_OUT_OF_MEMORY The pool could not be allocated. Failure to
+ *                              create some of the threads is not an error;
+ *                              the pool just has fewer workers.
+ */
+extern "C" KTX_error_code
+ktxThreadPool_Create(ktx_uint32_t threadCount, ktxThreadPool** newPool)
+{
+    if (newPool == nullptr)
+        return KTX_INVALID_VALUE;
+
+    ktxThreadPool* pool = new (std::nothrow) ktxThreadPool;
+    if (pool == nullptr)
+        return KTX_OUT_OF_MEMORY;
+
+#if !KTX_NO_THREADS
+    try {
+        if (threadCount > 1)
+            pool->threads.reserve(threadCount - 1);
+        for (ktx_uint32_t w = 1; w < threadCount; w++)
+            pool->threads.emplace_back(&ktxThreadPool::threadMain, pool, w);
+    } catch (const std::exception&) {
+        // Continue with however many threads were started.
+    }
+#else
+    (void)threadCount;
+#endif
+    *newPool = pool;
+    return KTX_SUCCESS;
+}
+
+/**
+ * @memberof ktxThreadPool
+ * @~English
+ * @brief Destroy a thread pool, stopping its threads.
+ *
+ * Must not be called while any call using @p pool is in progress.
+ *
+ * @param[in] pool  pointer to the pool to destroy. May be @c NULL.
+ */
+extern "C" void
+ktxThreadPool_Destroy(ktxThreadPool* pool)
+{
+    if (pool == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->stop = true;
+    }
+    pool->wake.notify_all();
+    for (auto& t : pool->threads)
+        t.join();
+    delete pool;
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Return the number of workers in a pool, including the caller of
+ *        ktxThreadPool_run().
+ *
+ * Callers use this to size arrays of per-worker scratch state.
+ */
+ktx_uint32_t
+ktxThreadPool_workerCount(ktxThreadPool* pool)
+{
+    return (ktx_uint32_t)pool->threads.size() + 1;
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Run @p jobCount independent jobs on the threads of a pool.
+ *
+ * Behaves like ktxRunJobs() except that the pool's threads are used rather
+ * than new threads being created. The calling thread is worker 0. Returns
+ * when all jobs have finished. Calls on the same pool from different
+ * threads, or from a job running on the pool, run concurrently sharing the
+ * pool's threads. The worker indices of concurrent batches overlap so
+ * per-worker scratch state must belong to the batch.
+ *
+ * @param[in] pool          pointer to the pool to use.
+ * @param[in] jobCount      the number of jobs to run.
+ * @param[in] job           function to call for each job.
+ * @param[in] userdata      pointer passed to each call of @p job.
+ *
+ * @return KTX_SUCCESS if all jobs succeeded, otherwise the error returned by
+ *         the lowest numbered failing job.
+ */
+KTX_error_code
+ktxThreadPool_run(ktxThreadPool* pool, ktx_uint32_t jobCount,
+                  PFNKTXJOB job, void* userdata)
+{
+    JobQueue queue;
+    queue.job = job;
+    queue.userdata = userdata;
+    queue.jobCount = jobCount;
+    queue.nextJob = 0;
+    queue.failed = false;
+    queue.errorJob = 0;
+    queue.error = KTX_SUCCESS;
+
+    // Only wake the threads when there is more than one job for them.
+    if (jobCount > 1 && !pool->threads.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->batches.push_back(&queue);
+        }
+        pool->wake.notify_all();
+        queue.work(0);
+        // All jobs are claimed. Stop more threads joining then wait for
+        // those still running jobs.
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->batches.erase(std::find(pool->batches.begin(),
+                                      pool->batches.end(), &queue));
+        pool->done.wait(lock, [&] { return queue.helpers == 0; });
+    } else {
+        queue.work(0);
+    }
+    return queue.error;
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Return the number of workers ktxRunJobsOn() will use.
+ *
+ * @param[in] pool          pointer to the pool the jobs will run on or
+ *                          @c NULL.
+ * @param[in] threadCount   the maximum number of threads requested. Ignored
+ *                          if @p pool is not @c NULL.
+ * @param[in] jobCount      the number of jobs to be run.
+ *
+ * @return the number of workers, at least 1.
+ */
+ktx_uint32_t
+ktxJobWorkerCountOn(ktxThreadPool* pool, ktx_uint32_t threadCount,
+                    ktx_uint32_t jobCount)
+{
+    // A pool's threads are not limited to the first jobCount worker indices.
+    if (pool)
+        return ktxThreadPool_workerCount(pool);
+    return ktxJobWorkerCount(threadCount, jobCount);
+}
+
+/**
+ * @internal
+ * @~English
+ * @brief Run @p jobCount independent jobs on @p pool, if given, otherwise on
+ *        up to @p threadCount new threads.
+ *
+ * For functions that take either a pool or a thread count from their caller.
+ * See ktxThreadPool_run() and ktxRunJobs().
+ */
+KTX_error_code
+ktxRunJobsOn(ktxThreadPool* pool, ktx_uint32_t threadCount,
+             ktx_uint32_t jobCount, PFNKTXJOB job, void* userdata)
+{
+    if (pool)
+        return ktxThreadPool_run(pool, jobCount, job, userdata);
+    return ktxRunJobs(threadCount, jobCount, job, userdata);
+}
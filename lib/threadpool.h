@@ -0,0 +1,72 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file threadpool.h
+ * @~English
+ *
+ * @brief Declare internal functions and a thread pool for running
+ *        independent jobs on multiple threads.
+ *
+ * These functions are private and should not be used outside the library.
+ */
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include "ktx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @~English
+ * @brief Signature of a job function run by ktxRunJobs().
+ *
+ * @param[in] userdata  pointer passed through from ktxRunJobs().
+ * @param[in] worker    index, in the range [0, workerCount), of the worker
+ *                      running the job. Use it to index per-worker scratch
+ *                      state. No two jobs with the same @p worker index run
+ *                      concurrently.
+ * @param[in] job       index, in the range [0, jobCount), of the job to run.
+ */
+typedef KTX_error_code (*PFNKTXJOB)(void* userdata, ktx_uint32_t worker,
+                                    ktx_uint32_t job);
+
+ktx_uint32_t
+ktxJobWorkerCount(ktx_uint32_t threadCount, ktx_uint32_t jobCount);
+
+KTX_error_code
+ktxRunJobs(ktx_uint32_t threadCount, ktx_uint32_t jobCount,
+           PFNKTXJOB job, void* userdata);
+
+/* ktxThreadPool_Create and ktxThreadPool_Destroy are public. See ktx.h. */
+
+ktx_uint32_t
+ktxThreadPool_workerCount(ktxThreadPool* pool);
+
+KTX_error_code
+ktxThreadPool_run(ktxThreadPool* pool, ktx_uint32_t jobCount,
+                  PFNKTXJOB job, void* userdata);
+
+ktx_uint32_t
+ktxJobWorkerCountOn(ktxThreadPool* pool, ktx_uint32_t threadCount,
+                    ktx_uint32_t jobCount);
+
+KTX_error_code
+ktxRunJobsOn(ktxThreadPool* pool, ktx_uint32_t threadCount,
+             ktx_uint32_t jobCount, PFNKTXJOB job, void* userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _THREADPOOL_H_ */
@@ -0,0 +1,2070 @@
+// -*- tab-width: 4; -*-
+// vi: set sw=2 ts=4 sts=4 expandtab:
+
+//
+// Copyright 2019-2023 The Khronos Group, Inc.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+/**
+ * @internal
+ * @file validate.cpp
+ * @~English
+ *
+ * @brief Validation of KTX 2 files held in memory.
+ *
+ * These are the checks made by the ktx2check tool, available to
+ * applications via ktxValidateMemory().
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <math.h>
+#include <iomanip>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ktx.h"
+#include <KHR/khr_df.h>
+
+#include "ktxint.h"
+#include "vkformat_enum.h"
+#include "dfdutils/dfd.h"
+#include "texture.h"
+#include "basis_sgd.h"
+
+#if defined(_MSC_VER)
+  #define strncasecmp _strnicmp
+#endif
+
+/////////////////////////////////////////////////////////////////////
+//                       External Functions                        //
+//             These are in libktx but not in a header.            //
+/////////////////////////////////////////////////////////////////////
+
+extern "C" {
+    bool isProhibitedFormat(VkFormat format);
+    bool isValidFormat(VkFormat format);
+    char* vkFormatString(VkFormat format);
+}
+
+using namespace std;
+
+namespace {
+
+#if !defined(BITFIELD_ORDER_FROM_MSB)
+// This declaration is solely to make debugging of certain problems easier.
+// Most compilers, including all those tested so far, including clang, gcc
+// and msvc, order bitfields from the lsb so these struct declarations work.
+// Possibly this is because I've only tested on little-endian machines?
+struct sampleType {
+    uint32_t bitOffset: 16;
+    uint32_t bitLength: 8;
+    uint32_t channelType: 8; // Includes qualifiers
+    uint32_t samplePosition0: 8;
+    uint32_t samplePosition1: 8;
+    uint32_t samplePosition2: 8;
+    uint32_t samplePosition3: 8;
+    uint32_t lower;
+    uint32_t upper;
+};
+
+struct BDFD {
+    uint32_t vendorId: 17;
+    uint32_t descriptorType: 15;
+    uint32_t versionNumber: 16;
+    uint32_t descriptorBlockSize: 16;
+    uint32_t model: 8;
+    uint32_t primaries: 8;
+    uint32_t transfer: 8;
+    uint32_t flags: 8;
+    uint32_t texelBlockDimension0: 8;
+    uint32_t texelBlockDimension1: 8;
+    uint32_t texelBlockDimension2: 8;
+    uint32_t texelBlockDimension3: 8;
+    uint32_t bytesPlane0: 8;
+    uint32_t bytesPlane1: 8;
+    uint32_t bytesPlane2: 8;
+    uint32_t bytesPlane3: 8;
+    uint32_t bytesPlane4: 8;
+    uint32_t bytesPlane5: 8;
+    uint32_t bytesPlane6: 8;
+    uint32_t bytesPlane7: 8;
+    struct sampleType samples[6];
+};
+#endif
+
+/////////////////////////////////////////////////////////////////////
+//                       Message Definitions                       //
+/////////////////////////////////////////////////////////////////////
+
+struct issue {
+    uint32_t code;
+    const string message;
+};
+
+struct {
+    issue FileOpen {
+        KTX_ISSUE_IO_FILE_OPEN, "File open failed: %s."
+    };
+    issue FileRead {
+        KTX_ISSUE_IO_FILE_READ, "File read failed: %s."
+    };
+    issue UnexpectedEOF {
+        KTX_ISSUE_IO_UNEXPECTED_EOF, "Unexpected end of file."
+    };
+    issue RewindFailure {
+        KTX_ISSUE_IO_REWIND_FAILURE, "Seek to start of file failed: %s."
+    };
+    issue FileSeekEndFailure {
+        KTX_ISSUE_IO_FILE_SEEK_END_FAILURE, "Seek to end of file failed: %s."
+    };
+    issue FileTellFailure {
+        KTX_ISSUE_IO_FILE_TELL_FAILURE, "Query of file position failed: %s."
+    };
+} IOError;
+
+struct {
+    issue NotKTX2 {
+        KTX_ISSUE_FILE_NOT_KTX2, "Not a KTX2 file."
+    };
+    issue CreateFailure {
+        KTX_ISSUE_FILE_CREATE_FAILURE, "ktxTexture2 creation failed: %s."
+    };
+    issue IncorrectDataSize {
+        KTX_ISSUE_FILE_INCORRECT_DATA_SIZE, "Size of image data in file does not match size calculated from levelIndex."
+    };
+} FileError;
+
+struct {
+    issue ProhibitedFormat {
+        KTX_ISSUE_HEADER_PROHIBITED_FORMAT, "vkFormat is one of the prohibited formats."
+    };
+    issue InvalidFormat {
+        KTX_ISSUE_HEADER_INVALID_FORMAT, "vkFormat, %#x, is not a valid VkFormat value."
+    };
+    issue UnknownFormat {
+        KTX_ISSUE_HEADER_UNKNOWN_FORMAT, "vkFormat, %#x is unknown, possibly an extension format."
+    };
+    issue WidthZero {
+        KTX_ISSUE_HEADER_WIDTH_ZERO, "pixelWidth is 0. Textures must have width."
+    };
+    issue DepthNoHeight {
+        KTX_ISSUE_HEADER_DEPTH_NO_HEIGHT, "pixelDepth != 0 but pixelHeight == 0. Depth textures must have height."
+    };
+    issue ThreeDArray {
+        KTX_ISSUE_HEADER_3D_ARRAY, "File contains a 3D array texture. No APIs support these."
+    };
+    issue CubeFaceNot2d {
+        KTX_ISSUE_HEADER_CUBE_FACE_NOT_2D, "Cube map faces must be 2d."
+    };
+    issue InvalidFaceCount {
+        KTX_ISSUE_HEADER_INVALID_FACE_COUNT, "faceCount is %d. It must be 1 or 6."
+    };
+    issue TooManyMipLevels {
+        KTX_ISSUE_HEADER_TOO_MANY_MIP_LEVELS, "%d is too many levels for the largest image dimension %d."
+    };
+    issue VendorSupercompression {
+        KTX_ISSUE_HEADER_VENDOR_SUPERCOMPRESSION, "Using vendor supercompressionScheme. Can't validate."
+    };
+    issue InvalidSupercompression {
+        KTX_ISSUE_HEADER_INVALID_SUPERCOMPRESSION, "Invalid supercompressionScheme: %#x"
+    };
+    issue InvalidOptionalIndexEntry {
+        KTX_ISSUE_HEADER_INVALID_OPTIONAL_INDEX_ENTRY, "Invalid %s index entry. Only 1 of offset & length != 0."
+    };
+    issue InvalidRequiredIndexEntry {
+        KTX_ISSUE_HEADER_INVALID_REQUIRED_INDEX_ENTRY, "Index for required entry has offset or length == 0."
+    };
+    issue InvalidDFDOffset {
+        KTX_ISSUE_HEADER_INVALID_DFD_OFFSET, "Invalid dfdByteOffset. DFD must immediately follow level index."
+    };
+    issue InvalidKVDOffset {
+        KTX_ISSUE_HEADER_INVALID_KVD_OFFSET, "Invalid kvdByteOffset. KVD must immediately follow DFD."
+    };
+    issue InvalidSGDOffset {
+        KTX_ISSUE_HEADER_INVALID_SGD_OFFSET, "Invalid sgdByteOffset. SGD must follow KVD."
+    };
+    issue TypeSizeMismatch {
+        KTX_ISSUE_HEADER_TYPE_SIZE_MISMATCH, "typeSize, %d, does not match data described by the DFD."
+    };
+    issue VkFormatAndBasis {
+        KTX_ISSUE_HEADER_VKFORMAT_AND_BASIS, "VkFormat must be VK_FORMAT_UNDEFINED for supercompressionScheme BASIS_LZ."
+    };
+    issue TypeSizeNotOne {
+        KTX_ISSUE_HEADER_TYPE_SIZE_NOT_ONE, "typeSize for a block compressed or supercompressed format must be 1."
+    };
+    issue ZeroLevelCountForBC {
+        KTX_ISSUE_HEADER_ZERO_LEVEL_COUNT_FOR_BC, "levelCount must be > 0 for block-compressed formats."
+    };
+} HeaderData;
+
+struct {
+    issue CreateDfdFailure {
+        KTX_ISSUE_VALIDATOR_CREATE_DFD_FAILURE, "Creation of DFD matching %s failed."
+    };
+    issue IncorrectDfd {
+        KTX_ISSUE_VALIDATOR_INCORRECT_DFD, "DFD created for %s confused interpretDFD()."
+    };
+    issue DfdValidationFailure {
+        KTX_ISSUE_VALIDATOR_DFD_VALIDATION_FAILURE, "DFD validation passed a DFD which extactFormatInfo() could not handle."
+    };
+} ValidatorError;
+
+struct {
+    issue InvalidTransferFunction {
+        KTX_ISSUE_DFD_INVALID_TRANSFER_FUNCTION, "Transfer function is not KHR_DF_TRANSFER_LINEAR or KHR_DF_TRANSFER_SRGB"
+    };
+    issue IncorrectBasics {
+        KTX_ISSUE_DFD_INCORRECT_BASICS, "DFD format is not the correct type or version."
+    };
+    issue IncorrectModelForBlock {
+        KTX_ISSUE_DFD_INCORRECT_MODEL_FOR_BLOCK, "DFD color model is not that of a block-compressed texture."
+    };
+    issue MultiplePlanes {
+        KTX_ISSUE_DFD_MULTIPLE_PLANES, "DFD is for a multiplane format. These are not supported."
+    };
+    issue sRGBMismatch {
+        KTX_ISSUE_DFD_SRGB_MISMATCH, "DFD says sRGB but vkFormat is not an sRGB format."
+    };
+    issue UnsignedFloat {
+        KTX_ISSUE_DFD_UNSIGNED_FLOAT, "DFD says data is unsigned float but there are no such texture formats."
+    };
+    issue FormatMismatch {
+        KTX_ISSUE_DFD_FORMAT_MISMATCH, "DFD does not match VK_FORMAT w.r.t. sign, float or normalization."
+    };
+    issue ZeroSamples {
+        KTX_ISSUE_DFD_ZERO_SAMPLES, "DFD for a %s texture must have sample information."
+    };
+    issue TexelBlockDimensionZeroForUndefined {
+        KTX_ISSUE_DFD_TEXEL_BLOCK_DIMENSION_ZERO_FOR_UNDEFINED, "DFD texel block dimensions must be non-zero for non-supercompressed texture"
+                        " with VK_FORMAT_UNDEFINED."
+    };
+    issue FourDimensionalTexturesNotSupported {
+        KTX_ISSUE_DFD_4D_TEXTURES_NOT_SUPPORTED, "DFD texelBlockDimension3 is non-zero indicating an unsupported four-dimensional texture."
+    };
+    issue BytesPlane0Zero {
+        KTX_ISSUE_DFD_BYTES_PLANE0_ZERO, "DFD bytesPlane0 must be non-zero for non-supercompressed %s texture."
+    };
+    issue MultiplaneFormatsNotSupported {
+        KTX_ISSUE_DFD_MULTIPLANE_FORMATS_NOT_SUPPORTED, "DFD has non-zero value in bytesPlane[1-7] indicating unsupported multiplane format."
+    };
+    issue InvalidSampleCount {
+        KTX_ISSUE_DFD_INVALID_SAMPLE_COUNT, "DFD for a %s texture must have %s sample(s)."
+    };
+    issue IncorrectModelForBLZE {
+        KTX_ISSUE_DFD_INCORRECT_MODEL_FOR_BLZE, "DFD colorModel for BasisLZ/ETC1S must be KHR_DF_MODEL_ETC1S."
+    };
+    issue InvalidTexelBlockDimension {
+        KTX_ISSUE_DFD_INVALID_TEXEL_BLOCK_DIMENSION, "DFD texel block dimension must be %dx%d for %s textures."
+    };
+    issue NotUnsized {
+        KTX_ISSUE_DFD_NOT_UNSIZED, "DFD bytes/plane must be 0 for a supercompressed texture."
+    };
+    issue InvalidChannelForBLZE {
+        KTX_ISSUE_DFD_INVALID_CHANNEL_FOR_BLZE, "Only ETC1S_RGB (0), ETC1S_RRR (3), ETC1S_GGG (4) or ETC1S_AAA (15)"
+                        " channels allowed for BasisLZ/ETC1S textures."
+    };
+    issue InvalidBitOffsetForBLZE {
+        KTX_ISSUE_DFD_INVALID_BIT_OFFSET_FOR_BLZE, "DFD sample bitOffsets for BasisLZ/ETC1S textures must be 0 and 64."
+    };
+    issue InvalidBitLength {
+        KTX_ISSUE_DFD_INVALID_BIT_LENGTH, "DFD sample bitLength for %s textures must be %d."
+    };
+    issue InvalidLowerOrUpper {
+        KTX_ISSUE_DFD_INVALID_LOWER_OR_UPPER, "All DFD samples' sampleLower must be 0 and sampleUpper must be 0xFFFFFFFF for"
+                        "%s textures."
+    };
+    issue InvalidChannelForUASTC {
+        KTX_ISSUE_DFD_INVALID_CHANNEL_FOR_UASTC, "Only UASTC_RGB (0), UASTC_RGBA (3), UASTC_RRR (4) or UASTC_RRRG (5) channels"
+                        " allowed for UASTC textures."
+    };
+    issue InvalidBitOffsetForUASTC {
+        KTX_ISSUE_DFD_INVALID_BIT_OFFSET_FOR_UASTC, "DFD sample bitOffset for UASTC textures must be 0."
+    };
+    issue SizeMismatch {
+        KTX_ISSUE_DFD_SIZE_MISMATCH, "DFD totalSize differs from header's dfdByteLength."
+    };
+    issue InvalidColorModel {
+        KTX_ISSUE_DFD_INVALID_COLOR_MODEL, "DFD colorModel for non block-compressed textures must be RGBSDA."
+    };
+    issue MixedChannels {
+        KTX_ISSUE_DFD_MIXED_CHANNELS, "DFD has channels with differing flags, e.g. some float, some integer."
+    };
+    issue Multisample {
+        KTX_ISSUE_DFD_MULTISAMPLE, "DFD indicates multiple sample locations."
+    };
+    issue NonTrivialEndianness {
+        KTX_ISSUE_DFD_NON_TRIVIAL_ENDIANNESS, "DFD describes non little-endian data."
+    };
+    issue InvalidPrimaries {
+        KTX_ISSUE_DFD_INVALID_PRIMARIES, "DFD primaries value, %d, is invalid."
+    };
+    issue SampleCountMismatch {
+        KTX_ISSUE_DFD_SAMPLE_COUNT_MISMATCH, "DFD sample count %d differs from expected %d."
+    };
+    issue BytesPlane0Mismatch {
+        KTX_ISSUE_DFD_BYTES_PLANE0_MISMATCH, "DFD bytesPlane0 value %d differs from expected %d."
+    };
+    issue InvalidDescriptorBlockSize {
+        KTX_ISSUE_DFD_INVALID_DESCRIPTOR_BLOCK_SIZE, "DFD descriptorBlockSize, %d, is smaller than the basic descriptor block header."
+    };
+} DFD;
+
+struct {
+    issue IncorrectByteLength {
+        KTX_ISSUE_LEVEL_INDEX_INCORRECT_BYTE_LENGTH, "Level %d byteLength or uncompressedByteLength does not match expected value."
+    };
+    issue ByteOffsetTooSmall {
+        KTX_ISSUE_LEVEL_INDEX_BYTE_OFFSET_TOO_SMALL, "Level %d byteOffset is smaller than expected value."
+    };
+    issue IncorrectByteOffset {
+        KTX_ISSUE_LEVEL_INDEX_INCORRECT_BYTE_OFFSET, "Level %d byteOffset does not match expected value."
+    };
+    issue UnalignedOffset {
+        KTX_ISSUE_LEVEL_INDEX_UNALIGNED_OFFSET, "Level %d byteOffset is not aligned to required %d byte alignment."
+    };
+    issue ExtraPadding {
+        KTX_ISSUE_LEVEL_INDEX_EXTRA_PADDING, "Level %d has disallowed extra padding."
+    };
+    issue ZeroOffsetOrLength {
+        KTX_ISSUE_LEVEL_INDEX_ZERO_OFFSET_OR_LENGTH, "Level %d's byteOffset or byteLength is 0."
+    };
+    issue ZeroUncompressedLength {
+        KTX_ISSUE_LEVEL_INDEX_ZERO_UNCOMPRESSED_LENGTH, "Level %d's uncompressedByteLength is 0."
+    };
+    issue IncorrectLevelOrder {
+        KTX_ISSUE_LEVEL_INDEX_INCORRECT_LEVEL_ORDER, "Larger mip levels are before smaller."
+    };
+} LevelIndex;
+
+struct {
+    issue MissingNulTerminator {
+        KTX_ISSUE_METADATA_MISSING_NUL_TERMINATOR, "Required NUL terminator missing from metadata key beginning \"%5s\"."
+                        "Abandoning validation of individual metadata entries."
+    };
+    issue ForbiddenBOM1 {
+        KTX_ISSUE_METADATA_FORBIDDEN_BOM1, "Metadata key beginning \"%5s\" has forbidden BOM."
+    };
+    issue ForbiddenBOM2 {
+        KTX_ISSUE_METADATA_FORBIDDEN_BOM2, "Metadata key beginning \"%s\" has forbidden BOM."
+    };
+    issue InvalidStructure {
+        KTX_ISSUE_METADATA_INVALID_STRUCTURE, "Invalid metadata structure? keyAndValueByteLengths failed to total kvdByteLength"
+                        " after %d KV pairs."
+    };
+    issue MissingFinalPadding {
+        KTX_ISSUE_METADATA_MISSING_FINAL_PADDING, "Required valuePadding after last metadata value missing."
+    };
+    issue OutOfOrder {
+        KTX_ISSUE_METADATA_OUT_OF_ORDER, "Metadata keys are not sorted in codepoint order."
+    };
+    issue CustomMetadata {
+        KTX_ISSUE_METADATA_CUSTOM_METADATA, "Custom metadata \"%s\" found."
+    };
+    issue IllegalMetadata {
+        KTX_ISSUE_METADATA_ILLEGAL_METADATA, "Unrecognized metadata \"%s\" found with KTX or ktx prefix found."
+    };
+    issue ValueNotNulTerminated {
+        KTX_ISSUE_METADATA_VALUE_NOT_NUL_TERMINATED, "%s value missing encouraged NUL termination."
+    };
+    issue InvalidValue {
+        KTX_ISSUE_METADATA_INVALID_VALUE, "%s has invalid value."
+    };
+    issue NoRequiredKTXwriter {
+        KTX_ISSUE_METADATA_NO_REQUIRED_KTXWRITER, "No KTXwriter key. Required when KTXwriterScParams is present."
+    };
+    issue MissingValue {
+        KTX_ISSUE_METADATA_MISSING_VALUE, "Missing required value for \"%s\" key."
+    };
+    issue NotAllowed {
+        KTX_ISSUE_METADATA_NOT_ALLOWED, "\"%s\" key not allowed %s."
+    };
+    issue NoKTXwriter {
+        KTX_ISSUE_METADATA_NO_KTXWRITER, "No KTXwriter key. Writers are strongly urged to identify themselves via this."
+    };
+} Metadata;
+
+struct {
+    issue UnexpectedSupercompressionGlobalData {
+        KTX_ISSUE_SGD_UNEXPECTED_SUPERCOMPRESSION_GLOBAL_DATA, "Supercompression global data found scheme that is not Basis."
+    };
+    issue MissingSupercompressionGlobalData {
+        KTX_ISSUE_SGD_MISSING_SUPERCOMPRESSION_GLOBAL_DATA, "Basis supercompression global data missing."
+    };
+    issue InvalidImageFlagBit {
+        KTX_ISSUE_SGD_INVALID_IMAGE_FLAG_BIT, "Basis supercompression global data imageDesc.imageFlags has an invalid bit set."
+    };
+    issue IncorrectGlobalDataSize {
+        KTX_ISSUE_SGD_INCORRECT_GLOBAL_DATA_SIZE, "Basis supercompression global data has incorrect size."
+    };
+    issue ExtendedByteLengthNotZero {
+        KTX_ISSUE_SGD_EXTENDED_BYTE_LENGTH_NOT_ZERO, "extendedByteLength != 0 in Basis supercompression global data."
+    };
+    issue DfdMismatchAlpha {
+        KTX_ISSUE_SGD_DFD_MISMATCH_ALPHA, "supercompressionGlobalData indicates no alpha but DFD indicates alpha channel."
+    };
+    issue DfdMismatchNoAlpha {
+        KTX_ISSUE_SGD_DFD_MISMATCH_NO_ALPHA, "supercompressionGlobalData indicates an alpha channel but DFD indicates no alpha channel."
+    };
+} SGD;
+
+struct {
+    issue OutOfMemory {
+        KTX_ISSUE_SYSTEM_OUT_OF_MEMORY, "System out of memory."
+    };
+} System;
+
+struct {
+    issue Failure {
+        KTX_ISSUE_TRANSCODE_FAILURE, "Transcode of BasisU payload failed: %s"
+    };
+} Transcode;
+
+/////////////////////////////////////////////////////////////////////
+//                      Define Useful Exceptions                   //
+/////////////////////////////////////////////////////////////////////
+
+class fatal : public runtime_error {
+  public:
+    fatal()
+        : runtime_error("Aborting validation.") { }
+};
+
+// Thrown when the callback asks for validation to stop.
+class stop_validation : public runtime_error {
+  public:
+    stop_validation()
+        : runtime_error("Validation stopped by callback.") { }
+};
+
+/////////////////////////////////////////////////////////////////////
+//                      Define Helpful Functions                   //
+/////////////////////////////////////////////////////////////////////
+
+// Increase nbytes to make it a multiple of n. Works for any n.
+size_t padn(uint32_t n, size_t nbytes) {
+    return (size_t)(n * ceilf((float)nbytes / n));
+}
+
+// Calculate number of bytes to add to nbytes to make it a multiple of n.
+// Works for any n.
+uint32_t padn_len(uint32_t n, size_t nbytes) {
+    return (uint32_t)((n * ceilf((float)nbytes / n)) - nbytes);
+}
+
+/////////////////////////////////////////////////////////////////////
+//                        A RAIIfied ktxTexture.                   //
+/////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class KtxTexture final
+{
+public:
+    KtxTexture(std::nullptr_t null = nullptr)
+        : _handle{nullptr}
+    {
+        (void)null;
+    }
+
+    KtxTexture(T* handle)
+        : _handle{handle}
+    {
+    }
+
+    KtxTexture(const KtxTexture&) = delete;
+    KtxTexture &operator=(const KtxTexture&) = delete;
+
+    KtxTexture(KtxTexture&& toMove)
+        : _handle{toMove._handle}
+    {
+        toMove._handle = nullptr;
+    }
+
+    KtxTexture &operator=(KtxTexture&& toMove)
+    {
+        _handle = toMove._handle;
+        toMove._handle = nullptr;
+        return *this;
+    }
+
+    ~KtxTexture()
+    {
+        if (_handle)
+        {
+            ktxTexture_Destroy(handle<ktxTexture>()); _handle = nullptr;
+        }
+    }
+
+    template <typename U = T>
+    inline U* handle() const
+    {
+        return reinterpret_cast<U*>(_handle);
+    }
+
+    template <typename U = T>
+    inline U** pHandle()
+    {
+        return reinterpret_cast<U**>(&_handle);
+    }
+
+    inline operator T*() const
+    {
+        return _handle;
+    }
+
+private:
+    T* _handle;
+};
+/////////////////////////////////////////////////////////////////////
+//                    Validator Class Definition                   //
+/////////////////////////////////////////////////////////////////////
+
+class ktxValidator {
+  public:
+    ktxValidator(PFNKTXVALIDATECALLBACK callback, void* userdata,
+                 ktxThreadPool* transcodePool) {
+        this->callback = callback;
+        this->userdata = userdata;
+        this->transcodePool = transcodePool;
+    }
+
+    KTX_error_code validate(const uint8_t* data, size_t size,
+                            ktxValidateFlags flags);
+
+  protected:
+    // Counts the issues found and passes them to the application's callback.
+    class logger {
+      public:
+        logger() {
+            callback = nullptr;
+            userdata = nullptr;
+            errorCount = 0;
+            warningCount = 0;
+        }
+        enum severity {
+            eWarning = KTX_VALIDATION_WARNING,
+            eError = KTX_VALIDATION_ERROR,
+            eFatal = KTX_VALIDATION_FATAL
+        };
+        template<typename ... Args>
+        void addIssue(severity severity, issue issue, Args ... args);
+        PFNKTXVALIDATECALLBACK callback;
+        void* userdata;
+        uint32_t errorCount;    // Includes fatal issues.
+        uint32_t warningCount;
+    };
+
+    struct validationContext {
+        logger log;
+        const uint8_t* data;
+        size_t size;
+        size_t offset;      // Of the next byte to read.
+        KTX_header2 header;
+        size_t levelIndexSize;
+        uint32_t layerCount;
+        uint32_t levelCount;
+        uint32_t dimensionCount;
+        uint32_t* pDfd4Format;
+        uint32_t* pActualDfd;
+        uint64_t dataSizeFromLevelIndex;
+        bool cubemapIncompleteFound;
+
+        struct formatInfo {
+            struct {
+                uint32_t x;
+                uint32_t y;
+                uint32_t z;
+            } blockDimension;
+            uint32_t wordSize;
+            uint32_t blockByteLength;
+            bool isBlockCompressed;
+        } formatInfo;
+
+        validationContext() {
+            data = nullptr;
+            size = 0;
+            offset = 0;
+            pDfd4Format = nullptr;
+            pActualDfd = nullptr;
+            cubemapIncompleteFound = false;
+            dataSizeFromLevelIndex = 0;
+        }
+
+        ~validationContext() {
+            if (pDfd4Format != nullptr) free(pDfd4Format);
+            if (pActualDfd != nullptr) delete[] pActualDfd;
+        }
+
+        size_t kvDataEndOffset() {
+            return sizeof(KTX_header2) + levelIndexSize
+                   + header.dataFormatDescriptor.byteLength
+                   + header.keyValueData.byteLength;
+        }
+
+        size_t calcImageSize(uint32_t level) {
+            struct blockCount {
+                uint32_t x, y;
+            } blockCount;
+
+            float levelWidth  = (float)(header.pixelWidth >> level);
+            float levelHeight = (float)(header.pixelHeight >> level);
+            // Round up to next whole block.
+            blockCount.x
+				= (uint32_t)ceilf(levelWidth / formatInfo.blockDimension.x);
+            blockCount.y
+				= (uint32_t)ceilf(levelHeight / formatInfo.blockDimension.y);
+            blockCount.x = MAX(1, blockCount.x);
+            blockCount.y = MAX(1, blockCount.y);
+
+            return blockCount.x * blockCount.y * formatInfo.blockByteLength;
+        }
+
+        size_t calcLayerSize(uint32_t level) {
+            /*
+             * As there are no 3D cubemaps, the image's z block count will always be
+             * 1 for cubemaps and numFaces will always be 1 for 3D textures so the
+             * multiply is safe. 3D cubemaps, if they existed, would require
+             * imageSize * (blockCount.z + This->numFaces);
+             */
+            uint32_t blockCountZ;
+            size_t imageSize, layerSize;
+
+            float levelDepth = (float)(header.pixelDepth >> level);
+            blockCountZ
+				= (uint32_t)ceilf(levelDepth / formatInfo.blockDimension.z);
+            blockCountZ = MAX(1, blockCountZ);
+            imageSize = calcImageSize(level);
+            layerSize = imageSize * blockCountZ;
+            return layerSize * header.faceCount;
+        }
+
+        // Recursive function to return the greatest common divisor of a and b.
+        uint32_t gcd(uint32_t a, uint32_t b) {
+            if (a == 0)
+                return b;
+            return gcd(b % a, a);
+        }
+
+        // Function to return the least common multiple of a & 4.
+        uint32_t lcm4(uint32_t a)
+        {
+            if (a == 0)
+                return 4;  // Format info unknown. Avoid dividing by 0.
+            if (!(a & 0x03))
+                return a;  // a is a multiple of 4.
+            return (a*4) / gcd(a, 4);
+        }
+
+        size_t calcLevelOffset(uint32_t level) {
+            // This function is only useful when the following 2 conditions
+            // are met as otherwise we have no idea what the size of a level
+            // ought to be.
+            assert (header.vkFormat != VK_FORMAT_UNDEFINED);
+            assert (header.supercompressionScheme == KTX_SS_NONE);
+
+            assert (level < levelCount);
+            // Calculate the expected base offset in the file
+            size_t levelOffset = kvDataEndOffset();
+            levelOffset
+                  = padn(lcm4(formatInfo.blockByteLength), levelOffset);
+            for (uint32_t i = levelCount - 1; i > level; i--) {
+                size_t levelSize;
+                levelSize = calcLevelSize(i);
+                levelOffset
+                    += padn(lcm4(formatInfo.blockByteLength), levelSize);
+            }
+            return levelOffset;
+        }
+
+        size_t calcLevelSize(uint32_t level)
+        {
+            return calcLayerSize(level) * layerCount;
+        }
+
+        bool extractFormatInfo(uint32_t* dfd) {
+            uint32_t* bdb = dfd + 1;
+            struct formatInfo& fi = formatInfo;
+            fi.blockDimension.x = KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION0) + 1;
+            fi.blockDimension.y = KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION1) + 1;
+            fi.blockDimension.z = KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION2) + 1;
+            fi.blockByteLength = KHR_DFDVAL(bdb, BYTESPLANE0);
+            if (KHR_DFDVAL(bdb, MODEL) >= KHR_DF_MODEL_DXT1A) {
+                // A block compressed format. Entire block is a single sample.
+                fi.isBlockCompressed = true;
+            } else {
+                // An uncompressed format.
+                InterpretedDFDChannel r, g, b, a;
+                InterpretDFDResult result;
+
+                fi.isBlockCompressed = false;
+                result = interpretDFD(dfd, &r, &g, &b, &a, &fi.wordSize);
+                if (result > i_UNSUPPORTED_ERROR_BIT)
+                    return false;
+            }
+            return true;
+        }
+
+        uint32_t requiredLevelAlignment() {
+            if (header.supercompressionScheme != KTX_SS_NONE)
+                return 1;
+            else
+                return lcm4(formatInfo.blockByteLength);
+        }
+
+        //
+        // This KTX-specific function adds support for combined depth stencil
+        // formats which are not supported by @e dfdutils' @c vk2dfd function
+        // because they are not seen outside a Vulkan device. KTX has its own
+        // definitions for these.
+        //
+        void createDfd4Format()
+        {
+            switch(header.vkFormat) {
+              case VK_FORMAT_D16_UNORM_S8_UINT:
+                // 2 16-bit words. D16 in the first. S8 in the 8 LSBs of the second.
+                pDfd4Format = createDFDDepthStencil(16, 8, 4);
+                break;
+              case VK_FORMAT_D24_UNORM_S8_UINT:
+                // 1 32-bit word. D24 in the MSBs. S8 in the LSBs.
+                pDfd4Format = createDFDDepthStencil(24, 8, 4);
+                break;
+              case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                // 2 32-bit words. D32 float in the first word. S8 in LSBs of the
+                // second.
+                pDfd4Format = createDFDDepthStencil(32, 8, 8);
+                break;
+              default:
+                pDfd4Format = vk2dfd((VkFormat)header.vkFormat);
+            }
+        }
+
+        void init(const uint8_t* bytes, size_t byteLength) {
+            if (pDfd4Format != nullptr) free(pDfd4Format);
+            pDfd4Format = nullptr;
+            data = bytes;
+            size = byteLength;
+            offset = 0;
+            dataSizeFromLevelIndex = 0;
+        }
+
+        // Copy the next n bytes to dst. Returns false if there are fewer.
+        bool read(void* dst, size_t n) {
+            if (offset > size || n > size - offset)
+                return false;
+            memcpy(dst, data + offset, n);
+            offset += n;
+            return true;
+        }
+
+        // Move read point from offset to next multiple of alignment bytes.
+        // As with seeking a stream, the read point may move past the end of
+        // the data. validateDataSize reports that.
+        void skipPadding(uint32_t alignment) {
+            offset += padn_len(alignment, offset);
+        }
+    };
+
+    // Using template because having a struct as last arg before the
+    // variable args when using va_start etc. is non-portable.
+    template <typename ... Args>
+    void addIssue(validationContext& ctx, logger::severity severity,
+                  issue issue, Args ... args)
+    {
+        ctx.log.addIssue(severity, issue, args...);
+    }
+    // Raise a fatal issue if fewer than n bytes remain. Called before
+    // allocating space for data whose length comes from the file.
+    void checkAvailable(validationContext& ctx, uint64_t n) {
+        if (ctx.offset > ctx.size || n > ctx.size - ctx.offset)
+            addIssue(ctx, logger::eFatal, IOError.UnexpectedEOF);
+    }
+    void read(validationContext& ctx, void* dst, size_t n) {
+        if (!ctx.read(dst, n))
+            addIssue(ctx, logger::eFatal, IOError.UnexpectedEOF);
+    }
+    void validateHeader(validationContext& ctx);
+    void validateLevelIndex(validationContext& ctx);
+    void validateDfd(validationContext& ctx);
+    void validateKvd(validationContext& ctx);
+    void validateSgd(validationContext& ctx);
+    void validateDataSize(validationContext& ctx);
+    bool validateTranscode(validationContext& ctx); // Must be called last.
+    bool validateMetadata(validationContext& ctx, const char* key,
+                          const uint8_t* value, uint32_t valueLen);
+
+    typedef void (ktxValidator::*validateMetadataFunc)(validationContext& ctx,
+                                                       const char* key,
+                                                       const uint8_t* value,
+                                                       uint32_t valueLen);
+    void validateCubemapIncomplete(validationContext& ctx, const char* key,
+                                   const uint8_t* value, uint32_t valueLen);
+    void validateOrientation(validationContext& ctx, const char* key,
+                             const uint8_t* value, uint32_t valueLen);
+    void validateGlFormat(validationContext& ctx, const char* key,
+                          const uint8_t* value, uint32_t valueLen);
+    void validateDxgiFormat(validationContext& ctx, const char* key,
+                            const uint8_t* value, uint32_t valueLen);
+    void validateMetalPixelFormat(validationContext& ctx, const char* key,
+                                  const uint8_t* value, uint32_t valueLen);
+    void validateSwizzle(validationContext& ctx, const char* key,
+                        const uint8_t* value, uint32_t valueLen);
+    void validateWriter(validationContext& ctx, const char* key,
+                        const uint8_t* value, uint32_t valueLen);
+    void validateWriterScParams(validationContext& ctx, const char* key,
+                                const uint8_t* value, uint32_t valueLen);
+    void validateAstcDecodeMode(validationContext& ctx, const char* key,
+                                const uint8_t* value, uint32_t valueLen);
+    void validateAnimData(validationContext& ctx, const char* key,
+                          const uint8_t* value, uint32_t valueLen);
+
+    typedef struct {
+        string name;
+        validateMetadataFunc validateFunc;
+    } metadataValidator;
+    static vector<metadataValidator> metadataValidators;
+
+
+    PFNKTXVALIDATECALLBACK callback;
+    void* userdata;
+    // NULL to transcode on the calling thread.
+    ktxThreadPool* transcodePool;
+};
+
+vector<ktxValidator::metadataValidator> ktxValidator::metadataValidators {
+    // cubemapIncomplete must appear in this list before animData.
+    { "KTXcubemapIncomplete", &ktxValidator::validateCubemapIncomplete },
+    { "KTXorientation", &ktxValidator::validateOrientation },
+    { "KTXglFormat", &ktxValidator::validateGlFormat },
+    { "KTXdxgiFormat__", &ktxValidator::validateDxgiFormat },
+    { "KTXmetalPixelFormat", &ktxValidator::validateMetalPixelFormat },
+    { "KTXswizzle", &ktxValidator::validateSwizzle },
+    { "KTXwriter", &ktxValidator::validateWriter },
+    { "KTXwriterScParams", &ktxValidator::validateWriterScParams },
+    { "KTXastcDecodeMode", &ktxValidator::validateAstcDecodeMode },
+    { "KTXanimData", &ktxValidator::validateAnimData }
+};
+
+/////////////////////////////////////////////////////////////////////
+//                     Validator Implementation                    //
+/////////////////////////////////////////////////////////////////////
+
+void
+streamout(stringstream& oss, const char* s, int length)
+{
+    // Can't find a way to get stringstream to truncate a stream.
+    if (length != 0)
+        oss.write(s, length);
+    else
+        oss << s;
+}
+
+template <typename T>
+void streamout(stringstream&oss, T value, int)
+{
+    oss << value;
+}
+
+void
+sprintf(stringstream& oss, const string& fmt)
+{
+    for (auto it = fmt.cbegin() ; it != fmt.cend(); ++it) {
+        if (*it == '%' && *++it != '%')
+            throw std::runtime_error("invalid format string: missing arguments");
+        oss << *it;
+    }
+}
+
+// Does not support repordering of arguments which would be needed for
+// multi-language support. Don't know how to do that with variadic templates.
+template <typename T, typename ... Args>
+void
+sprintf(stringstream& oss, const string& fmt, T value, Args ... args)
+{
+    for (size_t pos = 0; pos < fmt.size(); pos++) {
+        if (fmt[pos] == '%' && fmt[++pos] != '%') {
+            bool alternateForm = false;
+            // Find the format character
+            size_t fpos = fmt.find_first_of("diouXxfFeEgGaAcsb", pos);
+            for (; pos < fpos; pos++) {
+                switch (fmt[pos]) {
+                  case '#':
+                    alternateForm = true;
+                    continue;
+                  case '-':
+                    oss << left;
+                    continue;
+                  case '+':
+                    oss << showpos;
+                    continue;
+                  case ' ':
+                    continue;
+                  case '0':
+                    if (!(oss.flags() & oss.left))
+                        oss << setfill('0');
+                    continue;
+                  default:
+                    break;
+                }
+                break;
+            }
+            try {
+                size_t afterpos;
+                int width = stoi(fmt.substr(pos, fpos - pos), &afterpos);
+                oss << setw(width);
+                pos += afterpos;
+            } catch (invalid_argument& e) {
+                (void)e;
+            }
+            int precision = 0;
+            if (fmt[pos] == '.') try {
+                size_t afterpos;
+                ++pos;
+                precision = stoi(fmt.substr(pos, fpos - pos), &afterpos);
+                if (!std::is_same<T, const char*>::value) {
+                     oss << setprecision(precision);
+                     precision = 0;
+                }
+                pos += afterpos;
+            } catch (invalid_argument& e) {
+                throw std::runtime_error("Expected precision value in sprintf");
+                (void)e;
+            }
+            if (fmt[pos] == 'x' || fmt[pos] == 'X') {
+                oss << hex;
+                if (alternateForm) oss << showbase;
+            }
+            // Having another function call sucks. See streamout for the reason.
+            streamout(oss, value, precision);
+            return sprintf(oss, fmt.substr(++pos), args...);
+        }
+        oss << fmt[pos];
+    }
+    throw std::runtime_error("extra arguments provided to sprintf");
+}
+// Why is severity passed here?
+// -  Because it is convenient when browsing the code to see the severity
+//    at the place an issue is raised.
+
+template<typename ... Args>
+void
+ktxValidator::logger::addIssue(severity severity, issue issue, Args ... args)
+{
+    assert((issue.code & KTX_ISSUE_SEVERITY_MASK)
+           == (severity == eWarning ? KTX_ISSUE_WARNING_BIT
+               : severity == eError ? KTX_ISSUE_ERROR_BIT
+               : KTX_ISSUE_FATAL_BIT));
+    if (severity == eWarning)
+        warningCount++;
+    else
+        errorCount++;
+    if (callback) {
+        std::stringstream oss;
+        sprintf(oss, issue.message, args...);
+        if (!callback((ktxValidationSeverity)severity, issue.code,
+                      oss.str().c_str(), userdata)
+            && severity != eFatal)
+            throw stop_validation();
+    }
+    if (severity == eFatal)
+        throw fatal();
+}
+
+KTX_error_code
+ktxValidator::validate(const uint8_t* data, size_t size,
+                       ktxValidateFlags flags)
+{
+    validationContext context;
+
+    context.log.callback = callback;
+    context.log.userdata = userdata;
+    try {
+        context.init(data, size);
+        validateHeader(context);
+        validateLevelIndex(context);
+        // DFD is validated from within validateLevelIndex.
+        validateKvd(context);
+        if (context.header.supercompressionGlobalData.byteLength > 0)
+            context.skipPadding(8);
+        validateSgd(context);
+        context.skipPadding(context.requiredLevelAlignment());
+        validateDataSize(context);
+        if (flags & KTX_VALIDATE_TRANSCODE_BIT)
+            validateTranscode(context);
+    } catch (fatal&) {
+    } catch (stop_validation&) {
+    } catch (bad_alloc&) {
+        return KTX_OUT_OF_MEMORY;
+    } catch (...) {
+        // Nothing may escape to the C caller. Anything else reaching here,
+        // e.g. a runtime_error from sprintf, is a failure of the validator
+        // not of the file.
+        return KTX_INVALID_OPERATION;
+    }
+    return context.log.errorCount > 0 ? KTX_FILE_DATA_ERROR : KTX_SUCCESS;
+}
+
+void
+ktxValidator::validateHeader(validationContext& ctx)
+{
+    ktx_uint8_t identifier_reference[12] = KTX2_IDENTIFIER_REF;
+    ktx_uint32_t max_dim;
+
+    read(ctx, &ctx.header, sizeof(KTX_header2));
+
+    // Is this a KTX2 file?
+    if (memcmp(&ctx.header.identifier, identifier_reference, 12) != 0) {
+        addIssue(ctx, logger::eFatal, FileError.NotKTX2);
+    }
+
+    if (isProhibitedFormat((VkFormat)ctx.header.vkFormat))
+        addIssue(ctx, logger::eError, HeaderData.ProhibitedFormat);
+
+    if (!isValidFormat((VkFormat)ctx.header.vkFormat)) {
+        if (ctx.header.vkFormat <= VK_FORMAT_MAX_STANDARD_ENUM || ctx.header.vkFormat > 0x10010000)
+            addIssue(ctx, logger::eError, HeaderData.InvalidFormat, ctx.header.vkFormat);
+        else
+            addIssue(ctx, logger::eError, HeaderData.UnknownFormat, ctx.header.vkFormat);
+    }
+
+    /* Check texture dimensions. KTX files can store 8 types of textures:
+       1D, 2D, 3D, cube, and array variants of these. There is currently
+       no extension for 3D array textures in any 3D API. */
+    if (ctx.header.pixelWidth == 0)
+        addIssue(ctx, logger::eError, HeaderData.WidthZero);
+
+    if (ctx.header.pixelDepth > 0 && ctx.header.pixelHeight == 0)
+        addIssue(ctx, logger::eError, HeaderData.DepthNoHeight);
+
+    if (ctx.header.pixelDepth > 0)
+    {
+        if (ctx.header.layerCount > 0) {
+            /* No 3D array textures yet. */
+            addIssue(ctx, logger::eWarning, HeaderData.ThreeDArray);
+        } else
+            ctx.dimensionCount = 3;
+    }
+    else if (ctx.header.pixelHeight > 0)
+    {
+        ctx.dimensionCount = 2;
+    }
+    else
+    {
+        ctx.dimensionCount = 1;
+    }
+
+    if (ctx.header.faceCount == 6)
+    {
+        if (ctx.dimensionCount != 2)
+        {
+            /* cube map needs 2D faces */
+            addIssue(ctx, logger::eError, HeaderData.CubeFaceNot2d);
+        }
+    }
+    else if (ctx.header.faceCount != 1)
+    {
+        /* numberOfFaces must be either 1 or 6 */
+        addIssue(ctx, logger::eError, HeaderData.InvalidFaceCount,
+                 ctx.header.faceCount);
+    }
+
+    // Check number of mipmap levels
+    ctx.levelCount = MAX(ctx.header.levelCount, 1);
+
+    // This test works for arrays too because height or depth will be 0.
+    max_dim = MAX(MAX(ctx.header.pixelWidth, ctx.header.pixelHeight), ctx.header.pixelDepth);
+    if (max_dim < ((ktx_uint32_t)1 << (ctx.levelCount - 1)))
+    {
+        // Can't have more mip levels than 1 + log2(max(width, height, depth))
+        addIssue(ctx, logger::eError, HeaderData.TooManyMipLevels,
+                 ctx.levelCount, max_dim);
+    }
+
+    // Set layerCount to actual number of layers.
+    ctx.layerCount = MAX(ctx.header.layerCount, 1);
+
+    if (ctx.header.supercompressionScheme > KTX_SS_BEGIN_VENDOR_RANGE
+        && ctx.header.supercompressionScheme < KTX_SS_END_VENDOR_RANGE)
+    {
+        addIssue(ctx, logger::eWarning, HeaderData.VendorSupercompression);
+    } else if (ctx.header.supercompressionScheme < KTX_SS_BEGIN_RANGE
+        || ctx.header.supercompressionScheme > KTX_SS_END_RANGE)
+    {
+        addIssue(ctx, logger::eError, HeaderData.InvalidSupercompression,
+                 ctx.header.supercompressionScheme);
+    }
+
+    if (ctx.header.vkFormat != VK_FORMAT_UNDEFINED) {
+        if (ctx.header.supercompressionScheme != KTX_SS_BASIS_LZ) {
+            ctx.createDfd4Format();
+            if (ctx.pDfd4Format == nullptr) {
+                addIssue(ctx, logger::eFatal, ValidatorError.CreateDfdFailure,
+                         vkFormatString((VkFormat)ctx.header.vkFormat));
+            } else if (!ctx.extractFormatInfo(ctx.pDfd4Format)) {
+                addIssue(ctx, logger::eError, ValidatorError.IncorrectDfd,
+                         vkFormatString((VkFormat)ctx.header.vkFormat));
+            }
+
+            if (ctx.formatInfo.isBlockCompressed) {
+                if (ctx.header.typeSize != 1)
+                    addIssue(ctx, logger::eError, HeaderData.TypeSizeNotOne);
+                if (ctx.header.levelCount == 0)
+                    addIssue(ctx, logger::eError, HeaderData.ZeroLevelCountForBC);
+            } else {
+                if (ctx.header.typeSize != ctx.formatInfo.wordSize)
+                     addIssue(ctx, logger::eError, HeaderData.TypeSizeMismatch,
+                              ctx.header.typeSize);
+            }
+        } else {
+            addIssue(ctx, logger::eError, HeaderData.VkFormatAndBasis);
+        }
+    } else {
+        if (ctx.header.typeSize != 1)
+            addIssue(ctx, logger::eError, HeaderData.TypeSizeNotOne);
+    }
+
+#define checkRequiredIndexEntry(index, issue, name)     \
+    if (index.byteOffset == 0 || index.byteLength == 0) \
+        addIssue(ctx, logger::eError, issue, name)
+
+#define checkOptionalIndexEntry(index, issue, name)     \
+    if (!index.byteOffset != !index.byteLength)         \
+        addIssue(ctx, logger::eError, issue, name)
+
+    checkRequiredIndexEntry(ctx.header.dataFormatDescriptor,
+                    HeaderData.InvalidRequiredIndexEntry, "dfd");
+
+    checkOptionalIndexEntry(ctx.header.keyValueData,
+                    HeaderData.InvalidOptionalIndexEntry, "kvd");
+
+    if (ctx.header.supercompressionScheme == KTX_SS_BASIS_LZ) {
+        checkRequiredIndexEntry(ctx.header.supercompressionGlobalData,
+                                HeaderData.InvalidRequiredIndexEntry, "sgd");
+    } else {
+        checkOptionalIndexEntry(ctx.header.supercompressionGlobalData,
+                                HeaderData.InvalidOptionalIndexEntry, "sgd");
+    }
+
+    ctx.levelIndexSize = sizeof(ktxLevelIndexEntry) * ctx.levelCount;
+    uint64_t offset = KTX2_HEADER_SIZE + ctx.levelIndexSize;
+    if (offset != ctx.header.dataFormatDescriptor.byteOffset)
+        addIssue(ctx, logger::eError, HeaderData.InvalidDFDOffset);
+    offset += ctx.header.dataFormatDescriptor.byteLength;
+
+    if (ctx.header.keyValueData.byteOffset != 0) {
+        if (offset != ctx.header.keyValueData.byteOffset)
+            addIssue(ctx, logger::eError, HeaderData.InvalidKVDOffset);
+        offset += ctx.header.keyValueData.byteLength;
+        if (ctx.header.supercompressionGlobalData.byteOffset != 0)
+            // Pad before SGD.
+            offset = padn(8, offset);
+    }
+
+    if (ctx.header.supercompressionGlobalData.byteOffset != 0) {
+        if (offset != ctx.header.supercompressionGlobalData.byteOffset)
+            addIssue(ctx, logger::eError, HeaderData.InvalidSGDOffset);
+    }
+}
+
+void
+ktxValidator::validateLevelIndex(validationContext& ctx)
+{
+    checkAvailable(ctx, ctx.levelIndexSize);
+    vector<ktxLevelIndexEntry> levelIndex(ctx.levelCount);
+    read(ctx, levelIndex.data(), ctx.levelIndexSize);
+
+    validateDfd(ctx);
+    if (!ctx.pDfd4Format) {
+        // VK_FORMAT_UNDEFINED so we have to get info from the actual DFD.
+        // Not hugely robust but validateDfd does check known undefineds such
+        // as UASTC.
+        if (!ctx.extractFormatInfo(ctx.pActualDfd)) {
+            addIssue(ctx, logger::eError, ValidatorError.DfdValidationFailure);
+        }
+    }
+
+    uint32_t requiredLevelAlignment = ctx.requiredLevelAlignment();
+    size_t expectedOffset = 0;
+    size_t lastByteLength = 0;
+    switch (ctx.header.supercompressionScheme) {
+      case KTX_SS_NONE:
+      case KTX_SS_ZSTD:
+        expectedOffset = padn(requiredLevelAlignment, ctx.kvDataEndOffset());
+        break;
+      case KTX_SS_BASIS_LZ:
+        ktxIndexEntry64 sgdIndex = ctx.header.supercompressionGlobalData;
+        // No padding here.
+        expectedOffset = sgdIndex.byteOffset + sgdIndex.byteLength;
+        break;
+    }
+    expectedOffset = padn(requiredLevelAlignment, expectedOffset);
+    // Last mip level is first in the file. Count down so we can check the
+    // distance between levels for the UNDEFINED and SUPERCOMPRESSION cases.
+    for (int32_t level = ctx.levelCount-1; level >= 0; level--) {
+        if (ctx.header.vkFormat != VK_FORMAT_UNDEFINED
+            && ctx.header.supercompressionScheme == KTX_SS_NONE) {
+            if (levelIndex[level].uncompressedByteLength !=
+                ctx.calcLevelSize(level))
+                addIssue(ctx, logger::eError, LevelIndex.IncorrectByteLength, level);
+
+            if (levelIndex[level].byteLength !=
+                levelIndex[level].uncompressedByteLength)
+                addIssue(ctx, logger::eError, LevelIndex.IncorrectByteLength, level);
+
+            ktx_size_t expectedByteOffset = ctx.calcLevelOffset(level);
+            if (levelIndex[level].byteOffset != expectedByteOffset) {
+                if (levelIndex[level].byteOffset % requiredLevelAlignment != 0)
+                    addIssue(ctx, logger::eError, LevelIndex.UnalignedOffset,
+                             level, requiredLevelAlignment);
+                if (levelIndex[level].byteOffset > expectedByteOffset)
+                    addIssue(ctx, logger::eError, LevelIndex.ExtraPadding, level);
+                else
+                    addIssue(ctx, logger::eError, LevelIndex.ByteOffsetTooSmall,
+                             level);
+            }
+        } else {
+            // Can only do minimal validation as we have no idea what the
+            // level sizes are so we have to trust the byteLengths. We do
+            // at least know where the first level must be in the file and
+            // we can calculate how much padding, if any, there must be
+            // between levels.
+            if (levelIndex[level].byteLength == 0
+                || levelIndex[level].byteOffset == 0) {
+                 addIssue(ctx, logger::eError, LevelIndex.ZeroOffsetOrLength, level);
+                 continue;
+            }
+            if (levelIndex[level].byteOffset != expectedOffset) {
+                addIssue(ctx, logger::eError,
+                         LevelIndex.IncorrectByteOffset,
+                         level);
+            }
+            if (ctx.header.supercompressionScheme == KTX_SS_NONE) {
+                if (levelIndex[level].byteLength < lastByteLength)
+                    addIssue(ctx, logger::eError, LevelIndex.IncorrectLevelOrder);
+                if (levelIndex[level].byteOffset % requiredLevelAlignment != 0)
+                    addIssue(ctx, logger::eError, LevelIndex.UnalignedOffset,
+                             level, requiredLevelAlignment);
+                if (levelIndex[level].uncompressedByteLength == 0) {
+                    addIssue(ctx, logger::eError, LevelIndex.ZeroUncompressedLength,
+                             level);
+                }
+                lastByteLength = levelIndex[level].byteLength;
+            }
+            expectedOffset += padn(requiredLevelAlignment,
+                                   levelIndex[level].byteLength);
+        }
+        ctx.dataSizeFromLevelIndex += padn(ctx.requiredLevelAlignment(),
+                                           levelIndex[level].byteLength);
+    }
+}
+
+void
+ktxValidator::validateDfd(validationContext& ctx)
+{
+    if (ctx.header.dataFormatDescriptor.byteLength == 0)
+        return;
+
+    // We are right after the levelIndex. We've already checked that
+    // header.dataFormatDescriptor.byteOffset points to this location.
+    uint32_t dfdByteLength = ctx.header.dataFormatDescriptor.byteLength;
+    checkAvailable(ctx, dfdByteLength);
+    // The checks below trust the descriptor block size and sample count in
+    // the DFD. Make the buffer large enough for the largest basic descriptor
+    // block a 16-bit descriptorBlockSize can describe, so a bogus DFD cannot
+    // cause reads past its end.
+    size_t dfdWords = MAX((dfdByteLength + 3) / sizeof(uint32_t),
+                          (1 + 0xffff + 3) / sizeof(uint32_t));
+    ctx.pActualDfd = new uint32_t[dfdWords]();
+    read(ctx, ctx.pActualDfd, dfdByteLength);
+
+    if (ctx.header.dataFormatDescriptor.byteLength != *ctx.pActualDfd)
+        addIssue(ctx, logger::eError, DFD.SizeMismatch);
+
+    uint32_t* bdb = ctx.pActualDfd + 1; // Basic descriptor block.
+
+    // The sample count is derived from descriptorBlockSize. Nothing
+    // further can be checked if that would underflow.
+    if (KHR_DFDVAL(bdb, DESCRIPTORBLOCKSIZE) < KHR_DF_WORD_SAMPLESTART * 4) {
+        addIssue(ctx, logger::eError, DFD.InvalidDescriptorBlockSize,
+                 KHR_DFDVAL(bdb, DESCRIPTORBLOCKSIZE));
+        return;
+    }
+
+    uint32_t xferFunc;
+    if ((xferFunc = KHR_DFDVAL(bdb, TRANSFER)) != KHR_DF_TRANSFER_SRGB
+        && xferFunc != KHR_DF_TRANSFER_LINEAR)
+        addIssue(ctx, logger::eError, DFD.InvalidTransferFunction);
+
+    bool analyze = false;
+    uint32_t numSamples = KHR_DFDSAMPLECOUNT(bdb);
+    switch (ctx.header.supercompressionScheme) {
+      case KTX_SS_NONE:
+      case KTX_SS_ZSTD:
+        if (ctx.header.vkFormat != VK_FORMAT_UNDEFINED) {
+            if (ctx.header.supercompressionScheme != KTX_SS_ZSTD) {
+                // Do a simple comparison with the expected DFD.
+                analyze = memcmp(ctx.pActualDfd, ctx.pDfd4Format,
+                                  *ctx.pDfd4Format);
+            } else {
+                // Compare up to BYTESPLANE.
+                analyze = memcmp(ctx.pActualDfd, ctx.pDfd4Format,
+                                  KHR_DF_WORD_BYTESPLANE0 * 4);
+                // Check for unsized.
+                if (bdb[KHR_DF_WORD_BYTESPLANE0]  != 0
+                    || bdb[KHR_DF_WORD_BYTESPLANE4]  != 0)
+                    addIssue(ctx, logger::eError, DFD.NotUnsized);
+                // Compare the sample information.
+                if (!analyze) {
+                    analyze = memcmp(&ctx.pActualDfd[KHR_DF_WORD_SAMPLESTART+1],
+                                    &ctx.pDfd4Format[KHR_DF_WORD_SAMPLESTART+1],
+                                    numSamples * KHR_DF_WORD_SAMPLEWORDS);
+                }
+            }
+        } else {
+            if (KHR_DFDVAL(bdb, MODEL) == KHR_DF_MODEL_UASTC) {
+                // Validate UASTC
+                if (numSamples == 0)
+                    addIssue(ctx, logger::eError, DFD.ZeroSamples, "UASTC");
+                if (numSamples > 1)
+                    addIssue(ctx, logger::eError, DFD.InvalidSampleCount,
+                             "UASTC", "1");
+                if (KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION0) != 3
+                    && KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION1) != 3
+                    && (bdb[KHR_DF_WORD_TEXELBLOCKDIMENSION0] & 0xffff0000) != 0)
+                    addIssue(ctx, logger::eError, DFD.InvalidTexelBlockDimension,
+                             4, 4, "UASTC");
+                uint32_t bytesPlane0 = KHR_DFDVAL(bdb, BYTESPLANE0);
+                if (ctx.header.supercompressionScheme == KTX_SS_NONE) {
+                    if (bytesPlane0 != 16) {
+                        addIssue(ctx, logger::eError, DFD.BytesPlane0Mismatch,
+                                 bytesPlane0, 16);
+                    }
+                } else {
+                     if (bytesPlane0 != 0) {
+                          addIssue(ctx, logger::eError, DFD.NotUnsized);
+                     }
+                }
+                uint8_t channelID = KHR_DFDSVAL(bdb, 0, CHANNELID);
+                if (channelID != KHR_DF_CHANNEL_UASTC_RGB
+                    && channelID != KHR_DF_CHANNEL_UASTC_RGBA
+                    && channelID != KHR_DF_CHANNEL_UASTC_RRR
+                    && channelID != KHR_DF_CHANNEL_UASTC_RRRG)
+                    addIssue(ctx, logger::eError, DFD.InvalidChannelForUASTC);
+                if (KHR_DFDSVAL(bdb, 0, BITOFFSET) != 0)
+                    addIssue(ctx, logger::eError, DFD.InvalidBitOffsetForUASTC);
+                if (KHR_DFDSVAL(bdb, 0, BITLENGTH) != 127)
+                    addIssue(ctx, logger::eError, DFD.InvalidBitLength,
+                             "UASTC", 127);
+                if (KHR_DFDSVAL(bdb, 0, SAMPLELOWER) != 0
+                    && KHR_DFDSVAL(bdb, 0, SAMPLEUPPER) != UINT32_MAX)
+                    addIssue(ctx, logger::eError, DFD.InvalidLowerOrUpper, "UASTC");
+            } else {
+                // Check the basics
+                if (KHR_DFDVAL(bdb, VENDORID) != KHR_DF_VENDORID_KHRONOS
+                    || KHR_DFDVAL(bdb, DESCRIPTORTYPE) != KHR_DF_KHR_DESCRIPTORTYPE_BASICFORMAT
+                    || KHR_DFDVAL(bdb, VERSIONNUMBER) < KHR_DF_VERSIONNUMBER_1_3)
+                    addIssue(ctx, logger::eError, DFD.IncorrectBasics);
+
+                // Ensure there are at least some samples
+                if (KHR_DFDSAMPLECOUNT(bdb) == 0)
+                    addIssue(ctx, logger::eError, DFD.ZeroSamples,
+                             "non-supercompressed texture with VK_FORMAT_UNDEFINED");
+                // Check for properly sized format
+                // This checks texelBlockDimension[0-3] and bytesPlane[0-7]
+                // as each is a byte and bdb is unit32_t*.
+                if (bdb[KHR_DF_WORD_TEXELBLOCKDIMENSION0] == 0)
+                    addIssue(ctx, logger::eError, DFD.TexelBlockDimensionZeroForUndefined);
+                if (KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION3) != 0)
+                    addIssue(ctx, logger::eError, DFD.FourDimensionalTexturesNotSupported);
+                if (ctx.header.supercompressionScheme == KTX_SS_NONE) {
+                    if (KHR_DFDVAL(bdb, BYTESPLANE0) == 0)
+                        addIssue(ctx, logger::eError, DFD.BytesPlane0Zero,
+                                 "VK_FORMAT_UNDEFINED");
+                } else {
+                     if (KHR_DFDVAL(bdb, BYTESPLANE0) != 0) {
+                          addIssue(ctx, logger::eError, DFD.NotUnsized);
+                     }
+                }
+                if ((bdb[KHR_DF_WORD_BYTESPLANE0] & KHR_DF_MASK_BYTESPLANE0) != 0
+                    || bdb[KHR_DF_WORD_BYTESPLANE4] != 0)
+                    addIssue(ctx, logger::eError, DFD.MultiplaneFormatsNotSupported);
+            }
+        }
+        break;
+
+      case KTX_SS_BASIS_LZ:
+          // validateHeader has already checked if vkFormat is the required
+          // VK_FORMAT_UNDEFINED so no check here.
+
+          // The colorModel must be ETC1S, currently the only format supported
+          // with BasisLZ.
+          if (KHR_DFDVAL(bdb, MODEL) != KHR_DF_MODEL_ETC1S)
+              addIssue(ctx, logger::eError, DFD.IncorrectModelForBLZE);
+          // This descriptor should have 1 or 2 samples with bitLength 63
+          // and bitOffsets 0 and 64.
+          if (numSamples == 0)
+              addIssue(ctx, logger::eError, DFD.ZeroSamples, "BasisLZ/ETC1S");
+          if (numSamples > 2)
+              addIssue(ctx, logger::eError, DFD.InvalidSampleCount, "BasisLZ/ETC1S", "1 or 2");
+          if (KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION0) != 3
+              && KHR_DFDVAL(bdb, TEXELBLOCKDIMENSION1) != 3
+              && (bdb[KHR_DF_WORD_TEXELBLOCKDIMENSION0] & 0xffff0000) != 0)
+              addIssue(ctx, logger::eError, DFD.InvalidTexelBlockDimension,
+                       4, 4, "BasisLZ/ETC1S");
+          // Check for unsized.
+          if (bdb[KHR_DF_WORD_BYTESPLANE0]  != 0
+              || bdb[KHR_DF_WORD_BYTESPLANE4]  != 0)
+              addIssue(ctx, logger::eError, DFD.NotUnsized);
+
+          for (uint32_t sample = 0; sample < numSamples; sample++) {
+              uint8_t channelID = KHR_DFDSVAL(bdb, sample, CHANNELID);
+              if (channelID != KHR_DF_CHANNEL_ETC1S_RGB
+                  && channelID != KHR_DF_CHANNEL_ETC1S_RRR
+                  && channelID != KHR_DF_CHANNEL_ETC1S_GGG
+                  && channelID != KHR_DF_CHANNEL_ETC1S_AAA)
+                  addIssue(ctx, logger::eError, DFD.InvalidChannelForBLZE);
+              int bo = KHR_DFDSVAL(bdb, sample, BITOFFSET);
+              //if (KHR_DFDSVAL(bdb, sample, BITOFFSET) != sample == 0 ? 0 : 64)
+              if (bo != (sample == 0 ? 0 : 64))
+                  addIssue(ctx, logger::eError, DFD.InvalidBitOffsetForBLZE);
+              if (KHR_DFDSVAL(bdb, sample, BITLENGTH) != 63)
+                  addIssue(ctx, logger::eError, DFD.InvalidBitLength,
+                           "BasisLZ/ETC1S", 63);
+              if (KHR_DFDSVAL(bdb, sample, SAMPLELOWER) != 0
+                  && KHR_DFDSVAL(bdb, sample, SAMPLEUPPER) != UINT32_MAX)
+                  addIssue(ctx, logger::eError, DFD.InvalidLowerOrUpper,
+                           "BasisLZ/ETC1S");
+          }
+          break;
+
+      default:
+        break;
+    }
+
+    if (analyze) {
+        // ctx.pActualDfd differs from what is expected. To help developers, do
+        // a more in depth analysis.
+
+        string vkFormatStr(vkFormatString((VkFormat)ctx.header.vkFormat));
+        uint32_t* expBdb = ctx.pDfd4Format + 1; // Expected basic block.
+
+        if (KHR_DFDVAL(bdb, VENDORID) != KHR_DF_VENDORID_KHRONOS
+            || KHR_DFDVAL(bdb, DESCRIPTORTYPE) != KHR_DF_KHR_DESCRIPTORTYPE_BASICFORMAT
+            || KHR_DFDVAL(bdb, VERSIONNUMBER) < KHR_DF_VERSIONNUMBER_1_3)
+            addIssue(ctx, logger::eError, DFD.IncorrectBasics);
+
+        khr_df_primaries_e aPrim, ePrim;
+        aPrim = (khr_df_primaries_e)KHR_DFDVAL(bdb, PRIMARIES);
+        ePrim = (khr_df_primaries_e)KHR_DFDVAL(expBdb, PRIMARIES);
+        if (aPrim != ePrim) {
+            // Okay. Any valid PRIMARIES value can be used. Check validity.
+            if (aPrim < 0 || aPrim > KHR_DF_PRIMARIES_ADOBERGB)
+                 addIssue(ctx, logger::eError, DFD.InvalidPrimaries, aPrim);
+        }
+
+        // Don't check flags because all the expected DFDs we create have
+        // ALPHA_STRAIGHT but ALPHA_PREMULTIPLIED is also valid.
+
+        int aVal, eVal;
+        if (KHR_DFDSAMPLECOUNT(bdb) == 0) {
+            addIssue(ctx, logger::eError, DFD.ZeroSamples, vkFormatStr.c_str());
+        } else {
+            aVal = KHR_DFDSAMPLECOUNT(bdb);
+            eVal = KHR_DFDSAMPLECOUNT(expBdb);
+            if (aVal != eVal)
+                addIssue(ctx, logger::eError, DFD.SampleCountMismatch, aVal, eVal);
+        }
+
+        aVal = KHR_DFDVAL(bdb, BYTESPLANE0);
+        if (aVal == 0) {
+            addIssue(ctx, logger::eError, DFD.BytesPlane0Zero, vkFormatStr.c_str());
+        } else {
+            eVal = KHR_DFDVAL(expBdb, BYTESPLANE0);
+            if (aVal != eVal)
+                addIssue(ctx, logger::eError, DFD.BytesPlane0Mismatch, aVal, eVal);
+        }
+
+        if (ctx.formatInfo.isBlockCompressed) {
+            // _BLOCK formats.
+            if (KHR_DFDVAL(bdb, MODEL) < KHR_DF_MODEL_DXT1A)
+              addIssue(ctx, logger::eError, DFD.IncorrectModelForBlock);
+        } else {
+            InterpretedDFDChannel r, g, b, a;
+            uint32_t componentByteLength;
+            InterpretDFDResult result;
+
+            result = interpretDFD(ctx.pActualDfd, &r, &g, &b, &a, &componentByteLength);
+            if (result > i_UNSUPPORTED_ERROR_BIT) {
+                switch (result) {
+                  case i_UNSUPPORTED_CHANNEL_TYPES:
+                    addIssue(ctx, logger::eError, DFD.InvalidColorModel);
+                    break;
+                  case i_UNSUPPORTED_MULTIPLE_PLANES:
+                    addIssue(ctx, logger::eError, DFD.MultiplePlanes);
+                    break;
+                  case i_UNSUPPORTED_MIXED_CHANNELS:
+                    addIssue(ctx, logger::eError, DFD.MixedChannels);
+                    break;
+                  case i_UNSUPPORTED_MULTIPLE_SAMPLE_LOCATIONS:
+                    addIssue(ctx, logger::eError, DFD.Multisample);
+                    break;
+                  case i_UNSUPPORTED_NONTRIVIAL_ENDIANNESS:
+                    addIssue(ctx, logger::eError, DFD.NonTrivialEndianness);
+                    break;
+                  default:
+                    break;
+                }
+            } else {
+                if ((result & i_FLOAT_FORMAT_BIT) && !(result & i_SIGNED_FORMAT_BIT))
+                    addIssue(ctx, logger::eWarning, DFD.UnsignedFloat);
+
+                if (result & i_SRGB_FORMAT_BIT) {
+                    if (vkFormatStr.find("SRGB") == string::npos)
+                        addIssue(ctx, logger::eError, DFD.sRGBMismatch);
+                } else {
+                    string findStr;
+                    if (result & i_SIGNED_FORMAT_BIT)
+                        findStr += 'S';
+                    else
+                        findStr += 'U';
+
+                    if (result & i_FLOAT_FORMAT_BIT)
+                        findStr += "FLOAT";
+                    // else here because Vulkan format names do not reflect
+                    // both normalized and float. E.g, BC6H is just
+                    // VK_FORMAT_BC6H_[SU]FLOAT_BLOCK.
+                    else if (result & i_NORMALIZED_FORMAT_BIT)
+                        findStr += "NORM";
+                    else
+                        findStr += "INT";
+
+                    if (vkFormatStr.find(findStr) == string::npos)
+                        addIssue(ctx, logger::eError, DFD.FormatMismatch);
+                }
+            }
+        }
+    }
+}
+
+void
+ktxValidator::validateKvd(validationContext& ctx)
+{
+    uint32_t kvdLen = ctx.header.keyValueData.byteLength;
+    uint32_t lengthCheck = 0;
+    bool allKeysNulTerminated = true;
+
+    if (kvdLen == 0)
+        return;
+
+    checkAvailable(ctx, kvdLen);
+    // + 1 so a key lacking a NUL can still be printed as a string.
+    vector<uint8_t> kvdBuf(kvdLen + 1);
+    uint8_t* kvd = kvdBuf.data();
+    read(ctx, kvd, kvdLen);
+    bool overrun = false;
+
+    // Check all kv pairs have valuePadding and it's included in kvdLen;
+    uint8_t* pCurKv = kvd;
+    uint32_t safetyCount;
+    // safetyCount ensures we don't get stuck in an infinite loop in the event
+    // the kv data is completely bogus and the "lengths" never add up to kvdLen.
+#define MAX_KVPAIRS 75
+    for (safetyCount = 0; lengthCheck < kvdLen && safetyCount < MAX_KVPAIRS; safetyCount++) {
+        if (kvdLen - lengthCheck < sizeof(uint32_t)) {
+            // No room for keyAndValueByteLength.
+            overrun = true;
+            break;
+        }
+        uint32_t curKvLen;
+        memcpy(&curKvLen, pCurKv, sizeof(uint32_t));
+        lengthCheck += sizeof(uint32_t); // Add keyAndValueByteLength to total.
+        pCurKv += sizeof(uint32_t); // Move pointer past keyAndValueByteLength.
+        uint8_t* p = pCurKv;
+        // Don't look beyond the kvd if the length is bogus.
+        uint8_t* pCurKvEnd = pCurKv + std::min(curKvLen, kvdLen - lengthCheck);
+
+        // Check for BOM.
+        bool bom = false;
+        if (pCurKvEnd - p >= 3
+            && *p == 0xEF && *(p+1) == 0xBB && *(p+2) == 0xBF) {
+            bom = true;
+            p += 3;
+        }
+        for (; p < pCurKvEnd; p++) {
+            if (*p == '\0')
+              break;
+        }
+        bool noNul = (p == pCurKvEnd);
+        if (noNul) {
+            addIssue(ctx, logger::eError, Metadata.MissingNulTerminator, pCurKv);
+            allKeysNulTerminated = false;
+        }
+        if (bom) {
+            if (noNul)
+                addIssue(ctx, logger::eError, Metadata.ForbiddenBOM1, pCurKv);
+            else
+                addIssue(ctx, logger::eError, Metadata.ForbiddenBOM2, pCurKv);
+        }
+        if (curKvLen > kvdLen - lengthCheck) {
+            overrun = true;
+            break;
+        }
+        curKvLen = (uint32_t)padn(4, curKvLen);
+        lengthCheck += curKvLen;
+        pCurKv += curKvLen;
+    }
+    if (safetyCount == 75)
+        addIssue(ctx, logger::eError, Metadata.InvalidStructure, MAX_KVPAIRS);
+    else if (overrun || lengthCheck != kvdLen)
+        addIssue(ctx, logger::eError, Metadata.MissingFinalPadding);
+
+    // Frees the list however this function is left.
+    struct hashListOwner {
+        ktxHashList head = 0;
+        ~hashListOwner() { ktxHashList_Destruct(&head); }
+    } kvData;
+    ktxHashList& kvDataHead = kvData.head;
+    ktxHashListEntry* entry;
+    char* prevKey;
+    uint32_t prevKeyLen;
+    KTX_error_code result;
+    bool writerFound = false;
+    bool writerScParamsFound = false;
+
+    if (allKeysNulTerminated) {
+        result = ktxHashList_Deserialize(&kvDataHead, kvdLen, kvd);
+        if (result == KTX_OUT_OF_MEMORY) {
+            addIssue(ctx, logger::eError, System.OutOfMemory);
+            return;
+        } else if (result != KTX_SUCCESS) {
+            // Structure errors have been reported above.
+            return;
+        }
+
+        // Check the entries are sorted
+        ktxHashListEntry_GetKey(kvDataHead, &prevKeyLen, &prevKey);
+        entry = ktxHashList_Next(kvDataHead);
+        for (; entry != NULL; entry = ktxHashList_Next(entry)) {
+            uint32_t keyLen;
+            char* key;
+
+            ktxHashListEntry_GetKey(entry, &keyLen, &key);
+            if (strcmp(prevKey, key) > 0) {
+                addIssue(ctx, logger::eError, Metadata.OutOfOrder);
+                break;
+            }
+        }
+
+        for (entry = kvDataHead; entry != NULL; entry = ktxHashList_Next(entry)) {
+            uint32_t keyLen, valueLen;
+            char* key;
+            uint8_t* value;
+
+            ktxHashListEntry_GetKey(entry, &keyLen, &key);
+            ktxHashListEntry_GetValue(entry, &valueLen, (void**)&value);
+            if (strncasecmp(key, "KTX", 3) == 0) {
+                if (!validateMetadata(ctx, key, value, valueLen)) {
+                    addIssue(ctx, logger::eError, Metadata.IllegalMetadata, key);
+                }
+                if (strncmp(key, "KTXwriter", 9) == 0)
+                    writerFound = true;
+                if (strncmp(key, "KTXwriterScParams", 17) == 0)
+                    writerScParamsFound = true;
+            } else {
+                addIssue(ctx, logger::eWarning, Metadata.CustomMetadata, key);
+            }
+        }
+        if (!writerFound) {
+            if (writerScParamsFound)
+                addIssue(ctx, logger::eError, Metadata.NoRequiredKTXwriter);
+            else
+                addIssue(ctx, logger::eWarning, Metadata.NoKTXwriter);
+        }
+    }
+}
+
+bool
+ktxValidator::validateMetadata(validationContext& ctx, const char* key,
+                               const uint8_t* pValue, uint32_t valueLen)
+{
+#define CALL_MEMBER_FN(object,ptrToMember)  ((object)->*(ptrToMember))
+    vector<metadataValidator>::const_iterator it;
+
+    for (it = metadataValidators.begin(); it < metadataValidators.end(); it++) {
+        if (!it->name.compare(key)) {
+            //validateMetadataFunc vf = it->validateFunc;
+            CALL_MEMBER_FN(this, it->validateFunc)(ctx, key, pValue, valueLen);
+            break;
+        }
+    }
+    if (it == metadataValidators.end())
+        return false; // Unknown KTX-prefixed and therefore illegal metadata.
+    else
+        return true;
+}
+
+void
+ktxValidator::validateCubemapIncomplete(validationContext& ctx,
+                                        const char* key,
+                                        const uint8_t*,
+                                        uint32_t valueLen)
+{
+    ctx.cubemapIncompleteFound = true;
+    if (valueLen != 1)
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+}
+
+void
+ktxValidator::validateOrientation(validationContext& ctx,
+                                  const char* key,
+                                  const uint8_t* value,
+                                  uint32_t valueLen)
+{
+    if (valueLen == 0) {
+        addIssue(ctx, logger::eError, Metadata.MissingValue, key);
+        return;
+    }
+
+    string orientation;
+    const char* pOrientation = reinterpret_cast<const char*>(value);
+    if (value[valueLen - 1] != '\0') {
+        // regex_match on some platforms will fail to match an otherwise
+        // valid swizzle due to lack of a NUL terminator even IF there is
+        // no '$' at the end of the regex. Make a copy to avoid this.    
+        orientation.assign(pOrientation, valueLen);
+        pOrientation = orientation.c_str();
+        addIssue(ctx, logger::eWarning, Metadata.ValueNotNulTerminated, key);
+    }
+
+    if (valueLen != ctx.dimensionCount + 1)
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+
+    switch (ctx.dimensionCount) {
+      case 1:
+        if (!regex_match (pOrientation, regex("^[rl]$") ))
+            addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+        break;
+      case 2:
+        if (!regex_match(pOrientation, regex("^[rl][du]$")))
+            addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+        break;
+      case 3:
+        if (!regex_match(pOrientation, regex("^[rl][du][oi]$")))
+            addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+        break;
+    }
+}
+
+void
+ktxValidator::validateGlFormat(validationContext& ctx,
+                               const char* key,
+                               const uint8_t* /*value*/,
+                               uint32_t valueLen)
+{
+    if (valueLen != sizeof(uint32_t) * 3)
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+}
+
+void
+ktxValidator::validateDxgiFormat(validationContext& ctx,
+                                 const char* key,
+                                 const uint8_t* /*value*/,
+                                 uint32_t valueLen)
+                            {
+    if (valueLen != sizeof(uint32_t))
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);}
+
+void
+ktxValidator::validateMetalPixelFormat(validationContext& ctx,
+                                       const char* key,
+                                       const uint8_t* /*value*/,
+                                       uint32_t valueLen)
+{
+    if (valueLen != sizeof(uint32_t))
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+}
+
+void
+ktxValidator::validateSwizzle(validationContext& ctx,
+                              const char* key,
+                              const uint8_t* value,
+                              uint32_t valueLen)
+{
+    string swizzle;
+    const char* pSwizzle = reinterpret_cast<const char*>(value);
+    if (value[valueLen - 1] != '\0') {
+        addIssue(ctx, logger::eWarning, Metadata.ValueNotNulTerminated, key);
+        // See comment in validateOrientation.    
+        swizzle.assign(pSwizzle, valueLen);
+        pSwizzle = swizzle.c_str();
+    }
+    if (!regex_match(pSwizzle, regex("^[rgba01]{4}$")))
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+}
+
+void
+ktxValidator::validateWriter(validationContext& ctx,
+                             const char* key,
+                             const uint8_t* value,
+                             uint32_t valueLen)
+{
+    if (value[valueLen-1] != '\0')
+        addIssue(ctx, logger::eWarning, Metadata.ValueNotNulTerminated, key);
+}
+
+void
+ktxValidator::validateWriterScParams(validationContext& ctx,
+                                     const char* key,
+                                     const uint8_t* value,
+                                     uint32_t valueLen)
+{
+    if (value[valueLen-1] != '\0')
+        addIssue(ctx, logger::eWarning, Metadata.ValueNotNulTerminated, key);
+}
+
+void
+ktxValidator::validateAstcDecodeMode(validationContext& ctx,
+                                     const char* key,
+                                     const uint8_t* value,
+                                     uint32_t valueLen)
+{
+    if (valueLen == 0) {
+        addIssue(ctx, logger::eError, Metadata.MissingValue, key);
+        return;
+    }
+
+    if (!regex_match((char*)value, regex("rgb9e5"))
+       && !regex_match((char*)value, regex("unorm8")))
+         addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+
+    if (!ctx.pActualDfd)
+        return;
+
+    uint32_t* bdb = ctx.pDfd4Format + 1;
+    if (KHR_DFDVAL(bdb, MODEL) != KHR_DF_MODEL_ASTC) {
+         addIssue(ctx, logger::eError, Metadata.NotAllowed, key,
+                  "for non-ASTC texture formats");
+    }
+    if (KHR_DFDVAL(bdb, TRANSFER) == KHR_DF_TRANSFER_SRGB) {
+         addIssue(ctx, logger::eError, Metadata.NotAllowed, key,
+                  "with sRGB transfer function");
+    }
+}
+
+void
+ktxValidator::validateAnimData(validationContext& ctx,
+                               const char* key,
+                               const uint8_t* /*value*/,
+                               uint32_t valueLen)
+{
+    if (ctx.cubemapIncompleteFound) {
+         addIssue(ctx, logger::eError, Metadata.NotAllowed, key,
+                  "together with KTXcubemapIncomplete");
+    }
+    if (ctx.layerCount == 0)
+        addIssue(ctx, logger::eError, Metadata.NotAllowed, key,
+                 "except with array textures");
+
+    if (valueLen != sizeof(uint32_t) * 3)
+        addIssue(ctx, logger::eError, Metadata.InvalidValue, key);
+}
+
+void
+ktxValidator::validateSgd(validationContext& ctx)
+{
+    uint64_t sgdByteLength = ctx.header.supercompressionGlobalData.byteLength;
+    if (ctx.header.supercompressionScheme == KTX_SS_BASIS_LZ) {
+        if (sgdByteLength == 0) {
+            addIssue(ctx, logger::eError, SGD.MissingSupercompressionGlobalData);
+            return;
+        }
+    } else {
+        if (sgdByteLength > 0)
+            addIssue(ctx, logger::eError, SGD.UnexpectedSupercompressionGlobalData);
+        return;
+    }
+
+    checkAvailable(ctx, sgdByteLength);
+    vector<uint8_t> sgdBuf((size_t)sgdByteLength);
+    uint8_t* sgd = sgdBuf.data();
+    read(ctx, sgd, (size_t)sgdByteLength);
+
+    // firstImages contains the indices of the first images for each level.
+    // The last array entry contains the total number of images which is what
+    // we need here.
+    vector<uint32_t> firstImages(ctx.levelCount + 1);
+    // Temporary invariant value
+    uint32_t layersFaces = ctx.layerCount * ctx.header.faceCount;
+    firstImages[0] = 0;
+    for (uint32_t level = 1; level <= ctx.levelCount; level++) {
+        // NOTA BENE: numFaces * depth is only reasonable because they can't
+        // both be > 1. I.e there are no 3d cubemaps.
+        firstImages[level] = firstImages[level - 1]
+                           + layersFaces * MAX(ctx.header.pixelDepth >> (level - 1), 1);
+    }
+    uint32_t& imageCount = firstImages[ctx.levelCount];
+
+    if (sgdByteLength < sizeof(ktxBasisLzGlobalHeader)
+                        + sizeof(ktxBasisLzEtc1sImageDesc) * (uint64_t)imageCount) {
+        // Too small to hold the image descriptors so don't look at them.
+        addIssue(ctx, logger::eError, SGD.IncorrectGlobalDataSize);
+        return;
+    }
+
+    ktxBasisLzGlobalHeader& bgdh = *reinterpret_cast<ktxBasisLzGlobalHeader*>(sgd);
+    uint32_t numSamples = KHR_DFDSAMPLECOUNT(ctx.pActualDfd + 1);
+
+    uint64_t expectedBgdByteLength = sizeof(ktxBasisLzGlobalHeader)
+                                   + sizeof(ktxBasisLzEtc1sImageDesc) * imageCount
+                                   + bgdh.endpointsByteLength
+                                   + bgdh.selectorsByteLength
+                                   + bgdh.tablesByteLength;
+
+    ktxBasisLzEtc1sImageDesc* imageDescs = BGD_ETC1S_IMAGE_DESCS(sgd);
+    ktxBasisLzEtc1sImageDesc* image = imageDescs;
+    for (; image < imageDescs + imageCount; image++) {
+      if (image->imageFlags & ~eBUImageIsPframe)
+            addIssue(ctx, logger::eError, SGD.InvalidImageFlagBit);
+        // Crosscheck the DFD.
+        if (image->alphaSliceByteOffset == 0 && numSamples == 2)
+            addIssue(ctx, logger::eError, SGD.DfdMismatchAlpha);
+        if (image->alphaSliceByteOffset > 0 && numSamples == 1)
+            addIssue(ctx, logger::eError, SGD.DfdMismatchNoAlpha);
+    }
+
+    if (sgdByteLength != expectedBgdByteLength)
+        addIssue(ctx, logger::eError, SGD.IncorrectGlobalDataSize);
+
+    if (bgdh.extendedByteLength != 0)
+        addIssue(ctx, logger::eError, SGD.ExtendedByteLengthNotZero);
+
+    // Can't do anymore as we have no idea how many endpoints, etc there
+    // should be.
+    // TODO: attempt transcode
+}
+
+void
+ktxValidator::validateDataSize(validationContext& ctx)
+{
+    // Expects to be called after validateSgd so current file offset is at
+    // the start of the data.
+    // The read point may be past the end. As before the difference then
+    // wraps and so mismatches.
+    uint64_t dataSizeInFile = (uint64_t)ctx.size - (uint64_t)ctx.offset;
+    if (dataSizeInFile != ctx.dataSizeFromLevelIndex)
+        addIssue(ctx, logger::eError, FileError.IncorrectDataSize);
+}
+
+// Must be called last. Creates a texture from the whole file.
+bool
+ktxValidator::validateTranscode(validationContext& ctx)
+{
+    uint32_t* bdb = ctx.pActualDfd + 1; // Basic descriptor block.
+    uint32_t model = KHR_DFDVAL(bdb, MODEL);
+    if (model != KHR_DF_MODEL_UASTC && model != KHR_DF_MODEL_ETC1S) {
+        // Nothin to do. Not transcodable.
+        return true;
+    }
+
+    bool retval;
+    KtxTexture<ktxTexture2> texture2;
+    ktx_error_code_e result = ktxTexture2_CreateFromMemory(ctx.data, ctx.size,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        texture2.pHandle());
+    if (result != KTX_SUCCESS) {
+        addIssue(ctx, logger::eError, FileError.CreateFailure,
+                 ktxErrorString(result));
+        return false;
+    }
+
+    // The images are transcoded in parallel on transcodePool.
+    if (model == KHR_DF_MODEL_ETC1S)
+        result = ktxTexture2_TranscodeBasisWithPool(texture2.handle(),
+                                            KTX_TTF_ETC2_RGBA, 0,
+                                            transcodePool);
+    else
+        result = ktxTexture2_TranscodeBasisWithPool(texture2.handle(),
+                                            KTX_TTF_ASTC_4x4_RGBA, 0,
+                                            transcodePool);
+    if (result != KTX_SUCCESS) {
+        addIssue(ctx, logger::eError, Transcode.Failure, ktxErrorString(result));
+        retval = false;
+    } else {
+        retval = true;
+    }
+    return retval;
+}
+
+
+} // namespace
+
+/**
+ * @internal
+ * @~English
+ * @brief Validate a KTX 2 file held in memory, transcoding on a thread pool.
+ *
+ * As ktxValidateMemory() except that when @c KTX_VALIDATE_TRANSCODE_BIT is
+ * set the images are transcoded in parallel on @p pool. @p pool may be
+ * @c NULL, in which case they are transcoded on the calling thread.
+ */
+extern "C" KTX_error_code
+ktxValidateMemory_(const ktx_uint8_t* bytes, ktx_size_t size,
+                   ktxValidateFlags flags, PFNKTXVALIDATECALLBACK callback,
+                   void* userdata, ktxThreadPool* pool)
+{
+    if (bytes == NULL && size != 0)
+        return KTX_INVALID_VALUE;
+
+    ktxValidator validator(callback, userdata, pool);
+    return validator.validate(bytes, size, flags);
+}
+
+/**
+ * @ingroup reader
+ * @~English
+ * @brief Validate a KTX 2 file held in memory.
+ *
+ * Makes the checks of the @e ktx2check tool on the header, level index,
+ * data format descriptor, key/value data and supercompression global data
+ * and checks that the size of the image data matches the level index. The
+ * image data is neither copied nor examined unless
+ * @c KTX_VALIDATE_TRANSCODE_BIT is set in @p flags in which case a texture
+ * is created from the file and, if it is Basis Universal compressed,
+ * transcoded.
+ *
+ * Each issue found is passed to @p callback, if not @c NULL, together with
+ * its severity, a code identifying the issue and a message describing it.
+ * If @p callback returns @c KTX_FALSE validation stops and the return value
+ * reflects only the issues reported until then. Validation always stops
+ * after an issue of severity @c KTX_VALIDATION_FATAL.
+ *
+ * @param[in] bytes     pointer to the file data.
+ * @param[in] size      size of the file data in bytes.
+ * @param[in] flags     bitfield of @c ktxValidateFlagBits values.
+ * @param[in] callback  function called for each issue found. May be
+ *                      @c NULL.
+ * @param[in] userdata  pointer passed to @p callback.
+ *
+ * @return      KTX_SUCCESS if no errors were found, although there may have
+ *              been warnings, otherwise one of the following error codes.
+ *
+ * @exception KTX_FILE_DATA_ERROR
+ *                              One or more errors were found.
+ * @exception KTX_INVALID_OPERATION
+ *                              The validator failed internally before
+ *                              validation was complete.
+ * @exception KTX_INVALID_VALUE @p bytes is @c NULL and @p size is not 0.
+ * @exception KTX_OUT_OF_MEMORY Not enough memory to complete validation.
+ */
+extern "C" KTX_error_code
+ktxValidateMemory(const ktx_uint8_t* bytes, ktx_size_t size,
+                  ktxValidateFlags flags, PFNKTXVALIDATECALLBACK callback,
+                  void* userdata)
+{
+    return ktxValidateMemory_(bytes, size, flags, callback, userdata, NULL);
+}
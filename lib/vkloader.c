@@ -34,25 +34,6 @@
 #include "texture2.h"
 #include "vk_format.h"
 
-// Macro to check and display Vulkan return results.
-// Use when the only possible errors are caused by invalid usage by this loader.
-#if defined(_DEBUG)
-#define VK_CHECK_RESULT(f)                                                  \
-{                                                                           \
-    VkResult res = (f);                                                     \
-    if (res != VK_SUCCESS)                                                  \
-    {                                                                       \
-        /* XXX Find an errorString function. */                             \
-        fprintf(stderr, "Fatal error in ktxLoadVkTexture*: "                \
-                "VkResult is \"%d\" in %s at line %d\n",                    \
-                res, __FILE__, __LINE__);                                   \
-        assert(res == VK_SUCCESS);                                          \
-    }                                                                       \
-}
-#else
-#define VK_CHECK_RESULT(f) ((void)f)
-#endif
-
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(a[0]))
 
 #define DEFAULT_FENCE_TIMEOUT 100000000000
@@ -69,6 +50,7 @@ setImageLayout(
 
 static void
 generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
+                VkCommandBuffer cmdBuffer,
                 VkFilter filter, VkImageLayout initialLayout);
 
 /**
@@ -407,6 +389,349 @@ ktxVulkanDeviceInfo_getMemoryType(ktxVulkanDeviceInfo* This,
     return 0;
 }
 
+//======================================================================
+//  Staging ring
+//======================================================================
+
+/* Maximum number of staging allocations that can be in flight at once. */
+#define KTX_STAGING_RING_MAX_ALLOCS 256
+
+typedef enum ktxVulkanStagingAllocState {
+    KTX_STAGING_ALLOC_RECORDED,  /* Used by commands not yet submitted. */
+    KTX_STAGING_ALLOC_SUBMITTED, /* Free once its value is retired. */
+    KTX_STAGING_ALLOC_FREE       /* Commands using it have completed. */
+} ktxVulkanStagingAllocState;
+
+typedef struct ktxVulkanStagingAlloc {
+    VkDeviceSize begin;
+    VkDeviceSize end;
+    ktxVulkanStagingAllocState state;
+    ktx_uint64_t value;        // Submission value when SUBMITTED.
+} ktxVulkanStagingAlloc;
+
+/*
+ * Staging buffer of an upload that did not fit in the ring, released with
+ * ktxVulkanStaging_Release(). It is destroyed once its value is retired.
+ */
+typedef struct ktxVulkanDeferredStaging {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    ktx_uint64_t value;
+} ktxVulkanDeferredStaging;
+
+/*
+ * A persistently mapped staging buffer from which uploads sub-allocate.
+ * Allocations are made at the head and reclaimed from the tail, in
+ * allocation order, once the submission using them is retired.
+ */
+struct ktxVulkanStagingRing {
+    VkDevice device;
+    const VkAllocationCallbacks* pAllocator;
+    PFN_vkDestroyBuffer vkDestroyBuffer;
+    PFN_vkFreeMemory vkFreeMemory;
+    PFN_vkUnmapMemory vkUnmapMemory;
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    ktx_uint8_t* pMapped;
+    VkDeviceSize size;
+    VkDeviceSize head;         // Offset at which to try the next allocation.
+    ktx_uint32_t first;        // Index in allocs of the oldest allocation.
+    ktx_uint32_t count;        // Number of allocations in flight.
+    ktx_uint64_t retiredValue; // Highest value passed to Retire.
+    ktxVulkanStagingAlloc allocs[KTX_STAGING_RING_MAX_ALLOCS];
+    ktxVulkanDeferredStaging* deferred;
+    ktx_uint32_t numDeferred;
+    ktx_uint32_t deferredCapacity;
+};
+
+/**
+ * @memberof ktxVulkanStagingRing
+ * @~English
+ * @brief Create a persistently mapped staging ring.
+ *
+ * By default each upload of an optimally tiled image creates, maps and
+ * frees its own staging buffer. Uploads recorded by
+ * ktxTexture_VkRecordUpload() with a ring whose staging data fits in the
+ * free part of the ring sub-allocate from it instead, avoiding the cost of
+ * those calls. The image data is loaded directly into the mapped ring.
+ * Uploads that do not fit fall back to their own buffer so the size only
+ * affects performance.
+ *
+ * Space is reclaimed by submission value, not when the upload is recorded
+ * or submitted, so any number of submissions can be in flight. After
+ * submitting the commands of an upload, hand its staging to the ring with
+ * ktxVulkanStaging_Release() and the value, e.g. a timeline semaphore
+ * value or frame number, that identifies the submission. When submissions
+ * complete, pass the highest completed value to
+ * ktxVulkanStagingRing_Retire(). Allocations released with values up to
+ * that one are then reused.
+ *
+ * The ring is independent of the ktxVulkanDeviceInfo, which only provides
+ * the device, allocator and functions used to create it. It must not be
+ * used by multiple threads at once.
+ *
+ * @param vdi    pointer to the ktxVulkanDeviceInfo for the device on
+ *               which to create the ring.
+ * @param size   size in bytes of the ring.
+ * @param ppRing pointer to the location in which to store the ring.
+ *
+ * @returns KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE     @p vdi or @p ppRing is @c NULL or
+ *                                  @p size is 0.
+ * @exception KTX_OUT_OF_MEMORY     The ring could not be allocated on
+ *                                  either the CPU or the Vulkan device.
+ */
+KTX_error_code
+ktxVulkanStagingRing_Create(ktxVulkanDeviceInfo* vdi, VkDeviceSize size,
+                            ktxVulkanStagingRing** ppRing)
+{
+    ktxVulkanStagingRing* ring;
+    VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL
+    };
+    VkMemoryAllocateInfo memAllocInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL
+    };
+    VkMemoryRequirements memReqs;
+    VkResult vResult;
+
+    if (vdi == NULL || ppRing == NULL || size == 0)
+        return KTX_INVALID_VALUE;
+
+    ring = (ktxVulkanStagingRing*)calloc(1, sizeof(*ring));
+    if (ring == NULL)
+        return KTX_OUT_OF_MEMORY;
+
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vResult = vdi->vkFuncs.vkCreateBuffer(vdi->device, &bufferCreateInfo,
+                                          vdi->pAllocator, &ring->buffer);
+    if (vResult != VK_SUCCESS) {
+        free(ring);
+        return KTX_OUT_OF_MEMORY;
+    }
+
+    vdi->vkFuncs.vkGetBufferMemoryRequirements(vdi->device, ring->buffer,
+                                               &memReqs);
+    memAllocInfo.allocationSize = memReqs.size;
+    memAllocInfo.memoryTypeIndex = ktxVulkanDeviceInfo_getMemoryType(
+            vdi,
+            memReqs.memoryTypeBits,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+          | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    vResult = vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo,
+                                            vdi->pAllocator, &ring->memory);
+    if (vResult == VK_SUCCESS) {
+        vResult = vdi->vkFuncs.vkBindBufferMemory(vdi->device, ring->buffer,
+                                                  ring->memory, 0);
+        if (vResult == VK_SUCCESS)
+            vResult = vdi->vkFuncs.vkMapMemory(vdi->device, ring->memory,
+                                               0, size, 0,
+                                               (void**)&ring->pMapped);
+        if (vResult != VK_SUCCESS)
+            vdi->vkFuncs.vkFreeMemory(vdi->device, ring->memory,
+                                      vdi->pAllocator);
+    }
+    if (vResult != VK_SUCCESS) {
+        vdi->vkFuncs.vkDestroyBuffer(vdi->device, ring->buffer,
+                                     vdi->pAllocator);
+        free(ring);
+        return KTX_OUT_OF_MEMORY;
+    }
+    ring->device = vdi->device;
+    ring->pAllocator = vdi->pAllocator;
+    ring->vkDestroyBuffer = vdi->vkFuncs.vkDestroyBuffer;
+    ring->vkFreeMemory = vdi->vkFuncs.vkFreeMemory;
+    ring->vkUnmapMemory = vdi->vkFuncs.vkUnmapMemory;
+    ring->size = size;
+    *ppRing = ring;
+    return KTX_SUCCESS;
+}
+
+/**
+ * @memberof ktxVulkanStagingRing
+ * @~English
+ * @brief Destroy a staging ring.
+ *
+ * Frees the ring and any staging buffers released to it that have not yet
+ * been destroyed. All commands using them must have completed.
+ *
+ * @param This pointer to the ktxVulkanStagingRing to destroy.
+ */
+void
+ktxVulkanStagingRing_Destroy(ktxVulkanStagingRing* This)
+{
+    if (This == NULL)
+        return;
+    for (ktx_uint32_t i = 0; i < This->numDeferred; i++) {
+        This->vkDestroyBuffer(This->device, This->deferred[i].buffer,
+                              This->pAllocator);
+        This->vkFreeMemory(This->device, This->deferred[i].memory,
+                           This->pAllocator);
+    }
+    free(This->deferred);
+    This->vkUnmapMemory(This->device, This->memory);
+    This->vkDestroyBuffer(This->device, This->buffer, This->pAllocator);
+    This->vkFreeMemory(This->device, This->memory, This->pAllocator);
+    free(This);
+}
+
+/* True if the commands using @p alloc are known to have completed. */
+static ktx_bool_t
+ktxVulkanStagingRing_isFree(const ktxVulkanStagingRing* ring,
+                            const ktxVulkanStagingAlloc* alloc)
+{
+    return alloc->state == KTX_STAGING_ALLOC_FREE
+           || (alloc->state == KTX_STAGING_ALLOC_SUBMITTED
+               && alloc->value <= ring->retiredValue);
+}
+
+/* Drop completed allocations from the tail of the ring. */
+static void
+ktxVulkanStagingRing_reclaim(ktxVulkanStagingRing* ring)
+{
+    while (ring->count > 0
+           && ktxVulkanStagingRing_isFree(ring, &ring->allocs[ring->first])) {
+        ring->first = (ring->first + 1) % KTX_STAGING_RING_MAX_ALLOCS;
+        ring->count--;
+    }
+    if (ring->count == 0) {
+        ring->first = 0;
+        ring->head = 0;
+    }
+}
+
+/**
+ * @memberof ktxVulkanStagingRing
+ * @~English
+ * @brief Tell a staging ring which submissions have completed.
+ *
+ * Staging space and buffers released with ktxVulkanStaging_Release() with
+ * a value less than or equal to @p completedValue are reclaimed. Values
+ * lower than one previously passed are ignored.
+ *
+ * @param This           pointer to the ktxVulkanStagingRing.
+ * @param completedValue the highest submission value whose commands are
+ *                       known to have completed.
+ */
+void
+ktxVulkanStagingRing_Retire(ktxVulkanStagingRing* This,
+                            ktx_uint64_t completedValue)
+{
+    ktx_uint32_t kept = 0;
+
+    if (This == NULL)
+        return;
+    if (completedValue > This->retiredValue)
+        This->retiredValue = completedValue;
+    for (ktx_uint32_t i = 0; i < This->numDeferred; i++) {
+        ktxVulkanDeferredStaging* d = &This->deferred[i];
+        if (d->value <= This->retiredValue) {
+            This->vkDestroyBuffer(This->device, d->buffer, This->pAllocator);
+            This->vkFreeMemory(This->device, d->memory, This->pAllocator);
+        } else {
+            This->deferred[kept++] = *d;
+        }
+    }
+    This->numDeferred = kept;
+    ktxVulkanStagingRing_reclaim(This);
+}
+
+/*
+ * Allocate @p size bytes aligned to @p alignment, which need not be a power
+ * of 2. Returns KTX_FALSE, without waiting, if there is no room.
+ */
+static ktx_bool_t
+ktxVulkanStagingRing_alloc(ktxVulkanStagingRing* ring,
+                           VkDeviceSize size, VkDeviceSize alignment,
+                           VkDeviceSize* pOffset)
+{
+    VkDeviceSize offset;
+
+    ktxVulkanStagingRing_reclaim(ring);
+    if (ring->count == KTX_STAGING_RING_MAX_ALLOCS)
+        return KTX_FALSE;
+
+    offset = (ring->head + alignment - 1) / alignment * alignment;
+    if (ring->count == 0 || ring->head > ring->allocs[ring->first].begin) {
+        // In use: [tail, head). Try after head then wrap to the start.
+        if (offset > ring->size || size > ring->size - offset) {
+            offset = 0;
+            // Strictly less so a full ring is never mistaken for an empty
+            // one.
+            if (ring->count == 0 ? size > ring->size
+                : size >= ring->allocs[ring->first].begin)
+                return KTX_FALSE;
+        }
+    } else {
+        // Wrapped. In use: [tail, end) and [0, head).
+        VkDeviceSize tail = ring->allocs[ring->first].begin;
+        if (offset >= tail || size >= tail - offset)
+            return KTX_FALSE;
+    }
+
+    ktxVulkanStagingAlloc* alloc = &ring->allocs[(ring->first + ring->count)
+                                                 % KTX_STAGING_RING_MAX_ALLOCS];
+    alloc->begin = offset;
+    alloc->end = offset + size;
+    alloc->state = KTX_STAGING_ALLOC_RECORDED;
+    alloc->value = 0;
+    ring->count++;
+    ring->head = alloc->end;
+    *pOffset = offset;
+    return KTX_TRUE;
+}
+
+/*
+ * Mark the recorded allocation starting at @p offset as free or, if
+ * @p state is SUBMITTED, as free once @p value is retired.
+ */
+static void
+ktxVulkanStagingRing_release(ktxVulkanStagingRing* ring,
+                             VkDeviceSize offset,
+                             ktxVulkanStagingAllocState state,
+                             ktx_uint64_t value)
+{
+    for (ktx_uint32_t i = 0; i < ring->count; i++) {
+        ktxVulkanStagingAlloc* alloc =
+            &ring->allocs[(ring->first + i) % KTX_STAGING_RING_MAX_ALLOCS];
+        if (alloc->begin == offset
+            && alloc->state == KTX_STAGING_ALLOC_RECORDED) {
+            alloc->state = state;
+            alloc->value = value;
+            break;
+        }
+    }
+    ktxVulkanStagingRing_reclaim(ring);
+}
+
+/* Keep a staging buffer until @p value is retired. */
+static KTX_error_code
+ktxVulkanStagingRing_defer(ktxVulkanStagingRing* ring, VkBuffer buffer,
+                           VkDeviceMemory memory, ktx_uint64_t value)
+{
+    if (ring->numDeferred == ring->deferredCapacity) {
+        ktx_uint32_t capacity = ring->deferredCapacity ?
+                                ring->deferredCapacity * 2 : 16;
+        ktxVulkanDeferredStaging* deferred = (ktxVulkanDeferredStaging*)
+                   realloc(ring->deferred, capacity * sizeof(*deferred));
+        if (deferred == NULL)
+            return KTX_OUT_OF_MEMORY;
+        ring->deferred = deferred;
+        ring->deferredCapacity = capacity;
+    }
+    ring->deferred[ring->numDeferred].buffer = buffer;
+    ring->deferred[ring->numDeferred].memory = memory;
+    ring->deferred[ring->numDeferred].value = value;
+    ring->numDeferred++;
+    return KTX_SUCCESS;
+}
+
 //======================================================================
 //  ReadImages callbacks
 //======================================================================
@@ -731,30 +1056,42 @@ linearTilingPadCallback(int miplevel, int face,
 /**
  * @memberof ktxTexture
  * @~English
- * @brief Create a Vulkan image object from a ktxTexture object.
+ * @brief Record the creation of a Vulkan image object from a ktxTexture
+ *        object in a command buffer.
  *
- * Creates a VkImage with @c VkFormat etc. matching the KTX data and uploads
- * the images.  Mipmaps will be generated if the @c ktxTexture's
- * @c generateMipmaps flag is set. Returns the handles of the created objects
- * and information about the texture in the @c ktxVulkanTexture pointed at by
- * @p vkTexture.
+ * Creates a VkImage with @c VkFormat etc. matching the KTX data, copies the
+ * images to a staging buffer, if needed, and records the commands to copy
+ * them to the image in @p cmdBuffer. Mipmap generation is also recorded if
+ * the @c ktxTexture's @c generateMipmaps flag is set. Returns the handles of
+ * the created image objects in the @c ktxVulkanTexture pointed at by
+ * @p vkTexture and of the staging resources in the @c ktxVulkanStaging
+ * pointed at by @p staging.
  *
- * @p usageFlags and thus acceptable usage of the created image may be
- * augmented as follows:
- * - with @c VK_IMAGE_USAGE_TRANSFER_DST_BIT if @p tiling is
- *   @c VK_IMAGE_TILING_OPTIMAL
- * - with <code>VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT</code>
- *   if @c generateMipmaps is set in the @c ktxTexture.
+ * Unlike ktxTexture_VkUploadEx() nothing is submitted and the function does
+ * not wait for anything so uploads of many textures can be recorded in one
+ * command buffer and submitted together, for example to a transfer queue.
+ * The caller must begin @p cmdBuffer before and end and submit it after
+ * calling this. The image must not be used until the submitted commands
+ * have completed. Once they have, the staging resources must be released
+ * with ktxVulkanStaging_Destruct(). If @p ring is not @c NULL they can
+ * instead be handed to the ring with ktxVulkanStaging_Release() as soon as
+ * the commands have been submitted.
  *
- * Most Vulkan implementations support VK_IMAGE_TILING_LINEAR only for a very
- * limited number of formats and features. Generally VK_IMAGE_TILING_OPTIMAL is
- * preferred. The latter requires a staging buffer so will use more memory
- * during loading.
+ * If the image is generated by a queue family other than the one that will
+ * use it, the caller must record the queue family ownership transfer.
+ * Mipmap generation uses @c vkCmdBlitImage so needs a command buffer for a
+ * queue supporting graphics operations.
+ *
+ * @p usageFlags and thus acceptable usage of the created image may be
+ * augmented as described for ktxTexture_VkUploadEx().
  *
  * @param[in] This          pointer to the ktxTexture from which to upload.
  * @param [in] vdi          pointer to a ktxVulkanDeviceInfo structure providing
  *                          information about the Vulkan device onto which to
- *                          load the texture.
+ *                          load the texture. Its command buffer and queue are
+ *                          not used.
+ * @param [in] cmdBuffer    the command buffer, in the recording state, in
+ *                          which to record the upload commands.
  * @param [in,out] vkTexture pointer to a ktxVulkanTexture structure into which
  *                           the function writes information about the created
  *                           VkImage.
@@ -764,30 +1101,32 @@ linearTilingPadCallback(int miplevel, int face,
  *                          intended usage of the destination image.
  * @param [in] finalLayout  a VkImageLayout value indicating the desired
  *                          final layout of the created image.
+ * @param [in] ring         pointer to a ktxVulkanStagingRing from which to
+ *                          sub-allocate the staging data, or @c NULL to
+ *                          always create a staging buffer.
+ * @param [out] staging     pointer to a ktxVulkanStaging structure into which
+ *                          the function writes the handles of the staging
+ *                          resources. They are @c VK_NULL_HANDLE when no
+ *                          staging buffer is needed.
  *
- * @return  KTX_SUCCESS on success, other KTX_* enum values on error.
+ * @return  KTX_SUCCESS on success, other KTX_* enum values on error. On error
+ *          the image and any staging resources have already been released.
  *
- * @exception KTX_INVALID_VALUE @p This, @p vdi or @p vkTexture is @c NULL.
- * @exception KTX_INVALID_OPERATION The ktxTexture contains neither images nor
- *                                  an active stream from which to read them.
- * @exception KTX_INVALID_OPERATION The combination of the ktxTexture's format,
- *                                  @p tiling and @p usageFlags is not supported
- *                                  by the physical device.
- * @exception KTX_INVALID_OPERATION Requested mipmap generation is not supported
- *                                  by the physical device for the combination
- *                                  of the ktxTexture's format and @p tiling.
- * @exception KTX_INVALID_OPERATION Number of mip levels or array layers exceeds the
- *                                maximums supported for the ktxTexture's format
- *                                and @p tiling.
- * @exception KTX_OUT_OF_MEMORY Sufficient memory could not be allocated
- *                              on either the CPU or the Vulkan device.
+ * @exception KTX_INVALID_VALUE @p This, @p vdi, @p vkTexture or @p staging
+ *                              is @c NULL or @p cmdBuffer is
+ *                              @c VK_NULL_HANDLE.
+ *
+ * For other exceptions see ktxTexture_VkUploadEx().
  */
 KTX_error_code
-ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
-                      ktxVulkanTexture* vkTexture,
-                      VkImageTiling tiling,
-                      VkImageUsageFlags usageFlags,
-                      VkImageLayout finalLayout)
+ktxTexture_VkRecordUpload(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
+                          VkCommandBuffer cmdBuffer,
+                          ktxVulkanTexture* vkTexture,
+                          VkImageTiling tiling,
+                          VkImageUsageFlags usageFlags,
+                          VkImageLayout finalLayout,
+                          ktxVulkanStagingRing* ring,
+                          ktxVulkanStaging* staging)
 {
     KTX_error_code           kResult;
     VkFilter                 blitFilter = VK_FILTER_LINEAR;
@@ -797,10 +1136,6 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
     VkImageCreateFlags       createFlags = 0;
     VkImageFormatProperties  imageFormatProperties;
     VkResult                 vResult;
-    VkCommandBufferBeginInfo cmdBufBeginInfo = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = NULL
-    };
     VkImageCreateInfo        imageCreateInfo = {
          .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
          .pNext = NULL
@@ -816,7 +1151,8 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
     ktx_uint32_t elementSize = ktxTexture_GetElementSize(This);
     ktx_bool_t               canUseFasterPath;
 
-    if (!vdi || !This || !vkTexture) {
+    if (!vdi || !This || !vkTexture || !staging
+        || cmdBuffer == VK_NULL_HANDLE) {
         return KTX_INVALID_VALUE;
     }
 
@@ -959,16 +1295,20 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
     vkTexture->viewType = viewType;
     vkTexture->vkDestroyImage = vdi->vkFuncs.vkDestroyImage;
     vkTexture->vkFreeMemory = vdi->vkFuncs.vkFreeMemory;
-
-    VK_CHECK_RESULT(
-            vdi->vkFuncs.vkBeginCommandBuffer(vdi->cmdBuffer, &cmdBufBeginInfo)
-            );
+    vkTexture->image = VK_NULL_HANDLE;
+    vkTexture->deviceMemory = VK_NULL_HANDLE;
+    staging->vkDestroyBuffer = vdi->vkFuncs.vkDestroyBuffer;
+    staging->vkFreeMemory = vdi->vkFuncs.vkFreeMemory;
+    staging->buffer = VK_NULL_HANDLE;
+    staging->memory = VK_NULL_HANDLE;
+    staging->ring = NULL;
+    staging->offset = 0;
 
     if (tiling == VK_IMAGE_TILING_OPTIMAL)
     {
         // Create a host-visible staging buffer that contains the raw image data
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
         VkBufferImageCopy* copyRegions;
         VkDeviceSize textureSize;
         VkBufferCreateInfo bufferCreateInfo = {
@@ -976,17 +1316,9 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
           .pNext = NULL
         };
         VkImageSubresourceRange subresourceRange;
-        VkFence copyFence;
-        VkFenceCreateInfo fenceCreateInfo = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = VK_FLAGS_NONE
-        };
-        VkSubmitInfo submitInfo = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = NULL
-        };
         ktx_uint8_t* pMappedStagingBuffer;
+        VkDeviceSize stagingOffset = 0;
+        VkDeviceSize stagingSize;
         ktx_uint32_t numCopyRegions;
         user_cbdata_optimal cbData;
 
@@ -1022,42 +1354,67 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
             return KTX_OUT_OF_MEMORY;
         }
 
-        // This buffer is used as a transfer source for the buffer copy
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkCreateBuffer(vdi->device, &bufferCreateInfo,
-                                       vdi->pAllocator, &stagingBuffer));
-
-        // Get memory requirements for the staging buffer (alignment,
-        // memory type bits)
-        vdi->vkFuncs.vkGetBufferMemoryRequirements(vdi->device, stagingBuffer, &memReqs);
-
-        memAllocInfo.allocationSize = memReqs.size;
-        // Get memory type index for a host visible buffer
-        memAllocInfo.memoryTypeIndex = ktxVulkanDeviceInfo_getMemoryType(
-                vdi,
-                memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-              | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
+        if (ring != NULL
+            && ktxVulkanStagingRing_alloc(ring, bufferCreateInfo.size,
+                                          lcm4(elementSize), &stagingOffset))
+        {
+            // Sub-allocate from the persistently mapped staging ring.
+            stagingBuffer = ring->buffer;
+            pMappedStagingBuffer = ring->pMapped;
+            stagingSize = bufferCreateInfo.size;
+            staging->buffer = stagingBuffer;
+            staging->ring = ring;
+            staging->offset = stagingOffset;
+        } else {
+            // This buffer is used as a transfer source for the buffer copy
+            bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            vResult = vdi->vkFuncs.vkCreateBuffer(vdi->device,
+                                                  &bufferCreateInfo,
+                                                  vdi->pAllocator,
+                                                  &stagingBuffer);
+            if (vResult != VK_SUCCESS) {
+                kResult = KTX_OUT_OF_MEMORY;
+                goto cleanupOptimal;
+            }
+            staging->buffer = stagingBuffer;
+
+            // Get memory requirements for the staging buffer (alignment,
+            // memory type bits)
+            vdi->vkFuncs.vkGetBufferMemoryRequirements(vdi->device, stagingBuffer, &memReqs);
+
+            memAllocInfo.allocationSize = memReqs.size;
+            // Get memory type index for a host visible buffer
+            memAllocInfo.memoryTypeIndex = ktxVulkanDeviceInfo_getMemoryType(
+                    vdi,
+                    memReqs.memoryTypeBits,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
 
-        vResult = vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo,
-                                  vdi->pAllocator, &stagingMemory);
-        if (vResult != VK_SUCCESS) {
-            return KTX_OUT_OF_MEMORY;
+            vResult = vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo,
+                                      vdi->pAllocator, &stagingMemory);
+            if (vResult != VK_SUCCESS) {
+                kResult = KTX_OUT_OF_MEMORY;
+                goto cleanupOptimal;
+            }
+            staging->memory = stagingMemory;
+            vResult = vdi->vkFuncs.vkBindBufferMemory(vdi->device,
+                                                      stagingBuffer,
+                                                      stagingMemory, 0);
+            if (vResult == VK_SUCCESS)
+                vResult = vdi->vkFuncs.vkMapMemory(vdi->device, stagingMemory,
+                                                   0, memReqs.size, 0,
+                                            (void **)&pMappedStagingBuffer);
+            if (vResult != VK_SUCCESS) {
+                kResult = KTX_OUT_OF_MEMORY;
+                goto cleanupOptimal;
+            }
+            stagingSize = memReqs.size;
         }
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkBindBufferMemory(vdi->device, stagingBuffer,
-                                           stagingMemory, 0));
-
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkMapMemory(vdi->device, stagingMemory, 0,
-                                    memReqs.size, 0,
-                                    (void **)&pMappedStagingBuffer));
 
-        cbData.offset = 0;
+        cbData.offset = stagingOffset;
         cbData.region = copyRegions;
         cbData.numFaces = This->numFaces;
         cbData.numLayers = This->numLayers;
@@ -1074,25 +1431,25 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
             if (This->pData) {
                 // Image data has already been loaded. Copy to staging
                 // buffer.
-                assert(This->dataSize <= memAllocInfo.allocationSize);
-                memcpy(pMappedStagingBuffer, This->pData, This->dataSize);
+                assert(This->dataSize <= stagingSize);
+                memcpy(pMappedStagingBuffer + stagingOffset, This->pData,
+                       This->dataSize);
+                kResult = KTX_SUCCESS;
             } else {
                 /* Load the image data directly into the staging buffer. */
                 /* The strange cast quiets an Xcode warning when building
                  * for the Generic iOS Device where size_t is 32-bit even
                  * when building for arm64. */
                 kResult = ktxTexture_LoadImageData(This,
-                                      pMappedStagingBuffer,
-                                      (ktx_size_t)memAllocInfo.allocationSize);
-                if (kResult != KTX_SUCCESS)
-                    return kResult;
+                                      pMappedStagingBuffer + stagingOffset,
+                                      (ktx_size_t)stagingSize);
             }
 
             // Iterate over mip levels to set up the copy regions.
-            kResult = ktxTexture_IterateLevels(This,
-                                               optimalTilingCallback,
-                                               &cbData);
-            // XXX Check for possible errors.
+            if (kResult == KTX_SUCCESS)
+                kResult = ktxTexture_IterateLevels(This,
+                                                   optimalTilingCallback,
+                                                   &cbData);
         } else {
             // Iterate over face-levels with callback that copies the
             // face-levels to Vulkan-valid offsets in the staging buffer while
@@ -1108,11 +1465,13 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
                                             This,
                                             optimalTilingPadCallback,
                                             &cbData);
-                // XXX Check for possible errors.
             }
         }
 
-        vdi->vkFuncs.vkUnmapMemory(vdi->device, stagingMemory);
+        if (stagingMemory != VK_NULL_HANDLE)
+            vdi->vkFuncs.vkUnmapMemory(vdi->device, stagingMemory);
+        if (kResult != KTX_SUCCESS)
+            goto cleanupOptimal;
 
         // Create optimal tiled target image
         imageCreateInfo.imageType = imageType;
@@ -1130,9 +1489,14 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         imageCreateInfo.extent.height = vkTexture->height;
         imageCreateInfo.extent.depth = vkTexture->depth;
 
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkCreateImage(vdi->device, &imageCreateInfo,
-                                      vdi->pAllocator, &vkTexture->image));
+        vResult = vdi->vkFuncs.vkCreateImage(vdi->device, &imageCreateInfo,
+                                             vdi->pAllocator,
+                                             &vkTexture->image);
+        if (vResult != VK_SUCCESS) {
+            vkTexture->image = VK_NULL_HANDLE;
+            kResult = KTX_OUT_OF_MEMORY;
+            goto cleanupOptimal;
+        }
 
         vdi->vkFuncs.vkGetImageMemoryRequirements(vdi->device, vkTexture->image, &memReqs);
 
@@ -1141,13 +1505,20 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         memAllocInfo.memoryTypeIndex = ktxVulkanDeviceInfo_getMemoryType(
                                           vdi, memReqs.memoryTypeBits,
                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo,
-                                         vdi->pAllocator,
-                                         &vkTexture->deviceMemory));
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkBindImageMemory(vdi->device, vkTexture->image,
-                                          vkTexture->deviceMemory, 0));
+        vResult = vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo,
+                                                vdi->pAllocator,
+                                                &vkTexture->deviceMemory);
+        if (vResult != VK_SUCCESS)
+            vkTexture->deviceMemory = VK_NULL_HANDLE;
+        else
+            vResult = vdi->vkFuncs.vkBindImageMemory(vdi->device,
+                                                     vkTexture->image,
+                                                     vkTexture->deviceMemory,
+                                                     0);
+        if (vResult != VK_SUCCESS) {
+            kResult = KTX_OUT_OF_MEMORY;
+            goto cleanupOptimal;
+        }
 
         subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         subresourceRange.baseMipLevel = 0;
@@ -1160,7 +1531,7 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         // destination.
         setImageLayout(
             vdi->vkFuncs,
-            vdi->cmdBuffer,
+            cmdBuffer,
             vkTexture->image,
             VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -1168,7 +1539,7 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
 
         // Copy mip levels from staging buffer
         vdi->vkFuncs.vkCmdCopyBufferToImage(
-            vdi->cmdBuffer, stagingBuffer,
+            cmdBuffer, stagingBuffer,
             vkTexture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             numCopyRegions, copyRegions
             );
@@ -1176,7 +1547,7 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         free(copyRegions);
 
         if (This->generateMipmaps) {
-            generateMipmaps(vkTexture, vdi,
+            generateMipmaps(vkTexture, vdi, cmdBuffer,
                             blitFilter, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
         } else {
             // Transition image layout to finalLayout after all mip levels
@@ -1185,48 +1556,28 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
             //subresourceRange.levelCount = numImageLevels;
             setImageLayout(
                 vdi->vkFuncs,
-                vdi->cmdBuffer,
+                cmdBuffer,
                 vkTexture->image,
                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                 finalLayout,
                 subresourceRange);
         }
+        // The staging buffer must live until the commands have executed.
+        // A buffer of its own can be handed to the ring to be destroyed
+        // when they have.
+        staging->ring = ring;
+        return KTX_SUCCESS;
 
-        // Submit command buffer containing copy and image layout commands
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkEndCommandBuffer(vdi->cmdBuffer));
-
-        // Create a fence to make sure that the copies have finished before
-        // continuing
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkCreateFence(vdi->device, &fenceCreateInfo,
-                                      vdi->pAllocator, &copyFence));
-
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &vdi->cmdBuffer;
-
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkQueueSubmit(vdi->queue, 1, &submitInfo, copyFence));
-
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkWaitForFences(vdi->device, 1, &copyFence,
-                                        VK_TRUE, DEFAULT_FENCE_TIMEOUT));
-
-        vdi->vkFuncs.vkDestroyFence(vdi->device, copyFence, vdi->pAllocator);
-
-        // Clean up staging resources
-        vdi->vkFuncs.vkFreeMemory(vdi->device, stagingMemory, vdi->pAllocator);
-        vdi->vkFuncs.vkDestroyBuffer(vdi->device, stagingBuffer, vdi->pAllocator);
+      cleanupOptimal:
+        free(copyRegions);
+        ktxVulkanTexture_Destruct(vkTexture, vdi->device, vdi->pAllocator);
+        ktxVulkanStaging_Destruct(staging, vdi->device, vdi->pAllocator);
+        return kResult;
     }
     else
     {
         VkImage mappableImage;
         VkDeviceMemory mappableMemory;
-        VkFence nullFence = { VK_NULL_HANDLE };
-        VkSubmitInfo submitInfo = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = NULL
-        };
         user_cbdata_linear cbData;
         PFNKTXITERCB callback;
 
@@ -1246,9 +1597,13 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
 
         // Load mip map level 0 to linear tiling image
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkCreateImage(vdi->device, &imageCreateInfo,
-                                      vdi->pAllocator, &mappableImage));
+        vResult = vdi->vkFuncs.vkCreateImage(vdi->device, &imageCreateInfo,
+                                             vdi->pAllocator, &mappableImage);
+        if (vResult != VK_SUCCESS) {
+            return KTX_OUT_OF_MEMORY;
+        }
+        // Linear tiled images can be directly used as textures.
+        vkTexture->image = mappableImage;
 
         // Get memory requirements for this image
         // like size and alignment
@@ -1266,11 +1621,12 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
         vResult = vdi->vkFuncs.vkAllocateMemory(vdi->device, &memAllocInfo, vdi->pAllocator,
                                   &mappableMemory);
         if (vResult != VK_SUCCESS) {
-            return KTX_OUT_OF_MEMORY;
+            kResult = KTX_OUT_OF_MEMORY;
+            goto cleanupLinear;
         }
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkBindImageMemory(vdi->device, mappableImage,
-                                          mappableMemory, 0));
+        vkTexture->deviceMemory = mappableMemory;
+        vResult = vdi->vkFuncs.vkBindImageMemory(vdi->device, mappableImage,
+                                                 mappableMemory, 0);
 
         cbData.vkFuncs = vdi->vkFuncs;
         cbData.destImage = mappableImage;
@@ -1280,9 +1636,13 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
                          linearTilingCallback : linearTilingPadCallback;
 
         // Map image memory
-        VK_CHECK_RESULT(
-                vdi->vkFuncs.vkMapMemory(vdi->device, mappableMemory, 0,
-                        memReqs.size, 0, (void **)&cbData.dest));
+        if (vResult == VK_SUCCESS)
+            vResult = vdi->vkFuncs.vkMapMemory(vdi->device, mappableMemory, 0,
+                                  memReqs.size, 0, (void **)&cbData.dest);
+        if (vResult != VK_SUCCESS) {
+            kResult = KTX_OUT_OF_MEMORY;
+            goto cleanupLinear;
+        }
 
         // Iterate over images to copy texture data into mapped image memory.
         if (ktxTexture_isActiveStream(This)) {
@@ -1294,16 +1654,13 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
                                                    callback,
                                                    &cbData);
         }
-        // XXX Check for possible errors
 
         vdi->vkFuncs.vkUnmapMemory(vdi->device, mappableMemory);
-
-        // Linear tiled images can be directly used as textures.
-        vkTexture->image = mappableImage;
-        vkTexture->deviceMemory = mappableMemory;
+        if (kResult != KTX_SUCCESS)
+            goto cleanupLinear;
 
         if (This->generateMipmaps) {
-            generateMipmaps(vkTexture, vdi,
+            generateMipmaps(vkTexture, vdi, cmdBuffer,
                             blitFilter,
                             VK_IMAGE_LAYOUT_PREINITIALIZED);
         } else {
@@ -1317,26 +1674,169 @@ ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
            // Transition image layout to finalLayout.
             setImageLayout(
                 vdi->vkFuncs,
-                vdi->cmdBuffer,
+                cmdBuffer,
                 vkTexture->image,
                 VK_IMAGE_LAYOUT_PREINITIALIZED,
                 finalLayout,
                 subresourceRange);
         }
+        return KTX_SUCCESS;
+
+      cleanupLinear:
+        ktxVulkanTexture_Destruct(vkTexture, vdi->device, vdi->pAllocator);
+        return kResult;
+    }
+}
 
-        // Submit command buffer containing image layout commands
-        VK_CHECK_RESULT(vdi->vkFuncs.vkEndCommandBuffer(vdi->cmdBuffer));
 
-        submitInfo.waitSemaphoreCount = 0;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &vdi->cmdBuffer;
 
-        VK_CHECK_RESULT(vdi->vkFuncs.vkQueueSubmit(vdi->queue, 1, &submitInfo, nullFence));
-        VK_CHECK_RESULT(vdi->vkFuncs.vkQueueWaitIdle(vdi->queue));
+/**
+ * @memberof ktxTexture
+ * @~English
+ * @brief Create a Vulkan image object from a ktxTexture object.
+ *
+ * Creates a VkImage with @c VkFormat etc. matching the KTX data and uploads
+ * the images.  Mipmaps will be generated if the @c ktxTexture's
+ * @c generateMipmaps flag is set. Returns the handles of the created objects
+ * and information about the texture in the @c ktxVulkanTexture pointed at by
+ * @p vkTexture.
+ *
+ * The upload is recorded in the ktxVulkanDeviceInfo's command buffer and
+ * submitted to its queue. The function waits for the commands to complete
+ * before returning. Use ktxTexture_VkRecordUpload() to avoid the wait.
+ *
+ * @p usageFlags and thus acceptable usage of the created image may be
+ * augmented as follows:
+ * - with @c VK_IMAGE_USAGE_TRANSFER_DST_BIT if @p tiling is
+ *   @c VK_IMAGE_TILING_OPTIMAL
+ * - with <code>VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT</code>
+ *   if @c generateMipmaps is set in the @c ktxTexture.
+ *
+ * Most Vulkan implementations support VK_IMAGE_TILING_LINEAR only for a very
+ * limited number of formats and features. Generally VK_IMAGE_TILING_OPTIMAL is
+ * preferred. The latter requires a staging buffer so will use more memory
+ * during loading.
+ *
+ * @param[in] This          pointer to the ktxTexture from which to upload.
+ * @param [in] vdi          pointer to a ktxVulkanDeviceInfo structure providing
+ *                          information about the Vulkan device onto which to
+ *                          load the texture.
+ * @param [in,out] vkTexture pointer to a ktxVulkanTexture structure into which
+ *                           the function writes information about the created
+ *                           VkImage.
+ * @param [in] tiling       type of tiling to use in the destination image
+ *                          on the Vulkan device.
+ * @param [in] usageFlags   a set of VkImageUsageFlags bits indicating the
+ *                          intended usage of the destination image.
+ * @param [in] finalLayout  a VkImageLayout value indicating the desired
+ *                          final layout of the created image.
+ *
+ * @return  KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE @p This, @p vdi or @p vkTexture is @c NULL.
+ * @exception KTX_INVALID_OPERATION The ktxTexture contains neither images nor
+ *                                  an active stream from which to read them.
+ * @exception KTX_INVALID_OPERATION The combination of the ktxTexture's format,
+ *                                  @p tiling and @p usageFlags is not supported
+ *                                  by the physical device.
+ * @exception KTX_INVALID_OPERATION Requested mipmap generation is not supported
+ *                                  by the physical device for the combination
+ *                                  of the ktxTexture's format and @p tiling.
+ * @exception KTX_INVALID_OPERATION Number of mip levels or array layers exceeds the
+ *                                maximums supported for the ktxTexture's format
+ *                                and @p tiling.
+ * @exception KTX_OUT_OF_MEMORY Sufficient memory could not be allocated
+ *                              on either the CPU or the Vulkan device.
+ * @exception KTX_INVALID_OPERATION The upload commands could not be
+ *                                  submitted or did not complete, e.g.
+ *                                  because the device was lost.
+ *
+ * On error no image is created and no resources are left allocated.
+ */
+KTX_error_code
+ktxTexture_VkUploadEx(ktxTexture* This, ktxVulkanDeviceInfo* vdi,
+                      ktxVulkanTexture* vkTexture,
+                      VkImageTiling tiling,
+                      VkImageUsageFlags usageFlags,
+                      VkImageLayout finalLayout)
+{
+    KTX_error_code           kResult;
+    VkResult                 vResult;
+    ktxVulkanStaging         staging;
+    VkFence                  copyFence;
+    VkCommandBufferBeginInfo cmdBufBeginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL
+    };
+    VkFenceCreateInfo fenceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_FLAGS_NONE
+    };
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL
+    };
+
+    if (!vdi) {
+        return KTX_INVALID_VALUE;
     }
-    return KTX_SUCCESS;
-}
 
+    vResult = vdi->vkFuncs.vkBeginCommandBuffer(vdi->cmdBuffer,
+                                                &cmdBufBeginInfo);
+    if (vResult != VK_SUCCESS)
+        return KTX_OUT_OF_MEMORY;
+
+    kResult = ktxTexture_VkRecordUpload(This, vdi, vdi->cmdBuffer, vkTexture,
+                                        tiling, usageFlags, finalLayout,
+                                        NULL, &staging);
+
+    // Submit command buffer containing copy and image layout commands
+    vResult = vdi->vkFuncs.vkEndCommandBuffer(vdi->cmdBuffer);
+    if (kResult != KTX_SUCCESS)
+        return kResult;
+    if (vResult != VK_SUCCESS) {
+        kResult = KTX_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+
+    // Create a fence to make sure that the copies have finished before
+    // continuing
+    vResult = vdi->vkFuncs.vkCreateFence(vdi->device, &fenceCreateInfo,
+                                         vdi->pAllocator, &copyFence);
+    if (vResult != VK_SUCCESS) {
+        kResult = KTX_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &vdi->cmdBuffer;
+
+    vResult = vdi->vkFuncs.vkQueueSubmit(vdi->queue, 1, &submitInfo,
+                                         copyFence);
+    if (vResult == VK_SUCCESS) {
+        vResult = vdi->vkFuncs.vkWaitForFences(vdi->device, 1, &copyFence,
+                                               VK_TRUE,
+                                               DEFAULT_FENCE_TIMEOUT);
+        if (vResult != VK_SUCCESS) {
+            // Nothing can be released while the commands may be pending.
+            // This returns once they complete or the device is lost.
+            vdi->vkFuncs.vkQueueWaitIdle(vdi->queue);
+        }
+    }
+    vdi->vkFuncs.vkDestroyFence(vdi->device, copyFence, vdi->pAllocator);
+    if (vResult != VK_SUCCESS)
+        kResult = vResult == VK_ERROR_OUT_OF_HOST_MEMORY
+                  || vResult == VK_ERROR_OUT_OF_DEVICE_MEMORY
+                  ? KTX_OUT_OF_MEMORY : KTX_INVALID_OPERATION;
+
+  cleanup:
+    // Clean up staging resources
+    ktxVulkanStaging_Destruct(&staging, vdi->device, vdi->pAllocator);
+    if (kResult != KTX_SUCCESS)
+        ktxVulkanTexture_Destruct(vkTexture, vdi->device, vdi->pAllocator);
+    return kResult;
+}
 
 /** @memberof ktxTexture
  * @~English
@@ -1652,12 +2152,14 @@ setImageLayout(
  * @param[in] vkTexture     pointer to an object with information about the
  *                          image for which to generate mipmaps.
  * @param[in] vdi           pointer to an object with information about the
- *                          Vulkan device and command buffer to use.
+ *                          Vulkan device to use.
+ * @param[in] cmdBuffer     the command buffer in which to record the commands.
  * @param[in] blitFilter    the type of filter to use in the @c VkCmdBlitImage.
  * @param[in] initialLayout the layout of the image on entry to the function.
  */
 static void
 generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
+                VkCommandBuffer cmdBuffer,
                 VkFilter blitFilter, VkImageLayout initialLayout)
 {
     VkImageSubresourceRange subresourceRange;
@@ -1671,7 +2173,7 @@ generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
     // Transition base level to SRC_OPTIMAL for blitting.
     setImageLayout(
         vdi->vkFuncs,
-        vdi->cmdBuffer,
+        cmdBuffer,
         vkTexture->image,
         initialLayout,
         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -1712,7 +2214,7 @@ generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
         // Transiton current mip level to transfer dest
         setImageLayout(
             vdi->vkFuncs,
-            vdi->cmdBuffer,
+            cmdBuffer,
             vkTexture->image,
             VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -1720,7 +2222,7 @@ generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
 
         // Blit from previous level
         vdi->vkFuncs.vkCmdBlitImage(
-            vdi->cmdBuffer,
+            cmdBuffer,
             vkTexture->image,
             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
             vkTexture->image,
@@ -1733,7 +2235,7 @@ generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
         // next iteration.
         setImageLayout(
             vdi->vkFuncs,
-            vdi->cmdBuffer,
+            cmdBuffer,
             vkTexture->image,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -1745,7 +2247,7 @@ generateMipmaps(ktxVulkanTexture* vkTexture, ktxVulkanDeviceInfo* vdi,
     subresourceRange.levelCount = vkTexture->levelCount;
     setImageLayout(
         vdi->vkFuncs,
-        vdi->cmdBuffer,
+        cmdBuffer,
         vkTexture->image,
         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
         vkTexture->imageLayout,
@@ -1776,4 +2278,96 @@ ktxVulkanTexture_Destruct(ktxVulkanTexture* vkTexture, VkDevice device,
     vkTexture->vkFreeMemory(device, vkTexture->deviceMemory, pAllocator);
 }
 
+/**
+ * @memberof ktxVulkanStaging
+ * @~English
+ * @brief Destructor for the staging resources returned when recording the
+ *        upload of a texture image.
+ *
+ * Frees the staging buffer and its memory or, if they were sub-allocated
+ * from a staging ring, returns the space to the ring. Must not be called
+ * until the commands recorded by ktxTexture_VkRecordUpload() have
+ * completed. Use ktxVulkanStaging_Release() to hand the resources to the
+ * ring instead of waiting.
+ *
+ * @param staging    pointer to the ktxVulkanStaging to be destructed.
+ * @param device     handle to the Vulkan logical device to which the texture was
+ *                   loaded.
+ * @param pAllocator pointer to the allocator used during loading.
+ */
+void
+ktxVulkanStaging_Destruct(ktxVulkanStaging* staging, VkDevice device,
+                          const VkAllocationCallbacks* pAllocator)
+{
+    if (staging->ring != NULL && staging->memory == VK_NULL_HANDLE) {
+        ktxVulkanStagingRing_release(staging->ring, staging->offset,
+                                     KTX_STAGING_ALLOC_FREE, 0);
+    } else {
+        staging->vkDestroyBuffer(device, staging->buffer, pAllocator);
+        staging->vkFreeMemory(device, staging->memory, pAllocator);
+    }
+    staging->ring = NULL;
+    staging->buffer = VK_NULL_HANDLE;
+    staging->memory = VK_NULL_HANDLE;
+}
+
+/**
+ * @memberof ktxVulkanStaging
+ * @~English
+ * @brief Hand the staging resources of a submitted upload to its staging
+ *        ring.
+ *
+ * Call this once the commands recorded by ktxTexture_VkRecordUpload() have
+ * been submitted. The ring reuses or frees the resources once
+ * ktxVulkanStagingRing_Retire() has been called with a value greater than
+ * or equal to @p submitValue, so the caller need not wait for the commands
+ * to complete. This applies whether the staging data was sub-allocated from
+ * the ring or, because the ring was full, placed in a buffer of its own.
+ *
+ * @param staging     pointer to the ktxVulkanStaging to release.
+ * @param submitValue value identifying the submission containing the
+ *                    upload's commands.
+ *
+ * @returns KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_VALUE     @p staging is @c NULL.
+ * @exception KTX_INVALID_OPERATION The upload was not recorded with a
+ *                                  staging ring. Use
+ *                                  ktxVulkanStaging_Destruct().
+ * @exception KTX_OUT_OF_MEMORY     There was not enough memory to track the
+ *                                  staging buffer. @p staging is unchanged.
+ */
+KTX_error_code
+ktxVulkanStaging_Release(ktxVulkanStaging* staging, ktx_uint64_t submitValue)
+{
+    ktxVulkanStagingRing* ring;
+
+    if (staging == NULL)
+        return KTX_INVALID_VALUE;
+    ring = staging->ring;
+    if (ring == NULL)
+        return KTX_INVALID_OPERATION;
+
+    if (staging->memory == VK_NULL_HANDLE) {
+        ktxVulkanStagingRing_release(ring, staging->offset,
+                                     KTX_STAGING_ALLOC_SUBMITTED,
+                                     submitValue);
+    } else if (submitValue <= ring->retiredValue) {
+        ring->vkDestroyBuffer(ring->device, staging->buffer,
+                              ring->pAllocator);
+        ring->vkFreeMemory(ring->device, staging->memory, ring->pAllocator);
+    } else {
+        KTX_error_code result = ktxVulkanStagingRing_defer(ring,
+                                                           staging->buffer,
+                                                           staging->memory,
+                                                           submitValue);
+        if (result != KTX_SUCCESS)
+            return result;
+    }
+    staging->ring = NULL;
+    staging->buffer = VK_NULL_HANDLE;
+    staging->memory = VK_NULL_HANDLE;
+    return KTX_SUCCESS;
+}
+
 /** @} */
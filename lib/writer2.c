@@ -37,6 +37,7 @@
 #include "filestream.h"
 #include "memstream.h"
 #include "texture2.h"
+#include "threadpool.h"
 
 #include "dfdutils/dfd.h"
 #include "vkformat_enum.h"
@@ -744,6 +745,84 @@ ktxTexture2_WriteToMemory(ktxTexture2* This,
 
 }
 
+typedef struct {
+    ktxTexture2* This;
+    ktx_uint32_t compressionLevel;
+    ZSTD_CCtx** cctxs;        /* One per worker. */
+    ktx_uint8_t* workBuf;
+    ktx_size_t* dstOffsets;   /* Offset of each level's region of workBuf. */
+    ktx_size_t* cmpLengths;   /* Deflated length of each level. */
+} ktxDeflateZstdJobs;
+
+static KTX_error_code
+ktxZstdDeflateErrorToKtx(size_t code)
+{
+    ZSTD_ErrorCode error = ZSTD_getErrorCode(code);
+    switch(error) {
+      case ZSTD_error_parameter_outOfBound:
+        return KTX_INVALID_VALUE;
+      case ZSTD_error_dstSize_tooSmall:
+#ifdef DEBUG
+        assert(false && "Deflate dstSize too small.");
+#else
+        return KTX_OUT_OF_MEMORY;
+#endif
+      case ZSTD_error_workSpace_tooSmall:
+#ifdef DEBUG
+        assert(false && "Deflate workspace too small.");
+#else
+        return KTX_OUT_OF_MEMORY;
+#endif
+      case ZSTD_error_memory_allocation:
+        return KTX_OUT_OF_MEMORY;
+      default:
+        // The remaining errors look like they should only
+        // occur during decompression but just in case.
+#ifdef DEBUG
+        assert(true);
+#endif
+        return KTX_INVALID_OPERATION;
+    }
+}
+
+/*
+ * Deflate a single level. Job @p job deflates level @p job so the largest
+ * levels are started first.
+ */
+static KTX_error_code
+ktxTexture2_deflateZstdLevel(void* userdata, ktx_uint32_t worker,
+                             ktx_uint32_t job)
+{
+    ktxDeflateZstdJobs* jobs = (ktxDeflateZstdJobs*)userdata;
+    ktxTexture2* This = jobs->This;
+    ktxLevelIndexEntry* cindex = This->_private->_levelIndex;
+    ktx_uint32_t level = job;
+    ktx_size_t srcLength = cindex[level].byteLength;
+    size_t levelByteLengthCmp;
+
+    if (jobs->cctxs[worker] == NULL) {
+        jobs->cctxs[worker] = ZSTD_createCCtx();
+        if (jobs->cctxs[worker] == NULL)
+            return KTX_OUT_OF_MEMORY;
+    }
+    ZSTD_CCtx* cctx = jobs->cctxs[worker];
+
+    levelByteLengthCmp =
+        ZSTD_compressCCtx(cctx, jobs->workBuf + jobs->dstOffsets[level],
+                          ZSTD_compressBound(srcLength),
+                          &This->pData[cindex[level].byteOffset],
+                          srcLength,
+                          jobs->compressionLevel);
+    if (ZSTD_isError(levelByteLengthCmp))
+        return ktxZstdDeflateErrorToKtx(levelByteLengthCmp);
+    jobs->cmpLengths[level] = levelByteLengthCmp;
+    return KTX_SUCCESS;
+}
+
+static KTX_error_code
+ktxTexture2_deflateZstdOn(ktxTexture2* This, ktx_uint32_t compressionLevel,
+                          ktxThreadPool* pool, ktx_uint32_t threadCount);
+
 /**
  * @memberof ktxTexture2
  * @~English
@@ -760,93 +839,149 @@ ktxTexture2_WriteToMemory(ktxTexture2* This,
 KTX_error_code
 ktxTexture2_DeflateZstd(ktxTexture2* This, ktx_uint32_t compressionLevel)
 {
-    ktx_uint32_t levelIndexByteLength =
-                            This->numLevels * sizeof(ktxLevelIndexEntry);
-    ktx_uint8_t* workBuf;
+    return ktxTexture2_DeflateZstdEx(This, compressionLevel, 1);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Deflate the data in a ktxTexture2 object using Zstandard and
+ *        multiple threads.
+ *
+ * Each level is deflated as an independent Zstandard frame so levels are
+ * deflated concurrently, each thread using its own compression context.
+ * Each level is deflated on a single thread so the deflated data is the
+ * same as that produced by ktxTexture2_DeflateZstd(), whatever the value of
+ * @p threadCount.
+ *
+ * The texture's levelIndex, dataSize, DFD  and supercompressionScheme will
+ * all be updated after successful deflation to reflect the deflated data.
+ *
+ * @param[in] This pointer to the ktxTexture2 object of interest.
+ * @param[in] compressionLevel set speed vs compression ratio trade-off. Values
+ *            between 1 and 22 are accepted. The lower the level the faster. Values
+ *            above 20 should be used with caution as they require more memory.
+ * @param[in] threadCount maximum number of threads to use.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_OPERATION
+ *                              The texture is already supercompressed.
+ * @exception KTX_INVALID_VALUE @p compressionLevel is out of range.
+ * @exception KTX_OUT_OF_MEMORY Not enough memory to carry out the deflation.
+ */
+KTX_error_code
+ktxTexture2_DeflateZstdEx(ktxTexture2* This, ktx_uint32_t compressionLevel,
+                          ktx_uint32_t threadCount)
+{
+    return ktxTexture2_deflateZstdOn(This, compressionLevel, NULL,
+                                     threadCount);
+}
+
+/**
+ * @memberof ktxTexture2
+ * @~English
+ * @brief Deflate the data in a ktxTexture2 object using Zstandard and the
+ *        threads of a ktxThreadPool.
+ *
+ * Levels are deflated concurrently as for ktxTexture2_DeflateZstdEx() but
+ * on the threads of @p pool. The deflated data is the same as that produced
+ * by ktxTexture2_DeflateZstd().
+ *
+ * @param[in] This pointer to the ktxTexture2 object of interest.
+ * @param[in] compressionLevel set speed vs compression ratio trade-off. Values
+ *            between 1 and 22 are accepted. The lower the level the faster. Values
+ *            above 20 should be used with caution as they require more memory.
+ * @param[in] pool pointer to the pool whose threads to use. If @c NULL the
+ *            levels are deflated on the calling thread.
+ *
+ * @return      KTX_SUCCESS on success, other KTX_* enum values on error.
+ *
+ * @exception KTX_INVALID_OPERATION
+ *                              The texture is already supercompressed.
+ * @exception KTX_INVALID_VALUE @p compressionLevel is out of range.
+ * @exception KTX_OUT_OF_MEMORY Not enough memory to carry out the deflation.
+ */
+KTX_error_code
+ktxTexture2_DeflateZstdWithPool(ktxTexture2* This,
+                                ktx_uint32_t compressionLevel,
+                                ktxThreadPool* pool)
+{
+    return ktxTexture2_deflateZstdOn(This, compressionLevel, pool, 1);
+}
+
+/*
+ * Deflate the levels of This on @p pool, if not NULL, otherwise on up to
+ * @p threadCount new threads.
+ */
+static KTX_error_code
+ktxTexture2_deflateZstdOn(ktxTexture2* This, ktx_uint32_t compressionLevel,
+                          ktxThreadPool* pool, ktx_uint32_t threadCount)
+{
+    ktxDeflateZstdJobs jobs;
     ktx_uint8_t* cmpData;
-    ktx_size_t dstRemainingByteLength = 0;
+    ktx_size_t workBufByteLength = 0;
     ktx_size_t byteLengthCmp = 0;
     ktx_size_t levelOffset = 0;
     ktxLevelIndexEntry* cindex = This->_private->_levelIndex;
-    ktxLevelIndexEntry* nindex;
-    ktx_uint8_t* pCmpDst;
-
-    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ktx_uint32_t workers, w;
+    KTX_error_code result;
 
     if (This->supercompressionScheme != KTX_SS_NONE)
         return KTX_INVALID_OPERATION;
 
+    workers = ktxJobWorkerCountOn(pool, threadCount, This->numLevels);
+    memset(&jobs, 0, sizeof(jobs));
+    jobs.This = This;
+    jobs.compressionLevel = compressionLevel;
+    jobs.cctxs = calloc(workers, sizeof(ZSTD_CCtx*));
+    jobs.dstOffsets = malloc(This->numLevels * sizeof(ktx_size_t));
+    jobs.cmpLengths = malloc(This->numLevels * sizeof(ktx_size_t));
+    if (!jobs.cctxs || !jobs.dstOffsets || !jobs.cmpLengths) {
+        result = KTX_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+
     // On rare occasions the deflated data can be a few bytes larger than
     // the source data. Calculating the dst buffer size using
     // ZSTD_compressBound provides a suitable size plus compression is said
-    // to run faster when the dst buffer is >= compressBound.
+    // to run faster when the dst buffer is >= compressBound. Each level
+    // has its own region so the levels can be deflated concurrently.
     for (int32_t level = This->numLevels - 1; level >= 0; level--) {
-        dstRemainingByteLength += ZSTD_compressBound(cindex[level].byteLength);
+        jobs.dstOffsets[level] = workBufByteLength;
+        workBufByteLength += ZSTD_compressBound(cindex[level].byteLength);
     }
 
-    workBuf = malloc(dstRemainingByteLength + levelIndexByteLength);
-    if (workBuf == NULL)
-        return KTX_OUT_OF_MEMORY;
-    nindex = (ktxLevelIndexEntry*)workBuf;
-    pCmpDst = &workBuf[levelIndexByteLength];
-
-    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
-        size_t levelByteLengthCmp =
-            ZSTD_compressCCtx(cctx, pCmpDst + levelOffset,
-                              dstRemainingByteLength,
-                              &This->pData[cindex[level].byteOffset],
-                              cindex[level].byteLength,
-                              compressionLevel);
-        if (ZSTD_isError(levelByteLengthCmp)) {
-            free(workBuf);
-            ZSTD_ErrorCode error = ZSTD_getErrorCode(levelByteLengthCmp);
-            switch(error) {
-              case ZSTD_error_parameter_outOfBound:
-                return KTX_INVALID_VALUE;
-              case ZSTD_error_dstSize_tooSmall:
-#ifdef DEBUG
-                assert(false && "Deflate dstSize too small.");
-#else
-                return KTX_OUT_OF_MEMORY;
-#endif
-              case ZSTD_error_workSpace_tooSmall:
-#ifdef DEBUG
-                assert(false && "Deflate workspace too small.");
-#else
-                return KTX_OUT_OF_MEMORY;
-#endif
-              case ZSTD_error_memory_allocation:
-                return KTX_OUT_OF_MEMORY;
-              default:
-                // The remaining errors look like they should only
-                // occur during decompression but just in case.
-#ifdef DEBUG
-                assert(true);
-#else
-                return KTX_INVALID_OPERATION;
-#endif
-            }
-        }
-        nindex[level].byteOffset = levelOffset;
-        nindex[level].uncompressedByteLength = cindex[level].byteLength;
-        nindex[level].byteLength = levelByteLengthCmp;
-        byteLengthCmp += levelByteLengthCmp;
-        levelOffset += levelByteLengthCmp;
-        dstRemainingByteLength -= levelByteLengthCmp;
+    jobs.workBuf = malloc(workBufByteLength);
+    if (jobs.workBuf == NULL) {
+        result = KTX_OUT_OF_MEMORY;
+        goto cleanup;
     }
-    ZSTD_freeCCtx(cctx);
+
+    result = ktxRunJobsOn(pool, threadCount, This->numLevels,
+                          ktxTexture2_deflateZstdLevel, &jobs);
+    if (result != KTX_SUCCESS)
+        goto cleanup;
+
+    for (ktx_uint32_t level = 0; level < This->numLevels; level++)
+        byteLengthCmp += jobs.cmpLengths[level];
 
     // Move the compressed data into a correctly sized buffer.
     cmpData = malloc(byteLengthCmp);
     if (cmpData == NULL) {
-        free(workBuf);
-        return KTX_OUT_OF_MEMORY;
+        result = KTX_OUT_OF_MEMORY;
+        goto cleanup;
     }
     // Now modify the texture.
-    memcpy(cmpData, pCmpDst, byteLengthCmp); // Copy data to sized buffer.
-    memcpy(cindex, nindex, levelIndexByteLength); // Update level index
-    free(workBuf);
-    free(This->pData);
+    for (int32_t level = This->numLevels - 1; level >= 0; level--) {
+        memcpy(cmpData + levelOffset, jobs.workBuf + jobs.dstOffsets[level],
+               jobs.cmpLengths[level]);
+        cindex[level].byteOffset = levelOffset;
+        cindex[level].uncompressedByteLength = cindex[level].byteLength;
+        cindex[level].byteLength = jobs.cmpLengths[level];
+        levelOffset += jobs.cmpLengths[level];
+    }
+    ktxTexture_freeData(ktxTexture(This));
     This->pData = cmpData;
     This->dataSize = byteLengthCmp;
     This->supercompressionScheme = KTX_SS_ZSTD;
@@ -855,7 +990,16 @@ ktxTexture2_DeflateZstd(ktxTexture2* This, ktx_uint32_t compressionLevel)
     uint32_t* bdb = This->pDfd + 1;
     bdb[KHR_DF_WORD_BYTESPLANE0] = 0; /* bytesPlane3..0 = 0 */
 
-    return KTX_SUCCESS;
+cleanup:
+    if (jobs.cctxs) {
+        for (w = 0; w < workers; w++)
+            ZSTD_freeCCtx(jobs.cctxs[w]);
+        free(jobs.cctxs);
+    }
+    free(jobs.workBuf);
+    free(jobs.dstOffsets);
+    free(jobs.cmpLengths);
+    return result;
 }
 
 /** @} */
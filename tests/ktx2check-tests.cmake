@@ -177,3 +177,15 @@ set_tests_properties(
 PROPERTIES
     WILL_FAIL TRUE
 )
+
+# Files validated concurrently must give the same output, in the same order,
+# and exit code as when validated one at a time. Each file is listed 3 times
+# so there are more files than threads.
+add_test( NAME ktx2check-test-threads-match-serial
+    COMMAND ${BASH_EXECUTABLE} -c "files='*.ktx2 *.ktx2 *.ktx2'; diff <($<TARGET_FILE:ktx2check> --threads 1 $files 2>&1; echo exit $?) <($<TARGET_FILE:ktx2check> --threads 4 $files 2>&1; echo exit $?) && test $($<TARGET_FILE:ktx2check> --threads 4 $files 2>&1 | grep -c 'Issues in') -eq 12"
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/badktx2
+)
+add_test( NAME ktx2check-test-threads-match-serial-quiet
+    COMMAND ${BASH_EXECUTABLE} -c "files='*.ktx2 *.ktx2 *.ktx2'; diff <($<TARGET_FILE:ktx2check> --quiet --threads 1 $files 2>&1; echo exit $?) <($<TARGET_FILE:ktx2check> --quiet --threads 4 $files 2>&1; echo exit $?)"
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/badktx2
+)
@@ -12,6 +12,9 @@ enable_testing()
 
 add_subdirectory(transcodetests)
 add_subdirectory(streamtests)
+if(KTX_FEATURE_VULKAN)
+    add_subdirectory(vkuploadtests)
+endif()
 
 add_executable( unittests
     unittests/unittests.cc
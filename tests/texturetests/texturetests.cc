@@ -24,7 +24,10 @@
 #endif
 
 #include <string>
+#include <thread>
+#include <vector>
 #include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include "GL/glcorearb.h"
@@ -1145,6 +1148,269 @@ TEST_F(ktxTexture2_LoadImageDataTest, LoadImageDataExternal) {
     }
 }
 
+static bool
+writeTestFile(const char* filename, const ktx_uint8_t* data, ktx_size_t size)
+{
+    FILE* f = fopen(filename, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+TEST_F(ktxTexture2_LoadImageDataTest, LoadImageDataMapped) {
+    ktxTexture2* texture = 0;
+    KTX_error_code result;
+    const char* filename = "ktxTexture2_LoadImageDataMapped.ktx2";
+
+    if (ktxMemFile != NULL) {
+        ASSERT_TRUE(writeTestFile(filename, ktxMemFile, ktxMemFileLen));
+        result = ktxTexture2_CreateFromNamedFile(filename,
+                                        KTX_TEXTURE_CREATE_MMAP_BIT,
+                                        &texture);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture2_CreateFromNamedFile failed: "
+                                     << ktxErrorString(result);
+        // The offset is discarded once the data is loaded so get it now.
+        ktx_size_t firstLevelOffset = texture->_private->_firstLevelFileOffset;
+        ASSERT_NE(firstLevelOffset, 0U);
+        result = ktxTexture_LoadImageData(ktxTexture(texture), NULL, 0);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        ASSERT_TRUE(texture->pData != NULL) << "Image data not loaded";
+        EXPECT_EQ(paddedImageDataSize, ktxTexture_GetDataSize(ktxTexture(texture)));
+        EXPECT_EQ(helper.compareTexture2Images(texture->pData), true);
+        // The level data must be used in place, not copied out of the file.
+        ktxFileMap* map = &texture->_protected->_fileMap;
+        ASSERT_TRUE(map->bytes != NULL) << "File was not mapped";
+        EXPECT_EQ(map->size, ktxMemFileLen);
+        EXPECT_EQ(texture->pData, map->bytes + firstLevelOffset);
+        EXPECT_TRUE(ktxTexture_isDataMapped(ktxTexture(texture)));
+        // The mapping is private so writes must be allowed and must not
+        // reach the file.
+        ktx_uint8_t original = texture->pData[0];
+        texture->pData[0] = ~texture->pData[0];
+        ktxTexture_Destroy(ktxTexture(texture));
+        FILE* f = fopen(filename, "rb");
+        ASSERT_TRUE(f != NULL);
+        fseek(f, (long)firstLevelOffset, SEEK_SET);
+        EXPECT_EQ(fgetc(f), original);
+        fclose(f);
+        remove(filename);
+    }
+}
+
+TEST_F(ktxTexture2_LoadImageDataTest, LoadImageDataMappedZstd) {
+    ktxTexture2* texture = 0;
+    ktx_uint8_t* deflatedFile;
+    ktx_size_t deflatedFileLen;
+    KTX_error_code result;
+    const char* filename = "ktxTexture2_LoadImageDataMappedZstd.ktx2";
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &texture);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture2_DeflateZstd(texture, 5), KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture_WriteToMemory(ktxTexture(texture),
+                                           &deflatedFile, &deflatedFileLen),
+                  KTX_SUCCESS);
+        ktxTexture_Destroy(ktxTexture(texture));
+        texture = 0;
+        ASSERT_TRUE(writeTestFile(filename, deflatedFile, deflatedFileLen));
+        free(deflatedFile);
+
+        result = ktxTexture_CreateFromNamedFile(filename,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT
+                                        | KTX_TEXTURE_CREATE_MMAP_BIT,
+                                        (ktxTexture**)&texture);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture_CreateFromNamedFile failed: "
+                                     << ktxErrorString(result);
+        ASSERT_TRUE(texture->pData != NULL) << "Image data not loaded";
+        EXPECT_EQ(texture->supercompressionScheme, KTX_SS_NONE);
+        EXPECT_EQ(helper.compareTexture2Images(texture->pData), true);
+        ktxTexture_Destroy(ktxTexture(texture));
+        remove(filename);
+    }
+}
+
+TEST_F(ktxTexture2_LoadImageDataTest, DeflateInflateZstdMultithreaded) {
+    ktxTexture2* serial = 0;
+    ktxTexture2* parallel = 0;
+    ktx_uint8_t* deflatedFile;
+    ktx_size_t deflatedFileLen;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &serial);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &parallel);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture2_DeflateZstd(serial, 5), KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture2_DeflateZstdEx(parallel, 5, 4), KTX_SUCCESS);
+        ASSERT_EQ(parallel->dataSize, serial->dataSize);
+        EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0);
+        for (ktx_uint32_t level = 0; level < serial->numLevels; level++) {
+            EXPECT_EQ(parallel->_private->_levelIndex[level].byteOffset,
+                      serial->_private->_levelIndex[level].byteOffset);
+            EXPECT_EQ(parallel->_private->_levelIndex[level].byteLength,
+                      serial->_private->_levelIndex[level].byteLength);
+        }
+        ASSERT_EQ(ktxTexture_WriteToMemory(ktxTexture(parallel),
+                                           &deflatedFile, &deflatedFileLen),
+                  KTX_SUCCESS);
+        ktxTexture_Destroy(ktxTexture(serial));
+        ktxTexture_Destroy(ktxTexture(parallel));
+
+        result = ktxTexture2_CreateFromMemory(deflatedFile, deflatedFileLen,
+                                              0, &parallel);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        EXPECT_EQ(ktxTexture2_LoadImageDataEx(parallel, NULL, 0, 4),
+                  KTX_SUCCESS);
+        EXPECT_EQ(parallel->supercompressionScheme, KTX_SS_NONE);
+        EXPECT_EQ(paddedImageDataSize, parallel->dataSize);
+        EXPECT_EQ(helper.compareTexture2Images(parallel->pData), true);
+        ktxTexture_Destroy(ktxTexture(parallel));
+        free(deflatedFile);
+    }
+}
+
+TEST(ktxTexture2_DeflateZstdTest, LargeLevelIndependentOfThreadCount) {
+    // One level, larger than a zstd multithreaded job, so the extra threads
+    // have nothing to do. The output must still match single-threaded.
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = 2048;
+    createInfo.baseHeight = 1024;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = 1;
+    createInfo.numLayers = 1;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2* serial;
+    KTX_error_code result;
+    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                                &serial);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_size_t i = 0; i < serial->dataSize; i++)
+        serial->pData[i] = (ktx_uint8_t)((i * 7) ^ (i >> 9));
+
+    ktxTexture2* parallel;
+    result = ktxTexture2_CreateCopy(serial, &parallel);
+    ASSERT_EQ(result, KTX_SUCCESS);
+
+    EXPECT_EQ(ktxTexture2_DeflateZstd(serial, 3), KTX_SUCCESS);
+    EXPECT_EQ(ktxTexture2_DeflateZstdEx(parallel, 3, 4), KTX_SUCCESS);
+    ASSERT_EQ(parallel->dataSize, serial->dataSize);
+    EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0);
+    ktxTexture_Destroy(ktxTexture(serial));
+    ktxTexture_Destroy(ktxTexture(parallel));
+}
+
+TEST_F(ktxTexture2_LoadImageDataTest, LoadLevel) {
+    ktxTexture2* reference = 0;
+    ktxTexture2* texture = 0;
+    ktx_uint8_t* deflatedFile;
+    ktx_size_t deflatedFileLen;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &reference);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture2_DeflateZstd(reference, 5), KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture_WriteToMemory(ktxTexture(reference),
+                                           &deflatedFile, &deflatedFileLen),
+                  KTX_SUCCESS);
+        ktxTexture_Destroy(ktxTexture(reference));
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &reference);
+        ASSERT_EQ(result, KTX_SUCCESS);
+
+        result = ktxTexture2_CreateFromMemory(deflatedFile, deflatedFileLen,
+                                              0, &texture);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        std::vector<ktx_uint8_t> buffer(
+                       ktxTexture2_GetLevelSizeUncompressed(texture, 0));
+        EXPECT_EQ(ktxTexture2_LoadLevel(texture, 0, buffer.data(), 1),
+                  KTX_INVALID_VALUE);
+        EXPECT_EQ(ktxTexture2_LoadLevel(texture, texture->numLevels,
+                                        buffer.data(), buffer.size()),
+                  KTX_INVALID_VALUE);
+        // Smallest first then the base level twice to check the source is
+        // left usable.
+        for (ktx_int32_t level = texture->numLevels - 1; level >= -1; level--) {
+            ktx_uint32_t l = level < 0 ? 0 : level;
+            ktx_size_t levelSize =
+                        ktxTexture2_GetLevelSizeUncompressed(texture, l);
+            EXPECT_EQ(levelSize,
+                      reference->_private->_levelIndex[l].byteLength);
+            EXPECT_EQ(ktxTexture2_LoadLevel(texture, l,
+                                            buffer.data(), buffer.size()),
+                      KTX_SUCCESS);
+            EXPECT_EQ(memcmp(buffer.data(),
+                             reference->pData
+                             + reference->_private->_levelIndex[l].byteOffset,
+                             levelSize), 0) << "Level " << l << " differs";
+        }
+        EXPECT_EQ(texture->pData, (ktx_uint8_t*)NULL);
+        EXPECT_EQ(texture->supercompressionScheme, KTX_SS_ZSTD);
+        EXPECT_EQ(ktxTexture2_LoadImageData(texture, NULL, 0), KTX_SUCCESS);
+        EXPECT_EQ(helper.compareTexture2Images(texture->pData), true);
+        ktxTexture_Destroy(ktxTexture(texture));
+        ktxTexture_Destroy(ktxTexture(reference));
+        free(deflatedFile);
+    }
+}
+
+TEST_F(ktxTexture2_LoadImageDataTest, LoadLevelAfterDeflate) {
+    ktxTexture2* reference = 0;
+    ktxTexture2* texture = 0;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &reference);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                        &texture);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(ktxTexture2_DeflateZstd(texture, 5), KTX_SUCCESS);
+        ASSERT_EQ(texture->supercompressionScheme, KTX_SS_ZSTD);
+        ASSERT_TRUE(texture->pData != NULL);
+
+        std::vector<ktx_uint8_t> buffer(
+                       ktxTexture2_GetLevelSizeUncompressed(texture, 0));
+        for (ktx_uint32_t level = 0; level < texture->numLevels; level++) {
+            ktx_size_t levelSize =
+                        ktxTexture2_GetLevelSizeUncompressed(texture, level);
+            EXPECT_EQ(ktxTexture2_LoadLevel(texture, level,
+                                            buffer.data(), buffer.size()),
+                      KTX_SUCCESS);
+            EXPECT_EQ(memcmp(buffer.data(),
+                             reference->pData
+                             + reference->_private->_levelIndex[level].byteOffset,
+                             levelSize), 0) << "Level " << level << " differs";
+        }
+        ktxTexture_Destroy(ktxTexture(texture));
+        ktxTexture_Destroy(ktxTexture(reference));
+    }
+}
+
 /////////////////////////////////////////////
 // ktxTexture2_CreateCopyTest
 ////////////////////////////////////////////
@@ -2299,6 +2565,1426 @@ TEST_F(ktxTexture2_BasisCompressTest, Compress) {
     }
 }
 
+TEST_F(ktxTexture2_BasisCompressTest, TranscodeMultithreaded) {
+    ktxTexture2* texture;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                              KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                              &texture);
+        ASSERT_TRUE(result == KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture_CreateFromMemory failed: "
+                                     << ktxErrorString(result);
+
+        result = ktxTexture2_CompressBasis(texture, 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ktx_uint8_t* basisFile;
+        ktx_size_t basisFileLen;
+        result = ktxTexture_WriteToMemory(ktxTexture(texture),
+                                          &basisFile, &basisFileLen);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ktxTexture_Destroy(ktxTexture(texture));
+
+        const ktx_transcode_fmt_e formats[] = {
+            KTX_TTF_BC1_RGB, KTX_TTF_ETC2_RGBA, KTX_TTF_RGBA32
+        };
+        for (auto format : formats) {
+            ktxTexture2* serial;
+            ktxTexture2* parallel;
+            result = ktxTexture2_CreateFromMemory(basisFile, basisFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &serial);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_CreateFromMemory(basisFile, basisFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &parallel);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasis(serial, format, 0);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasisEx(parallel, format, 0, 4);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            ASSERT_EQ(parallel->dataSize, serial->dataSize);
+            EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0)
+                << "Transcoded data differs for format " << format;
+            ktxTexture_Destroy(ktxTexture(serial));
+            ktxTexture_Destroy(ktxTexture(parallel));
+        }
+        free(basisFile);
+    }
+}
+
+TEST_F(ktxTexture2_BasisCompressTest, TranscodeImage) {
+    ktxTexture2* texture;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                              KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                              &texture);
+        ASSERT_TRUE(result == KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture_CreateFromMemory failed: "
+                                     << ktxErrorString(result);
+
+        result = ktxTexture2_CompressBasis(texture, 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ktx_uint8_t* basisFile;
+        ktx_size_t basisFileLen;
+        result = ktxTexture_WriteToMemory(ktxTexture(texture),
+                                          &basisFile, &basisFileLen);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ktxTexture_Destroy(ktxTexture(texture));
+
+        // Transcode each image into a buffer whose rows are padded and
+        // check it matches the image from transcoding the whole texture.
+        struct { ktx_transcode_fmt_e format; ktx_uint32_t blockDim, blockBytes; }
+        const formats[] = {
+            { KTX_TTF_BC1_RGB, 4, 8 },
+            { KTX_TTF_RGBA32, 1, 4 }
+        };
+        const ktx_uint32_t padding = 16;
+        for (auto& f : formats) {
+            ktxTexture2* whole;
+            ktxTexture2* source;
+            result = ktxTexture2_CreateFromMemory(basisFile, basisFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &whole);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_CreateFromMemory(basisFile, basisFileLen,
+                                            KTX_TEXTURE_CREATE_NO_FLAGS,
+                                            &source);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasis(whole, f.format, 0);
+            ASSERT_EQ(result, KTX_SUCCESS);
+
+            ktx_uint32_t baseRowBytes = f.blockBytes
+                   * ((whole->baseWidth + f.blockDim - 1) / f.blockDim);
+            ktx_uint32_t baseRows
+                   = (whole->baseHeight + f.blockDim - 1) / f.blockDim;
+            ktx_uint32_t rowPitch = baseRowBytes + padding;
+            std::vector<ktx_uint8_t> dst(rowPitch * baseRows);
+            result = ktxTexture2_TranscodeBasisImage(source, 0, 0, 0,
+                                               f.format, 0, dst.data(),
+                                               dst.size() - 1, rowPitch);
+            EXPECT_EQ(result, KTX_INVALID_VALUE);
+            result = ktxTexture2_TranscodeBasisImage(source, 0, 0, 0,
+                                               f.format, 0, dst.data(),
+                                               dst.size(), baseRowBytes - 1);
+            EXPECT_EQ(result, KTX_INVALID_VALUE);
+            // Large enough that shifting by it would be undefined.
+            result = ktxTexture2_TranscodeBasisImage(source, 40, 0, 0,
+                                               f.format, 0, dst.data(),
+                                               dst.size(), rowPitch);
+            EXPECT_EQ(result, KTX_INVALID_VALUE);
+
+            // The queried size is what a tightly packed image needs.
+            ktx_size_t imageSize;
+            result = ktxTexture2_GetTranscodedImageSize(source, 0, f.format,
+                                                        0, &imageSize);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            EXPECT_EQ(imageSize, (ktx_size_t)baseRowBytes * baseRows);
+            result = ktxTexture2_TranscodeBasisImage(source, 0, 0, 0,
+                                               f.format, 0, dst.data(),
+                                               imageSize, 0);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasisImage(source, 0, 0, 0,
+                                               f.format, 0, dst.data(),
+                                               imageSize - 1, 0);
+            EXPECT_EQ(result, KTX_INVALID_VALUE);
+            result = ktxTexture2_GetTranscodedImageSize(source,
+                                                        source->numLevels,
+                                                        f.format, 0,
+                                                        &imageSize);
+            EXPECT_EQ(result, KTX_INVALID_VALUE);
+
+            for (ktx_uint32_t level = 0; level < whole->numLevels; level++) {
+                ktx_uint32_t levelWidth = MAX(1, whole->baseWidth >> level);
+                ktx_uint32_t levelHeight = MAX(1, whole->baseHeight >> level);
+                ktx_uint32_t levelRowBytes = f.blockBytes
+                       * ((levelWidth + f.blockDim - 1) / f.blockDim);
+                ktx_uint32_t levelRows
+                       = (levelHeight + f.blockDim - 1) / f.blockDim;
+                for (ktx_uint32_t layer = 0; layer < whole->numLayers; layer++) {
+                    for (ktx_uint32_t face = 0; face < whole->numFaces; face++) {
+                        ktx_size_t offset;
+                        result = ktxTexture_GetImageOffset(ktxTexture(whole),
+                                                           level, layer, face,
+                                                           &offset);
+                        ASSERT_EQ(result, KTX_SUCCESS);
+                        result = ktxTexture2_TranscodeBasisImage(source,
+                                                level, layer, face, f.format,
+                                                0, dst.data(), dst.size(),
+                                                rowPitch);
+                        ASSERT_EQ(result, KTX_SUCCESS);
+                        for (ktx_uint32_t row = 0; row < levelRows; row++) {
+                            EXPECT_EQ(memcmp(&dst[row * rowPitch],
+                                        whole->pData + offset + row * levelRowBytes,
+                                        levelRowBytes), 0)
+                                << "Image data differs for format " << f.format
+                                << " at level " << level << ", row " << row;
+                        }
+                    }
+                }
+            }
+            // The source texture must not have been changed.
+            EXPECT_EQ(source->supercompressionScheme, KTX_SS_BASIS_LZ);
+            ktxTexture_Destroy(ktxTexture(whole));
+            ktxTexture_Destroy(ktxTexture(source));
+        }
+        free(basisFile);
+    }
+}
+
+TEST_F(ktxTexture2_BasisCompressTest, CachedCodebooks) {
+    ktxTexture2* texture;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                              KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                              &texture);
+        ASSERT_TRUE(result == KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture_CreateFromMemory failed: "
+                                     << ktxErrorString(result);
+
+        result = ktxTexture2_CompressBasis(texture, 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        EXPECT_TRUE(texture->_private->_basisLzCodebooks == NULL);
+
+        std::vector<ktx_uint8_t> dst(texture->baseWidth * texture->baseHeight * 4);
+        result = ktxTexture2_TranscodeBasisImage(texture, 0, 0, 0,
+                                                 KTX_TTF_RGBA32, 0,
+                                                 dst.data(), dst.size(), 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        struct ktxBasisLzCodebooks* codebooks
+                                    = texture->_private->_basisLzCodebooks;
+        EXPECT_TRUE(codebooks != NULL);
+        result = ktxTexture2_TranscodeBasisImage(texture, 0, 0, 0,
+                                                 KTX_TTF_BC1_RGB, 0,
+                                                 dst.data(), dst.size(), 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        EXPECT_EQ(texture->_private->_basisLzCodebooks, codebooks)
+            << "Codebooks were decoded again";
+
+        ktxTexture2* copy;
+        result = ktxTexture2_CreateCopy(texture, &copy);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        EXPECT_TRUE(copy->_private->_basisLzCodebooks == NULL);
+
+        result = ktxTexture2_TranscodeBasis(texture, KTX_TTF_BC1_RGB, 0);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        EXPECT_TRUE(texture->_private->_basisLzCodebooks == NULL);
+
+        result = ktxTexture2_TranscodeBasis(copy, KTX_TTF_BC1_RGB, 0);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        EXPECT_EQ(copy->dataSize, texture->dataSize);
+        ktxTexture_Destroy(ktxTexture(copy));
+        ktxTexture_Destroy(ktxTexture(texture));
+    }
+}
+
+TEST_F(ktxTexture2_BasisCompressTest, TranscodeMulti) {
+    ktxTexture2* texture;
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                              KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                              &texture);
+        ASSERT_TRUE(result == KTX_SUCCESS);
+        ASSERT_TRUE(texture != NULL) << "ktxTexture_CreateFromMemory failed: "
+                                     << ktxErrorString(result);
+
+        result = ktxTexture2_CompressBasis(texture, 0);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ktx_uint8_t* basisFile;
+        ktx_size_t basisFileLen;
+        result = ktxTexture_WriteToMemory(ktxTexture(texture),
+                                          &basisFile, &basisFileLen);
+        ASSERT_EQ(result, KTX_SUCCESS);
+
+        const ktx_transcode_fmt_e formats[] = {
+            KTX_TTF_BC1_RGB, KTX_TTF_ETC2_RGBA, KTX_TTF_RGBA32
+        };
+        const ktx_uint32_t numTargets = sizeof(formats) / sizeof(formats[0]);
+        ktxTexture2* outputs[numTargets];
+        result = ktxTexture2_TranscodeBasisMulti(texture, numTargets, formats,
+                                                 0, 4, outputs);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        // The source is unchanged.
+        EXPECT_EQ(texture->supercompressionScheme, KTX_SS_BASIS_LZ);
+
+        for (ktx_uint32_t i = 0; i < numTargets; i++) {
+            ktxTexture2* single;
+            result = ktxTexture2_CreateFromMemory(basisFile, basisFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &single);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasis(single, formats[i], 0);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            ASSERT_TRUE(outputs[i] != NULL);
+            EXPECT_EQ(outputs[i]->vkFormat, single->vkFormat);
+            EXPECT_EQ(outputs[i]->supercompressionScheme, KTX_SS_NONE);
+            ASSERT_EQ(outputs[i]->dataSize, single->dataSize);
+            EXPECT_EQ(memcmp(outputs[i]->pData, single->pData, single->dataSize), 0)
+                << "Transcoded data differs for format " << formats[i];
+            EXPECT_EQ(memcmp(outputs[i]->pDfd, single->pDfd, *single->pDfd), 0);
+            ktxTexture_Destroy(ktxTexture(single));
+            ktxTexture_Destroy(ktxTexture(outputs[i]));
+        }
+
+        const ktx_transcode_fmt_e badFormats[] = {
+            KTX_TTF_BC1_RGB, (ktx_transcode_fmt_e)-1
+        };
+        outputs[0] = texture; // Any non-NULL value.
+        result = ktxTexture2_TranscodeBasisMulti(texture, 2, badFormats,
+                                                 0, 1, outputs);
+        EXPECT_EQ(result, KTX_INVALID_VALUE);
+        EXPECT_TRUE(outputs[0] == NULL && outputs[1] == NULL);
+
+        ktxTexture_Destroy(ktxTexture(texture));
+        free(basisFile);
+    }
+}
+
+TEST_F(ktxTexture2_BasisCompressTest, SharedThreadPool) {
+    KTX_error_code result;
+
+    if (ktxMemFile != NULL) {
+        ktxThreadPool* pool;
+        result = ktxThreadPool_Create(4, &pool);
+        ASSERT_EQ(result, KTX_SUCCESS);
+
+        // Using the pool gives the same result as the same number of
+        // threads created by the encoder.
+        ktxTexture2* encoded[2];
+        for (int uastc = 0; uastc < 2; uastc++) {
+            ktxTexture2* own;
+            ktxTexture2* shared;
+            result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &own);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_CreateFromMemory(ktxMemFile, ktxMemFileLen,
+                                            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                            &shared);
+            ASSERT_EQ(result, KTX_SUCCESS);
+
+            ktxBasisParams params = {};
+            params.structSize = sizeof(params);
+            params.uastc = uastc;
+            params.uastcRDO = uastc;
+            params.threadCount = 4;
+            result = ktxTexture2_CompressBasisEx(own, &params);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            params.threadCount = 0;
+            params.threadPool = pool;
+            result = ktxTexture2_CompressBasisEx(shared, &params);
+            EXPECT_EQ(result, KTX_SUCCESS);
+            ASSERT_EQ(shared->dataSize, own->dataSize);
+            EXPECT_EQ(memcmp(shared->pData, own->pData, own->dataSize), 0);
+            EXPECT_EQ(shared->_private->_sgdByteLength,
+                      own->_private->_sgdByteLength);
+            ktxTexture_Destroy(ktxTexture(own));
+            encoded[uastc] = shared;
+        }
+
+        // Transcode both on separate threads at the same time, sharing the
+        // pool, and compare with a serial transcode.
+        ktxTexture2* serial[2];
+        for (int i = 0; i < 2; i++) {
+            result = ktxTexture2_CreateCopy(encoded[i], &serial[i]);
+            ASSERT_EQ(result, KTX_SUCCESS);
+            result = ktxTexture2_TranscodeBasis(serial[i], KTX_TTF_BC3_RGBA, 0);
+            EXPECT_EQ(result, KTX_SUCCESS);
+        }
+        KTX_error_code results[2];
+        std::thread threads[2];
+        for (int i = 0; i < 2; i++) {
+            threads[i] = std::thread([&, i] {
+                results[i] = ktxTexture2_TranscodeBasisWithPool(encoded[i],
+                                                    KTX_TTF_BC3_RGBA, 0, pool);
+            });
+        }
+        for (int i = 0; i < 2; i++) {
+            threads[i].join();
+            EXPECT_EQ(results[i], KTX_SUCCESS);
+            ASSERT_EQ(encoded[i]->dataSize, serial[i]->dataSize);
+            EXPECT_EQ(memcmp(encoded[i]->pData, serial[i]->pData,
+                             serial[i]->dataSize), 0);
+        }
+
+        // Zstd deflate and inflate with the pool.
+        ktx_uint8_t* zstdFile[2];
+        ktx_size_t zstdFileLen[2];
+        ktxTexture2* plain;
+        result = ktxTexture2_CreateCopy(serial[0], &plain);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        result = ktxTexture2_DeflateZstd(serial[0], 5);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        result = ktxTexture2_DeflateZstdWithPool(encoded[0], 5, pool);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        for (int i = 0; i < 2; i++) {
+            ktxTexture2* texture = i ? encoded[0] : serial[0];
+            result = ktxTexture_WriteToMemory(ktxTexture(texture),
+                                              &zstdFile[i], &zstdFileLen[i]);
+            ASSERT_EQ(result, KTX_SUCCESS);
+        }
+        ASSERT_EQ(zstdFileLen[1], zstdFileLen[0]);
+        EXPECT_EQ(memcmp(zstdFile[1], zstdFile[0], zstdFileLen[0]), 0);
+
+        ktxTexture2* inflated;
+        result = ktxTexture2_CreateFromMemory(zstdFile[1], zstdFileLen[1],
+                                              0, &inflated);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        result = ktxTexture2_LoadImageDataWithPool(inflated, NULL, 0, pool);
+        EXPECT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(inflated->dataSize, plain->dataSize);
+        EXPECT_EQ(memcmp(inflated->pData, plain->pData, plain->dataSize), 0);
+
+        ktxTexture_Destroy(ktxTexture(inflated));
+        ktxTexture_Destroy(ktxTexture(plain));
+        for (int i = 0; i < 2; i++) {
+            free(zstdFile[i]);
+            ktxTexture_Destroy(ktxTexture(serial[i]));
+            ktxTexture_Destroy(ktxTexture(encoded[i]));
+        }
+        ktxThreadPool_Destroy(pool);
+    }
+}
+
+/////////////////////////////////////////
+// ktxTexture2_CompressAstc tests
+////////////////////////////////////////
+
+TEST(ktxTexture2_CompressAstcTest, Multithreaded) {
+    // Large enough that level 0 is compressed by all threads together
+    // and the smaller levels one per thread.
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = 256;
+    createInfo.baseHeight = 256;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = 9;
+    createInfo.numLayers = 2;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_TRUE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2* serial;
+    KTX_error_code result;
+    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                                &serial);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_size_t i = 0; i < serial->dataSize; i++)
+        serial->pData[i] = (ktx_uint8_t)((i * 7) ^ (i >> 9));
+
+    ktxTexture2* parallel;
+    result = ktxTexture2_CreateCopy(serial, &parallel);
+    ASSERT_EQ(result, KTX_SUCCESS);
+
+    ktxAstcParams params = {};
+    params.structSize = sizeof(params);
+    params.blockDimension = KTX_PACK_ASTC_BLOCK_DIMENSION_6x6;
+    params.mode = KTX_PACK_ASTC_ENCODER_MODE_LDR;
+    params.qualityLevel = KTX_PACK_ASTC_QUALITY_LEVEL_FASTEST;
+    params.threadCount = 1;
+    result = ktxTexture2_CompressAstcEx(serial, &params);
+    EXPECT_EQ(result, KTX_SUCCESS);
+    params.threadCount = 4;
+    result = ktxTexture2_CompressAstcEx(parallel, &params);
+    EXPECT_EQ(result, KTX_SUCCESS);
+
+    ASSERT_EQ(parallel->dataSize, serial->dataSize);
+    EXPECT_EQ(parallel->vkFormat, (ktx_uint32_t)VK_FORMAT_ASTC_6x6_UNORM_BLOCK);
+    EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0);
+    ktxTexture_Destroy(ktxTexture(serial));
+    ktxTexture_Destroy(ktxTexture(parallel));
+}
+
+// Create a texture with zeroed image data.
+static ktxTexture2*
+createTestTexture(VkFormat vkFormat, ktx_uint32_t width, ktx_uint32_t height,
+                  ktx_uint32_t depth = 1, ktx_uint32_t numLevels = 1,
+                  ktx_uint32_t numLayers = 1)
+{
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = vkFormat;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = width;
+    createInfo.baseHeight = height;
+    createInfo.baseDepth = depth;
+    createInfo.numDimensions = depth > 1 ? 3 : 2;
+    createInfo.numLevels = numLevels;
+    createInfo.numLayers = numLayers;
+    createInfo.numFaces = 1;
+    createInfo.isArray = numLayers > 1 ? KTX_TRUE : KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2* texture = nullptr;
+    if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                           &texture) != KTX_SUCCESS)
+        return nullptr;
+    memset(texture->pData, 0, texture->dataSize);
+    return texture;
+}
+
+// Create a small RGBA8 texture with varied content for the encoders.
+static ktxTexture2*
+createEncoderTestTexture()
+{
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM, 32, 32);
+    if (!texture)
+        return nullptr;
+    for (ktx_size_t i = 0; i < texture->dataSize; i++)
+        texture->pData[i] = (ktx_uint8_t)((i * 7) ^ (i >> 5));
+    return texture;
+}
+
+TEST(ktxTexture2_CompressAstcTest, PreThreadPoolStructSize) {
+    // The struct as it was before threadPool was appended. Whatever
+    // follows it in memory must be ignored.
+    const ktx_uint32_t oldSize = offsetof(ktxAstcParams, inputSwizzle)
+                                 + sizeof(ktxAstcParams::inputSwizzle);
+    ktxTexture2* current = createEncoderTestTexture();
+    ASSERT_TRUE(current != nullptr);
+    ktxTexture2* old;
+    ASSERT_EQ(ktxTexture2_CreateCopy(current, &old), KTX_SUCCESS);
+
+    ktxAstcParams params = {};
+    params.structSize = sizeof(params);
+    params.blockDimension = KTX_PACK_ASTC_BLOCK_DIMENSION_6x6;
+    params.qualityLevel = KTX_PACK_ASTC_QUALITY_LEVEL_FASTEST;
+    params.threadCount = 1;
+    EXPECT_EQ(ktxTexture2_CompressAstcEx(current, &params), KTX_SUCCESS);
+
+    params.threadPool = reinterpret_cast<ktxThreadPool*>(1);
+    params.structSize = oldSize - 1;
+    EXPECT_EQ(ktxTexture2_CompressAstcEx(old, &params), KTX_INVALID_VALUE);
+    params.structSize = sizeof(params) + 1;
+    EXPECT_EQ(ktxTexture2_CompressAstcEx(old, &params), KTX_INVALID_VALUE);
+    params.structSize = oldSize;
+    EXPECT_EQ(ktxTexture2_CompressAstcEx(old, &params), KTX_SUCCESS);
+
+    ASSERT_EQ(old->dataSize, current->dataSize);
+    EXPECT_EQ(memcmp(old->pData, current->pData, current->dataSize), 0);
+    ktxTexture_Destroy(ktxTexture(current));
+    ktxTexture_Destroy(ktxTexture(old));
+}
+
+TEST(ktxTexture2_CompressBasisTest, PreThreadPoolStructSize) {
+    const ktx_uint32_t oldSize =
+        offsetof(ktxBasisParams, uastcRDONoMultithreading)
+        + sizeof(ktx_bool_t);
+    for (int uastc = 0; uastc < 2; uastc++) {
+        ktxTexture2* current = createEncoderTestTexture();
+        ASSERT_TRUE(current != nullptr);
+        ktxTexture2* old;
+        ASSERT_EQ(ktxTexture2_CreateCopy(current, &old), KTX_SUCCESS);
+
+        ktxBasisParams params = {};
+        params.structSize = sizeof(params);
+        params.uastc = uastc;
+        params.threadCount = 1;
+        EXPECT_EQ(ktxTexture2_CompressBasisEx(current, &params),
+                  KTX_SUCCESS);
+
+        params.threadPool = reinterpret_cast<ktxThreadPool*>(1);
+        params.structSize = oldSize - 1;
+        EXPECT_EQ(ktxTexture2_CompressBasisEx(old, &params),
+                  KTX_INVALID_VALUE);
+        params.structSize = sizeof(params) + 1;
+        EXPECT_EQ(ktxTexture2_CompressBasisEx(old, &params),
+                  KTX_INVALID_VALUE);
+        params.structSize = oldSize;
+        EXPECT_EQ(ktxTexture2_CompressBasisEx(old, &params), KTX_SUCCESS);
+
+        ASSERT_EQ(old->dataSize, current->dataSize);
+        EXPECT_EQ(memcmp(old->pData, current->pData, current->dataSize), 0);
+        ktxTexture_Destroy(ktxTexture(current));
+        ktxTexture_Destroy(ktxTexture(old));
+    }
+}
+
+TEST(ktxTexture2_CompressBasisTest, TooWide) {
+    // One more than basisu's maximum dimension. UASTC is encoded without
+    // basis_compressor so must apply the same limit as ETC1S.
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = 16385;
+    createInfo.baseHeight = 1;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = 1;
+    createInfo.numLayers = 1;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    for (int uastc = 0; uastc < 2; uastc++) {
+        ktxTexture2* texture;
+        ASSERT_EQ(ktxTexture2_Create(&createInfo,
+                                     KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                                     &texture),
+                  KTX_SUCCESS);
+        memset(texture->pData, 0x80, texture->dataSize);
+        ktxBasisParams params = {};
+        params.structSize = sizeof(params);
+        params.uastc = uastc;
+        params.threadCount = 1;
+        EXPECT_EQ(ktxTexture2_CompressBasisEx(texture, &params),
+                  KTX_INVALID_OPERATION) << "uastc = " << uastc;
+        EXPECT_EQ(texture->vkFormat,
+                  (ktx_uint32_t)VK_FORMAT_R8G8B8A8_UNORM);
+        ktxTexture_Destroy(ktxTexture(texture));
+    }
+}
+
+/////////////////////////////////////////
+// ktxTexture2_GenerateMipmaps tests
+////////////////////////////////////////
+
+TEST(ktxTexture2_GenerateMipmapsTest, ConstantColorIsPreserved) {
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8G8B8A8_SRGB,
+                                             16, 16, 1, 5, 2);
+    ASSERT_TRUE(texture != nullptr);
+    const ktx_uint8_t color[4] = { 200, 100, 30, 128 };
+    ktx_size_t offset;
+    for (ktx_uint32_t layer = 0; layer < 2; layer++) {
+        ktxTexture2_GetImageOffset(texture, 0, layer, 0, &offset);
+        for (ktx_uint32_t i = 0; i < 16 * 16; i++)
+            memcpy(texture->pData + offset + i * 4, color, 4);
+    }
+
+    KTX_error_code result;
+    result = ktxTexture2_GenerateMipmaps(texture, KTX_MIPMAP_FILTER_LANCZOS3,
+                                         0, 4);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_uint32_t level = 1; level < 5; level++) {
+        ktx_uint32_t size = 16 >> level;
+        for (ktx_uint32_t layer = 0; layer < 2; layer++) {
+            ktxTexture2_GetImageOffset(texture, level, layer, 0, &offset);
+            for (ktx_uint32_t i = 0; i < size * size; i++) {
+                EXPECT_EQ(memcmp(texture->pData + offset + i * 4, color, 4), 0)
+                    << "level " << level << " layer " << layer << " texel " << i;
+            }
+        }
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_GenerateMipmapsTest, BoxFilterAveragesTexels) {
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8_UNORM,
+                                             4, 4, 1, 3, 1);
+    ASSERT_TRUE(texture != nullptr);
+    // Alternating 0 and 200 in both directions.
+    ktx_size_t offset;
+    ktxTexture2_GetImageOffset(texture, 0, 0, 0, &offset);
+    for (ktx_uint32_t y = 0; y < 4; y++)
+        for (ktx_uint32_t x = 0; x < 4; x++)
+            texture->pData[offset + y * 4 + x] = ((x ^ y) & 1) ? 200 : 0;
+
+    KTX_error_code result;
+    result = ktxTexture2_GenerateMipmaps(texture, KTX_MIPMAP_FILTER_BOX, 0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_uint32_t level = 1; level < 3; level++) {
+        ktxTexture2_GetImageOffset(texture, level, 0, 0, &offset);
+        ktx_uint32_t size = 4 >> level;
+        for (ktx_uint32_t i = 0; i < size * size; i++)
+            EXPECT_EQ(texture->pData[offset + i], 100);
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_GenerateMipmapsTest, Filters3DDepth) {
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8_UNORM,
+                                             2, 2, 4, 3, 1);
+    ASSERT_TRUE(texture != nullptr);
+    // Alternating z slices of 0 and 254.
+    ktx_size_t offset;
+    for (ktx_uint32_t z = 0; z < 4; z++) {
+        ktxTexture2_GetImageOffset(texture, 0, 0, z, &offset);
+        memset(texture->pData + offset, (z & 1) ? 254 : 0, 4);
+    }
+
+    KTX_error_code result;
+    result = ktxTexture2_GenerateMipmaps(texture, KTX_MIPMAP_FILTER_BOX, 0, 2);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_uint32_t z = 0; z < 2; z++) {
+        ktxTexture2_GetImageOffset(texture, 1, 0, z, &offset);
+        EXPECT_EQ(texture->pData[offset], 127) << "z " << z;
+    }
+    ktxTexture2_GetImageOffset(texture, 2, 0, 0, &offset);
+    EXPECT_EQ(texture->pData[offset], 127);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_GenerateMipmapsTest, MultithreadedMatchesSerial) {
+    ktxTexture2* serial = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                            64, 48, 1, 6, 1);
+    ASSERT_TRUE(serial != nullptr);
+    for (ktx_size_t i = 0; i < serial->dataSize; i++)
+        serial->pData[i] = (ktx_uint8_t)((i * 7) ^ (i >> 9));
+    ktxTexture2* parallel;
+    ASSERT_EQ(ktxTexture2_CreateCopy(serial, &parallel), KTX_SUCCESS);
+
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(serial, KTX_MIPMAP_FILTER_MITCHELL,
+                                          KTX_MIPMAP_WRAP_BIT, 1),
+              KTX_SUCCESS);
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(parallel, KTX_MIPMAP_FILTER_MITCHELL,
+                                          KTX_MIPMAP_WRAP_BIT, 4),
+              KTX_SUCCESS);
+    EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0);
+    ktxTexture_Destroy(ktxTexture(serial));
+    ktxTexture_Destroy(ktxTexture(parallel));
+}
+
+TEST(ktxTexture2_GenerateMipmapsTest, InvalidArguments) {
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                             8, 8, 1, 1, 1);
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(nullptr, KTX_MIPMAP_FILTER_BOX, 0, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(texture, (ktx_mipmap_filter_e)99,
+                                          0, 1),
+              KTX_INVALID_VALUE);
+    // Only 1 level.
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(texture, KTX_MIPMAP_FILTER_BOX, 0, 1),
+              KTX_INVALID_OPERATION);
+    ktxTexture_Destroy(ktxTexture(texture));
+
+    texture = createTestTexture(VK_FORMAT_R5G6B5_UNORM_PACK16,
+                                8, 8, 1, 4, 1);
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture2_GenerateMipmaps(texture, KTX_MIPMAP_FILTER_BOX, 0, 1),
+              KTX_INVALID_OPERATION);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+/////////////////////////////////////////
+// ktxTexture2_DecodeEtcImage tests
+////////////////////////////////////////
+
+// Create a single level 2D texture with every block set to @p block.
+static ktxTexture2*
+createEtcTestTexture(VkFormat vkFormat, ktx_uint32_t width,
+                     ktx_uint32_t height, const ktx_uint8_t* block,
+                     ktx_uint32_t blockSize)
+{
+    ktxTexture2* texture = createTestTexture(vkFormat, width, height);
+    if (!texture)
+        return nullptr;
+    for (ktx_size_t i = 0; i < texture->dataSize; i += blockSize)
+        memcpy(texture->pData + i, block, blockSize);
+    return texture;
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, IndividualModeClipped) {
+    // Individual mode, not flipped. Left subblock base 0x88, right 0x44,
+    // modifier table 0 and every index 0, i.e. +2.
+    const ktx_uint8_t block[8] = { 0x84, 0x84, 0x84, 0x00, 0, 0, 0, 0 };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,
+                                    5, 6, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+
+    // Pad the rows to check the pitch is honored.
+    const ktx_uint32_t rowPitch = 6 * 4;
+    std::vector<ktx_uint8_t> pixels(rowPitch * 6, 0xCD);
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, pixels.data(),
+                                        pixels.size(), rowPitch, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_uint32_t y = 0; y < 6; y++) {
+        for (ktx_uint32_t x = 0; x < 6; x++) {
+            const ktx_uint8_t* p = &pixels[y * rowPitch + x * 4];
+            if (x == 5) {
+                EXPECT_EQ(p[0], 0xCD) << "Wrote beyond the image";
+                continue;
+            }
+            ktx_uint8_t expected = x % 4 < 2 ? 0x88 + 2 : 0x44 + 2;
+            EXPECT_EQ(p[0], expected) << "at " << x << ", " << y;
+            EXPECT_EQ(p[1], expected);
+            EXPECT_EQ(p[2], expected);
+            EXPECT_EQ(p[3], 255);
+        }
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, Eac11) {
+    // Base 128, multiplier 0, table 0 and every index 4, i.e. +2.
+    const ktx_uint8_t block[8] = { 0x80, 0x00, 0x92, 0x49, 0x24,
+                                   0x92, 0x49, 0x24 };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_EAC_R11_UNORM_BLOCK,
+                                    4, 4, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+
+    ktx_uint16_t values[16];
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0,
+                                        (ktx_uint8_t*)values, sizeof(values),
+                                        0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    // The 11-bit value, 128 * 8 + 4 + 2, extended to 16 bits.
+    const ktx_uint16_t expected = (1030 << 5) | (1030 >> 6);
+    for (ktx_uint32_t i = 0; i < 16; i++)
+        EXPECT_EQ(values[i], expected);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+// Decode a 4x4 RGB8 or RGBA8 block whose pixels in column x are all
+// expected[x] and check the result.
+static void
+checkEtcColumns(VkFormat vkFormat, const ktx_uint8_t* block,
+                ktx_uint32_t blockSize, const ktx_uint8_t expected[4][4])
+{
+    ktxTexture2* texture = createEtcTestTexture(vkFormat, 4, 4, block,
+                                                blockSize);
+    ASSERT_TRUE(texture != nullptr);
+    ktx_uint8_t pixels[4 * 4 * 4];
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, pixels,
+                                        sizeof(pixels), 0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    for (ktx_uint32_t y = 0; y < 4; y++) {
+        for (ktx_uint32_t x = 0; x < 4; x++) {
+            for (ktx_uint32_t c = 0; c < 4; c++) {
+                EXPECT_EQ(pixels[(y * 4 + x) * 4 + c], expected[x][c])
+                    << "at " << x << ", " << y << " channel " << c;
+            }
+        }
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, TMode) {
+    // Red overflows. C1 0xA53, C2 0x888, distance index 2, i.e. 11.
+    // Column x has index x.
+    const ktx_uint8_t block[8] = { 0xF2, 0x53, 0x88, 0x86,
+                                   0xFF, 0x00, 0xF0, 0xF0 };
+    const ktx_uint8_t expected[4][4] = {
+        { 0xAA, 0x55, 0x33, 255 },  // C1
+        { 0x93, 0x93, 0x93, 255 },  // C2 + 11
+        { 0x88, 0x88, 0x88, 255 },  // C2
+        { 0x7D, 0x7D, 0x7D, 255 }   // C2 - 11
+    };
+    checkEtcColumns(VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, block, sizeof(block),
+                    expected);
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, HMode) {
+    // Green overflows. C1 0x246, C2 0xCA8. C1 < C2 so the distance index
+    // is 4, i.e. 23. Column x has index x.
+    const ktx_uint8_t block[8] = { 0x12, 0x07, 0x65, 0x46,
+                                   0xFF, 0x00, 0xF0, 0xF0 };
+    const ktx_uint8_t expected[4][4] = {
+        { 0x39, 0x5B, 0x7D, 255 },  // C1 + 23
+        { 0x0B, 0x2D, 0x4F, 255 },  // C1 - 23
+        { 0xE3, 0xC1, 0x9F, 255 },  // C2 + 23
+        { 0xB5, 0x93, 0x71, 255 }   // C2 - 23
+    };
+    checkEtcColumns(VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, block, sizeof(block),
+                    expected);
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, PlanarMode) {
+    // Blue overflows. Red goes from 0 at O to 255 at H, green is 0x81
+    // everywhere and blue goes from 0 at O to 255 at V.
+    const ktx_uint8_t block[8] = { 0x01, 0x00, 0x04, 0x7F,
+                                   0x80, 0x00, 0x10, 0x3F };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,
+                                    4, 4, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+    ktx_uint8_t pixels[4 * 4 * 4];
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, pixels,
+                                        sizeof(pixels), 0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    const ktx_uint8_t ramp[4] = { 0, 64, 128, 191 };
+    for (ktx_uint32_t y = 0; y < 4; y++) {
+        for (ktx_uint32_t x = 0; x < 4; x++) {
+            const ktx_uint8_t* p = &pixels[(y * 4 + x) * 4];
+            EXPECT_EQ(p[0], ramp[x]) << "at " << x << ", " << y;
+            EXPECT_EQ(p[1], 0x81) << "at " << x << ", " << y;
+            EXPECT_EQ(p[2], ramp[y]) << "at " << x << ", " << y;
+            EXPECT_EQ(p[3], 255);
+        }
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, EacAlpha) {
+    // Alpha base 240, multiplier 2, table 0 and column x has index
+    // 0, 3, 4 and 7 respectively. The last clamps. The color block is
+    // individual mode, base 0, index 0, i.e. +2.
+    const ktx_uint8_t block[16] = { 0xF0, 0x20, 0x00, 0x06, 0xDB, 0x92,
+                                    0x4F, 0xFF,
+                                    0, 0, 0, 0, 0, 0, 0, 0 };
+    const ktx_uint8_t expected[4][4] = {
+        { 2, 2, 2, 240 - 3 * 2 },
+        { 2, 2, 2, 240 - 15 * 2 },
+        { 2, 2, 2, 240 + 2 * 2 },
+        { 2, 2, 2, 255 }
+    };
+    checkEtcColumns(VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, block, sizeof(block),
+                    expected);
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, SignedEac11) {
+    // R: base -128, which is treated as -127, multiplier 0 so the modifier,
+    // +2, is not scaled. G: base 127, multiplier 15 and every index 7,
+    // i.e. +14, which clamps.
+    const ktx_uint8_t block[16] = { 0x80, 0x00, 0x92, 0x49, 0x24,
+                                    0x92, 0x49, 0x24,
+                                    0x7F, 0xF0, 0xFF, 0xFF, 0xFF,
+                                    0xFF, 0xFF, 0xFF };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_EAC_R11G11_SNORM_BLOCK,
+                                    4, 4, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+
+    ktx_int16_t values[16 * 2];
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0,
+                                        (ktx_uint8_t*)values, sizeof(values),
+                                        0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    // -127 * 8 + 2 = -1014 and 1023 extended to 16 bits.
+    const ktx_int16_t expectedR = -((1014 << 5) + (1014 >> 5));
+    const ktx_int16_t expectedG = 32767;
+    for (ktx_uint32_t i = 0; i < 16; i++) {
+        EXPECT_EQ(values[i * 2], expectedR);
+        EXPECT_EQ(values[i * 2 + 1], expectedG);
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, MultithreadedMatchesSerial) {
+    const ktx_uint8_t block[16] = { 0 };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK,
+                                    250, 130, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+    // Arbitrary data covering all modes.
+    for (ktx_size_t i = 0; i < texture->dataSize; i++)
+        texture->pData[i] = (ktx_uint8_t)((i * 2654435761u) >> 13);
+
+    const ktx_size_t size = 250 * 130 * 4;
+    std::vector<ktx_uint8_t> serial(size), parallel(size);
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, serial.data(),
+                                        size, 0, 1);
+    EXPECT_EQ(result, KTX_SUCCESS);
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, parallel.data(),
+                                        size, 0, 4);
+    EXPECT_EQ(result, KTX_SUCCESS);
+    EXPECT_EQ(serial, parallel);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecodeEtcImageTest, InvalidArguments) {
+    const ktx_uint8_t block[8] = { 0 };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK,
+                                    8, 8, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+    ktx_uint8_t pixels[8 * 8 * 4];
+
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(texture, 1, 0, 0, pixels,
+                                         sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+    // Large enough that shifting by it would be undefined.
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(texture, 40, 0, 0, pixels,
+                                         sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, pixels,
+                                         sizeof(pixels) - 1, 0, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, pixels,
+                                         sizeof(pixels), 8 * 4 - 4, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, nullptr,
+                                         sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+    ktxTexture_Destroy(ktxTexture(texture));
+
+    ktxTexture2* rgba = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                          8, 8, 1, 1, 1);
+    ASSERT_TRUE(rgba != nullptr);
+    EXPECT_EQ(ktxTexture2_DecodeEtcImage(rgba, 0, 0, 0, pixels,
+                                         sizeof(pixels), 0, 1),
+              KTX_INVALID_OPERATION);
+    ktxTexture_Destroy(ktxTexture(rgba));
+}
+
+/////////////////////////////////////////
+// ktxTexture_DecodeEtcImage tests
+////////////////////////////////////////
+
+#ifndef GL_ETC1_RGB8_OES
+// Not defined in glcorearb.h.
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+
+// Create a single level 2D KTX texture of arbitrary data.
+static ktxTexture1*
+createEtcTestTexture1(GLenum glInternalformat, ktx_uint32_t width,
+                      ktx_uint32_t height)
+{
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = glInternalformat;
+    createInfo.vkFormat = 0;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = width;
+    createInfo.baseHeight = height;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = 1;
+    createInfo.numLayers = 1;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture1* texture = nullptr;
+    if (ktxTexture1_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                           &texture) != KTX_SUCCESS)
+        return nullptr;
+    for (ktx_size_t i = 0; i < texture->dataSize; i++)
+        texture->pData[i] = (ktx_uint8_t)((i * 2654435761u) >> 13);
+    return texture;
+}
+
+// A KTX texture must decode as the KTX2 texture of the same format and data.
+TEST(ktxTexture_DecodeEtcImageTest, Ktx1MatchesKtx2) {
+    const struct {
+        GLenum glFormat;
+        VkFormat vkFormat;
+        ktx_uint32_t pixelSize;
+    } formats[] = {
+        { GL_ETC1_RGB8_OES, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, 4 },
+        { GL_COMPRESSED_SRGB8_ETC2, VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK, 4 },
+        { GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+          VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK, 4 },
+        { GL_COMPRESSED_RGBA8_ETC2_EAC,
+          VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, 4 },
+        { GL_COMPRESSED_R11_EAC, VK_FORMAT_EAC_R11_UNORM_BLOCK, 2 },
+        { GL_COMPRESSED_SIGNED_RG11_EAC,
+          VK_FORMAT_EAC_R11G11_SNORM_BLOCK, 4 },
+    };
+    const ktx_uint32_t width = 14, height = 9;
+
+    for (const auto& format : formats) {
+        ktxTexture1* texture1 = createEtcTestTexture1(format.glFormat,
+                                                      width, height);
+        ASSERT_TRUE(texture1 != nullptr);
+        const ktx_uint8_t block[16] = { 0 };
+        ktxTexture2* texture2 = createEtcTestTexture(format.vkFormat,
+                                                     width, height, block,
+                                                     sizeof(block));
+        ASSERT_TRUE(texture2 != nullptr);
+        ASSERT_EQ(texture1->dataSize, texture2->dataSize);
+        memcpy(texture2->pData, texture1->pData, texture1->dataSize);
+
+        const ktx_size_t size = width * height * format.pixelSize;
+        std::vector<ktx_uint8_t> pixels1(size), pixels2(size);
+        EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture1), 0, 0, 0,
+                                            pixels1.data(), size, 0, 2),
+                  KTX_SUCCESS);
+        EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture2), 0, 0, 0,
+                                            pixels2.data(), size, 0, 2),
+                  KTX_SUCCESS);
+        EXPECT_EQ(pixels1, pixels2) << "glInternalformat 0x" << std::hex
+                                    << format.glFormat;
+        ktxTexture_Destroy(ktxTexture(texture1));
+        ktxTexture_Destroy(ktxTexture(texture2));
+    }
+}
+
+TEST(ktxTexture_DecodeEtcImageTest, InvalidArguments) {
+    ktx_uint8_t pixels[8 * 8 * 4];
+    EXPECT_EQ(ktxTexture_DecodeEtcImage(nullptr, 0, 0, 0, pixels,
+                                        sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+
+    ktxTexture1* texture = createEtcTestTexture1(GL_COMPRESSED_RGB8_ETC2,
+                                                 8, 8);
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture), 1, 0, 0, pixels,
+                                        sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture), 0, 0, 0, nullptr,
+                                        sizeof(pixels), 0, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture), 0, 0, 0, pixels,
+                                        sizeof(pixels) - 1, 0, 1),
+              KTX_INVALID_VALUE);
+    ktxTexture_Destroy(ktxTexture(texture));
+
+    texture = createEtcTestTexture1(GL_RGBA8, 8, 8);
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture_DecodeEtcImage(ktxTexture(texture), 0, 0, 0, pixels,
+                                        sizeof(pixels), 0, 1),
+              KTX_INVALID_OPERATION);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+/////////////////////////////////////////
+// ktxTexture2_Decompress tests
+////////////////////////////////////////
+
+TEST(ktxTexture2_DecompressTest, Bc1) {
+    // Left block 4-color mode, all red. Right block 3-color mode, all
+    // index 3 which is transparent black for RGBA and opaque black for RGB.
+    const ktx_uint8_t blocks[2][8] = {
+        { 0x00, 0xF8, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x1F, 0x00, 0x00, 0xF8, 0xFF, 0xFF, 0xFF, 0xFF }
+    };
+    const VkFormat formats[2] = { VK_FORMAT_BC1_RGBA_UNORM_BLOCK,
+                                  VK_FORMAT_BC1_RGB_UNORM_BLOCK };
+    for (VkFormat format : formats) {
+        ktxTexture2* texture = createEtcTestTexture(format, 7, 3, blocks[0],
+                                                    sizeof(blocks[0]));
+        ASSERT_TRUE(texture != nullptr);
+        memcpy(texture->pData + 8, blocks[1], sizeof(blocks[1]));
+
+        KTX_error_code result;
+        result = ktxTexture2_Decompress(texture, VK_FORMAT_UNDEFINED, 1);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        EXPECT_EQ(texture->vkFormat, (ktx_uint32_t)VK_FORMAT_R8G8B8A8_UNORM);
+        EXPECT_FALSE(texture->isCompressed);
+        ASSERT_EQ(texture->dataSize, 7U * 3 * 4);
+        const ktx_uint8_t alpha = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK
+                                  ? 255 : 0;
+        for (ktx_uint32_t y = 0; y < 3; y++) {
+            for (ktx_uint32_t x = 0; x < 7; x++) {
+                const ktx_uint8_t* p = texture->pData + (y * 7 + x) * 4;
+                EXPECT_EQ(p[0], x < 4 ? 255 : 0) << "at " << x << ", " << y;
+                EXPECT_EQ(p[1], 0);
+                EXPECT_EQ(p[2], 0);
+                EXPECT_EQ(p[3], x < 4 ? 255 : alpha);
+            }
+        }
+        ktxTexture_Destroy(ktxTexture(texture));
+    }
+}
+
+TEST(ktxTexture2_DecompressTest, Bc2Bc3FourColorOnly) {
+    // Colour endpoints blue then red, so color0 <= color1, which would
+    // select BC1's 3-color mode. Selectors alternate 2 and 3 along rows.
+    // BC2 alpha alternates 0 and 15. BC3 alpha is 0x80 everywhere.
+    const ktx_uint8_t bc2[16] = {
+        0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+        0x1F, 0x00, 0x00, 0xF8, 0xEE, 0xEE, 0xEE, 0xEE
+    };
+    const ktx_uint8_t bc3[16] = {
+        0x80, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x1F, 0x00, 0x00, 0xF8, 0xEE, 0xEE, 0xEE, 0xEE
+    };
+    const struct {
+        VkFormat format;
+        const ktx_uint8_t* block;
+    } cases[2] = {
+        { VK_FORMAT_BC2_UNORM_BLOCK, bc2 },
+        { VK_FORMAT_BC3_UNORM_BLOCK, bc3 }
+    };
+    for (const auto& c : cases) {
+        ktxTexture2* texture = createEtcTestTexture(c.format, 4, 4,
+                                                    c.block, 16);
+        ASSERT_TRUE(texture != nullptr);
+
+        KTX_error_code result;
+        result = ktxTexture2_Decompress(texture, VK_FORMAT_UNDEFINED, 1);
+        ASSERT_EQ(result, KTX_SUCCESS);
+        ASSERT_EQ(texture->dataSize, 4U * 4 * 4);
+        for (ktx_uint32_t i = 0; i < 16; i++) {
+            const ktx_uint8_t* p = texture->pData + i * 4;
+            // Index 2 is 2/3 color0 + 1/3 color1, index 3 the reverse.
+            const bool index3 = i & 1;
+            EXPECT_EQ(p[0], index3 ? 170 : 85) << "at " << i;
+            EXPECT_EQ(p[1], 0) << "at " << i;
+            EXPECT_EQ(p[2], index3 ? 85 : 170) << "at " << i;
+            if (c.format == VK_FORMAT_BC2_UNORM_BLOCK)
+                EXPECT_EQ(p[3], index3 ? 255 : 0) << "at " << i;
+            else
+                EXPECT_EQ(p[3], 0x80) << "at " << i;
+        }
+        ktxTexture_Destroy(ktxTexture(texture));
+    }
+}
+
+TEST(ktxTexture2_DecompressTest, Bc4Snorm) {
+    // Endpoints 127 and -127, every index 1.
+    const ktx_uint8_t block[8] = { 0x7F, 0x81, 0x49, 0x92, 0x24,
+                                   0x49, 0x92, 0x24 };
+    ktxTexture2* texture = createEtcTestTexture(VK_FORMAT_BC4_SNORM_BLOCK,
+                                                4, 4, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+
+    EXPECT_EQ(ktxTexture2_Decompress(texture, VK_FORMAT_R8G8B8A8_UNORM, 1),
+              KTX_INVALID_OPERATION);
+    KTX_error_code result;
+    result = ktxTexture2_Decompress(texture, VK_FORMAT_UNDEFINED, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    EXPECT_EQ(texture->vkFormat,
+              (ktx_uint32_t)VK_FORMAT_R16G16B16A16_SFLOAT);
+    const ktx_uint16_t* p = (const ktx_uint16_t*)texture->pData;
+    for (ktx_uint32_t i = 0; i < 16; i++, p += 4) {
+        EXPECT_EQ(p[0], 0xBC00);  // -1.0
+        EXPECT_EQ(p[1], 0);
+        EXPECT_EQ(p[2], 0);
+        EXPECT_EQ(p[3], 0x3C00);  // 1.0
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecompressTest, AstcRoundTrip) {
+    ktxTexture2* original = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                              61, 37, 1, 3, 2);
+    ASSERT_TRUE(original != nullptr);
+    for (ktx_size_t i = 0; i < original->dataSize; i += 4) {
+        ktx_size_t pixel = i / 4;
+        original->pData[i] = (ktx_uint8_t)(pixel % 61 * 4);
+        original->pData[i + 1] = (ktx_uint8_t)(pixel / 61 % 37 * 6);
+        original->pData[i + 2] = 128;
+        original->pData[i + 3] = 255;
+    }
+    ktxTexture2* serial;
+    KTX_error_code result;
+    result = ktxTexture2_CreateCopy(original, &serial);
+    ASSERT_EQ(result, KTX_SUCCESS);
+
+    ktxAstcParams params = {};
+    params.structSize = sizeof(params);
+    params.blockDimension = KTX_PACK_ASTC_BLOCK_DIMENSION_4x4;
+    params.mode = KTX_PACK_ASTC_ENCODER_MODE_LDR;
+    params.qualityLevel = KTX_PACK_ASTC_QUALITY_LEVEL_FAST;
+    params.threadCount = 1;
+    result = ktxTexture2_CompressAstcEx(serial, &params);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    ktxTexture2* parallel;
+    result = ktxTexture2_CreateCopy(serial, &parallel);
+    ASSERT_EQ(result, KTX_SUCCESS);
+
+    result = ktxTexture2_Decompress(serial, VK_FORMAT_R8G8B8A8_UNORM, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    result = ktxTexture2_Decompress(parallel, VK_FORMAT_R8G8B8A8_UNORM, 4);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    ASSERT_EQ(serial->dataSize, original->dataSize);
+    ASSERT_EQ(parallel->dataSize, original->dataSize);
+    EXPECT_EQ(memcmp(parallel->pData, serial->pData, serial->dataSize), 0);
+
+    // Level 0 of a smooth gradient should survive nearly unchanged.
+    ktx_size_t levelSize = ktxTexture_GetImageSize(ktxTexture(original), 0)
+                           * original->numLayers;
+    int maxError = 0;
+    for (ktx_size_t i = 0; i < levelSize; i++) {
+        int error = abs((int)serial->pData[i] - (int)original->pData[i]);
+        maxError = error > maxError ? error : maxError;
+    }
+    EXPECT_LE(maxError, 8);
+
+    ktxTexture_Destroy(ktxTexture(original));
+    ktxTexture_Destroy(ktxTexture(serial));
+    ktxTexture_Destroy(ktxTexture(parallel));
+}
+
+TEST(ktxTexture2_DecompressTest, AstcToHalf) {
+    ktxTexture2* texture = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                             16, 16, 1, 1, 1);
+    ASSERT_TRUE(texture != nullptr);
+    for (ktx_size_t i = 0; i < texture->dataSize; i += 4) {
+        texture->pData[i] = 255;
+        texture->pData[i + 3] = 255;
+    }
+    KTX_error_code result;
+    result = ktxTexture2_CompressAstc(texture, 0);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    result = ktxTexture2_Decompress(texture, VK_FORMAT_R16G16B16A16_SFLOAT,
+                                    2);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    EXPECT_EQ(texture->vkFormat,
+              (ktx_uint32_t)VK_FORMAT_R16G16B16A16_SFLOAT);
+    ASSERT_EQ(texture->dataSize, 16U * 16 * 8);
+    const ktx_uint16_t* p = (const ktx_uint16_t*)texture->pData;
+    for (ktx_uint32_t i = 0; i < 16 * 16; i++, p += 4) {
+        EXPECT_EQ(p[0], 0x3C00);
+        EXPECT_EQ(p[1], 0);
+        EXPECT_EQ(p[2], 0);
+        EXPECT_EQ(p[3], 0x3C00);
+    }
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecompressTest, EtcMatchesDecodeEtcImage) {
+    const ktx_uint8_t block[16] = { 0 };
+    ktxTexture2* texture = createEtcTestTexture(
+                                    VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK,
+                                    50, 30, block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+    for (ktx_size_t i = 0; i < texture->dataSize; i++)
+        texture->pData[i] = (ktx_uint8_t)((i * 2654435761u) >> 13);
+
+    std::vector<ktx_uint8_t> expected(50 * 30 * 4);
+    KTX_error_code result;
+    result = ktxTexture2_DecodeEtcImage(texture, 0, 0, 0, expected.data(),
+                                        expected.size(), 0, 1);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    result = ktxTexture2_Decompress(texture, VK_FORMAT_UNDEFINED, 2);
+    ASSERT_EQ(result, KTX_SUCCESS);
+    ASSERT_EQ(texture->dataSize, expected.size());
+    EXPECT_EQ(memcmp(texture->pData, expected.data(), expected.size()), 0);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST(ktxTexture2_DecompressTest, InvalidArguments) {
+    EXPECT_EQ(ktxTexture2_Decompress(nullptr, VK_FORMAT_UNDEFINED, 1),
+              KTX_INVALID_VALUE);
+
+    const ktx_uint8_t block[16] = { 0 };
+    ktxTexture2* texture = createEtcTestTexture(VK_FORMAT_BC1_RGB_SRGB_BLOCK,
+                                                8, 8, block, 8);
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture2_Decompress(texture, VK_FORMAT_R8G8B8_SRGB, 1),
+              KTX_INVALID_VALUE);
+    EXPECT_EQ(ktxTexture2_Decompress(texture, VK_FORMAT_R8G8B8A8_UNORM, 1),
+              KTX_INVALID_OPERATION);
+    EXPECT_EQ(ktxTexture2_Decompress(texture,
+                                     VK_FORMAT_R16G16B16A16_SFLOAT, 1),
+              KTX_INVALID_OPERATION);
+    EXPECT_EQ(texture->vkFormat, (ktx_uint32_t)VK_FORMAT_BC1_RGB_SRGB_BLOCK);
+    ktxTexture_Destroy(ktxTexture(texture));
+
+    texture = createEtcTestTexture(VK_FORMAT_BC6H_UFLOAT_BLOCK, 8, 8,
+                                   block, sizeof(block));
+    ASSERT_TRUE(texture != nullptr);
+    EXPECT_EQ(ktxTexture2_Decompress(texture, VK_FORMAT_UNDEFINED, 1),
+              KTX_UNSUPPORTED_FEATURE);
+    ktxTexture_Destroy(ktxTexture(texture));
+
+    ktxTexture2* rgba = createTestTexture(VK_FORMAT_R8G8B8A8_UNORM,
+                                          8, 8, 1, 1, 1);
+    ASSERT_TRUE(rgba != nullptr);
+    EXPECT_EQ(ktxTexture2_Decompress(rgba, VK_FORMAT_UNDEFINED, 1),
+              KTX_INVALID_OPERATION);
+    ktxTexture_Destroy(ktxTexture(rgba));
+}
+
+class ktxValidateMemoryTest : public ktxTexture2TestBase<GLubyte, 4, GL_RGBA8> {
+  protected:
+    struct issueCounts {
+        ktx_uint32_t warnings = 0;
+        ktx_uint32_t errors = 0;
+        ktx_uint32_t fatals = 0;
+        ktx_uint32_t lastCode = 0;
+        ktx_bool_t keepGoing = KTX_TRUE;
+    };
+
+    static ktx_bool_t
+    countIssue(ktxValidationSeverity severity, ktx_uint32_t issueCode,
+               const char*, void* userdata)
+    {
+        issueCounts* counts = static_cast<issueCounts*>(userdata);
+        ktx_uint32_t severityBit = 0;
+        switch (severity) {
+          case KTX_VALIDATION_WARNING:
+            counts->warnings++;
+            severityBit = KTX_ISSUE_WARNING_BIT;
+            break;
+          case KTX_VALIDATION_ERROR:
+            counts->errors++;
+            severityBit = KTX_ISSUE_ERROR_BIT;
+            break;
+          case KTX_VALIDATION_FATAL:
+            counts->fatals++;
+            severityBit = KTX_ISSUE_FATAL_BIT;
+            break;
+        }
+        EXPECT_EQ(issueCode & KTX_ISSUE_SEVERITY_MASK, severityBit);
+        counts->lastCode = issueCode;
+        return counts->keepGoing;
+    }
+};
+
+/////////////////////////////////////////
+// ktxValidateMemory tests
+////////////////////////////////////////
+
+TEST_F(ktxValidateMemoryTest, InvalidValueOnNullBytes) {
+    EXPECT_EQ(ktxValidateMemory(nullptr, 80, 0, nullptr, nullptr),
+              KTX_INVALID_VALUE);
+}
+
+TEST_F(ktxValidateMemoryTest, ValidTexture) {
+    issueCounts counts;
+
+    ASSERT_TRUE(ktxMemFile != NULL);
+    EXPECT_EQ(ktxValidateMemory(ktxMemFile, ktxMemFileLen, 0,
+                                countIssue, &counts),
+              KTX_SUCCESS);
+    EXPECT_EQ(counts.errors, 0U);
+    EXPECT_EQ(counts.fatals, 0U);
+    // No callback is needed just to get the result.
+    EXPECT_EQ(ktxValidateMemory(ktxMemFile, ktxMemFileLen, 0, nullptr, nullptr),
+              KTX_SUCCESS);
+}
+
+TEST_F(ktxValidateMemoryTest, FatalOnBadIdentifier) {
+    issueCounts counts;
+
+    ASSERT_TRUE(ktxMemFile != NULL);
+    std::vector<ktx_uint8_t> file(ktxMemFile, ktxMemFile + ktxMemFileLen);
+    file[1] = 'X';
+    EXPECT_EQ(ktxValidateMemory(file.data(), file.size(), 0,
+                                countIssue, &counts),
+              KTX_FILE_DATA_ERROR);
+    EXPECT_EQ(counts.fatals, 1U);
+    EXPECT_EQ(counts.errors, 0U);
+    EXPECT_EQ(counts.lastCode, (ktx_uint32_t)KTX_ISSUE_FILE_NOT_KTX2);
+
+    // Truncated files must not be read past their end.
+    counts = issueCounts();
+    EXPECT_EQ(ktxValidateMemory(ktxMemFile, KTX2_HEADER_SIZE + 4, 0,
+                                countIssue, &counts),
+              KTX_FILE_DATA_ERROR);
+    EXPECT_EQ(counts.fatals, 1U);
+    EXPECT_EQ(counts.lastCode, (ktx_uint32_t)KTX_ISSUE_IO_UNEXPECTED_EOF);
+}
+
+TEST_F(ktxValidateMemoryTest, CallbackStopsValidation) {
+    issueCounts counts;
+
+    ASSERT_TRUE(ktxMemFile != NULL);
+    std::vector<ktx_uint8_t> file(ktxMemFile, ktxMemFile + ktxMemFileLen);
+    // Make every level's uncompressedByteLength wrong. Each level then
+    // has two errors.
+    KTX_header2* header = reinterpret_cast<KTX_header2*>(file.data());
+    ktxLevelIndexEntry* levelIndex =
+        reinterpret_cast<ktxLevelIndexEntry*>(file.data() + KTX2_HEADER_SIZE);
+    for (ktx_uint32_t level = 0; level < MAX(header->levelCount, 1U); level++)
+        levelIndex[level].uncompressedByteLength += 1;
+
+    EXPECT_EQ(ktxValidateMemory(file.data(), file.size(), 0,
+                                countIssue, &counts),
+              KTX_FILE_DATA_ERROR);
+    EXPECT_GT(counts.errors, 1U);
+
+    counts = issueCounts();
+    counts.keepGoing = KTX_FALSE;
+    EXPECT_EQ(ktxValidateMemory(file.data(), file.size(), 0,
+                                countIssue, &counts),
+              KTX_FILE_DATA_ERROR);
+    EXPECT_EQ(counts.errors, 1U);
+}
+
 class ktxTexture2_GetNumComponentsTestR8 : public ktxTexture2TestBase<GLubyte, 1, GL_R8> { };
 class ktxTexture2_GetNumComponentsTestRG8 : public ktxTexture2TestBase<GLubyte, 2, GL_RG8> { };
 class ktxTexture2_GetNumComponentsTestRGB8 : public ktxTexture2TestBase<GLubyte, 3, GL_RGB8> { };
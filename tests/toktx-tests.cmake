@@ -149,6 +149,15 @@ function( gencmpktx test_name reference source args env files )
 
 endfunction()
 
+# Like gencmpktx but compares the SHA-256 of the output with sha256 instead of
+# diffing it with a reference file, so it needs no file from LFS.
+function( genhashktx test_name source args sha256 )
+    add_test( NAME toktx-hash-${test_name}
+        COMMAND ${BASH_EXECUTABLE} -c "$<TARGET_FILE:toktx> --test ${args} toktx.${test_name}.ktx2 ${source} && test \"$(${CMAKE_COMMAND} -E sha256sum toktx.${test_name}.ktx2 | cut -d' ' -f1)\" = ${sha256}; status=$?; rm -f toktx.${test_name}.ktx2; exit $status"
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/testimages
+    )
+endfunction()
+
 gencmpktx( rgb-reference rgb-reference.ktx "../srcimages/rgb.ppm" "--lower_left_maps_to_s0t0 --nometadata" "" "" )
 gencmpktx( rgb-amg-reference rgb-amg-reference.ktx "../srcimages/rgb.ppm" "--automipmap --lower_left_maps_to_s0t0 --linear --nometadata" "" "" )
 gencmpktx( orient-up orient-up.ktx "../srcimages/up.ppm" "" "--lower_left_maps_to_s0t0 --nometadata" "" )
@@ -159,6 +168,16 @@ gencmpktx( rgba-reference rgba-reference.ktx ../srcimages/rgba.pam "--lower_left
 gencmpktx( rgb-mipmap-reference rgb-mipmap-reference.ktx "../srcimages/level0.ppm ../srcimages/level1.ppm ../srcimages/level2.ppm ../srcimages/level3.ppm ../srcimages/level4.ppm ../srcimages/level5.ppm ../srcimages/level6.ppm" "--lower_left_maps_to_s0t0 --mipmap --nometadata" "" "" )
 gencmpktx( rgb-mipmap-reference-u rgb-mipmap-reference-u.ktx2 "../srcimages/level0.ppm ../srcimages/level1.ppm ../srcimages/level2.ppm ../srcimages/level3.ppm ../srcimages/level4.ppm ../srcimages/level5.ppm ../srcimages/level6.ppm" "--t2 --mipmap" "" "" )
 
+# Generated mipmaps. Hashes of the non-cascade tests match the output of the
+# serial generator that preceded createMipmaps. Output must not depend on
+# --threads.
+genhashktx( genmipmap-rgba ../srcimages/rgba.pam "--t2 --genmipmap" 5629e76362355a6ff69776e3154656d85a8d0869400ddfb291b0327c50e9e700 )
+genhashktx( genmipmap-rgba-1-thread ../srcimages/rgba.pam "--t2 --genmipmap --threads 1" 5629e76362355a6ff69776e3154656d85a8d0869400ddfb291b0327c50e9e700 )
+genhashktx( genmipmap-rgb-linear-mitchell ../srcimages/rgb.ppm "--t2 --genmipmap --assign_oetf linear --filter mitchell" d3943a5c18b7df52e7ee255531998f978a76c0e095157e2726f5959c7efd2593 )
+genhashktx( genmipmap-cascade-rgba ../srcimages/rgba.pam "--t2 --genmipmap --cascade" ad31a8b8fac22a8b1c14258a783194c8f6be083109c3256c83832495a00d6864 )
+genhashktx( genmipmap-cascade-rgba-1-thread ../srcimages/rgba.pam "--t2 --genmipmap --cascade --threads 1" ad31a8b8fac22a8b1c14258a783194c8f6be083109c3256c83832495a00d6864 )
+genhashktx( genmipmap-cascade-rgb-linear-mitchell ../srcimages/rgb.ppm "--t2 --genmipmap --cascade --assign_oetf linear --filter mitchell" 6b070f8c6b2acf289410f03de26984d42dc9be41f374265c4b21d4d84843dd5c )
+
 if(APPLE)
   # Run only on macOS until we figure out the BasisLZ/ETC1S compressor non-determinancy.
   gencmpktx( alpha_simple_basis alpha_simple_basis.ktx2 ../srcimages/alpha_simple.png "--bcmp" "" "" )
@@ -264,3 +283,23 @@ gencmpktx( 3dtex_7_reference_u 3dtex_7_reference_u.ktx2 "../srcimages/red16.png
 gencmpktx( arraytex_1_reference_u arraytex_1_reference_u.ktx2 "../srcimages/red16.png" "--test --t2 --layers 1" "" "")
 gencmpktx( arraytex_7_reference_u arraytex_7_reference_u.ktx2 "../srcimages/red16.png ../srcimages/orange16.png ../srcimages/yellow16.png ../srcimages/green16.png ../srcimages/blue16.png ../srcimages/indigo16.png ../srcimages/violet16.png" "--test --t2 --layers 7" "" "")
 gencmpktx( arraytex_7_mipmap_reference_u arraytex_7_mipmap_reference_u.ktx2 "../srcimages/red16.png ../srcimages/orange16.png ../srcimages/yellow16.png ../srcimages/green16.png ../srcimages/blue16.png ../srcimages/indigo16.png ../srcimages/violet16.png" "--test --t2 --layers 7 --genmipmap" "" "")
+
+# Each entry of a batch manifest must give the same output as running toktx
+# on it alone.
+add_test( NAME toktx-batch-two-entries
+    COMMAND ${BASH_EXECUTABLE} -c "printf -- '--t2 toktx.batch1.ktx2 ../srcimages/rgb.ppm\\n--t2 --genmipmap toktx.batch2.ktx2 ../srcimages/rgba.pam\\n' > toktx.batch.txt && $<TARGET_FILE:toktx> --test --batch toktx.batch.txt && $<TARGET_FILE:toktx> --test --t2 toktx.single1.ktx2 ../srcimages/rgb.ppm && $<TARGET_FILE:toktx> --test --t2 --genmipmap toktx.single2.ktx2 ../srcimages/rgba.pam && diff toktx.batch1.ktx2 toktx.single1.ktx2 && diff toktx.batch2.ktx2 toktx.single2.ktx2; status=$?; rm -f toktx.batch.txt toktx.batch1.ktx2 toktx.batch2.ktx2 toktx.single1.ktx2 toktx.single2.ktx2; exit $status"
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/testimages
+)
+
+# An option error in an entry must fail only that entry, be reported with
+# its line number and stop the batch.
+function( batchoptionerror test_name entry )
+    add_test( NAME toktx-batch-${test_name}
+        COMMAND ${BASH_EXECUTABLE} -c "printf -- '--t2 toktx.batch1.ktx2 ../srcimages/rgb.ppm\\n${entry}\\n--t2 toktx.batch3.ktx2 ../srcimages/rgb.ppm\\n' > toktx.batch.txt && ! $<TARGET_FILE:toktx> --test --batch toktx.batch.txt 2> toktx.batch.err && grep -q 'toktx.batch.txt:2: conversion failed' toktx.batch.err && test -e toktx.batch1.ktx2 && test ! -e toktx.batch3.ktx2; status=$?; rm -f toktx.batch.txt toktx.batch.err toktx.batch1.ktx2 toktx.batch3.ktx2; exit $status"
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/testimages
+    )
+endfunction()
+
+batchoptionerror( unknown-option "--foobar toktx.batch2.ktx2 ../srcimages/rgb.ppm" )
+batchoptionerror( invalid-option-combination "--t2 --genmipmap --automipmap toktx.batch2.ktx2 ../srcimages/rgb.ppm" )
+batchoptionerror( no-input-files "--t2 toktx.batch2.ktx2" )
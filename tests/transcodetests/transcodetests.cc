@@ -24,6 +24,7 @@ extern "C" {
 #include <cstring>
 
 #include "basisu_c_binding.h"
+#include "basisu/transcoder/basisu_transcoder.h"
 
 using namespace std;
 
@@ -213,6 +214,66 @@ TEST_P(TextureCombinationsTest, Basic) {
     FormatFeature format = get<1>(GetParam());
     test_texture_set(ts,format);
 }
+
+// Compare a UASTC palette kernel with astc_interpolate() for every pair of
+// endpoint values, every weight of every weight range and both decode modes.
+void
+test_uastc_palette_kernel(basist::uastc_palette_kernel_func kernel)
+{
+    using namespace basist;
+
+    const struct {
+        const uint32_t* weights;
+        uint32_t count;
+    } weightRanges[] = {
+        { g_bc7_weights1, 2 },
+        { g_bc7_weights2, 4 },
+        { g_bc7_weights3, 8 },
+        { g_astc_weights4, 16 },
+        { g_astc_weights5, 32 },
+    };
+
+    for (bool srgb : { false, true }) {
+        for (const auto& range : weightRanges) {
+            color32 colors[32];
+            for (uint32_t a = 0; a < 256; a++) {
+                for (uint32_t b = 0; b < 256; b++) {
+                    // Each component sees every (low, high) pair.
+                    const color32 l(a, b, a, 255 - b);
+                    const color32 h(b, a, 255 - b, a);
+                    kernel(l, h, range.weights, range.count, srgb, colors);
+                    for (uint32_t i = 0; i < range.count; i++) {
+                        for (uint32_t c = 0; c < 4; c++) {
+                            ASSERT_EQ(colors[i][c],
+                                      astc_interpolate(l[c], h[c],
+                                                       range.weights[i], srgb))
+                                << "srgb " << srgb << ", " << range.count
+                                << " weights, weight " << i
+                                << ", component " << c << ", l " << (int)l[c]
+                                << ", h " << (int)h[c];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(UastcPaletteKernelTest, SSE41MatchesScalar) {
+    basist::uastc_palette_kernel_func sse41, avx2;
+    basist::get_uastc_palette_kernels(sse41, avx2);
+    if (!sse41)
+        GTEST_SKIP() << "SSE4.1 kernel not built or not supported by CPU";
+    test_uastc_palette_kernel(sse41);
+}
+
+TEST(UastcPaletteKernelTest, AVX2MatchesScalar) {
+    basist::uastc_palette_kernel_func sse41, avx2;
+    basist::get_uastc_palette_kernels(sse41, avx2);
+    if (!avx2)
+        GTEST_SKIP() << "AVX2 kernel not built or not supported by CPU";
+    test_uastc_palette_kernel(avx2);
+}
 }  // namespace
 
 int main(int argc, char **argv) {
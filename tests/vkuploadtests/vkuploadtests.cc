@@ -0,0 +1,748 @@
+/* -*- tab-width: 4; -*- */
+/* vi: set sw=2 ts=4 expandtab: */
+
+/*
+ * Copyright 2023 The Khronos Group Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @internal
+ * @file vkuploadtests.cc
+ * @~English
+ *
+ * @brief Tests of the Vulkan upload functions run against a fake device.
+ *
+ * The fake implements just enough of the Vulkan API for the loader. It
+ * tracks every object created so leaks can be detected, can be told to
+ * fail the Nth call that creates, allocates, binds, maps or submits and
+ * executes buffer to image copies only when a submission's fence is
+ * waited on, as a real device executes them some time after submission.
+ */
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+#include "vulkan/vulkan_core.h"
+#include "ktx.h"
+#include "ktxvulkan.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+//////////////////////////////
+// The fake device
+//////////////////////////////
+
+struct FakeMemory {
+    std::vector<uint8_t> bytes;
+    bool mapped = false;
+};
+
+struct FakeBuffer {
+    VkDeviceSize size;
+    uint64_t memory = 0;
+};
+
+struct FakeImage {
+    VkImageCreateInfo info;
+    uint64_t memory = 0;
+    // Bytes received by each mip level from buffer copies.
+    std::map<uint32_t, std::vector<uint8_t>> levels;
+};
+
+struct PendingCopy {
+    uint64_t buffer;
+    uint64_t image;
+    std::vector<VkBufferImageCopy> regions;
+};
+
+struct FakeDevice {
+    uint64_t nextHandle = 1;
+    std::map<uint64_t, FakeMemory> memories;
+    std::map<uint64_t, FakeBuffer> buffers;
+    std::map<uint64_t, FakeImage> images;
+    std::set<uint64_t> fences;
+    std::set<uint64_t> signaledFences;
+    // Copies recorded in the command buffer, not yet submitted.
+    std::vector<PendingCopy> recorded;
+    // Copies submitted with each fence, not yet executed.
+    std::map<uint64_t, std::vector<PendingCopy>> submitted;
+    // Fail the Nth fallible call, counting from 1. 0 disables failure.
+    int failAt = 0;
+    int fallibleCalls = 0;
+
+    void reset() { *this = FakeDevice(); }
+
+    bool fail() {
+        return ++fallibleCalls == failAt;
+    }
+
+    size_t liveObjects() const {
+        return memories.size() + buffers.size() + images.size()
+               + fences.size();
+    }
+
+    void execute(const PendingCopy& copy) {
+        const FakeBuffer& buffer = buffers.at(copy.buffer);
+        const FakeMemory& memory = memories.at(buffer.memory);
+        FakeImage& image = images.at(copy.image);
+        for (const VkBufferImageCopy& region : copy.regions) {
+            // The tests use only 4 byte texels.
+            VkDeviceSize size = (VkDeviceSize)region.imageExtent.width
+                                * region.imageExtent.height
+                                * region.imageExtent.depth
+                                * region.imageSubresource.layerCount * 4;
+            const uint8_t* src = memory.bytes.data() + region.bufferOffset;
+            image.levels[region.imageSubresource.mipLevel]
+                                            .assign(src, src + size);
+        }
+    }
+
+    void signal(uint64_t fence) {
+        for (const PendingCopy& copy : submitted[fence])
+            execute(copy);
+        submitted.erase(fence);
+        signaledFences.insert(fence);
+    }
+};
+
+FakeDevice fake;
+
+template<typename Handle>
+Handle toHandle(uint64_t h) { return (Handle)(uintptr_t)h; }
+
+template<typename Handle>
+uint64_t fromHandle(Handle h) { return (uint64_t)(uintptr_t)h; }
+
+VKAPI_ATTR void VKAPI_CALL
+fakeGetPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat,
+                                      VkFormatProperties* pProperties)
+{
+    pProperties->linearTilingFeatures = ~0U;
+    pProperties->optimalTilingFeatures = ~0U;
+    pProperties->bufferFeatures = ~0U;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeGetPhysicalDeviceImageFormatProperties(VkPhysicalDevice, VkFormat,
+                                           VkImageType, VkImageTiling,
+                                           VkImageUsageFlags,
+                                           VkImageCreateFlags,
+                                           VkImageFormatProperties* pProps)
+{
+    pProps->maxExtent = { 16384, 16384, 2048 };
+    pProps->maxMipLevels = 15;
+    pProps->maxArrayLayers = 2048;
+    pProps->sampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    pProps->maxResourceSize = ~0ULL;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeGetPhysicalDeviceMemoryProperties(VkPhysicalDevice,
+                                  VkPhysicalDeviceMemoryProperties* pProps)
+{
+    memset(pProps, 0, sizeof(*pProps));
+    pProps->memoryTypeCount = 1;
+    pProps->memoryTypes[0].propertyFlags =
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                  | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    pProps->memoryHeapCount = 1;
+    pProps->memoryHeaps[0].size = 1ULL << 32;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeAllocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo*,
+                           VkCommandBuffer* pCommandBuffers)
+{
+    static int commandBuffer;
+    *pCommandBuffers = (VkCommandBuffer)&commandBuffer;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeFreeCommandBuffers(VkDevice, VkCommandPool, uint32_t,
+                       const VkCommandBuffer*)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeBeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo*)
+{
+    fake.recorded.clear();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeEndCommandBuffer(VkCommandBuffer)
+{
+    return fake.fail() ? VK_ERROR_OUT_OF_DEVICE_MEMORY : VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeAllocateMemory(VkDevice, const VkMemoryAllocateInfo* pInfo,
+                   const VkAllocationCallbacks*, VkDeviceMemory* pMemory)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    uint64_t h = fake.nextHandle++;
+    fake.memories[h].bytes.resize(pInfo->allocationSize);
+    *pMemory = toHandle<VkDeviceMemory>(h);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+{
+    if (memory != VK_NULL_HANDLE) {
+        EXPECT_EQ(fake.memories.erase(fromHandle(memory)), 1U);
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset,
+              VkDeviceSize, VkMemoryMapFlags, void** ppData)
+{
+    if (fake.fail())
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    FakeMemory& m = fake.memories.at(fromHandle(memory));
+    EXPECT_FALSE(m.mapped);
+    m.mapped = true;
+    *ppData = m.bytes.data() + offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeUnmapMemory(VkDevice, VkDeviceMemory memory)
+{
+    FakeMemory& m = fake.memories.at(fromHandle(memory));
+    EXPECT_TRUE(m.mapped);
+    m.mapped = false;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeCreateBuffer(VkDevice, const VkBufferCreateInfo* pInfo,
+                 const VkAllocationCallbacks*, VkBuffer* pBuffer)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    uint64_t h = fake.nextHandle++;
+    fake.buffers[h].size = pInfo->size;
+    *pBuffer = toHandle<VkBuffer>(h);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*)
+{
+    if (buffer != VK_NULL_HANDLE) {
+        EXPECT_EQ(fake.buffers.erase(fromHandle(buffer)), 1U);
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeGetBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+                                VkMemoryRequirements* pReqs)
+{
+    pReqs->size = fake.buffers.at(fromHandle(buffer)).size;
+    pReqs->alignment = 16;
+    pReqs->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeBindBufferMemory(VkDevice, VkBuffer buffer, VkDeviceMemory memory,
+                     VkDeviceSize)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    fake.buffers.at(fromHandle(buffer)).memory = fromHandle(memory);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeCreateImage(VkDevice, const VkImageCreateInfo* pInfo,
+                const VkAllocationCallbacks*, VkImage* pImage)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    uint64_t h = fake.nextHandle++;
+    fake.images[h].info = *pInfo;
+    *pImage = toHandle<VkImage>(h);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeDestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*)
+{
+    if (image != VK_NULL_HANDLE) {
+        EXPECT_EQ(fake.images.erase(fromHandle(image)), 1U);
+    }
+}
+
+// Linear images are laid out with every level and layer a full base level
+// image, with rows padded to 256 bytes.
+static VkDeviceSize
+fakeLinearRowPitch(const VkImageCreateInfo& info)
+{
+    return (info.extent.width * 4 + 255) / 256 * 256;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeGetImageMemoryRequirements(VkDevice, VkImage image,
+                               VkMemoryRequirements* pReqs)
+{
+    const VkImageCreateInfo& info = fake.images.at(fromHandle(image)).info;
+    pReqs->size = fakeLinearRowPitch(info) * info.extent.height
+                  * info.extent.depth * info.arrayLayers * info.mipLevels;
+    pReqs->alignment = 256;
+    pReqs->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeGetImageSubresourceLayout(VkDevice, VkImage image,
+                              const VkImageSubresource* pSubresource,
+                              VkSubresourceLayout* pLayout)
+{
+    const VkImageCreateInfo& info = fake.images.at(fromHandle(image)).info;
+    pLayout->rowPitch = fakeLinearRowPitch(info);
+    pLayout->depthPitch = pLayout->rowPitch * info.extent.height;
+    pLayout->arrayPitch = pLayout->depthPitch * info.extent.depth;
+    pLayout->size = pLayout->arrayPitch;
+    pLayout->offset = pLayout->arrayPitch
+                      * (pSubresource->mipLevel * info.arrayLayers
+                         + pSubresource->arrayLayer);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeBindImageMemory(VkDevice, VkImage image, VkDeviceMemory memory,
+                    VkDeviceSize)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    fake.images.at(fromHandle(image)).memory = fromHandle(memory);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags,
+                       VkPipelineStageFlags, VkDependencyFlags,
+                       uint32_t, const VkMemoryBarrier*,
+                       uint32_t, const VkBufferMemoryBarrier*,
+                       uint32_t, const VkImageMemoryBarrier*)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeCmdBlitImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage,
+                 VkImageLayout, uint32_t, const VkImageBlit*, VkFilter)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeCmdCopyBufferToImage(VkCommandBuffer, VkBuffer buffer, VkImage image,
+                         VkImageLayout, uint32_t regionCount,
+                         const VkBufferImageCopy* pRegions)
+{
+    fake.recorded.push_back({ fromHandle(buffer), fromHandle(image),
+                              std::vector<VkBufferImageCopy>(pRegions,
+                                                pRegions + regionCount) });
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeCreateFence(VkDevice, const VkFenceCreateInfo*,
+                const VkAllocationCallbacks*, VkFence* pFence)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    uint64_t h = fake.nextHandle++;
+    fake.fences.insert(h);
+    *pFence = toHandle<VkFence>(h);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL
+fakeDestroyFence(VkDevice, VkFence fence, const VkAllocationCallbacks*)
+{
+    if (fence != VK_NULL_HANDLE) {
+        EXPECT_EQ(fake.fences.erase(fromHandle(fence)), 1U);
+        EXPECT_EQ(fake.submitted.count(fromHandle(fence)), 0U)
+            << "Fence destroyed while its submission is pending";
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeQueueSubmit(VkQueue, uint32_t, const VkSubmitInfo*, VkFence fence)
+{
+    if (fake.fail())
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    std::vector<PendingCopy>& pending = fake.submitted[fromHandle(fence)];
+    pending.insert(pending.end(), fake.recorded.begin(), fake.recorded.end());
+    fake.recorded.clear();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeQueueWaitIdle(VkQueue)
+{
+    while (!fake.submitted.empty())
+        fake.signal(fake.submitted.begin()->first);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+fakeWaitForFences(VkDevice, uint32_t fenceCount, const VkFence* pFences,
+                  VkBool32, uint64_t)
+{
+    for (uint32_t i = 0; i < fenceCount; i++)
+        fake.signal(fromHandle(pFences[i]));
+    return VK_SUCCESS;
+}
+
+ktxVulkanFunctions
+fakeFunctions()
+{
+    ktxVulkanFunctions funcs;
+    memset(&funcs, 0, sizeof(funcs));
+    // Never called because every other member is set.
+    funcs.vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)(uintptr_t)1;
+    funcs.vkGetDeviceProcAddr = (PFN_vkGetDeviceProcAddr)(uintptr_t)1;
+    funcs.vkAllocateCommandBuffers = fakeAllocateCommandBuffers;
+    funcs.vkAllocateMemory = fakeAllocateMemory;
+    funcs.vkBeginCommandBuffer = fakeBeginCommandBuffer;
+    funcs.vkBindBufferMemory = fakeBindBufferMemory;
+    funcs.vkBindImageMemory = fakeBindImageMemory;
+    funcs.vkCmdBlitImage = fakeCmdBlitImage;
+    funcs.vkCmdCopyBufferToImage = fakeCmdCopyBufferToImage;
+    funcs.vkCmdPipelineBarrier = fakeCmdPipelineBarrier;
+    funcs.vkCreateImage = fakeCreateImage;
+    funcs.vkDestroyImage = fakeDestroyImage;
+    funcs.vkCreateBuffer = fakeCreateBuffer;
+    funcs.vkDestroyBuffer = fakeDestroyBuffer;
+    funcs.vkCreateFence = fakeCreateFence;
+    funcs.vkDestroyFence = fakeDestroyFence;
+    funcs.vkEndCommandBuffer = fakeEndCommandBuffer;
+    funcs.vkFreeCommandBuffers = fakeFreeCommandBuffers;
+    funcs.vkFreeMemory = fakeFreeMemory;
+    funcs.vkGetBufferMemoryRequirements = fakeGetBufferMemoryRequirements;
+    funcs.vkGetImageMemoryRequirements = fakeGetImageMemoryRequirements;
+    funcs.vkGetImageSubresourceLayout = fakeGetImageSubresourceLayout;
+    funcs.vkGetPhysicalDeviceImageFormatProperties =
+                                fakeGetPhysicalDeviceImageFormatProperties;
+    funcs.vkGetPhysicalDeviceFormatProperties =
+                                fakeGetPhysicalDeviceFormatProperties;
+    funcs.vkGetPhysicalDeviceMemoryProperties =
+                                fakeGetPhysicalDeviceMemoryProperties;
+    funcs.vkMapMemory = fakeMapMemory;
+    funcs.vkQueueSubmit = fakeQueueSubmit;
+    funcs.vkQueueWaitIdle = fakeQueueWaitIdle;
+    funcs.vkUnmapMemory = fakeUnmapMemory;
+    funcs.vkWaitForFences = fakeWaitForFences;
+    return funcs;
+}
+
+//////////////////////////////
+// Helpers
+//////////////////////////////
+
+// An RGBA8 texture with a distinct value in each byte.
+ktxTexture2*
+createTexture(ktx_uint32_t width, ktx_uint32_t height,
+              ktx_uint32_t numLevels, ktx_uint32_t seed = 0)
+{
+    ktxTextureCreateInfo createInfo;
+    createInfo.glInternalformat = 0;
+    createInfo.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.pDfd = nullptr;
+    createInfo.baseWidth = width;
+    createInfo.baseHeight = height;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = numLevels;
+    createInfo.numLayers = 1;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2* texture;
+    if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE,
+                           &texture) != KTX_SUCCESS)
+        return nullptr;
+    for (ktx_size_t i = 0; i < texture->dataSize; i++)
+        texture->pData[i] = (ktx_uint8_t)(i * 13 + (i >> 8) + seed);
+    return texture;
+}
+
+// Check the image received every level of @p texture.
+void
+expectUploaded(ktxTexture2* texture, const ktxVulkanTexture& vkTexture)
+{
+    const FakeImage& image = fake.images.at(fromHandle(vkTexture.image));
+    for (ktx_uint32_t level = 0; level < texture->numLevels; level++) {
+        ktx_size_t offset;
+        ktxTexture_GetImageOffset(ktxTexture(texture), level, 0, 0,
+                                  &offset);
+        ktx_size_t size =
+                ktxTexture_GetImageSize(ktxTexture(texture), level);
+        ASSERT_EQ(image.levels.count(level), 1U)
+            << "Level " << level << " not copied";
+        const std::vector<uint8_t>& got = image.levels.at(level);
+        ASSERT_EQ(got.size(), size);
+        EXPECT_EQ(memcmp(got.data(), texture->pData + offset, size), 0)
+            << "Level " << level << " differs";
+    }
+}
+
+//////////////////////////////
+// Fixture
+//////////////////////////////
+
+class VkUploadTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        static int instance, physicalDevice, device, queue;
+        fake.reset();
+        ktxVulkanFunctions funcs = fakeFunctions();
+        ASSERT_EQ(ktxVulkanDeviceInfo_ConstructEx(&vdi,
+                                        (VkInstance)&instance,
+                                        (VkPhysicalDevice)&physicalDevice,
+                                        (VkDevice)&device, (VkQueue)&queue,
+                                        toHandle<VkCommandPool>(~0ULL),
+                                        nullptr, &funcs),
+                  KTX_SUCCESS);
+    }
+
+    void TearDown() override {
+        ktxVulkanDeviceInfo_Destruct(&vdi);
+        EXPECT_EQ(fake.liveObjects(), 0U);
+    }
+
+    ktxVulkanDeviceInfo vdi;
+};
+
+//////////////////////////////
+// Tests
+//////////////////////////////
+
+TEST_F(VkUploadTest, UploadOptimal) {
+    ktxTexture2* texture = createTexture(64, 32, 7);
+    ASSERT_TRUE(texture != nullptr);
+    ktxVulkanTexture vkTexture;
+    EXPECT_EQ(ktxTexture2_VkUploadEx(texture, &vdi, &vkTexture,
+                                     VK_IMAGE_TILING_OPTIMAL,
+                                     VK_IMAGE_USAGE_SAMPLED_BIT,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+              KTX_SUCCESS);
+    expectUploaded(texture, vkTexture);
+    // Only the image is left.
+    EXPECT_EQ(fake.images.size(), 1U);
+    EXPECT_EQ(fake.memories.size(), 1U);
+    EXPECT_EQ(fake.buffers.size(), 0U);
+    ktxVulkanTexture_Destruct(&vkTexture, vdi.device, nullptr);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST_F(VkUploadTest, RecordUpload) {
+    ktxTexture2* texture = createTexture(32, 32, 6);
+    ASSERT_TRUE(texture != nullptr);
+    ktxVulkanTexture vkTexture;
+    ktxVulkanStaging staging;
+    ASSERT_EQ(ktxTexture_VkRecordUpload(ktxTexture(texture), &vdi,
+                                        vdi.cmdBuffer, &vkTexture,
+                                        VK_IMAGE_TILING_OPTIMAL,
+                                        VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                        nullptr, &staging),
+              KTX_SUCCESS);
+    // Nothing has been submitted so nothing is copied yet.
+    EXPECT_TRUE(fake.images.at(fromHandle(vkTexture.image)).levels.empty());
+    EXPECT_EQ(fake.buffers.count(fromHandle(staging.buffer)), 1U);
+
+    VkFence fence;
+    ASSERT_EQ(fakeCreateFence(vdi.device, nullptr, nullptr, &fence),
+              VK_SUCCESS);
+    ASSERT_EQ(fakeQueueSubmit(vdi.queue, 1, nullptr, fence), VK_SUCCESS);
+    fakeWaitForFences(vdi.device, 1, &fence, VK_TRUE, ~0ULL);
+    fakeDestroyFence(vdi.device, fence, nullptr);
+    expectUploaded(texture, vkTexture);
+
+    // Without a ring the staging can only be destructed.
+    EXPECT_EQ(ktxVulkanStaging_Release(&staging, 1), KTX_INVALID_OPERATION);
+    ktxVulkanStaging_Destruct(&staging, vdi.device, nullptr);
+    ktxVulkanTexture_Destruct(&vkTexture, vdi.device, nullptr);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+// Record the upload of @p texture using @p ring and submit it with a new
+// fence, which is returned in @p fence.
+static void
+recordAndSubmit(ktxVulkanDeviceInfo* vdi, ktxVulkanStagingRing* ring,
+                ktxTexture2* texture, ktxVulkanTexture* vkTexture,
+                ktxVulkanStaging* staging, VkFence* fence)
+{
+    fakeBeginCommandBuffer(vdi->cmdBuffer, nullptr);
+    ASSERT_EQ(ktxTexture_VkRecordUpload(ktxTexture(texture), vdi,
+                                        vdi->cmdBuffer, vkTexture,
+                                        VK_IMAGE_TILING_OPTIMAL,
+                                        VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                        ring, staging),
+              KTX_SUCCESS);
+    ASSERT_EQ(fakeCreateFence(vdi->device, nullptr, nullptr, fence),
+              VK_SUCCESS);
+    ASSERT_EQ(fakeQueueSubmit(vdi->queue, 1, nullptr, *fence), VK_SUCCESS);
+}
+
+static void
+waitAndDestroyFence(ktxVulkanDeviceInfo* vdi, VkFence fence)
+{
+    fakeWaitForFences(vdi->device, 1, &fence, VK_TRUE, ~0ULL);
+    fakeDestroyFence(vdi->device, fence, nullptr);
+}
+
+// Several uploads are in flight at once. Space must not be reused until
+// the value with which it was released is retired, even though the
+// uploads have been submitted, and uploads that do not fit must fall back
+// to their own staging buffer.
+TEST_F(VkUploadTest, StagingRingInFlight) {
+    // Each 16x16 RGBA8 level needs 1024 bytes so exactly 2 fit.
+    ktxVulkanStagingRing* ring;
+    ASSERT_EQ(ktxVulkanStagingRing_Create(&vdi, 2048, &ring), KTX_SUCCESS);
+    uint64_t ringBuffer = fake.buffers.begin()->first;
+
+    ktxTexture2* textures[4] = {
+        createTexture(16, 16, 1, 1), createTexture(16, 16, 1, 2),
+        createTexture(16, 16, 1, 3), createTexture(8, 8, 1, 4)
+    };
+    ktxVulkanTexture vkTextures[4];
+    ktxVulkanStaging staging;
+    VkFence fences[4];
+    for (int i = 0; i < 4; i++)
+        ASSERT_TRUE(textures[i] != nullptr);
+
+    // 0 and 1 are sub-allocated from the ring.
+    for (int i = 0; i < 2; i++) {
+        recordAndSubmit(&vdi, ring, textures[i], &vkTextures[i], &staging,
+                        &fences[i]);
+        EXPECT_EQ(fromHandle(staging.buffer), ringBuffer);
+        EXPECT_TRUE(staging.memory == VK_NULL_HANDLE);
+        EXPECT_EQ(staging.offset, 1024U * i);
+        EXPECT_EQ(ktxVulkanStaging_Release(&staging, i + 1), KTX_SUCCESS);
+    }
+
+    // The ring is full so 2 gets its own buffer, kept after release until
+    // its value is retired.
+    recordAndSubmit(&vdi, ring, textures[2], &vkTextures[2], &staging,
+                    &fences[2]);
+    EXPECT_FALSE(staging.memory == VK_NULL_HANDLE);
+    uint64_t ownBuffer = fromHandle(staging.buffer);
+    EXPECT_NE(ownBuffer, ringBuffer);
+    EXPECT_EQ(ktxVulkanStaging_Release(&staging, 3), KTX_SUCCESS);
+    EXPECT_TRUE(staging.buffer == VK_NULL_HANDLE);
+    EXPECT_EQ(fake.buffers.count(ownBuffer), 1U);
+
+    // Only 0 has completed. Its space is reused, wrapping around, while 1
+    // is still pending.
+    waitAndDestroyFence(&vdi, fences[0]);
+    ktxVulkanStagingRing_Retire(ring, 1);
+    recordAndSubmit(&vdi, ring, textures[3], &vkTextures[3], &staging,
+                    &fences[3]);
+    EXPECT_EQ(fromHandle(staging.buffer), ringBuffer);
+    EXPECT_EQ(staging.offset, 0U);
+    EXPECT_EQ(ktxVulkanStaging_Release(&staging, 4), KTX_SUCCESS);
+
+    // Every upload received its own data.
+    for (int i = 1; i < 4; i++)
+        waitAndDestroyFence(&vdi, fences[i]);
+    for (int i = 0; i < 4; i++)
+        expectUploaded(textures[i], vkTextures[i]);
+
+    ktxVulkanStagingRing_Retire(ring, 2);
+    EXPECT_EQ(fake.buffers.count(ownBuffer), 1U);
+    ktxVulkanStagingRing_Retire(ring, 4);
+    EXPECT_EQ(fake.buffers.count(ownBuffer), 0U);
+
+    // With everything retired the whole ring is available again.
+    ktxVulkanTexture_Destruct(&vkTextures[0], vdi.device, nullptr);
+    recordAndSubmit(&vdi, ring, textures[0], &vkTextures[0], &staging,
+                    &fences[0]);
+    EXPECT_EQ(fromHandle(staging.buffer), ringBuffer);
+    EXPECT_EQ(staging.offset, 0U);
+    waitAndDestroyFence(&vdi, fences[0]);
+    expectUploaded(textures[0], vkTextures[0]);
+    ktxVulkanStaging_Destruct(&staging, vdi.device, nullptr);
+
+    ktxVulkanStagingRing_Destroy(ring);
+    for (int i = 0; i < 4; i++) {
+        ktxVulkanTexture_Destruct(&vkTextures[i], vdi.device, nullptr);
+        ktxTexture_Destroy(ktxTexture(textures[i]));
+    }
+}
+
+// Destroying a ring frees staging buffers released to it but not yet
+// retired.
+TEST_F(VkUploadTest, StagingRingDestroyDeferred) {
+    ktxVulkanStagingRing* ring;
+    ASSERT_EQ(ktxVulkanStagingRing_Create(&vdi, 512, &ring), KTX_SUCCESS);
+    ktxTexture2* texture = createTexture(16, 16, 1);
+    ASSERT_TRUE(texture != nullptr);
+    ktxVulkanTexture vkTexture;
+    ktxVulkanStaging staging;
+    VkFence fence;
+    recordAndSubmit(&vdi, ring, texture, &vkTexture, &staging, &fence);
+    EXPECT_FALSE(staging.memory == VK_NULL_HANDLE);
+    EXPECT_EQ(ktxVulkanStaging_Release(&staging, 1), KTX_SUCCESS);
+    waitAndDestroyFence(&vdi, fence);
+    expectUploaded(texture, vkTexture);
+    ktxVulkanStagingRing_Destroy(ring);
+    ktxVulkanTexture_Destruct(&vkTexture, vdi.device, nullptr);
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+// Fail each fallible Vulkan call of an upload in turn and check that no
+// objects are left behind.
+static void
+failEachCall(ktxVulkanDeviceInfo* vdi, VkImageTiling tiling)
+{
+    ktxTexture2* texture = createTexture(16, 16, 5);
+    ASSERT_TRUE(texture != nullptr);
+    ktxVulkanTexture vkTexture;
+
+    // Count the calls made by a successful upload.
+    fake.failAt = 0;
+    fake.fallibleCalls = 0;
+    ASSERT_EQ(ktxTexture2_VkUploadEx(texture, vdi, &vkTexture, tiling,
+                                     VK_IMAGE_USAGE_SAMPLED_BIT,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+              KTX_SUCCESS);
+    ktxVulkanTexture_Destruct(&vkTexture, vdi->device, nullptr);
+    int calls = fake.fallibleCalls;
+    ASSERT_GT(calls, 0);
+
+    for (int failAt = 1; failAt <= calls; failAt++) {
+        fake.failAt = failAt;
+        fake.fallibleCalls = 0;
+        EXPECT_NE(ktxTexture2_VkUploadEx(texture, vdi, &vkTexture, tiling,
+                                         VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+                  KTX_SUCCESS) << "Call " << failAt << " failed";
+        EXPECT_EQ(fake.liveObjects(), 0U)
+            << "Leak after failing call " << failAt;
+        for (const auto& m : fake.memories)
+            EXPECT_FALSE(m.second.mapped);
+    }
+    fake.failAt = 0;
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TEST_F(VkUploadTest, NoLeaksOnErrorOptimal) {
+    failEachCall(&vdi, VK_IMAGE_TILING_OPTIMAL);
+}
+
+TEST_F(VkUploadTest, NoLeaksOnErrorLinear) {
+    failEachCall(&vdi, VK_IMAGE_TILING_LINEAR);
+}
+
+} // namespace
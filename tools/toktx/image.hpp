@@ -16,8 +16,12 @@
 #define IMAGE_HPP
 
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <KHR/khr_df.h>
 
@@ -447,6 +451,14 @@ class Image {
                           float filter_scale = 1.0f,
                           basisu::Resampler::Boundary_Op wrapMode
                           = basisu::Resampler::Boundary_Op::BOUNDARY_CLAMP) = 0;
+    virtual std::vector<Image*> createMipmaps(uint32_t numLevels,
+                          bool srgb = false,
+                          const char *pFilter = "lanczos4",
+                          float filter_scale = 1.0f,
+                          basisu::Resampler::Boundary_Op wrapMode
+                          = basisu::Resampler::Boundary_Op::BOUNDARY_CLAMP,
+                          bool cascade = false,
+                          uint32_t threadCount = 1) = 0;
     virtual Image& yflip() = 0;
     virtual Image& transformOETF(OETFFunc decode, OETFFunc encode,
                                  float gamma = 1.0f) = 0;
@@ -686,6 +698,212 @@ class ImageT : public Image {
           delete resamplers[i];
     }
 
+    // Resample a single component plane. Planes hold linear values in
+    // [0, 1]. Each output line is passed to storeLine(dst_y, samples) as
+    // soon as the resampler produces it so no output plane is needed.
+    template<typename StoreLine>
+    static void resamplePlane(const float* src, uint32_t src_w, uint32_t src_h,
+                              uint32_t dst_w, uint32_t dst_h,
+                              const char *pFilter, float filter_scale,
+                              basisu::Resampler::Boundary_Op wrapMode,
+                              StoreLine storeLine)
+    {
+        using namespace basisu;
+
+        Resampler resampler(src_w, src_h, dst_w, dst_h,
+                            wrapMode,
+                            0.0f, 1.0f,
+                            pFilter, nullptr, nullptr,
+                            filter_scale, filter_scale,
+                            0, 0);
+        checkResamplerStatus(resampler, pFilter);
+
+        uint32_t dst_y = 0;
+        for (uint32_t src_y = 0; src_y < src_h; ++src_y)
+        {
+            if (!resampler.put_line(&src[src_y * src_w]))
+                checkResamplerStatus(resampler, pFilter);
+
+            const float* pOutput_samples;
+            while ((pOutput_samples = resampler.get_line()) != nullptr)
+                storeLine(dst_y++, pOutput_samples);
+        }
+    }
+
+    // Generate levels 1 to numLevels - 1 of a mipmap pyramid with this
+    // image as the base level. The caller owns the returned images.
+    //
+    // The base image is converted to linear float planes, one per
+    // component, once. By default each level is resampled from the base
+    // level, giving the same result as resample(). If cascade is true each
+    // level is resampled from the float planes of the previous level, which
+    // is much cheaper for large images and wide filters such as lanczos4 at
+    // a small cost in quality. Components, and levels too when not
+    // cascading, are resampled on up to threadCount threads.
+    //
+    // Resampled lines are converted to the output format as they are
+    // produced. Only the planes of the level being resampled from are kept
+    // plus, when cascading, those of the level being made, which replace
+    // them once it is done.
+    virtual std::vector<Image*> createMipmaps(uint32_t numLevels, bool srgb,
+                          const char *pFilter, float filter_scale,
+                          basisu::Resampler::Boundary_Op wrapMode,
+                          bool cascade, uint32_t threadCount)
+    {
+        const uint32_t comps = getComponentCount();
+        std::vector<Image*> levels;
+        if (numLevels < 2)
+            return levels;
+
+        if (::maximum(width, height) > BASISU_RESAMPLER_MAX_DIMENSION)
+        {
+            std::stringstream message;
+            message << "Image larger than max supported size of "
+                    << BASISU_RESAMPLER_MAX_DIMENSION;
+            throw std::runtime_error(message.str());
+        }
+
+        float srgb_to_linear_table[256];
+        if (srgb) {
+          for (int i = 0; i < 256; ++i)
+            srgb_to_linear_table[i] = decode_sRGB((float)i * (1.0f/255.0f));
+        }
+
+        const int LINEAR_TO_SRGB_TABLE_SIZE = 8192;
+        uint8_t linear_to_srgb_table[LINEAR_TO_SRGB_TABLE_SIZE];
+        if (srgb)
+        {
+            for (int i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; ++i)
+              linear_to_srgb_table[i] = (uint8_t)cclamp<int>((int)(255.0f * encode_sRGB((float)i * (1.0f / (LINEAR_TO_SRGB_TABLE_SIZE - 1))) + .5f), 0, 255);
+        }
+
+        // Planes of the level being resampled from, srcPlanes[component].
+        std::vector<std::vector<float>> srcPlanes(comps);
+        for (uint32_t ci = 0; ci < comps; ++ci)
+            srcPlanes[ci].resize(getPixelCount());
+
+        for (uint32_t i = 0; i < getPixelCount(); ++i)
+        {
+            for (uint32_t ci = 0; ci < comps; ++ci)
+            {
+                const uint32_t v = pixels[i][ci];
+
+                if (!srgb || (ci == 3))
+                    srcPlanes[ci][i] = v * (1.0f / 255.0f);
+                else
+                    srcPlanes[ci][i] = srgb_to_linear_table[v];
+            }
+        }
+
+        // Convert one resampled line of component ci of dst.
+        auto convertLine = [&](ImageT* dst, uint32_t ci, uint32_t y,
+                               const float* pSamples) {
+            const bool linear_flag = !srgb || (ci == 3);
+            Color* pDst = &dst->pixels[y * dst->getWidth()];
+
+            for (uint32_t x = 0; x < dst->getWidth(); x++, pDst++)
+            {
+                // TODO: Add dithering
+                if (linear_flag) {
+                    int j = (int)(255.0f * pSamples[x] + .5f);
+                    pDst->set(ci, (componentType)cclamp<int>(j, 0, Color::one()));
+                } else {
+                    int j = (int)((LINEAR_TO_SRGB_TABLE_SIZE - 1) * pSamples[x] + .5f);
+                    pDst->set(ci, (componentType)linear_to_srgb_table[cclamp<int>(j, 0, LINEAR_TO_SRGB_TABLE_SIZE - 1)]);
+                }
+            }
+        };
+
+        // Run resampling tasks, each producing one component of one level,
+        // from first to last on up to threadCount threads. Tasks write
+        // different components so they never write the same byte. If
+        // nextPlanes is not null the float lines of lastLevel are kept there
+        // too.
+        auto runTasks = [&](uint32_t firstLevel, uint32_t lastLevel,
+                            std::vector<std::vector<float>>* nextPlanes) {
+            const uint32_t taskCount = (lastLevel - firstLevel + 1) * comps;
+            const uint32_t srcLevel = cascade ? firstLevel - 1 : 0;
+            const uint32_t src_w = ::maximum<uint32_t>(1, width >> srcLevel);
+            const uint32_t src_h = ::maximum<uint32_t>(1, height >> srcLevel);
+            std::atomic<uint32_t> nextTask(0);
+            std::exception_ptr error;
+            std::mutex errorMutex;
+
+            auto work = [&]() {
+                for (uint32_t t; (t = nextTask++) < taskCount; )
+                {
+                    const uint32_t level = firstLevel + t / comps;
+                    const uint32_t ci = t % comps;
+                    ImageT* dst = static_cast<ImageT*>(levels[level - 1]);
+                    const uint32_t dst_w = dst->getWidth();
+                    float* next = nextPlanes ? (*nextPlanes)[ci].data()
+                                             : nullptr;
+                    try {
+                        resamplePlane(srcPlanes[ci].data(), src_w, src_h,
+                                      dst_w, dst->getHeight(),
+                                      pFilter, filter_scale, wrapMode,
+                                      [&](uint32_t y, const float* pSamples) {
+                            convertLine(dst, ci, y, pSamples);
+                            if (next)
+                                memcpy(&next[y * dst_w], pSamples,
+                                       dst_w * sizeof(float));
+                        });
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (!error)
+                            error = std::current_exception();
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            const uint32_t threadsToStart = ::minimum(threadCount, taskCount);
+            for (uint32_t i = 1; i < threadsToStart; ++i)
+                threads.emplace_back(work);
+            work();
+            for (auto& thread : threads)
+                thread.join();
+            if (error)
+                std::rethrow_exception(error);
+        };
+
+        try {
+            for (uint32_t level = 1; level < numLevels; level++)
+            {
+                ImageT* dst = new ImageT(::maximum<uint32_t>(1, width >> level),
+                                         ::maximum<uint32_t>(1, height >> level));
+                levels.push_back(dst);
+                dst->setOetf(oetf);
+                dst->setColortype(colortype);
+                dst->setPrimaries(primaries);
+            }
+
+            if (cascade) {
+                for (uint32_t level = 1; level < numLevels; level++)
+                {
+                    // The last level is not a source so keep no planes.
+                    std::vector<std::vector<float>> nextPlanes;
+                    if (level + 1 < numLevels) {
+                        nextPlanes.resize(comps);
+                        for (uint32_t ci = 0; ci < comps; ++ci)
+                            nextPlanes[ci].resize(levels[level - 1]->getPixelCount());
+                    }
+                    runTasks(level, level,
+                             nextPlanes.empty() ? nullptr : &nextPlanes);
+                    // Frees the previous level's planes.
+                    srcPlanes.swap(nextPlanes);
+                }
+            } else {
+                runTasks(1, numLevels - 1, nullptr);
+            }
+        } catch (...) {
+            for (Image* level : levels)
+                delete level;
+            throw;
+        }
+        return levels;
+    }
+
     virtual ImageT& yflip() {
         uint32_t rowSize = width * sizeof(Color);
         // Minimize memory use by only buffering a single row.
@@ -0,0 +1,136 @@
+// -*- tab-width: 4; -*-
+// vi: set sw=2 ts=4 expandtab:
+
+// Copyright 2023 The Khronos Group Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+//!
+//! @internal
+//! @~English
+//! @file inputdecoder.cc
+//!
+//! @brief Decode input image files on worker threads ahead of their use.
+//!
+
+#include "stdafx.h"
+
+#include "inputdecoder.hpp"
+
+InputDecoder::~InputDecoder()
+{
+    finish();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    workReady.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+void
+InputDecoder::start(const std::vector<_tstring>& fileList, bool transform,
+                    Image::rescale_e rescaleMode, uint32_t threadCount)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    files = fileList;
+    slots.assign(files.size(), slot());
+    transformOETF = transform;
+    rescale = rescaleMode;
+    nextToDecode = nextToReturn = 0;
+    limit = files.size();
+    // With one thread, or one file, there is nothing to overlap so decode
+    // each file on the calling thread when next() asks for it.
+    if (threadCount < 2 || files.size() < 2) {
+        limit = 0;
+        return;
+    }
+    window = 2 * (size_t)threadCount;
+    lock.unlock();
+
+    // Threads are only ever added, so a later texture with a lower thread
+    // count than an earlier one may use more threads than it asked for.
+    // window still bounds the number of images in memory.
+    try {
+        while (threads.size() < threadCount)
+            threads.emplace_back(&InputDecoder::worker, this);
+    } catch (const std::exception&) {
+        // Continue with however many threads were started. next() decodes
+        // on the calling thread if there are none.
+    }
+    workReady.notify_all();
+}
+
+Image*
+InputDecoder::decode(size_t index)
+{
+    return Image::CreateFromFile(files[index], transformOETF, rescale);
+}
+
+void
+InputDecoder::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        workReady.wait(lock, [&] {
+            return stop || (nextToDecode < limit
+                            && nextToDecode < nextToReturn + window);
+        });
+        if (stop)
+            return;
+        size_t index = nextToDecode++;
+        inFlight++;
+        lock.unlock();
+
+        Image* image = nullptr;
+        std::exception_ptr error;
+        try {
+            image = decode(index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        slots[index].image = image;
+        slots[index].error = error;
+        slots[index].done = true;
+        inFlight--;
+        imageReady.notify_all();
+    }
+}
+
+Image*
+InputDecoder::next()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t index = nextToReturn++;
+
+    if (index >= limit || threads.empty()) {
+        // Not handed to the threads.
+        lock.unlock();
+        return decode(index);
+    }
+    workReady.notify_all();     // The window has moved.
+    imageReady.wait(lock, [&] { return slots[index].done; });
+    Image* image = slots[index].image;
+    std::exception_ptr error = slots[index].error;
+    slots[index].image = nullptr;
+    lock.unlock();
+
+    if (error)
+        std::rethrow_exception(error);
+    return image;
+}
+
+void
+InputDecoder::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    limit = 0;
+    imageReady.wait(lock, [&] { return inFlight == 0; });
+    for (auto& s : slots)
+        delete s.image;
+    slots.clear();
+    files.clear();
+    nextToDecode = nextToReturn = 0;
+}
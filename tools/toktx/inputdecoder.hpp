@@ -0,0 +1,76 @@
+// -*- tab-width: 4; -*-
+// vi: set sw=2 ts=4 expandtab:
+
+// Copyright 2023 The Khronos Group Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+//!
+//! @internal
+//! @~English
+//! @file inputdecoder.hpp
+//!
+//! @brief Decode input image files on worker threads ahead of their use.
+//!
+
+#ifndef INPUTDECODER_HPP
+#define INPUTDECODER_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "image.hpp"
+
+//!
+//! @internal
+//! @brief Decodes a list of files with Image::CreateFromFile on a set of
+//!        threads, handing the images back in list order.
+//!
+//! At most a small multiple of the thread count of images are decoded but
+//! not yet taken by next() so memory use is bounded however long the list.
+//! The threads persist across calls to start() so one decoder can serve
+//! many textures.
+//!
+class InputDecoder {
+  public:
+    InputDecoder() { }
+    ~InputDecoder();
+
+    //! Begin decoding @p files. Any previous list must have been finished.
+    void start(const std::vector<_tstring>& files, bool transformOETF,
+               Image::rescale_e rescale, uint32_t threadCount);
+    //! Return the next image in list order, waiting for it if necessary.
+    //! Rethrows any exception raised while decoding it.
+    Image* next();
+    //! Stop decoding the current list and free images not taken by next().
+    void finish();
+
+  protected:
+    struct slot {
+        Image* image = nullptr;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    void worker();
+    Image* decode(size_t index);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable imageReady;
+    std::vector<_tstring> files;
+    std::vector<slot> slots;
+    bool transformOETF = false;
+    Image::rescale_e rescale = Image::eNoRescale;
+    size_t nextToDecode = 0;    // Index of next file to hand to a thread.
+    size_t nextToReturn = 0;    // Index of next image next() will return.
+    size_t limit = 0;           // Files at or after this are not decoded.
+    size_t window = 1;          // Max images decoded ahead of nextToReturn.
+    uint32_t inFlight = 0;      // Files being decoded.
+    bool stop = false;
+};
+
+#endif /* INPUTDECODER_HPP */
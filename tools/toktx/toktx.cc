@@ -16,6 +16,8 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <inttypes.h>
@@ -27,6 +29,7 @@
 #include "argparser.h"
 #include "version.h"
 #include "image.hpp"
+#include "inputdecoder.hpp"
 #if (IMAGE_DEBUG) && defined(_DEBUG) && defined(_WIN32) && !defined(_WIN32_WCE)
 #  include "imdebug.h"
 #elif defined(IMAGE_DEBUG) && IMAGE_DEBUG
@@ -80,6 +83,7 @@ Create a KTX file from JPEG, PNG or netpbm format files.
 
 @section toktx_synopsis SYNOPSIS
     toktx [options] @e outfile [@e infile.{jpg,png,pam,pgm,ppm} ...]
+    toktx --batch @e manifest [options]
 
 @section toktx_description DESCRIPTION
     Create a Khronos format texture file (KTX) from a set of JPEG (.jpg),
@@ -94,6 +98,10 @@ Create a KTX file from JPEG, PNG or netpbm format files.
     If '\@@' is used instead, paths must be absolute or relative to the location
     of the list file.
 
+    Input files are decoded on up to @b --threads threads while earlier
+    images are being processed. At most twice that number of decoded images
+    are held in memory at once.
+
     The target texture type (number of components in the output texture) is
     chosen via @b --target_type. Swizzling of the components of the input
     file is specified with @b --input_swizzle and swizzzle metadata can be
@@ -152,6 +160,16 @@ Create a KTX file from JPEG, PNG or netpbm format files.
     <dt>--2d</dt>
     <dd>If the image height is 1, by default a KTX file for a 1D texture is
         created. With this option one for a 2D texture is created instead.</dd>
+    <dt>--batch @e manifest</dt>
+    <dd>Create several KTX files in one run. Each non-blank line of the text
+        file @e manifest not starting with '#' holds the options, @e outfile
+        and @e infiles for one KTX file, as they would be given on the
+        command line. Arguments are separated by white space so paths in
+        the manifest cannot contain spaces. Any other options given on the
+        command line are applied to every line before the line's own. The
+        lines are processed in order and processing stops at the first one
+        that fails. Running one process amortizes encoder initialization and
+        the input decoding threads across all the files.</dd>
     <dt>--automipmap</dt>
     <dd>Causes the KTX file to be marked to request generation of a mipmap
         pyramid when the file is loaded. This option is mutually exclusive
@@ -188,7 +206,14 @@ Create a KTX file from JPEG, PNG or netpbm format files.
         <dt>--wmode &lt;mode&gt;</dt>
         <dd>Specify how to sample pixels near the image boundaries. Values
             are @e wrap, @e reflect and @e clamp. The default is @e clamp.</dd>
+        <dt>--cascade</dt>
+        <dd>Generate each level from the previous level instead of from the
+            base level. This is much faster for large images, particularly
+            with wide filters such as @e lanczos4, at a small cost in quality.
+            </dd>
         </dl>
+        Levels are generated using the number of threads set by
+        @b --threads.
     </dd>
     <dt>--layers &lt;number&gt;</dt>
     <dd>KTX file is for an array texture with @e number of layers where
@@ -339,15 +364,20 @@ class toktxApp : public scApp {
     virtual bool processOption(argparser& parser, int opt);
     void processEnvOptions();
     void validateOptions();
+    int batch(int argc, _TCHAR* argv[], int batchArg);
+
+    bool inBatch = false;
 
     struct commandOptions : public scApp::commandOptions {
         struct mipgenOptions {
             string filter;
             float filterScale;
             enum basisu::Resampler::Boundary_Op wrapMode;
+            int cascade;
 
             mipgenOptions() : filter("lanczos4"), filterScale(1.0),
-                  wrapMode(basisu::Resampler::Boundary_Op::BOUNDARY_CLAMP) { }
+                  wrapMode(basisu::Resampler::Boundary_Op::BOUNDARY_CLAMP),
+                  cascade(0) { }
         };
 
         int          automipmap;
@@ -416,6 +446,7 @@ toktxApp::toktxApp() : scApp(myversion, mydefversion, options)
         { "filter", argparser::option::required_argument, NULL, 'f' },
         { "fscale", argparser::option::required_argument, NULL, 'F' },
         { "wrapping", argparser::option::required_argument, NULL, 'w' },
+        { "cascade", argparser::option::no_argument, &options.gmopts.cascade, 1 },
         { "depth", argparser::option::required_argument, NULL, 'd' },
         { "layers", argparser::option::required_argument, NULL, 'a' },
         { "levels", argparser::option::required_argument, NULL, 'l' },
@@ -444,6 +475,11 @@ toktxApp::toktxApp() : scApp(myversion, mydefversion, options)
 }
 
 toktxApp theApp;
+// The app whose options govern warnings. Differs from theApp while a
+// --batch entry is being converted.
+static toktxApp* activeApp = &theApp;
+// Shared by all the textures made by a --batch run.
+static InputDecoder inputDecoder;
 
 // I really HATE this duplication of text but I cannot find a simple way to
 // avoid it that works on all platforms (e.g running man toktx) even if I was
@@ -453,6 +489,7 @@ toktxApp::usage()
 {
     cerr <<
         "Usage: " << name << " [options] <outfile> [<infile>.{jpg,png,pam,pgm,ppm} ...]\n"
+        "       " << name << " --batch <manifest> [options]\n"
         "\n"
         "  <outfile>    The destination ktx file. \".ktx\" will appended if necessary.\n"
         "               If it is '-' the output will be written to stdout.\n"
@@ -465,6 +502,10 @@ toktxApp::usage()
         "               is used instead, paths must be absolute or relative to the\n"
         "               location of the list file.\n"
         "\n"
+        "  Input files are decoded on up to --threads threads while earlier images\n"
+        "  are being processed. At most twice that number of decoded images are held\n"
+        "  in memory at once.\n"
+        "\n"
         "  The target texture type (number of components in the output texture) is chosen\n"
         "  via --target_type. Swizzling of the components of the input file is specified\n"
         "  with --input_swizzle and swizzle metadata can be specified with --swizzle\n"
@@ -498,6 +539,17 @@ toktxApp::usage()
         "  --2d         If the image height is 1, by default a KTX file for a 1D\n"
         "               texture is created. With this option one for a 2D texture is\n"
         "               created instead.\n"
+        "  --batch <manifest>\n"
+        "               Create several KTX files in one run. Each non-blank line of the\n"
+        "               text file <manifest> not starting with '#' holds the options,\n"
+        "               <outfile> and <infile>s for one KTX file, as they would be given\n"
+        "               on the command line. Arguments are separated by white space so\n"
+        "               paths in the manifest cannot contain spaces. Any other options\n"
+        "               given on the command line are applied to every line before the\n"
+        "               line's own. The lines are processed in order and processing\n"
+        "               stops at the first one that fails. Running one process amortizes\n"
+        "               encoder initialization and the input decoding threads across\n"
+        "               all the files.\n"
         "  --automipmap Causes the KTX file to be marked to request generation of a\n"
         "               mipmap pyramid when the file is loaded. This option is mutually\n"
         "               exclusive with --genmipmap, --levels and --mipmap.\n"
@@ -530,6 +582,11 @@ toktxApp::usage()
         "      --wmode <mode>\n"
         "               Specify how to sample pixels near the image boundaries. Values\n"
         "               are wrap, reflect and clamp. The default is clamp.\n"
+        "      --cascade\n"
+        "               Generate each level from the previous level instead of from\n"
+        "               the base level. This is much faster for large images,\n"
+        "               particularly with wide filters such as lanczos4, at a small\n"
+        "               cost in quality.\n"
         "  --layers <number>\n"
         "               KTX file is for an array texture with number of layers\n"
         "               where number > 0. Provide the file(s) for layer 0 first then\n"
@@ -664,9 +721,28 @@ toktxApp::main(int argc, _TCHAR *argv[])
     };
     string defaultSwizzle;
 
-    processEnvOptions();
-    processCommandLine(argc, argv, eDisallowStdin, eFirst);
-    validateOptions();
+    for (int a = 1; a < argc; a++) {
+        _tstring arg(argv[a]);
+        if (arg == _T("--"))
+            break;
+        if (arg == _T("--batch")) {
+            if (inBatch) {
+                setName(argv[0]);
+                error("--batch cannot be used in a batch manifest.");
+                return 1;
+            }
+            return batch(argc, argv, a);
+        }
+    }
+
+    try {
+        processEnvOptions();
+        processCommandLine(argc, argv, eDisallowStdin, eFirst);
+        validateOptions();
+    } catch (const exitStatus& e) {
+        // Only thrown in a batch. The error has been reported.
+        return e.status;
+    }
 
     memset(&createInfo, 0, sizeof(createInfo));
     if (options.cubemap)
@@ -681,6 +757,17 @@ toktxApp::main(int argc, _TCHAR *argv[])
         createInfo.numLayers = 1;
     }
 
+    Image::rescale_e rescale = Image::eNoRescale;
+    if (options.etc1s || options.bopts.uastc)
+        rescale = Image::rescale_e::eAlwaysRescaleTo8Bits;
+    else if (options.astc)
+        rescale = Image::rescale_e::eRescaleTo8BitsIfLess;
+    // Decode the input files on other threads, in order, while the images
+    // already decoded are processed below.
+    inputDecoder.start(options.infiles,
+                       options.assign_oetf == KHR_DF_TRANSFER_UNSPECIFIED,
+                       rescale, options.threadCount);
+
     faceSlice = layer = level = 0;
     std::vector<_tstring>::const_iterator it;
     uint32_t i;
@@ -692,16 +779,7 @@ toktxApp::main(int argc, _TCHAR *argv[])
 
         Image* image;
         try {
-            Image::rescale_e rescale = Image::eNoRescale;
-            if (options.etc1s || options.bopts.uastc)
-                rescale = Image::rescale_e::eAlwaysRescaleTo8Bits;
-            else if (options.astc)
-                rescale = Image::rescale_e::eRescaleTo8BitsIfLess;
-
-            image =
-              Image::CreateFromFile(infile,
-                                    options.assign_oetf == KHR_DF_TRANSFER_UNSPECIFIED,
-                                    rescale);
+            image = inputDecoder.next();
 
             // If input is > 8bit and user wants LDR issue quality loss warning
             if (options.astc && image->getComponentSize() > 1
@@ -820,7 +898,8 @@ toktxApp::main(int argc, _TCHAR *argv[])
         } catch (exception& e) {
             cerr << name << ": failed to create image from "
                       << infile << ". " << e.what() << endl;
-            exit(2);
+            exitCode = 2;
+            goto cleanup;
         }
 
         /* Sanity check. */
@@ -1177,26 +1256,25 @@ toktxApp::main(int argc, _TCHAR *argv[])
         // necessary to present the base images for each slice to a
         // resampler that can sample across images.
         if (options.genmipmap) {
-            for (uint32_t glevel = 1; glevel < createInfo.numLevels; glevel++)
-            {
-                Image *levelImage = image->createImage(
-                    maximum<uint32_t>(1, image->getWidth() >> glevel),
-                    maximum<uint32_t>(1, image->getHeight() >> glevel));
-                levelImage->setOetf(image->getOetf());
-                levelImage->setColortype(image->getColortype());
-                levelImage->setPrimaries(image->getPrimaries());
-                try {
-                    image->resample(*levelImage,
+            vector<Image*> levelImages;
+            try {
+                levelImages = image->createMipmaps(createInfo.numLevels,
                                     image->getOetf() == KHR_DF_TRANSFER_SRGB,
                                     options.gmopts.filter.c_str(),
                                     options.gmopts.filterScale,
-                                    options.gmopts.wrapMode);
-                } catch (runtime_error& e) {
-                    cerr << name << ": Image::resample() failed! "
-                              << e.what() << endl;
-                    exitCode = 1;
-                    goto cleanup;
-                }
+                                    options.gmopts.wrapMode,
+                                    options.gmopts.cascade != 0,
+                                    options.threadCount);
+            } catch (runtime_error& e) {
+                cerr << name << ": Image::createMipmaps() failed! "
+                          << e.what() << endl;
+                exitCode = 1;
+                goto cleanup;
+            }
+
+            for (uint32_t glevel = 1; glevel < createInfo.numLevels; glevel++)
+            {
+                Image *levelImage = levelImages[glevel - 1];
 
                 if (options.normalize)
                     levelImage->normalize();
@@ -1331,10 +1409,77 @@ closefileandcleanup:
     }
 
 cleanup:
+    inputDecoder.finish();
     if (texture) ktxTexture_Destroy(ktxTexture(texture));
     return exitCode;
 }
 
+/*
+ * @brief Convert each entry of a batch manifest.
+ *
+ * Each non-blank line of the manifest not starting with '#' holds the
+ * options, output file and input files of one texture, exactly as they
+ * would be given on the command line. The options on toktx's own command
+ * line, other than --batch, are prepended to every entry. Processing
+ * stops at the first entry that fails.
+ *
+ * @return the exit code of the failing entry or 0 if all succeeded.
+ *
+ * @param[in] argc      the number of command line arguments.
+ * @param[in] argv      the command line arguments.
+ * @param[in] batchArg  the index in @p argv of "--batch".
+ */
+int
+toktxApp::batch(int argc, _TCHAR* argv[], int batchArg)
+{
+    setName(argv[0]);
+    if (batchArg + 1 >= argc) {
+        error("--batch requires a manifest file.");
+        usage();
+        return 1;
+    }
+    _tstring manifestName(argv[batchArg + 1]);
+    ifstream manifest(manifestName);
+    if (!manifest) {
+        error("could not open batch manifest \"%s\". %s",
+              manifestName.c_str(), strerror(errno));
+        return 2;
+    }
+
+    argvector commonArgs;
+    for (int a = 0; a < argc; a++) {
+        if (a != batchArg && a != batchArg + 1)
+            commonArgs.push_back(argv[a]);
+    }
+
+    string line;
+    for (uint32_t lineNum = 1; getline(manifest, line); lineNum++) {
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == string::npos || line[start] == '#')
+            continue;
+
+        argvector args(commonArgs);
+        argvector entryArgs(line);
+        args.insert(args.end(), entryArgs.begin(), entryArgs.end());
+        vector<_TCHAR*> entryArgv;
+        for (auto& arg : args)
+            entryArgv.push_back(const_cast<_TCHAR*>(arg.c_str()));
+
+        toktxApp entry;
+        entry.inBatch = true;
+        entry.exitThrows = true;
+        activeApp = &entry;
+        int exitCode = entry.main((int)entryArgv.size(), entryArgv.data());
+        activeApp = this;
+        if (exitCode) {
+            cerr << name << ": " << manifestName << ":" << lineNum
+                 << ": conversion failed." << endl;
+            return exitCode;
+        }
+    }
+    return 0;
+}
+
 
 void
 toktxApp::validateOptions()
@@ -1345,12 +1490,12 @@ toktxApp::validateOptions()
         error("only one of --automipmap, --genmipmap and "
               "--mipmap may be specified.");
         usage();
-        exit(1);
+        exitApp(1);
     }
     if ((options.automipmap || options.genmipmap) && options.levels > 1) {
         error("cannot specify --levels > 1 with --automipmap or --genmipmap.");
         usage();
-        exit(1);
+        exitApp(1);
     }
     if (options.cubemap && options.lower_left_maps_to_s0t0) {
         error("cubemaps require images to have an upper-left origin. "
@@ -1360,28 +1505,28 @@ toktxApp::validateOptions()
     if (options.cubemap && options.depth > 0) {
         error("cubemaps cannot have 3D textures.");
         usage();
-        exit(1);
+        exitApp(1);
     }
     if (options.layers && options.depth > 0) {
         error("cannot have 3D array textures.");
         usage();
-        exit(1);
+        exitApp(1);
     }
     if (options.scale != 1.0 && options.resize) {
         error("only one of --scale and --resize can be specified.");
         usage();
-        exit(1);
+        exitApp(1);
     }
     if (options.resize && options.mipmap) {
         error("only one of --resize and --mipmap can be specified.");
         usage();
-        exit(1);
+        exitApp(1);
     }
 
     if (options.depth > 1 && options.genmipmap) {
         error("generation of mipmaps for 3d textures is not supported.\n"
               "A PR to add this feature will be gratefully accepted!");
-        exit(1);
+        exitApp(1);
     }
 
     if (options.outfile.compare(_T("-")) != 0
@@ -1393,7 +1538,7 @@ toktxApp::validateOptions()
     ktx_uint32_t requiredInputFiles = options.cubemap ? 6 : 1 * options.levels;
     if (requiredInputFiles > options.infiles.size()) {
         error("too few input files.");
-        exit(1);
+        exitApp(1);
     }
     /* Whether there are enough input files for all the mipmap levels in
      * a full pyramid can only be checked when the first file has been
@@ -1423,7 +1568,7 @@ toktxApp::processEnvOptions() {
             cerr << "Only options are allowed in the TOKTX_OPTIONS "
                  << "environment variable." << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
     }
 }
@@ -1449,7 +1594,7 @@ toktxApp::processOption(argparser& parser, int opt)
         if (options.layers == 0) {
             cerr << name << ": "
                  << "To create an array texture set --layers > 0." << endl;
-            exit(1);
+            exitApp(1);
         }
         break;
       case 'd':
@@ -1457,7 +1602,7 @@ toktxApp::processOption(argparser& parser, int opt)
         if (options.depth == 0) {
             cerr << name << ": "
                  << "To create a 3d texture set --depth > 0." << endl;
-            exit(1);
+            exitApp(1);
         }
         break;
       case 'l':
@@ -1465,7 +1610,7 @@ toktxApp::processOption(argparser& parser, int opt)
         if (options.levels < 2) {
             cerr << name << ": "
                  << "--levels must be > 1." << endl;
-            exit(1);
+            exitApp(1);
         }
         break;
       case 'f':
@@ -1488,7 +1633,7 @@ toktxApp::processOption(argparser& parser, int opt)
             cerr << "Unrecognized mode \"" << parser.optarg
                  << "\" passed to --wmode" << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         break;
       case 'r':
@@ -1499,7 +1644,7 @@ toktxApp::processOption(argparser& parser, int opt)
             if (iss.fail()) {
                 cerr << "Bad resize geometry." << endl;
                 usage();
-                exit(1);
+                exitApp(1);
             }
             options.resize = 1;
             break;
@@ -1509,7 +1654,7 @@ toktxApp::processOption(argparser& parser, int opt)
         if (options.scale > 2000.0f) {
             cerr << name << ": Unreasonable scale factor of "
                  << options.scale << "." << endl;
-            exit(1);
+            exitApp(1);
         }
         break;
       case 1101:
@@ -1532,7 +1677,7 @@ toktxApp::processOption(argparser& parser, int opt)
             cerr << name << ": unrecognized target_type \"" << parser.optarg
                  << "\"." << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         break;
       case 1103:
@@ -1596,16 +1741,22 @@ void toktxApp::warning(const string& msg) {
     }
 }
 
+// Input files are decoded on several threads so serialize the warnings
+// the image readers issue.
+static std::mutex warningMutex;
+
 void warning(const char *pFmt, ...) {
     va_list args;
     va_start(args, pFmt);
 
-    theApp.warning(pFmt, args);
+    std::lock_guard<std::mutex> lock(warningMutex);
+    activeApp->warning(pFmt, args);
     va_end(args);
 }
 
 void warning(const string& msg) {
-   theApp.warning(msg);
+    std::lock_guard<std::mutex> lock(warningMutex);
+    activeApp->warning(msg);
 }
 
 static ktx_uint32_t
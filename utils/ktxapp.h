@@ -105,6 +105,27 @@ class ktxApp {
         : version(version), defaultVersion(defaultVersion),
           options(options) { }
 
+    // Thrown by exitApp() when exitThrows is set.
+    struct exitStatus {
+        int status;
+    };
+
+    /** @internal
+     * @~English
+     * @brief Exit the program with @p status.
+     *
+     * If @c exitThrows is set an @c exitStatus holding @p status is thrown
+     * instead so an app run from another app's main, as in toktx's batch
+     * mode, can fail without ending the process.
+     */
+    [[noreturn]] void exitApp(int status) {
+        if (exitThrows)
+            throw exitStatus{status};
+        exit(status);
+    }
+
+    bool exitThrows = false;
+
     void error(const char *pFmt, ...) {
         va_list args;
         va_start(args, pFmt);
@@ -154,21 +175,16 @@ class ktxApp {
         if (value == 0 && endptr && *endptr != '\0') {
             cerr << "Argument \"" << endptr << "\" not a number." << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         return value;
     }
 
-    enum StdinUse { eDisallowStdin, eAllowStdin };
-    enum OutfilePos { eNone, eFirst, eLast };
-    void processCommandLine(int argc, _TCHAR* argv[],
-                            StdinUse stdinStat = eAllowStdin,
-                            OutfilePos outfilePos = eNone)
+    void setName(const _TCHAR* argv0)
     {
-        uint32_t i;
         size_t slash, dot;
 
-        name = argv[0];
+        name = argv0;
         // For consistent Id, only use the stem of name;
         slash = name.find_last_of(_T('\\'));
         if (slash == _tstring::npos)
@@ -178,6 +194,17 @@ class ktxApp {
         dot = name.find_last_of(_T('.'));
             if (dot != _tstring::npos)
                 name.erase(dot, _tstring::npos); // Remove extension.
+    }
+
+    enum StdinUse { eDisallowStdin, eAllowStdin };
+    enum OutfilePos { eNone, eFirst, eLast };
+    void processCommandLine(int argc, _TCHAR* argv[],
+                            StdinUse stdinStat = eAllowStdin,
+                            OutfilePos outfilePos = eNone)
+    {
+        uint32_t i;
+
+        setName(argv[0]);
 
         argparser parser(argc, argv);
         processOptions(parser);
@@ -192,7 +219,7 @@ class ktxApp {
                     if (!loadFileList(parser.argv[i],
                                       parser.argv[i][1] == _T('@'),
                                       options.infiles)) {
-                        exit(1);
+                        exitApp(1);
                     }
                 } else {
                     options.infiles.push_back(parser.argv[i]);
@@ -204,7 +231,7 @@ class ktxApp {
                     if (it->compare(_T("-")) == 0) {
                         error("cannot use stdin as one among many inputs.");
                         usage();
-                        exit(1);
+                        exitApp(1);
                     }
                 }
             }
@@ -218,7 +245,7 @@ class ktxApp {
             } else {
                 error("need some input files.");
                 usage();
-                exit(1);
+                exitApp(1);
             }
         }
         if (outfilePos != eNone && options.outfile.empty()) {
@@ -313,18 +340,18 @@ class ktxApp {
                 break;
               case 'h':
                 usage();
-                exit(0);
+                exitApp(0);
               case 'v':
                 printVersion();
-                exit(0);
+                exitApp(0);
               case ':':
                 error("missing required option argument.");
                 usage();
-                exit(0);
+                exitApp(0);
               default:
                 if (!processOption(parser, opt)) {
                     usage();
-                    exit(1);
+                    exitApp(1);
                 }
             }
         }
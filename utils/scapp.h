@@ -373,8 +373,9 @@ astcEncoderMode(const char* mode) {
     <dt>--threads &lt;count&gt;</dt>
                  <dd>Explicitly set the number of threads to use during
                  compression. By default, ETC1S / BasisLZ and ASTC compression
-                 will use the number of threads reported by
-                 thread::hardware_concurrency or 1 if value returned is 0.</dd>
+                 and Zstandard supercompression will use the number of threads
+                 reported by thread::hardware_concurrency or 1 if value
+                 returned is 0.</dd>
     <dt>--verbose</dt>
                  <dd>Print encoder/compressor activity status to stdout.
                  Currently only the astc, etc1s and uastc encoders emit
@@ -448,6 +449,7 @@ class scApp : public ktxApp {
                 noSSE = false;
                 verbose = false; // Default to quiet operation.
                 for (int i = 0; i < 4; i++) inputSwizzle[i] = 0;
+                threadPool = nullptr;
             }
 #define TRAVIS_DEBUG 0
 #if TRAVIS_DEBUG
@@ -503,6 +505,7 @@ class scApp : public ktxApp {
                 qualityLevel.clear();
                 normalMap = false;
                 for (int i = 0; i < 4; i++) inputSwizzle[i] = 0;
+                threadPool = nullptr;
             }
         };
         int          ktx2;
@@ -756,9 +759,9 @@ class scApp : public ktxApp {
           "               should be used with caution as they require more memory.\n"
           "  --threads <count>\n"
           "               Explicitly set the number of threads to use during compression.\n"
-          "               By default, ETC1S / BasisLZ and ASTC compression will use the\n"
-          "               number of threads reported by thread::hardware_concurrency or 1\n"
-          "               if value returned is 0.\n"
+          "               By default, ETC1S / BasisLZ and ASTC compression and Zstandard\n"
+          "               supercompression will use the number of threads reported by\n"
+          "               thread::hardware_concurrency or 1 if value returned is 0.\n"
           "  --verbose\n"
           "               Print encoder/compressor activity status to stdout. Currently\n"
           "               only the astc, etc1s and uastc encoders emit status.\n"
@@ -838,7 +841,7 @@ scApp::validateOptions() {
         cerr << name << ": Both or neither of --max_endpoints and"
              << " --max_selectors must be specified." << endl;
         usage();
-        exit(1);
+        exitApp(1);
     }
     if (options.bopts.qualityLevel
         && (options.bopts.maxEndpoints + options.bopts.maxSelectors)) {
@@ -852,7 +855,7 @@ scApp::validateSwizzle(string& swizzle)
 {
     if (swizzle.size() != 4) {
         error("a swizzle parameter must have 4 characters.");
-        exit(1);
+        exitApp(1);
     }
     std::for_each(swizzle.begin(), swizzle.end(), [](char & c) {
         c = (char)::tolower(c);
@@ -867,7 +870,7 @@ scApp::validateSwizzle(string& swizzle)
             && swizzle[i] != '1') {
             error("invalid character in swizzle.");
             usage();
-            exit(1);
+            exitApp(1);
         }
     }
 }
@@ -886,7 +889,7 @@ scApp::processOption(argparser& parser, int opt)
             cerr << "Only one of '--encode etc1s | --bcmp'  and --zcmp can be specified."
                  << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         options.zcmp = 1;
         options.ktx2 = 1;
@@ -1004,14 +1007,14 @@ scApp::processOption(argparser& parser, int opt)
                  << "--bcmp is deprecated, use '--encode etc1s' instead."
                  << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         if (options.bopts.uastc) {
             cerr << "Only one of --bcmp and '--encode etc1s | --uastc' can be specified.\n"
                  << "--bcmp is deprecated, use '--encode etc1s' instead."
                  << endl;
             usage();
-            exit(1);
+            exitApp(1);
         }
         options.etc1s = 1;
         options.ktx2 = 1;
@@ -1032,7 +1035,7 @@ scApp::processOption(argparser& parser, int opt)
              cerr << "Only one of `--encode etc1s | --bcmp` and `--uastc [<level>]` can be specified."
                   << endl;
              usage();
-             exit(1);
+             exitApp(1);
         }
         options.bopts.uastc = 1;
         options.ktx2 = 1;
@@ -1134,8 +1137,9 @@ scApp::encode(ktxTexture2* texture, const string& swizzle,
     }
     if (KTX_SUCCESS == result) {
         if (options.zcmp) {
-            result = ktxTexture2_DeflateZstd((ktxTexture2*)texture,
-                                              options.zcmpLevel);
+            result = ktxTexture2_DeflateZstdEx((ktxTexture2*)texture,
+                                                options.zcmpLevel,
+                                                options.threadCount);
             if (KTX_SUCCESS != result) {
                 cerr << name << ": Zstd deflation of \"" << filename
                      << "\" failed; KTX error: "